@@ -1,14 +1,147 @@
 #include <jni.h>
-#include "include/Light.h"
+#include <GLES2/gl2.h>
+#include <mutex>
+#include <string>
+#include "include/FrameProfiler.h"
+#include "include/LoadUtil.h"
+#include "include/Scene.h"
+#include "include/SimulationUtil.h"
+#include "include/TextureStream.h"
+
+// 要显示的场景，界面线程通过selectScene修改，渲染线程在下一帧切换，见SceneRegistry.cpp
+static std::mutex sceneMutex;
+static std::string requestedScene = "Light";
+static bool sceneChanged = false;
+static int surfaceWidth = 0;
+static int surfaceHeight = 0;
+
+// 在渲染线程上切换（或重新设置）场景，支持模拟线程的场景在模拟线程上按1/60秒的固定步长更新，和帧率无关
+static void startScene(int width, int height)
+{
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(sceneMutex);
+        name = requestedScene;
+        sceneChanged = false;
+    }
+    if (!selectScene(name.c_str(), width, height))
+    {
+        return;
+    }
+    const Scene* scene = currentScene();
+    if (scene->update != NULL)
+    {
+        // surface大小变化时重新启动，场景状态保留
+        startSimulation(scene->update, scene->writeSnapshot, scene->snapshotBytes, 1.0 / 60.0);
+    }
+}
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_learnopengl_nativecode_NativeRender_init(JNIEnv *env, jobject thiz, jint width, jint height) {
-    setupGraphics(width, height); // 初始化OpenGL ES
+    surfaceWidth = width;
+    surfaceHeight = height;
+    startScene(width, height); // 第一次时加载场景的库并初始化OpenGL ES，之后同一个上下文只调整大小
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_learnopengl_nativecode_NativeRender_setup(JNIEnv *env, jobject thiz) {
-    renderFrame(); // 渲染
-}
\ No newline at end of file
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lock(sceneMutex);
+        changed = sceneChanged;
+    }
+    if (changed)
+    {
+        startScene(surfaceWidth, surfaceHeight); // 释放并卸载原来的场景，加载新选中的
+    }
+    const Scene* scene = currentScene();
+    if (scene == NULL)
+    {
+        return;
+    }
+    if (scene->update == NULL)
+    {
+        beginFrameProfile();
+        scene->render();
+        endFrameProfile();
+        return;
+    }
+    // 渲染线程只取模拟线程最新发布的快照提交绘制，不更新场景，见SimulationUtil.cpp
+    const void* snapshot = latestSimulationSnapshot();
+    if (snapshot != NULL)
+    {
+        beginFrameProfile();
+        scene->renderSnapshot(snapshot); // 渲染
+        endFrameProfile();
+    }
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_learnopengl_nativecode_NativeRender_selectScene(JNIEnv *env, jobject thiz, jstring name) {
+    const char* scene = env->GetStringUTFChars(name, NULL);
+    {
+        std::lock_guard<std::mutex> lock(sceneMutex);
+        requestedScene = scene;
+        sceneChanged = true;
+    }
+    env->ReleaseStringUTFChars(name, scene);
+}
+
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_com_learnopengl_nativecode_NativeRender_getSceneNames(JNIEnv *env, jobject thiz) {
+    // 所有可以选择的场景，不需要加载它们的库
+    jobjectArray result = env->NewObjectArray(sceneCount(), env->FindClass("java/lang/String"), NULL);
+    for (int i = 0; result != NULL && i < sceneCount(); i++)
+    {
+        jstring name = env->NewStringUTF(sceneName(i));
+        env->SetObjectArrayElement(result, i, name);
+        env->DeleteLocalRef(name);
+    }
+    return result;
+}
+
+extern "C"
+JNIEXPORT jfloatArray JNICALL
+Java_com_learnopengl_nativecode_NativeRender_getFrameProfile(JNIEnv *env, jobject thiz) {
+    // 最近几秒各阶段帧时间的分位数，格式见FrameProfiler.h，可以在任意线程调用
+    FrameProfile profile;
+    getFrameProfile(&profile);
+    float packed[frameProfileFloats];
+    packFrameProfile(&profile, packed);
+    jfloatArray result = env->NewFloatArray(frameProfileFloats);
+    if (result != NULL)
+    {
+        env->SetFloatArrayRegion(result, 0, frameProfileFloats, packed);
+    }
+    return result;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_learnopengl_nativecode_NativeRender_setSimulationPaused(JNIEnv *env, jobject thiz, jboolean paused) {
+    setSimulationPaused(paused); // 界面不可见时模拟线程休眠，恢复后不补暂停期间的步数
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_learnopengl_nativecode_NativeRender_setCacheDirectory(JNIEnv *env, jobject thiz, jstring path) {
+    const char* directory = env->GetStringUTFChars(path, NULL);
+    setProgramCacheDirectory(directory); // 着色器程序二进制缓存目录，之后的createProgram会优先从这里加载
+    env->ReleaseStringUTFChars(path, directory);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_learnopengl_nativecode_NativeRender_setTextureFile(JNIEnv *env, jobject thiz, jstring path,
+                                                            jstring fallbackPath) {
+    // lesson3流式加载的纹理文件，下次setup时生效，空字符串表示只用内置纹理
+    const char* file = env->GetStringUTFChars(path, NULL);
+    const char* fallback = env->GetStringUTFChars(fallbackPath, NULL);
+    setSceneTextureFile(file, fallback);
+    env->ReleaseStringUTFChars(fallbackPath, fallback);
+    env->ReleaseStringUTFChars(path, file);
+}
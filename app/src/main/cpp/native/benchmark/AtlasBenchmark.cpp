@@ -0,0 +1,128 @@
+/**
+ * 纹理图集的性能测试：随机生成16到1024张8～128像素的小图片（有2的幂也有不是的），装进1024×1024的页面，
+ * padding 4像素、对齐到8像素（前3级mipmap不会混色）。报告每张图片的装箱耗时（ns/op）、页数、装箱效率，
+ * 以及一帧里每张图片画4次、按随机顺序绘制时，换成图集后每帧少绑定多少次纹理。
+ *
+ * 同时检查装箱结果：图片（含padding）之间不能重叠，页中的像素和原图一致，重映射后的纹理坐标落在图片的区域里。
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../include/AtlasUtil.h"
+
+static const int atlasPageSize = 1024;
+static const int drawsPerImage = 4;
+static const AtlasOptions atlasOptions = {atlasPageSize, 4, 8};
+
+static std::vector<std::vector<unsigned char> > pixels;
+static std::vector<AtlasImage> images;
+static TextureAtlas atlas;
+
+static void benchmarkPack(int count)
+{
+    buildTextureAtlas(&images[0], count, &atlasOptions, &atlas);
+}
+
+// 相同页里两张图片（含padding）不能重叠，页里的像素要和原图一样
+static bool atlasValid(int count)
+{
+    int padding = atlasOptions.padding;
+    for (int i = 0; i < count; i++)
+    {
+        const AtlasEntry& a = atlas.entries[i];
+        for (int j = i + 1; j < count; j++)
+        {
+            const AtlasEntry& b = atlas.entries[j];
+            if (a.page == b.page && a.x - padding < b.x + b.width + padding && b.x - padding < a.x + a.width + padding &&
+                a.y - padding < b.y + b.height + padding && b.y - padding < a.y + a.height + padding)
+            {
+                return false;
+            }
+        }
+        const unsigned char* page = &atlas.pages[a.page][0];
+        for (int row = 0; row < a.height; row++)
+        {
+            if (memcmp(page + ((size_t) (a.y + row) * atlasPageSize + a.x) * 4, images[i].rgba + (size_t) row * a.width * 4,
+                       (size_t) a.width * 4) != 0)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// lesson3正方体的纹理坐标映射到图集后，应该落在图片所在的区域里
+static bool remapValid(int count)
+{
+    static const float cubeCords[] = {1.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f};
+    float remapped[8];
+    for (int i = 0; i < count; i++)
+    {
+        const AtlasEntry& entry = atlas.entries[i];
+        remapAtlasUVs(&entry, cubeCords, 4, remapped);
+        for (int k = 0; k < 4; k++)
+        {
+            float x = remapped[k * 2] * atlasPageSize;
+            float y = remapped[k * 2 + 1] * atlasPageSize;
+            if (x < entry.x - 0.01f || x > entry.x + entry.width + 0.01f || y < entry.y - 0.01f ||
+                y > entry.y + entry.height + 0.01f)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void runAtlasBenchmarks()
+{
+    int maxImages = std::min(1024, benchmarkOptions.maxCount);
+    srand(1);
+    pixels.resize(maxImages);
+    images.resize(maxImages);
+    for (int i = 0; i < maxImages; i++)
+    {
+        static const int sizes[] = {8, 16, 24, 32, 48, 64, 96, 128};
+        int width = sizes[rand() % 8];
+        int height = sizes[rand() % 8];
+        pixels[i].resize((size_t) width * height * 4);
+        for (size_t k = 0; k < pixels[i].size(); k++)
+        {
+            pixels[i][k] = (unsigned char) (rand() & 255);
+        }
+        AtlasImage image = {&pixels[i][0], width, height};
+        images[i] = image;
+    }
+
+    for (int count = 16; count <= maxImages; count *= 4)
+    {
+        benchmarkReport("atlas.pack", count, "nsPerOp", benchmarkMeasure(benchmarkPack, count));
+        buildTextureAtlas(&images[0], count, &atlasOptions, &atlas);
+        benchmarkReport("atlas.pages", count, "pages", atlas.pageCount);
+        benchmarkReport("atlas.efficiency", count, "percent", 100.0 * atlasEfficiency(&atlas));
+        if (!atlasValid(count) || !remapValid(count))
+        {
+            fprintf(stderr, "Texture atlas for %d images is invalid\n", count);
+        }
+        // 每张图片画drawsPerImage次，绘制顺序打乱（场景按物体或深度排序，和纹理无关）
+        std::vector<int> draws(count * drawsPerImage);
+        for (size_t i = 0; i < draws.size(); i++)
+        {
+            draws[i] = (int) (i % count);
+        }
+        for (size_t i = draws.size() - 1; i > 0; i--)
+        {
+            std::swap(draws[i], draws[rand() % (i + 1)]);
+        }
+        int separate = countTextureBinds(&draws[0], (int) draws.size());
+        int atlased = countAtlasBinds(&atlas, &draws[0], (int) draws.size());
+        benchmarkReport("atlas.bindsPerFrame.separate", count, "binds", separate);
+        benchmarkReport("atlas.bindsPerFrame.atlas", count, "binds", atlased);
+        benchmarkReport("atlas.bindsSavedPerFrame", count, "binds", separate - atlased);
+    }
+}
@@ -0,0 +1,162 @@
+/**
+ * 性能测试程序，只在主机（Linux）构建中编译，数学、剔除、mipmap、图集和网格导入部分不需要设备和GPU，GL部分使用Mesa的软件渲染。
+ *
+ * 每组数据先预热一次，然后分5轮，每轮重复运行直到超过minTime/5，取最快的一轮算出平均耗时。
+ * 结果以JSON输出，方便在CI里保存下来比较是否有性能退化。
+ *
+ * 用法：Benchmark [--suite math|cull|mip|atlas|import|index|lod|soft|gl|all] [--max-count N] [--min-time-ms T] [--output file.json]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Benchmark.h"
+#include "../include/SimdUtil.h"
+
+BenchmarkOptions benchmarkOptions = {1000000, 200.0};
+
+static FILE* output = NULL;
+static bool firstResult = true;
+
+double benchmarkNowNanoseconds()
+{
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double benchmarkMeasure(BenchmarkFunction function, int count)
+{
+    double minTimeNanoseconds = benchmarkOptions.minTimeMilliseconds * 1e6;
+    function(count);
+    double best = 0.0;
+    for (int round = 0; round < 5; round++)
+    {
+        long iterations = 0;
+        double start = benchmarkNowNanoseconds();
+        double elapsed = 0.0;
+        do
+        {
+            function(count);
+            iterations++;
+            elapsed = benchmarkNowNanoseconds() - start;
+        } while (elapsed < minTimeNanoseconds / 5);
+        double perOperation = elapsed / ((double)iterations * count);
+        if (round == 0 || perOperation < best)
+        {
+            best = perOperation;
+        }
+    }
+    return best;
+}
+
+void benchmarkReport(const char* name, int count, const char* metric, double value)
+{
+    fprintf(output, "%s    {\"name\": \"%s\", \"count\": %d, \"%s\": %.3f}",
+            firstResult ? "" : ",\n", name, count, metric, value);
+    firstResult = false;
+    fflush(output);
+}
+
+static const char* simdBackendName()
+{
+#if defined(SIMD_NEON)
+    return "neon";
+#elif defined(SIMD_AVX)
+    return "avx";
+#elif defined(SIMD_SSE)
+    return "sse";
+#else
+    return "scalar";
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    const char* suite = "all";
+    const char* outputPath = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--suite") == 0 && i + 1 < argc)
+        {
+            suite = argv[++i];
+        }
+        else if (strcmp(argv[i], "--max-count") == 0 && i + 1 < argc)
+        {
+            benchmarkOptions.maxCount = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc)
+        {
+            benchmarkOptions.minTimeMilliseconds = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+        {
+            outputPath = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--suite math|cull|mip|atlas|import|index|lod|soft|gl|all] [--max-count N] [--min-time-ms T] [--output file.json]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (benchmarkOptions.maxCount < 1)
+    {
+        benchmarkOptions.maxCount = 1;
+    }
+
+    output = stdout;
+    if (outputPath != NULL)
+    {
+        output = fopen(outputPath, "w");
+        if (output == NULL)
+        {
+            fprintf(stderr, "Could not open %s\n", outputPath);
+            return 1;
+        }
+    }
+    fprintf(output, "{\n  \"simd\": \"%s\",\n  \"minTimeMs\": %g,\n  \"results\": [\n",
+            simdBackendName(), benchmarkOptions.minTimeMilliseconds);
+    bool all = strcmp(suite, "all") == 0;
+    if (all || strcmp(suite, "math") == 0)
+    {
+        runMathBenchmarks();
+    }
+    if (all || strcmp(suite, "cull") == 0)
+    {
+        runCullBenchmarks();
+    }
+    if (all || strcmp(suite, "mip") == 0)
+    {
+        runMipBenchmarks();
+    }
+    if (all || strcmp(suite, "atlas") == 0)
+    {
+        runAtlasBenchmarks();
+    }
+    if (all || strcmp(suite, "import") == 0)
+    {
+        runImportBenchmarks();
+    }
+    if (all || strcmp(suite, "index") == 0)
+    {
+        runIndexBenchmarks();
+    }
+    if (all || strcmp(suite, "lod") == 0)
+    {
+        runLodBenchmarks();
+    }
+    if (all || strcmp(suite, "soft") == 0)
+    {
+        runSoftBenchmarks();
+    }
+    if ((all || strcmp(suite, "gl") == 0) && !runGLBenchmarks())
+    {
+        fprintf(stderr, "No GLES context available, skipping GL benchmarks\n");
+    }
+    fprintf(output, "\n  ]\n}\n");
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+    return 0;
+}
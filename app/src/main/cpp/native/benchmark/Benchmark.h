@@ -0,0 +1,52 @@
+#ifndef LEARNOPENGL_BENCHMARK_H
+#define LEARNOPENGL_BENCHMARK_H
+
+#include <string>
+#include <vector>
+
+// 性能测试公共部分，测试项按套件分文件放在native/benchmark下，结果统一由benchmarkReport输出成JSON
+
+typedef void (*BenchmarkFunction)(int count);
+
+struct BenchmarkOptions
+{
+    int maxCount; // 数量类测试项的最大规模
+    double minTimeMilliseconds; // 每组数据至少运行的时间
+};
+extern BenchmarkOptions benchmarkOptions;
+
+double benchmarkNowNanoseconds();
+// 测一组数据，返回每个元素的平均耗时（ns）
+double benchmarkMeasure(BenchmarkFunction function, int count);
+// 输出一条结果，metric是字段名，例如nsPerOp、hits
+void benchmarkReport(const char* name, int count, const char* metric, double value);
+
+void runMathBenchmarks();
+void runCullBenchmarks();
+// 1K到8K图片的mipmap链生成，不受maxCount限制
+void runMipBenchmarks();
+void runAtlasBenchmarks();
+// 生成约13万和210万个三角形的OBJ、glb文件测导入吞吐量，不受maxCount限制
+void runImportBenchmarks();
+// 写出n×n个四边形的网格面片，GLBenchmark用它比较网格缓存和解析源文件的启动耗时
+bool writeGridObj(const std::string& path, int n);
+bool writeGridGlb(const std::string& path, int n);
+// 约210万个三角形的索引优化，不受maxCount限制
+void runIndexBenchmarks();
+// 约26万个三角形的UV球生成LOD链，不受maxCount限制
+void runLodBenchmarks();
+// segments×rings段的单位UV球，首尾两列位置相同、纹理坐标不同（接缝），GLBenchmark用它测运行时的LOD选择
+struct SphereMesh
+{
+    int vertexCount;
+    std::vector<float> positions;
+    std::vector<float> attributes; // 每个顶点法线3个、纹理坐标2个
+    std::vector<unsigned int> indices;
+};
+void createSphere(SphereMesh* sphere, int segments, int rings);
+// 软件光栅化的三角形和像素吞吐量，不受maxCount限制
+void runSoftBenchmarks();
+// 需要GLES上下文，没有可用的EGL时跳过，返回false
+bool runGLBenchmarks();
+
+#endif //LEARNOPENGL_BENCHMARK_H
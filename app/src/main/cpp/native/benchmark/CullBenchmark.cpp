@@ -0,0 +1,94 @@
+/**
+ * 视锥剔除的性能测试：物体随机分布在一个2000×100×2000的世界里，相机在原点看向Z轴负方向，远平面100，
+ * 绝大部分物体都不在视野里。分别测层次剔除和逐个测试（SIMD）每个物体的平均耗时（ns/op），
+ * 以及建立层次的耗时和剔除掉的比例，并检查两种方法得到的可见物体是否一致。
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../include/CameraUtil.h"
+#include "../include/CullUtil.h"
+
+static std::vector<BoundingSphere> spheres;
+static std::vector<float> sphereX;
+static std::vector<float> sphereY;
+static std::vector<float> sphereZ;
+static std::vector<float> sphereRadius;
+static std::vector<int> visible;
+static CullHierarchy hierarchy;
+static Frustum frustum;
+
+static void benchmarkBuild(int count)
+{
+    buildCullHierarchy(&hierarchy, &spheres[0], count);
+}
+
+static void benchmarkHierarchy(int count)
+{
+    cullHierarchy(&hierarchy, &frustum, &visible[0], NULL);
+}
+
+static void benchmarkBruteForce(int count)
+{
+    cullSpheres(&frustum, &sphereX[0], &sphereY[0], &sphereZ[0], &sphereRadius[0], count, &visible[0]);
+}
+
+// 两种方法的可见物体必须完全相同
+static bool sameVisibleSet(int count)
+{
+    int hierarchyVisible = cullHierarchy(&hierarchy, &frustum, &visible[0], NULL);
+    std::vector<int> expected(count);
+    int bruteForceVisible = cullSpheres(&frustum, &sphereX[0], &sphereY[0], &sphereZ[0], &sphereRadius[0], count,
+                                        &expected[0]);
+    if (hierarchyVisible != bruteForceVisible)
+    {
+        return false;
+    }
+    std::sort(visible.begin(), visible.begin() + hierarchyVisible);
+    return std::equal(visible.begin(), visible.begin() + hierarchyVisible, expected.begin());
+}
+
+void runCullBenchmarks()
+{
+    int maxCount = benchmarkOptions.maxCount;
+    srand(1);
+    spheres.resize(maxCount);
+    sphereX.resize(maxCount);
+    sphereY.resize(maxCount);
+    sphereZ.resize(maxCount);
+    sphereRadius.resize(maxCount);
+    visible.resize(maxCount);
+    for (int i = 0; i < maxCount; i++)
+    {
+        BoundingSphere& sphere = spheres[i];
+        sphere.x = (float) (rand() % 20000) / 10.0f - 1000.0f;
+        sphere.y = (float) (rand() % 1000) / 10.0f - 50.0f;
+        sphere.z = (float) (rand() % 20000) / 10.0f - 1000.0f;
+        sphere.radius = 0.5f + (float) (rand() % 100) / 100.0f;
+        sphereX[i] = sphere.x;
+        sphereY[i] = sphere.y;
+        sphereZ[i] = sphere.z;
+        sphereRadius[i] = sphere.radius;
+    }
+    float projection[16];
+    matrixPerspective(projection, 45.0f, 1.5f, 0.1f, 100.0f);
+    extractFrustumPlanes(&frustum, projection); // 视图矩阵是单位矩阵
+
+    for (int count = 1000; count <= maxCount; count *= 10)
+    {
+        benchmarkReport("cullHierarchy.build", count, "nsPerOp", benchmarkMeasure(benchmarkBuild, count));
+        benchmarkReport("cullHierarchy", count, "nsPerOp", benchmarkMeasure(benchmarkHierarchy, count));
+        benchmarkReport("cullSpheres", count, "nsPerOp", benchmarkMeasure(benchmarkBruteForce, count));
+        CullStats stats;
+        cullHierarchy(&hierarchy, &frustum, &visible[0], &stats);
+        benchmarkReport("cullHierarchy.culledPercent", count, "percent", 100.0 * (stats.objects - stats.visible) / stats.objects);
+        benchmarkReport("cullHierarchy.spheresTested", count, "spheres", stats.spheresTested);
+        if (!sameVisibleSet(count))
+        {
+            fprintf(stderr, "cullHierarchy and cullSpheres disagree for %d objects\n", count);
+        }
+    }
+}
@@ -0,0 +1,1444 @@
+/**
+ * 需要GLES上下文的性能测试，在主机上通过EGL使用Mesa的llvmpipe运行。
+ */
+#include <GLES3/gl3.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../include/AtlasUtil.h"
+#include "../include/HostContext.h"
+#include "../include/CameraUtil.h"
+#include "../include/InstancedCube.h"
+#include "../include/LoadUtil.h"
+#include "../include/MeshCache.h"
+#include "../include/MeshImport.h"
+#include "../include/MeshSimplify.h"
+#include "../include/RenderQueue.h"
+#include "../include/Scene.h"
+#include "../include/ShaderVariant.h"
+#include "../include/StateCache.h"
+#include "../include/TextureStream.h"
+#include "../include/UniformBlocks.h"
+
+static const int benchmarkContextSize = 256;
+
+// 与lesson4的光照着色器规模相近
+static const char benchmarkVertexShader[] =
+        "attribute vec3 vertexNormal;\n"
+        "attribute vec4 vertexPosition;\n"
+        "attribute vec3 vertexColour;\n"
+        "varying vec3 fragColour;\n"
+        "uniform mat4 projection;\n"
+        "uniform mat4 modelView;\n"
+        "void main()\n"
+        "{\n"
+        "    vec3 transformedVertexNormal = normalize((modelView * vec4(vertexNormal, 0.0)).xyz);\n"
+        "    vec3 inverseLightDirection = normalize(vec3(0.0, 1.0, 1.0));\n"
+        "    float normalDotLight = max(0.0, dot(transformedVertexNormal, inverseLightDirection));\n"
+        "    fragColour = normalDotLight * vertexColour + vertexColour * 0.1;\n"
+        "    vec3 lightReflectionDirection = reflect(vec3(0) - inverseLightDirection, transformedVertexNormal);\n"
+        "    float normalDotReflection = max(0.0, dot(vec3(0.0, 0.0, 1.0), lightReflectionDirection));\n"
+        "    fragColour += pow(normalDotReflection, 2.0) * vec3(1.0);\n"
+        "    gl_Position = projection * modelView * vertexPosition;\n"
+        "}\n";
+
+static const char benchmarkFragmentShader[] =
+        "precision mediump float;\n"
+        "varying vec3 fragColour;\n"
+        "void main()\n"
+        "{\n"
+        "    gl_FragColor = vec4(fragColour, 1.0);\n"
+        "}\n";
+
+// 每个变体在源码末尾加一行不同的注释，得到不同的缓存键，用来模拟冷启动
+static std::string shaderVariant(const char* source, int variant)
+{
+    char comment[64];
+    snprintf(comment, sizeof(comment), "// variant %d\n", variant);
+    return std::string(source) + comment;
+}
+
+static void removeDirectory(const char* path)
+{
+    DIR* directory = opendir(path);
+    if (directory == NULL)
+    {
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL)
+    {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+        {
+            std::string file = std::string(path) + "/" + entry->d_name;
+            unlink(file.c_str());
+        }
+    }
+    closedir(directory);
+    rmdir(path);
+}
+
+// 把缓存目录里的第一个文件的二进制部分改坏，模拟驱动升级后拒绝旧的二进制
+static void corruptFirstCacheEntry(const char* path)
+{
+    DIR* directory = opendir(path);
+    if (directory == NULL)
+    {
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL)
+    {
+        if (strstr(entry->d_name, ".bin") != NULL)
+        {
+            std::string file = std::string(path) + "/" + entry->d_name;
+            FILE* stream = fopen(file.c_str(), "r+b");
+            if (stream != NULL)
+            {
+                fseek(stream, 64, SEEK_SET);
+                for (int i = 0; i < 64; i++)
+                {
+                    fputc(0xA5, stream);
+                }
+                fclose(stream);
+            }
+            break;
+        }
+    }
+    closedir(directory);
+}
+
+/**
+ * 着色器程序二进制缓存：分别测不使用缓存、缓存未命中（编译并写入）、缓存命中的createProgram耗时，
+ * 以及被驱动拒绝的缓存能否回退到源码编译。
+ */
+static void benchmarkProgramCache()
+{
+    const int variantCount = 16;
+    char directory[] = "/tmp/programCacheXXXXXX";
+    if (mkdtemp(directory) == NULL)
+    {
+        fprintf(stderr, "Could not create program cache directory\n");
+        return;
+    }
+
+    double start = benchmarkNowNanoseconds();
+    for (int i = 0; i < variantCount; i++)
+    {
+        glDeleteProgram(createProgram(shaderVariant(benchmarkVertexShader, i).c_str(), benchmarkFragmentShader));
+    }
+    benchmarkReport("createProgram.uncached", variantCount, "msPerOp",
+                    (benchmarkNowNanoseconds() - start) / 1e6 / variantCount);
+
+    ProgramCacheStats stats;
+    setProgramCacheDirectory(directory);
+    resetProgramCacheStats();
+    // 第一遍全部未命中，第二遍全部命中，变体编号与上面不同，避免驱动内部的着色器缓存影响未命中的耗时
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < variantCount; i++)
+        {
+            glDeleteProgram(createProgram(shaderVariant(benchmarkVertexShader, variantCount + i).c_str(),
+                                          benchmarkFragmentShader));
+        }
+    }
+    getProgramCacheStats(&stats);
+    benchmarkReport("createProgram.cacheMiss", stats.misses, "msPerOp",
+                    stats.misses ? stats.missMilliseconds / stats.misses : 0.0);
+    benchmarkReport("createProgram.cacheHit", stats.hits, "msPerOp",
+                    stats.hits ? stats.hitMilliseconds / stats.hits : 0.0);
+
+    resetProgramCacheStats();
+    corruptFirstCacheEntry(directory);
+    int linked = 0;
+    for (int i = 0; i < variantCount; i++)
+    {
+        GLuint program = createProgram(shaderVariant(benchmarkVertexShader, variantCount + i).c_str(),
+                                       benchmarkFragmentShader);
+        linked += program != 0;
+        glDeleteProgram(program);
+    }
+    getProgramCacheStats(&stats);
+    benchmarkReport("createProgram.rejectedFallback", stats.rejected, "linked", linked);
+
+    setProgramCacheDirectory(NULL);
+    removeDirectory(directory);
+}
+
+// 渲染帧直到超过最短测试时间（至少3帧），glFinish等待渲染完成。
+// 返回平均每帧毫秒数，cpuMilliseconds是其中renderFrame本身（计算矩阵和发出GL调用）的耗时
+static double measureFrames(double* cpuMilliseconds)
+{
+    renderFrame();
+    glFinish();
+    int frames = 0;
+    double cpu = 0.0;
+    double start = benchmarkNowNanoseconds();
+    double elapsed = 0.0;
+    do
+    {
+        double frameStart = benchmarkNowNanoseconds();
+        renderFrame();
+        cpu += benchmarkNowNanoseconds() - frameStart;
+        glFinish();
+        frames++;
+        elapsed = benchmarkNowNanoseconds() - start;
+    } while (frames < 3 || elapsed < benchmarkOptions.minTimeMilliseconds * 1e6);
+    *cpuMilliseconds = cpu / 1e6 / frames;
+    return elapsed / 1e6 / frames;
+}
+
+/**
+ * lesson5的压力测试：立方体数量从1增加到十万（不超过--max-count），分别测实例化绘制和逐个绘制的帧时间。
+ * 实例化绘制再分成矩阵直接写进环形流式缓冲区（instanced，同时报告每帧等待栅栏的时间和写入的字节数）
+ * 和orphan加glBufferSubData上传（orphan）两种。measureFrames每帧都glFinish，栅栏总是已经触发，stall应该接近0。
+ * 逐个绘制最多测到一万个，再多在软件渲染上太慢。软件渲染的帧时间主要是光栅化，.cpu结果更能反映调用开销的差别。
+ */
+static void benchmarkInstancing()
+{
+    if (!setupGraphics(benchmarkContextSize, benchmarkContextSize))
+    {
+        fprintf(stderr, "Could not set up the instanced cube scene\n");
+        return;
+    }
+    for (int count = 1; count <= 100000 && count <= benchmarkOptions.maxCount; count *= 10)
+    {
+        double cpuMilliseconds;
+        setInstanceCount(count);
+        setInstancingEnabled(true);
+        setInstanceStreamingEnabled(true);
+        resetInstanceStreamStats();
+        benchmarkReport("instancedCube.instanced", count, "msPerFrame", measureFrames(&cpuMilliseconds));
+        benchmarkReport("instancedCube.instanced.cpu", count, "msPerFrame", cpuMilliseconds);
+        StreamBufferStats stream;
+        getInstanceStreamStats(&stream);
+        int streamFrames = stream.frames > 0 ? stream.frames : 1;
+        benchmarkReport("instancedCube.stream.stall", count, "msPerFrame", stream.stallMilliseconds / streamFrames);
+        benchmarkReport("instancedCube.stream.bytes", count, "bytesPerFrame", (double) stream.bytesStreamed / streamFrames);
+        setInstanceStreamingEnabled(false);
+        benchmarkReport("instancedCube.orphan", count, "msPerFrame", measureFrames(&cpuMilliseconds));
+        benchmarkReport("instancedCube.orphan.cpu", count, "msPerFrame", cpuMilliseconds);
+        setInstanceStreamingEnabled(true);
+        if (count <= 10000)
+        {
+            setInstancingEnabled(false);
+            benchmarkReport("instancedCube.perDraw", count, "msPerFrame", measureFrames(&cpuMilliseconds));
+            benchmarkReport("instancedCube.perDraw.cpu", count, "msPerFrame", cpuMilliseconds);
+        }
+    }
+    setInstanceCount(1000); // 恢复课程默认的数量，benchmarkScenes还会测这一课
+    setInstancingEnabled(true);
+    teardownGraphics();
+}
+
+static void appendUint32(std::vector<unsigned char>* file, unsigned int value)
+{
+    file->insert(file->end(), (unsigned char*) &value, (unsigned char*) &value + 4);
+}
+
+static void appendUint64(std::vector<unsigned char>* file, unsigned long long value)
+{
+    file->insert(file->end(), (unsigned char*) &value, (unsigned char*) &value + 8);
+}
+
+static bool writeFile(const std::string& path, const std::vector<unsigned char>& file)
+{
+    FILE* stream = fopen(path.c_str(), "wb");
+    if (stream == NULL)
+    {
+        return false;
+    }
+    bool written = fwrite(&file[0], 1, file.size(), stream) == file.size();
+    return fclose(stream) == 0 && written;
+}
+
+/**
+ * 生成一张size×size、带完整mipmap链的测试纹理，每个块都是block（blockBytes字节，覆盖blockSize×blockSize个像素）。
+ * vkFormat为0时写KTX1（glInternalFormat，压缩格式），否则写KTX2。
+ */
+static bool writeTestKtx(const std::string& path, unsigned int vkFormat, GLenum internalFormat, int blockSize,
+                         const unsigned char* block, int blockBytes, int size)
+{
+    static const unsigned char ktx1[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+    static const unsigned char ktx2[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    int levelCount = 1;
+    while ((size >> (levelCount - 1)) > 1)
+    {
+        levelCount++;
+    }
+    std::vector<std::vector<unsigned char> > levels(levelCount);
+    for (int level = 0; level < levelCount; level++)
+    {
+        int dimension = size >> level;
+        int blocks = (dimension + blockSize - 1) / blockSize;
+        for (int i = 0; i < blocks * blocks; i++)
+        {
+            levels[level].insert(levels[level].end(), block, block + blockBytes);
+        }
+    }
+    std::vector<unsigned char> file;
+    if (vkFormat == 0)
+    {
+        file.insert(file.end(), ktx1, ktx1 + 12);
+        unsigned int header[] = {0x04030201, 0, 1, 0, internalFormat, GL_RGBA, (unsigned int) size, (unsigned int) size,
+                                 0, 0, 1, (unsigned int) levelCount, 0};
+        for (size_t i = 0; i < sizeof(header) / sizeof(header[0]); i++)
+        {
+            appendUint32(&file, header[i]);
+        }
+        for (int level = 0; level < levelCount; level++)
+        {
+            appendUint32(&file, (unsigned int) levels[level].size());
+            file.insert(file.end(), levels[level].begin(), levels[level].end());
+            file.resize((file.size() + 3) & ~(size_t) 3);
+        }
+        return writeFile(path, file);
+    }
+    file.insert(file.end(), ktx2, ktx2 + 12);
+    unsigned int header[] = {vkFormat, 1, (unsigned int) size, (unsigned int) size, 0, 0, 1, (unsigned int) levelCount,
+                             0, 0, 0, 0, 0};
+    for (size_t i = 0; i < sizeof(header) / sizeof(header[0]); i++)
+    {
+        appendUint32(&file, header[i]);
+    }
+    appendUint64(&file, 0); // 没有超压缩全局数据
+    appendUint64(&file, 0);
+    size_t offset = file.size() + 24 * levelCount;
+    for (int level = 0; level < levelCount; level++)
+    {
+        appendUint64(&file, offset);
+        appendUint64(&file, levels[level].size());
+        appendUint64(&file, levels[level].size());
+        offset += levels[level].size();
+    }
+    for (int level = 0; level < levelCount; level++)
+    {
+        file.insert(file.end(), levels[level].begin(), levels[level].end());
+    }
+    return writeFile(path, file);
+}
+
+// 在GL线程上直接读文件、解析并上传全部级别（流式加载之前的做法），返回毫秒
+static double loadTextureSynchronously(const std::string& path)
+{
+    double start = benchmarkNowNanoseconds();
+    FILE* stream = fopen(path.c_str(), "rb");
+    if (stream == NULL)
+    {
+        return 0.0;
+    }
+    std::vector<unsigned char> data;
+    unsigned char buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), stream)) > 0)
+    {
+        data.insert(data.end(), buffer, buffer + read);
+    }
+    fclose(stream);
+    KtxImage image;
+    if (parseKtx(&data[0], data.size(), &image))
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        for (int level = 0; level < image.levelCount; level++)
+        {
+            const KtxLevel& current = image.levels[level];
+            if (image.compressed)
+            {
+                glCompressedTexImage2D(GL_TEXTURE_2D, level, image.internalFormat, current.width, current.height, 0,
+                                       (GLsizei) current.bytes, current.data);
+            }
+            else
+            {
+                glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, current.width, current.height, 0, GL_RGBA,
+                             GL_UNSIGNED_BYTE, current.data);
+            }
+        }
+        glFinish();
+        glDeleteTextures(1, &texture);
+    }
+    return (benchmarkNowNanoseconds() - start) / 1e6;
+}
+
+// 把纹理的第0级挂到帧缓冲上读回左下角的像素
+static bool readTexturePixel(GLuint texture, int level, unsigned char* pixel)
+{
+    GLuint framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, level);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (complete)
+    {
+        glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    return complete;
+}
+
+/**
+ * 纹理流式加载：生成ETC2（KTX1）、ASTC 4x4和RGBA8（KTX2）三张2048×2048带mipmap的纹理，外加一张不存在的文件（回退到RGBA8）
+ * 和一张只有一级的RGBA8纹理（工作线程生成mipmap链），
+ * 每帧上传预算2ms，统计全部完成用了多少帧、单帧最长的上传时间和超出预算的停顿，并和在GL线程上同步加载比较。
+ */
+static void benchmarkTextureStreaming()
+{
+    char directory[] = "/tmp/learnopengl-textures-XXXXXX";
+    if (mkdtemp(directory) == NULL)
+    {
+        fprintf(stderr, "Could not create texture directory\n");
+        return;
+    }
+    static const int size = 2048;
+    static const double budgetMilliseconds = 2.0;
+    unsigned char etc2Block[16];
+    for (int i = 0; i < 16; i++)
+    {
+        etc2Block[i] = (unsigned char) (i * 37 + 11); // ETC2的任何比特组合都是合法的块
+    }
+    // ASTC的void-extent块：整块是同一个颜色，RGBA各16位
+    static const unsigned char astcBlock[16] = {0xFC, 0xFD, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                                0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0xFF, 0xFF};
+    static const unsigned char rgbaPixel[4] = {12, 34, 56, 255};
+    std::string etc2Path = std::string(directory) + "/etc2.ktx";
+    std::string astcPath = std::string(directory) + "/astc.ktx2";
+    std::string rgbaPath = std::string(directory) + "/rgba8.ktx2";
+    std::string missingPath = std::string(directory) + "/missing.ktx2";
+    std::string singleLevelPath = std::string(directory) + "/single.ktx2";
+    // 只有一级的RGBA8纹理，mipmap链由工作线程生成
+    std::vector<unsigned char> singleLevel((size_t) size * size * 4);
+    for (size_t i = 0; i < singleLevel.size(); i++)
+    {
+        singleLevel[i] = rgbaPixel[i % 4];
+    }
+    KtxImage singleLevelImage = {GL_RGBA8, false, 1, 1, size, size, 1};
+    singleLevelImage.levels[0].data = &singleLevel[0];
+    singleLevelImage.levels[0].bytes = singleLevel.size();
+    if (!writeTestKtx(etc2Path, 0, GL_COMPRESSED_RGBA8_ETC2_EAC, 4, etc2Block, 16, size) ||
+        !writeTestKtx(astcPath, 157, 0, 4, astcBlock, 16, size) ||
+        !writeTestKtx(rgbaPath, 37, 0, 1, rgbaPixel, 4, size) || !writeKtx2(singleLevelPath.c_str(), &singleLevelImage))
+    {
+        fprintf(stderr, "Could not write test textures\n");
+        removeDirectory(directory);
+        return;
+    }
+    benchmarkReport("textureStream.sync.etc2", size, "ms", loadTextureSynchronously(etc2Path));
+    benchmarkReport("textureStream.sync.astc", size, "ms", loadTextureSynchronously(astcPath));
+    benchmarkReport("textureStream.sync.rgba8", size, "ms", loadTextureSynchronously(rgbaPath));
+
+    resetTextureStreamStats();
+    startTextureStreaming();
+    int handles[] = {requestTexture(etc2Path.c_str(), rgbaPath.c_str()),
+                     requestTexture(astcPath.c_str(), rgbaPath.c_str()),
+                     requestTexture(missingPath.c_str(), rgbaPath.c_str()),
+                     requestTexture(singleLevelPath.c_str(), NULL)};
+    int textureCount = sizeof(handles) / sizeof(handles[0]);
+    int frames = 0;
+    int firstUsableFrame = -1;
+    for (; frames < 10000; frames++)
+    {
+        pumpTextureUploads(budgetMilliseconds);
+        int finished = 0;
+        for (int i = 0; i < textureCount; i++)
+        {
+            GLuint texture;
+            StreamedTextureState state = getStreamedTexture(handles[i], &texture);
+            finished += state == TEXTURE_COMPLETE || state == TEXTURE_FAILED;
+            if (firstUsableFrame < 0 && (state == TEXTURE_PARTIAL || state == TEXTURE_COMPLETE))
+            {
+                firstUsableFrame = frames;
+            }
+        }
+        if (finished == textureCount)
+        {
+            break;
+        }
+        usleep(1000); // 模拟两帧之间渲染线程做的其它事情
+    }
+    glFinish();
+    TextureStreamStats stats;
+    getTextureStreamStats(&stats);
+    benchmarkReport("textureStream.frames", size, "frames", frames + 1);
+    benchmarkReport("textureStream.firstUsableFrame", size, "frame", firstUsableFrame);
+    benchmarkReport("textureStream.bytesStreamed", size, "bytes", (double) stats.bytesStreamed);
+    benchmarkReport("textureStream.maxFrame", size, "ms", stats.maxFrameMilliseconds);
+    benchmarkReport("textureStream.stall", size, "ms", stats.stallMilliseconds);
+    benchmarkReport("textureStream.upload", size, "ms", stats.uploadMilliseconds);
+    benchmarkReport("textureStream.mipGeneration", size, "ms", stats.mipMilliseconds);
+    if (stats.mipChainsGenerated != 1)
+    {
+        fprintf(stderr, "Expected one generated mipmap chain, got %d\n", stats.mipChainsGenerated);
+    }
+    if (stats.completed != textureCount || glGetError() != GL_NO_ERROR)
+    {
+        fprintf(stderr, "Texture streaming completed %d of %d textures\n", stats.completed, textureCount);
+    }
+    // 不存在的文件回退到了RGBA8纹理，读回的像素应该和文件里的一样
+    GLuint fallbackTexture;
+    unsigned char pixel[4] = {0, 0, 0, 0};
+    getStreamedTexture(handles[2], &fallbackTexture);
+    if (!readTexturePixel(fallbackTexture, 0, pixel) || memcmp(pixel, rgbaPixel, 4) != 0)
+    {
+        fprintf(stderr, "Fallback texture has pixel %d,%d,%d,%d\n", pixel[0], pixel[1], pixel[2], pixel[3]);
+    }
+    GLuint singleLevelTexture;
+    getStreamedTexture(handles[3], &singleLevelTexture);
+    if (!readTexturePixel(singleLevelTexture, 11, pixel) || memcmp(pixel, rgbaPixel, 4) != 0) // 生成的1x1级
+    {
+        fprintf(stderr, "Generated 1x1 mipmap has pixel %d,%d,%d,%d\n", pixel[0], pixel[1], pixel[2], pixel[3]);
+    }
+    for (int i = 0; i < textureCount; i++)
+    {
+        GLuint texture;
+        getStreamedTexture(handles[i], &texture);
+        glDeleteTextures(1, &texture);
+    }
+    stopTextureStreaming();
+    removeDirectory(directory);
+}
+
+/**
+ * 图集上传：64张64×64的纯色图片装进一页1024×1024（sRGB过滤生成mipmap），报告上传耗时，
+ * 并检查页的左下角（第一张图片复制出来的padding）是原图的颜色。
+ */
+static void benchmarkAtlasUpload()
+{
+    static const int imageCount = 64;
+    static const int imageSize = 64;
+    std::vector<unsigned char> pixels((size_t) imageCount * imageSize * imageSize * 4);
+    std::vector<AtlasImage> images(imageCount);
+    for (int i = 0; i < imageCount; i++)
+    {
+        unsigned char* image = &pixels[(size_t) i * imageSize * imageSize * 4];
+        for (int k = 0; k < imageSize * imageSize; k++)
+        {
+            image[k * 4] = (unsigned char) (i * 4);
+            image[k * 4 + 1] = (unsigned char) (255 - i * 4);
+            image[k * 4 + 2] = 128;
+            image[k * 4 + 3] = 255;
+        }
+        AtlasImage atlasImage = {image, imageSize, imageSize};
+        images[i] = atlasImage;
+    }
+    AtlasOptions options = {1024, 4, 8};
+    TextureAtlas atlas;
+    if (!buildTextureAtlas(&images[0], imageCount, &options, &atlas))
+    {
+        fprintf(stderr, "Could not build texture atlas\n");
+        return;
+    }
+    std::vector<GLuint> textures(atlas.pageCount);
+    double start = benchmarkNowNanoseconds();
+    bool uploaded = uploadAtlasPages(&atlas, true, &textures[0]);
+    glFinish();
+    benchmarkReport("atlas.upload", imageCount, "ms", (benchmarkNowNanoseconds() - start) / 1e6);
+    unsigned char pixel[4] = {0, 0, 0, 0};
+    if (!uploaded || !readTexturePixel(textures[0], 0, pixel) || memcmp(pixel, images[0].rgba, 4) != 0)
+    {
+        fprintf(stderr, "Atlas page has pixel %d,%d,%d,%d\n", pixel[0], pixel[1], pixel[2], pixel[3]);
+    }
+    glDeleteTextures(atlas.pageCount, &textures[0]);
+}
+
+static bool writeImportedMeshCache(const std::string& path, const ImportedMesh& imported)
+{
+    MeshCacheSource source;
+    memset(&source, 0, sizeof(source));
+    source.mode = GL_TRIANGLES;
+    source.vertexCount = imported.vertexCount;
+    MeshCacheAttribute attributes[3] = {{MESH_POSITION, 3, VERTEX_FLOAT, &imported.positions[0]},
+                                        {MESH_NORMAL, 3, VERTEX_FLOAT, &imported.normals[0]},
+                                        {MESH_TEXTURE_CORD, 2, VERTEX_FLOAT, &imported.textureCords[0]}};
+    source.attributeCount = 3;
+    memcpy(source.attributes, attributes, sizeof(attributes));
+    source.indexType = imported.indexType;
+    source.indexCount = imported.indexCount;
+    source.indices = imported.indexType == GL_UNSIGNED_INT ? (const void*) &imported.indices[0]
+                                                           : (const void*) &imported.shortIndices[0];
+    return writeMeshCache(path.c_str(), &source);
+}
+
+// 把lesson5的静态数组写成缓存再读回来，检查布局、包围盒、顶点和索引，以及损坏的文件会被拒绝
+static bool checkCubeMeshCache(const std::string& path)
+{
+    extern GLfloat cubeVertices[72];
+    extern GLfloat colour[72];
+    extern GLushort indices[36];
+    MeshCacheSource source;
+    memset(&source, 0, sizeof(source));
+    source.mode = GL_TRIANGLES;
+    source.vertexCount = 24;
+    MeshCacheAttribute attributes[2] = {{MESH_POSITION, 3, VERTEX_FLOAT, cubeVertices},
+                                        {MESH_COLOUR, 3, VERTEX_UNORM8, colour}};
+    source.attributeCount = 2;
+    memcpy(source.attributes, attributes, sizeof(attributes));
+    source.indices = indices;
+    source.indexCount = 36;
+    source.indexType = GL_UNSIGNED_SHORT;
+    MeshCacheFile file;
+    if (!writeMeshCache(path.c_str(), &source) || !openMeshCache(path.c_str(), true, &file))
+    {
+        return false;
+    }
+    const MeshCacheHeader* header = file.header;
+    const unsigned char* vertices = (const unsigned char*) file.vertices;
+    bool valid = header->stride == 16 && header->vertexCount == 24 && header->indexCount == 36 &&
+                 header->boundsMin[0] == -1.0f && header->boundsMax[2] == 1.0f &&
+                 fabsf(header->boundingSphere[3] - sqrtf(3.0f)) < 1e-6f && file.lods[0].indexCount == 36 &&
+                 memcmp(file.indices, indices, sizeof(GLushort) * 36) == 0 && (size_t) file.vertices % 64 == 0;
+    for (int v = 0; valid && v < 24; v++)
+    {
+        valid = memcmp(vertices + v * 16, &cubeVertices[v * 3], 12) == 0 &&
+                vertices[v * 16 + 12] == (unsigned char) (colour[v * 3] * 255.0f);
+    }
+    GLint locations[MESH_SEMANTIC_COUNT] = {0, -1, -1, 1};
+    Mesh mesh;
+    valid = valid && createCachedMesh(&mesh, &file, locations, 0);
+    if (valid)
+    {
+        deleteMesh(&mesh);
+    }
+    closeMeshCache(&file);
+    // 改动一个字节后校验和应该不再匹配
+    FILE* stream = fopen(path.c_str(), "r+b");
+    if (stream != NULL)
+    {
+        fseek(stream, -1, SEEK_END);
+        int last = fgetc(stream);
+        fseek(stream, -1, SEEK_END);
+        fputc(last ^ 1, stream);
+        fclose(stream);
+    }
+    bool rejected = !openMeshCache(path.c_str(), true, &file);
+    unlink(path.c_str());
+    return valid && rejected;
+}
+
+/**
+ * 网格缓存的启动耗时：同一个1024×1024的网格面片（约210万个三角形），分别从OBJ、glb导入并上传，
+ * 和从缓存文件映射并上传（校验和不校验两种）比较，都包含glFinish。文件刚写完，都在页缓存里。
+ */
+static void benchmarkMeshCache()
+{
+    char directory[] = "/tmp/learnopengl-cache-XXXXXX";
+    if (mkdtemp(directory) == NULL)
+    {
+        fprintf(stderr, "Could not create mesh cache directory\n");
+        return;
+    }
+    if (!checkCubeMeshCache(std::string(directory) + "/cube.mesh"))
+    {
+        fprintf(stderr, "Cube mesh cache round trip failed\n");
+    }
+    static const int n = 1024;
+    const char* sources[2] = {"obj", "glb"};
+    std::string paths[2] = {std::string(directory) + "/grid.obj", std::string(directory) + "/grid.glb"};
+    std::string cachePath = std::string(directory) + "/grid.mesh";
+    if (!writeGridObj(paths[0], n) || !writeGridGlb(paths[1], n))
+    {
+        fprintf(stderr, "Could not write test meshes\n");
+        removeDirectory(directory);
+        return;
+    }
+    int triangles = 2 * n * n;
+    unsigned int vertexCount = 0;
+    unsigned int indexCount = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        double start = benchmarkNowNanoseconds();
+        ImportedMesh imported;
+        Mesh mesh;
+        bool ok = importMesh(paths[i].c_str(), 0, &imported, NULL) && createImportedMesh(&mesh, &imported, 0, 1, 2);
+        glFinish();
+        benchmarkReport((std::string("meshCache.startup.") + sources[i]).c_str(), triangles, "ms",
+                        (benchmarkNowNanoseconds() - start) / 1e6);
+        if (!ok)
+        {
+            fprintf(stderr, "Could not import %s\n", paths[i].c_str());
+            continue;
+        }
+        deleteMesh(&mesh);
+        if (i == 0)
+        {
+            vertexCount = (unsigned int) imported.vertexCount;
+            indexCount = (unsigned int) imported.indexCount;
+            if (!writeImportedMeshCache(cachePath, imported))
+            {
+                fprintf(stderr, "Could not write %s\n", cachePath.c_str());
+            }
+        }
+    }
+    for (int verify = 1; verify >= 0; verify--)
+    {
+        double start = benchmarkNowNanoseconds();
+        MeshCacheFile file;
+        Mesh mesh;
+        GLint locations[MESH_SEMANTIC_COUNT] = {0, 1, 2, -1};
+        bool ok = openMeshCache(cachePath.c_str(), verify != 0, &file) && createCachedMesh(&mesh, &file, locations, 0);
+        glFinish();
+        benchmarkReport(verify ? "meshCache.startup.cache" : "meshCache.startup.cacheUnverified", triangles, "ms",
+                        (benchmarkNowNanoseconds() - start) / 1e6);
+        if (!ok || file.header->vertexCount != vertexCount || file.header->indexCount != indexCount)
+        {
+            fprintf(stderr, "Mesh cache %s does not match the imported mesh\n", cachePath.c_str());
+        }
+        if (ok)
+        {
+            if (verify)
+            {
+                benchmarkReport("meshCache.bytes", triangles, "bytes", (double) file.bytes);
+            }
+            deleteMesh(&mesh);
+        }
+        closeMeshCache(&file);
+    }
+    removeDirectory(directory);
+}
+
+static const int lodFieldSize = 8; // 8×8个球，沿视线方向越来越远
+
+struct LodField
+{
+    Mesh mesh;
+    const MeshCacheLod* lods;
+    int lodCount;
+    GLint modelViewLocation;
+    float errorScale;
+};
+
+// 画一帧，select为false时全部用第0级
+static void drawLodField(const LodField& field, bool select, LodStats* stats)
+{
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    resetLodStats(stats);
+    for (int row = 0; row < lodFieldSize; row++)
+    {
+        for (int column = 0; column < lodFieldSize; column++)
+        {
+            float position[3] = {(column - (lodFieldSize - 1) * 0.5f) * 3.0f * (row + 1) / lodFieldSize, 0.0f,
+                                 -4.0f - row * row * 4.0f};
+            float modelView[16];
+            matrixIdentityFunction(modelView);
+            matrixTranslate(modelView, position[0], position[1], position[2]);
+            float distance = sqrtf(position[0] * position[0] + position[2] * position[2]);
+            int lod = select ? selectLod(field.lods, field.lodCount, distance, 1.0f, field.errorScale,
+                                         defaultLodPixelError) : 0;
+            countLod(stats, field.lods, lod);
+            glUniformMatrix4fv(field.modelViewLocation, 1, GL_FALSE, modelView);
+            drawMeshRange(&field.mesh, (GLsizei) field.lods[lod].firstIndex, (GLsizei) field.lods[lod].indexCount);
+        }
+    }
+}
+
+static double measureLodFrames(const LodField& field, bool select, LodStats* stats)
+{
+    drawLodField(field, select, stats);
+    glFinish();
+    int frames = 0;
+    double start = benchmarkNowNanoseconds();
+    double elapsed = 0.0;
+    do
+    {
+        drawLodField(field, select, stats);
+        glFinish();
+        frames++;
+        elapsed = benchmarkNowNanoseconds() - start;
+    } while (frames < 3 || elapsed < benchmarkOptions.minTimeMilliseconds * 1e6);
+    return elapsed / 1e6 / frames;
+}
+
+/**
+ * 按距离选择LOD：128×64段的UV球生成LOD链写进网格缓存，全部级别一起上传，64个球从近到远排开，
+ * 分别测全部用第0级和按投影误差不超过1像素选择时的帧时间，以及每帧实际画的三角形数。
+ */
+static void benchmarkLod()
+{
+    char directory[] = "/tmp/learnopengl-lod-XXXXXX";
+    if (mkdtemp(directory) == NULL)
+    {
+        fprintf(stderr, "Could not create LOD directory\n");
+        return;
+    }
+    std::string path = std::string(directory) + "/sphere.mesh";
+    SphereMesh sphere;
+    createSphere(&sphere, 128, 64);
+    static const float weights[5] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+    SimplifyAttributes attributes = {&sphere.attributes[0], 5, weights};
+    MeshLodChain chain;
+    buildLodChain(&chain, &sphere.indices[0], (int) sphere.indices.size(), &sphere.positions[0], sphere.vertexCount,
+                  &attributes, maxMeshLods, defaultLodReduction, 0.5f);
+    // 法线和位置相同，只上传位置和法线
+    std::vector<float> normals((size_t) sphere.vertexCount * 3);
+    for (int v = 0; v < sphere.vertexCount; v++)
+    {
+        memcpy(&normals[(size_t) v * 3], &sphere.attributes[(size_t) v * 5], sizeof(float) * 3);
+    }
+    MeshCacheSource source;
+    memset(&source, 0, sizeof(source));
+    source.mode = GL_TRIANGLES;
+    source.vertexCount = sphere.vertexCount;
+    MeshCacheAttribute cacheAttributes[2] = {{MESH_POSITION, 3, VERTEX_FLOAT, &sphere.positions[0]},
+                                             {MESH_NORMAL, 3, VERTEX_FLOAT, &normals[0]}};
+    source.attributeCount = 2;
+    memcpy(source.attributes, cacheAttributes, sizeof(cacheAttributes));
+    source.indices = &chain.indices[0];
+    source.indexCount = (int) chain.indices.size();
+    source.indexType = GL_UNSIGNED_INT;
+    source.lodCount = chain.lodCount;
+    memcpy(source.lods, chain.lods, sizeof(MeshCacheLod) * chain.lodCount);
+
+    GLuint program = createProgram(benchmarkVertexShader, benchmarkFragmentShader);
+    MeshCacheFile file;
+    LodField field;
+    GLint locations[MESH_SEMANTIC_COUNT] = {-1, -1, -1, -1};
+    locations[MESH_POSITION] = glGetAttribLocation(program, "vertexPosition");
+    locations[MESH_NORMAL] = glGetAttribLocation(program, "vertexNormal");
+    if (program == 0 || !writeMeshCache(path.c_str(), &source) || !openMeshCache(path.c_str(), true, &file))
+    {
+        fprintf(stderr, "Could not set up the LOD scene\n");
+        glDeleteProgram(program);
+        removeDirectory(directory);
+        return;
+    }
+    if (createCachedMesh(&field.mesh, &file, locations, -1))
+    {
+        field.lods = file.lods;
+        field.lodCount = (int) file.header->lodCount;
+        field.modelViewLocation = glGetUniformLocation(program, "modelView");
+        field.errorScale = lodErrorScale(45.0f, benchmarkContextSize);
+        float projection[16];
+        matrixPerspective(projection, 45.0f, 1.0f, 0.1f, 500.0f);
+        glViewport(0, 0, benchmarkContextSize, benchmarkContextSize);
+        glEnable(GL_DEPTH_TEST);
+        glUseProgram(program);
+        glVertexAttrib3f(glGetAttribLocation(program, "vertexColour"), 0.8f, 0.6f, 0.2f);
+        glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, projection);
+        LodStats full;
+        LodStats selected;
+        double fullMilliseconds = measureLodFrames(field, false, &full);
+        double selectedMilliseconds = measureLodFrames(field, true, &selected);
+        benchmarkReport("lod.levels", full.objects, "lods", field.lodCount);
+        benchmarkReport("lod.trianglesFull", full.objects, "trianglesPerFrame", (double) full.trianglesDrawn);
+        benchmarkReport("lod.trianglesDrawn", selected.objects, "trianglesPerFrame", (double) selected.trianglesDrawn);
+        benchmarkReport("lod.trianglesSaved", selected.objects, "trianglesPerFrame",
+                        (double) (selected.trianglesFull - selected.trianglesDrawn));
+        benchmarkReport("lod.full", full.objects, "msPerFrame", fullMilliseconds);
+        benchmarkReport("lod.selected", selected.objects, "msPerFrame", selectedMilliseconds);
+        for (int i = 0; i < field.lodCount; i++)
+        {
+            benchmarkReport((std::string("lod.objects.") + std::to_string(i)).c_str(), selected.objects, "objects",
+                            selected.objectsPerLod[i]);
+        }
+        deleteMesh(&field.mesh);
+    }
+    else
+    {
+        fprintf(stderr, "Could not upload the LOD mesh\n");
+    }
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(0);
+    glDeleteProgram(program);
+    closeMeshCache(&file);
+    removeDirectory(directory);
+}
+
+/**
+ * 着色器变体：phongTemplate全部16种组合（一半是uniform块的变体）的编译耗时（不使用程序缓存）和已编译变体的查找耗时，
+ * 以及同一个球（128×64段，铺满大半个画面）用逐顶点、逐顶点加高光、逐像素加高光三种变体绘制的帧时间。
+ */
+static void benchmarkShaderVariants()
+{
+    resetStateCache();
+    resetShaderVariants();
+    resetShaderVariantStats();
+    int variantTotal = 1 << SHADER_FEATURE_COUNT;
+    for (unsigned int features = 0; features < (unsigned int) variantTotal; features++)
+    {
+        if (getShaderVariant(&phongTemplate, features) == 0)
+        {
+            fprintf(stderr, "Could not build shader variant 0x%x\n", features);
+        }
+    }
+    ShaderVariantStats stats;
+    getShaderVariantStats(&stats);
+    benchmarkReport("shaderVariant.build", stats.built, "msPerOp", stats.built ? stats.buildMilliseconds / stats.built : 0.0);
+    const int lookups = 100000;
+    double start = benchmarkNowNanoseconds();
+    for (int i = 0; i < lookups; i++)
+    {
+        getShaderVariant(&phongTemplate, (unsigned int) i & (variantTotal - 1));
+    }
+    benchmarkReport("shaderVariant.lookup", lookups, "nsPerOp", (benchmarkNowNanoseconds() - start) / lookups);
+
+    SphereMesh sphere;
+    createSphere(&sphere, 128, 64);
+    std::vector<float> colours((size_t) sphere.vertexCount * 3, 0.8f);
+    std::vector<float> normals((size_t) sphere.vertexCount * 3);
+    for (int v = 0; v < sphere.vertexCount; v++)
+    {
+        memcpy(&normals[(size_t) v * 3], &sphere.attributes[(size_t) v * 5], sizeof(float) * 3);
+    }
+    const char* names[3] = {"perVertex", "perVertexSpecular", "perPixelSpecular"};
+    LightingMaterial materials[3] = {{{0.0f, 0.0f, 0.0f}, 2.0f, 0, false},
+                                     {{1.0f, 1.0f, 1.0f}, 2.0f, 0, false},
+                                     {{1.0f, 1.0f, 1.0f}, 2.0f, 0, true}};
+    static const float light[3] = {0.0f, 1.0f, 1.0f};
+    static const float eye[3] = {0.0f, 0.0f, 1.0f};
+    static const float ambient[3] = {0.1f, 0.1f, 0.1f};
+    static const float white[3] = {1.0f, 1.0f, 1.0f};
+    float projection[16];
+    float modelView[16];
+    matrixPerspective(projection, 45.0f, 1.0f, 0.1f, 100.0f);
+    matrixIdentityFunction(modelView);
+    matrixTranslate(modelView, 0.0f, 0.0f, -3.0f);
+    cachedViewport(0, 0, benchmarkContextSize, benchmarkContextSize);
+    cachedEnable(GL_DEPTH_TEST);
+    for (int m = 0; m < 3; m++)
+    {
+        GLuint program = getShaderVariant(&phongTemplate, materialShaderFeatures(&materials[m]));
+        const float* sources[3] = {&sphere.positions[0], &normals[0], &colours[0]};
+        VertexLayout layout;
+        initVertexLayout(&layout);
+        addVertexElement(&layout, glGetAttribLocation(program, "vertexPosition"), 3, VERTEX_FLOAT);
+        addVertexElement(&layout, glGetAttribLocation(program, "vertexNormal"), 3, VERTEX_FLOAT);
+        addVertexElement(&layout, glGetAttribLocation(program, "vertexColour"), 3, VERTEX_FLOAT);
+        std::vector<unsigned char> vertices((size_t) sphere.vertexCount * layout.stride);
+        packVertices(&layout, sources, sphere.vertexCount, &vertices[0]);
+        Mesh mesh;
+        if (program == 0 || !createInterleavedMesh(&mesh, GL_TRIANGLES, &layout, &vertices[0], sphere.vertexCount,
+                                                   &sphere.indices[0], (GLsizei) sphere.indices.size(), GL_UNSIGNED_INT))
+        {
+            fprintf(stderr, "Could not set up the %s shader variant scene\n", names[m]);
+            continue;
+        }
+        LightingLocations locations;
+        getLightingLocations(program, &locations);
+        int frames = 0;
+        double elapsed = 0.0;
+        start = benchmarkNowNanoseconds();
+        do
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            cachedUseProgram(program);
+            cachedUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, projection);
+            cachedUniformMatrix4fv(glGetUniformLocation(program, "modelView"), 1, modelView);
+            LightingUniforms uniforms;
+            computeLightingUniforms(&uniforms, light, eye, ambient, white, white, &materials[m]);
+            applyLightingUniforms(&locations, &uniforms);
+            drawMesh(&mesh);
+            glFinish();
+            frames++;
+            elapsed = benchmarkNowNanoseconds() - start;
+        } while (frames < 3 || elapsed < benchmarkOptions.minTimeMilliseconds * 1e6);
+        benchmarkReport((std::string("shaderVariant.") + names[m]).c_str(), (int) sphere.indices.size() / 3,
+                        "msPerFrame", elapsed / 1e6 / frames);
+        deleteMesh(&mesh);
+    }
+    cachedDisable(GL_DEPTH_TEST);
+    cachedUseProgram(0);
+    deleteShaderVariants();
+    resetStateCache();
+}
+
+static const int uniformBlockObjects = 48;
+
+// 画一帧：第i个物体用programs[i % 3]，blocks为false时用单独的uniform，否则用共享的uniform块
+static void drawUniformBlockFrame(bool blocks, const GLuint* programs, const Mesh* meshes, const LightingLocations* locations,
+                                  const float* projection, const float* modelViews, const LightingUniforms* lighting)
+{
+    GLintptr offsets[uniformBlockObjects];
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (blocks)
+    {
+        beginUniformFrame();
+        updateCameraBlock(projection, NULL);
+        updateLightingBlock(lighting);
+        for (int i = 0; i < uniformBlockObjects; i++)
+        {
+            offsets[i] = writeObjectBlock(&modelViews[(size_t) i * 16]); // 先全部写好，每帧只映射一次
+        }
+    }
+    for (int i = 0; i < uniformBlockObjects; i++)
+    {
+        int m = i % 3;
+        cachedUseProgram(programs[m]);
+        if (blocks)
+        {
+            bindObjectBlock(offsets[i]);
+        }
+        else
+        {
+            cachedUniformMatrix4fv(glGetUniformLocation(programs[m], "projection"), 1, projection);
+            cachedUniformMatrix4fv(glGetUniformLocation(programs[m], "modelView"), 1, &modelViews[(size_t) i * 16]);
+            applyLightingUniforms(&locations[m], lighting);
+        }
+        drawMesh(&meshes[m]);
+    }
+    if (blocks)
+    {
+        endUniformFrame();
+    }
+}
+
+/**
+ * 多程序场景：48个小球轮流用三种光照变体绘制，每个物体都要切换程序。分别用单独的uniform（每次切换后对新程序重新设置
+ * projection、modelView和光照参数）和共享的uniform块（相机、光照每帧上传一次，物体矩阵先全部写进流式缓冲区，
+ * 每个物体只换一下Object块的偏移）绘制，报告帧时间和每帧真正调用驱动的glUniform*次数。
+ */
+static void benchmarkUniformBlocks()
+{
+    resetStateCache();
+    resetShaderVariants();
+    if (!initUniformBlocks(uniformBlockObjects))
+    {
+        fprintf(stderr, "Could not set up uniform blocks\n");
+        return;
+    }
+    SphereMesh sphere;
+    createSphere(&sphere, 32, 16);
+    std::vector<float> colours((size_t) sphere.vertexCount * 3, 0.8f);
+    std::vector<float> normals((size_t) sphere.vertexCount * 3);
+    for (int v = 0; v < sphere.vertexCount; v++)
+    {
+        memcpy(&normals[(size_t) v * 3], &sphere.attributes[(size_t) v * 5], sizeof(float) * 3);
+    }
+    const float* sources[3] = {&sphere.positions[0], &normals[0], &colours[0]};
+    LightingMaterial materials[3] = {{{0.0f, 0.0f, 0.0f}, 2.0f, 0, false},
+                                     {{1.0f, 1.0f, 1.0f}, 2.0f, 0, false},
+                                     {{1.0f, 1.0f, 1.0f}, 2.0f, 0, true}};
+    static const float light[3] = {0.0f, 1.0f, 1.0f};
+    static const float eye[3] = {0.0f, 0.0f, 1.0f};
+    static const float ambient[3] = {0.1f, 0.1f, 0.1f};
+    static const float white[3] = {1.0f, 1.0f, 1.0f};
+    LightingUniforms lighting;
+    computeLightingUniforms(&lighting, light, eye, ambient, white, white, &materials[1]);
+    float projection[16];
+    matrixPerspective(projection, 45.0f, 1.0f, 0.1f, 100.0f);
+    std::vector<float> modelViews((size_t) uniformBlockObjects * 16);
+    for (int i = 0; i < uniformBlockObjects; i++)
+    {
+        matrixEulerTransform(&modelViews[(size_t) i * 16], 0.0f, 0.0f, 0.0f,
+                             (i % 8 - 3.5f) * 0.5f, (i / 8 - 2.5f) * 0.5f, -6.0f, 0.2f, 0.2f, 0.2f);
+    }
+    cachedViewport(0, 0, benchmarkContextSize, benchmarkContextSize);
+    cachedEnable(GL_DEPTH_TEST);
+    const char* names[2] = {"uniformBlocks.separate", "uniformBlocks.shared"};
+    for (int blocks = 0; blocks < 2; blocks++)
+    {
+        GLuint programs[3];
+        Mesh meshes[3];
+        LightingLocations locations[3];
+        bool ready = true;
+        for (int m = 0; m < 3; m++)
+        {
+            unsigned int features = materialShaderFeatures(&materials[m]) | (blocks ? SHADER_UNIFORM_BLOCKS : 0);
+            programs[m] = getShaderVariant(&phongTemplate, features);
+            VertexLayout layout;
+            initVertexLayout(&layout);
+            addVertexElement(&layout, glGetAttribLocation(programs[m], "vertexPosition"), 3, VERTEX_FLOAT);
+            addVertexElement(&layout, glGetAttribLocation(programs[m], "vertexNormal"), 3, VERTEX_FLOAT);
+            addVertexElement(&layout, glGetAttribLocation(programs[m], "vertexColour"), 3, VERTEX_FLOAT);
+            std::vector<unsigned char> vertices((size_t) sphere.vertexCount * layout.stride);
+            packVertices(&layout, sources, sphere.vertexCount, &vertices[0]);
+            memset(&meshes[m], 0, sizeof(Mesh));
+            ready = ready && programs[m] != 0
+                    && createInterleavedMesh(&meshes[m], GL_TRIANGLES, &layout, &vertices[0], sphere.vertexCount,
+                                             &sphere.indices[0], (GLsizei) sphere.indices.size(), GL_UNSIGNED_INT);
+            getLightingLocations(programs[m], &locations[m]);
+        }
+        if (ready)
+        {
+            // 预热：llvmpipe第一次用程序绘制时才编译着色器，不算在帧时间里
+            drawUniformBlockFrame(blocks != 0, programs, meshes, locations, projection, &modelViews[0], &lighting);
+            glFinish();
+            resetStateCacheStats();
+            resetUniformBlockStats();
+            int frames = 0;
+            double elapsed = 0.0;
+            double start = benchmarkNowNanoseconds();
+            do
+            {
+                drawUniformBlockFrame(blocks != 0, programs, meshes, locations, projection, &modelViews[0], &lighting);
+                glFinish();
+                frames++;
+                elapsed = benchmarkNowNanoseconds() - start;
+            } while (frames < 3 || elapsed < benchmarkOptions.minTimeMilliseconds * 1e6);
+            StateCacheStats stats;
+            getStateCacheStats(&stats);
+            benchmarkReport(names[blocks], uniformBlockObjects, "msPerFrame", elapsed / 1e6 / frames);
+            benchmarkReport((std::string(names[blocks]) + ".uniformCalls").c_str(), uniformBlockObjects,
+                            "perFrame", (double) stats.issued[STATE_UNIFORM] / frames);
+            if (blocks)
+            {
+                UniformBlockStats blockStats;
+                getUniformBlockStats(&blockStats);
+                benchmarkReport("uniformBlocks.shared.blockUploads", uniformBlockObjects, "perFrame",
+                                (double) (blockStats.cameraUploads + blockStats.lightingUploads) / frames);
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Could not set up the %s scene\n", names[blocks]);
+        }
+        for (int m = 0; m < 3; m++)
+        {
+            deleteMesh(&meshes[m]);
+        }
+    }
+    cachedDisable(GL_DEPTH_TEST);
+    cachedUseProgram(0);
+    deleteShaderVariants();
+    deleteUniformBlocks();
+    resetStateCache();
+}
+
+static const int renderQueueObjects = 2000;
+static const int renderQueueSortKeys = 100000;
+
+// 渲染队列测试用的着色器，属性位置固定，实例矩阵占4到7
+static const char renderQueueInstancedVertexShader[] =
+        "#version 300 es\n"
+        "layout(location = 0) in vec3 vertexPosition;\n"
+        "layout(location = 1) in vec2 vertexTextureCoordinate;\n"
+        "layout(location = 4) in mat4 instanceModelView;\n"
+        "uniform mat4 projection;\n"
+        "out vec2 textureCoordinate;\n"
+        "void main()\n"
+        "{\n"
+        "    textureCoordinate = vertexTextureCoordinate;\n"
+        "    gl_Position = projection * instanceModelView * vec4(vertexPosition, 1.0);\n"
+        "}\n";
+
+static const char renderQueueVertexShader[] =
+        "#version 300 es\n"
+        "layout(location = 0) in vec3 vertexPosition;\n"
+        "layout(location = 1) in vec2 vertexTextureCoordinate;\n"
+        "uniform mat4 projection;\n"
+        "uniform mat4 modelView;\n"
+        "out vec2 textureCoordinate;\n"
+        "void main()\n"
+        "{\n"
+        "    textureCoordinate = vertexTextureCoordinate;\n"
+        "    gl_Position = projection * modelView * vec4(vertexPosition, 1.0);\n"
+        "}\n";
+
+static const char renderQueueColourShader[] =
+        "#version 300 es\n"
+        "precision mediump float;\n"
+        "in vec2 textureCoordinate;\n"
+        "out vec4 fragColour;\n"
+        "void main()\n"
+        "{\n"
+        "    fragColour = vec4(textureCoordinate, 0.5, 1.0);\n"
+        "}\n";
+
+static const char renderQueueTextureShader[] =
+        "#version 300 es\n"
+        "precision mediump float;\n"
+        "in vec2 textureCoordinate;\n"
+        "uniform sampler2D texture0;\n"
+        "out vec4 fragColour;\n"
+        "void main()\n"
+        "{\n"
+        "    fragColour = texture(texture0, textureCoordinate);\n"
+        "}\n";
+
+static const char renderQueueTranslucentShader[] =
+        "#version 300 es\n"
+        "precision mediump float;\n"
+        "in vec2 textureCoordinate;\n"
+        "out vec4 fragColour;\n"
+        "void main()\n"
+        "{\n"
+        "    fragColour = vec4(0.2, 0.6, 1.0, 0.5);\n"
+        "}\n";
+
+static bool createSphereMesh(Mesh* mesh, int segments, int rings)
+{
+    SphereMesh sphere;
+    createSphere(&sphere, segments, rings);
+    std::vector<float> textureCoordinates((size_t) sphere.vertexCount * 2);
+    for (int v = 0; v < sphere.vertexCount; v++)
+    {
+        memcpy(&textureCoordinates[(size_t) v * 2], &sphere.attributes[(size_t) v * 5 + 3], sizeof(float) * 2);
+    }
+    MeshAttribute attributes[2] = {
+            {0, 3, GL_FLOAT, GL_FALSE, &sphere.positions[0], (GLsizeiptr) (sphere.positions.size() * sizeof(float)), 0},
+            {1, 2, GL_FLOAT, GL_FALSE, &textureCoordinates[0],
+             (GLsizeiptr) (textureCoordinates.size() * sizeof(float)), 0}};
+    return createMesh(mesh, GL_TRIANGLES, attributes, 2, sphere.vertexCount, &sphere.indices[0],
+                      (GLsizei) sphere.indices.size(), GL_UNSIGNED_INT);
+}
+
+// 4×4的棋盘格纹理
+static GLuint createCheckerTexture(unsigned char red, unsigned char green, unsigned char blue)
+{
+    unsigned char pixels[4 * 4 * 4];
+    for (int i = 0; i < 16; i++)
+    {
+        unsigned char shade = ((i % 4) + (i / 4)) % 2 ? 255 : 96;
+        pixels[i * 4] = (unsigned char) (red * shade / 255);
+        pixels[i * 4 + 1] = (unsigned char) (green * shade / 255);
+        pixels[i * 4 + 2] = (unsigned char) (blue * shade / 255);
+        pixels[i * 4 + 3] = 255;
+    }
+    GLuint texture;
+    glGenTextures(1, &texture);
+    cachedActiveTexture(GL_TEXTURE0);
+    cachedBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 4, 4, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return texture;
+}
+
+struct RenderQueueObject
+{
+    int material;
+    int mesh;
+    float modelView[16];
+};
+
+static void drawRenderQueueFrame(RenderQueue* queue, const std::vector<RenderQueueObject>& objects,
+                                 const RenderMaterial* materials, const Mesh* meshes, const float* projection)
+{
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    beginRenderQueue(queue, 0.1f, 100.0f);
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        submitDraw(queue, 0, &materials[objects[i].material], &meshes[objects[i].mesh], objects[i].modelView);
+    }
+    flushRenderQueue(queue, projection);
+}
+
+// 基数排序和std::sort排同样的随机键（高位只有少数几种取值，和真实的排序键类似）
+static void benchmarkRadixSort()
+{
+    int count = renderQueueSortKeys < benchmarkOptions.maxCount ? renderQueueSortKeys : benchmarkOptions.maxCount;
+    if (count < 2)
+    {
+        return;
+    }
+    srand(1);
+    std::vector<unsigned long long> source(count);
+    for (int i = 0; i < count; i++)
+    {
+        source[i] = ((unsigned long long) (rand() % 4) << 35) | ((unsigned long long) (rand() % 8) << 24)
+                    | (unsigned long long) (rand() & 0xffffff);
+    }
+    std::vector<unsigned long long> keys(count);
+    std::vector<unsigned long long> scratchKeys(count);
+    std::vector<unsigned int> order(count);
+    std::vector<unsigned int> scratchOrder(count);
+    const char* names[2] = {"renderQueue.radixSort", "renderQueue.stdSort"};
+    for (int method = 0; method < 2; method++)
+    {
+        int runs = 0;
+        double elapsed = 0.0;
+        do
+        {
+            keys = source;
+            double start = benchmarkNowNanoseconds();
+            if (method == 0)
+            {
+                radixSortKeys(&keys[0], &order[0], count, &scratchKeys[0], &scratchOrder[0]);
+            }
+            else
+            {
+                std::sort(keys.begin(), keys.end());
+            }
+            elapsed += benchmarkNowNanoseconds() - start;
+            runs++;
+        } while (runs < 3 || elapsed < benchmarkOptions.minTimeMilliseconds * 1e6);
+        benchmarkReport(names[method], count, "nsPerKey", elapsed / runs / count);
+    }
+}
+
+/**
+ * 排序键渲染队列：2000个小球随机用四种材质（纯色、两种纹理、半透明）和两种精度的网格，按随机顺序提交。
+ * 分别按提交顺序逐个绘制、排序后逐个绘制、排序并合并成实例化批次，报告帧时间、排序和提交的CPU时间、
+ * 每帧的状态切换（程序、纹理、网格）和绘制调用次数。另外比较基数排序和std::sort排10万个键的耗时。
+ */
+static void benchmarkRenderQueue()
+{
+    benchmarkRadixSort();
+    resetStateCache();
+    GLuint instancedColour = createProgram(renderQueueInstancedVertexShader, renderQueueColourShader);
+    GLuint instancedTexture = createProgram(renderQueueInstancedVertexShader, renderQueueTextureShader);
+    GLuint translucent = createProgram(renderQueueVertexShader, renderQueueTranslucentShader);
+    Mesh meshes[2];
+    memset(meshes, 0, sizeof(meshes));
+    InstanceBuffer instances[2];
+    memset(instances, 0, sizeof(instances));
+    GLuint textures[2] = {createCheckerTexture(255, 128, 64), createCheckerTexture(64, 255, 128)};
+    RenderQueue queue;
+    bool ready = createRenderQueue(&queue) && instancedColour != 0 && instancedTexture != 0 && translucent != 0;
+    for (int m = 0; m < 2 && ready; m++)
+    {
+        // 实例属性由队列指向流式缓冲区，这里只需要在VAO里启用属性和设好除数
+        ready = createSphereMesh(&meshes[m], m ? 8 : 16, m ? 4 : 8)
+                && attachInstanceMatrices(&meshes[m], &instances[m], 4, 1);
+    }
+    if (!ready)
+    {
+        fprintf(stderr, "Could not set up the render queue scene\n");
+    }
+    else
+    {
+        GLint projectionLocations[3] = {glGetUniformLocation(instancedColour, "projection"),
+                                        glGetUniformLocation(instancedTexture, "projection"),
+                                        glGetUniformLocation(translucent, "projection")};
+        RenderMaterial materials[4] = {
+                {instancedColour, 0, false, projectionLocations[0], -1, 4},
+                {instancedTexture, textures[0], false, projectionLocations[1], -1, 4},
+                {instancedTexture, textures[1], false, projectionLocations[1], -1, 4},
+                {translucent, 0, true, projectionLocations[2], glGetUniformLocation(translucent, "modelView"), -1}};
+        cachedUseProgram(instancedTexture);
+        glUniform1i(glGetUniformLocation(instancedTexture, "texture0"), 0);
+        srand(2);
+        std::vector<RenderQueueObject> objects(renderQueueObjects);
+        for (int i = 0; i < renderQueueObjects; i++)
+        {
+            // 半透明的占八分之一
+            objects[i].material = rand() % 8 == 0 ? 3 : rand() % 3;
+            objects[i].mesh = rand() % 2;
+            float x = (rand() % 1000 / 1000.0f - 0.5f) * 8.0f;
+            float y = (rand() % 1000 / 1000.0f - 0.5f) * 8.0f;
+            float z = -4.0f - rand() % 1000 / 1000.0f * 20.0f;
+            matrixEulerTransform(objects[i].modelView, 0.0f, 0.0f, 0.0f, x, y, z, 0.1f, 0.1f, 0.1f);
+        }
+        float projection[16];
+        matrixPerspective(projection, 45.0f, 1.0f, 0.1f, 100.0f);
+        cachedViewport(0, 0, benchmarkContextSize, benchmarkContextSize);
+        cachedEnable(GL_DEPTH_TEST);
+        const char* names[3] = {"renderQueue.submissionOrder", "renderQueue.sorted", "renderQueue.batched"};
+        for (int mode = 0; mode < 3; mode++)
+        {
+            queue.sort = mode > 0;
+            queue.batch = mode > 1;
+            // 预热：llvmpipe第一次用程序绘制时才编译着色器
+            drawRenderQueueFrame(&queue, objects, materials, meshes, projection);
+            glFinish();
+            resetRenderQueueStats(&queue);
+            int frames = 0;
+            double elapsed = 0.0;
+            double start = benchmarkNowNanoseconds();
+            do
+            {
+                drawRenderQueueFrame(&queue, objects, materials, meshes, projection);
+                glFinish();
+                frames++;
+                elapsed = benchmarkNowNanoseconds() - start;
+            } while (frames < 3 || elapsed < benchmarkOptions.minTimeMilliseconds * 1e6);
+            const RenderQueueStats& stats = queue.stats;
+            std::string name = names[mode];
+            benchmarkReport(name.c_str(), renderQueueObjects, "msPerFrame", elapsed / 1e6 / frames);
+            benchmarkReport((name + ".sort").c_str(), renderQueueObjects, "msPerFrame", stats.sortMilliseconds / frames);
+            benchmarkReport((name + ".submit").c_str(), renderQueueObjects, "msPerFrame",
+                            stats.submitMilliseconds / frames);
+            const RenderStateChanges& changes = mode == 0 ? stats.unsorted : stats.sorted;
+            benchmarkReport((name + ".stateChanges").c_str(), renderQueueObjects, "perFrame",
+                            (double) (changes.programs + changes.textures + changes.meshes) / frames);
+            benchmarkReport((name + ".drawCalls").c_str(), renderQueueObjects, "perFrame",
+                            (double) changes.drawCalls / frames);
+            if (stats.overflows > 0)
+            {
+                fprintf(stderr, "%s dropped %d batches\n", names[mode], stats.overflows);
+            }
+        }
+        cachedDisable(GL_DEPTH_TEST);
+    }
+    deleteRenderQueue(&queue);
+    for (int m = 0; m < 2; m++)
+    {
+        deleteInstanceBuffer(&instances[m]);
+        deleteMesh(&meshes[m]);
+    }
+    cachedDeleteTextures(2, textures);
+    cachedUseProgram(0);
+    cachedDeleteProgram(instancedColour);
+    cachedDeleteProgram(instancedTexture);
+    cachedDeleteProgram(translucent);
+    resetStateCache();
+}
+
+/**
+ * 场景注册表：在同一个进程里依次切换到每一课，测加载（dlopen和注册）加setup的耗时和之后的帧时间。
+ * 课程库从Benchmark所在的目录加载；InstancedCube已经直接链接，不需要加载。
+ */
+static void benchmarkScenes()
+{
+    char executable[512];
+    ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+    if (length <= 0)
+    {
+        fprintf(stderr, "Could not find the benchmark directory\n");
+        return;
+    }
+    executable[length] = '\0';
+    char* separator = strrchr(executable, '/');
+    if (separator != NULL)
+    {
+        *separator = '\0';
+    }
+    setSceneLibraryDirectory(executable);
+    resetStateCache();
+    for (int i = 0; i < sceneCount(); i++)
+    {
+        const char* name = sceneName(i);
+        double start = benchmarkNowNanoseconds();
+        if (!selectScene(name, benchmarkContextSize, benchmarkContextSize))
+        {
+            fprintf(stderr, "Could not select scene %s\n", name);
+            continue;
+        }
+        glFinish();
+        benchmarkReport((std::string("scene.") + name + ".select").c_str(), 1, "ms",
+                        (benchmarkNowNanoseconds() - start) / 1e6);
+        const Scene* scene = currentScene();
+        int frames = 0;
+        double elapsed = 0.0;
+        start = benchmarkNowNanoseconds();
+        do
+        {
+            scene->render();
+            glFinish();
+            frames++;
+            elapsed = benchmarkNowNanoseconds() - start;
+        } while (frames < 3 || elapsed < benchmarkOptions.minTimeMilliseconds * 1e6);
+        benchmarkReport((std::string("scene.") + name + ".frame").c_str(), frames, "msPerFrame", elapsed / 1e6 / frames);
+    }
+    closeScene();
+    setSceneLibraryDirectory(NULL);
+    resetStateCache();
+}
+
+bool runGLBenchmarks()
+{
+    if (!createHostContext(benchmarkContextSize, benchmarkContextSize))
+    {
+        return false;
+    }
+    benchmarkProgramCache();
+    benchmarkInstancing();
+    benchmarkTextureStreaming();
+    benchmarkAtlasUpload();
+    benchmarkMeshCache();
+    benchmarkLod();
+    benchmarkShaderVariants();
+    benchmarkUniformBlocks();
+    benchmarkRenderQueue();
+    benchmarkScenes();
+    destroyHostContext();
+    return true;
+}
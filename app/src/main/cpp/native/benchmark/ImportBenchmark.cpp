@@ -0,0 +1,220 @@
+/**
+ * 网格导入的性能测试：生成(n + 1)²个顶点、2n²个三角形的网格面片（n = 256和1024，后者约210万个三角形），
+ * 分别写成OBJ（v/vt/vn，四边形面）和glb（32位索引），用单线程和按CPU核数多线程导入，
+ * 报告吞吐量（MB/s，按文件大小算）和解析、去重各自的耗时。
+ *
+ * 同时检查结果：去重后的顶点数应该正好是(n + 1)²，超过65536个顶点时要用32位索引，多线程的结果要和单线程完全相同；
+ * 另外用一个小OBJ检查负数（相对）索引和多边形的扇形切分。
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../include/MeshImport.h"
+
+static void gridVertex(int n, int x, int y, float* position, float* normal, float* textureCord)
+{
+    float u = (float) x / n;
+    float v = (float) y / n;
+    position[0] = u * 10.0f - 5.0f;
+    position[1] = 0.25f * (float) ((x * 7 + y * 13) % 17) / 17.0f;
+    position[2] = v * 10.0f - 5.0f;
+    normal[0] = 0.0f;
+    normal[1] = 1.0f;
+    normal[2] = 0.0f;
+    textureCord[0] = u;
+    textureCord[1] = v;
+}
+
+bool writeGridObj(const std::string& path, int n)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == NULL)
+    {
+        return false;
+    }
+    fprintf(file, "# %dx%d grid\no grid\n", n, n);
+    for (int y = 0; y <= n; y++)
+    {
+        for (int x = 0; x <= n; x++)
+        {
+            float position[3], normal[3], textureCord[2];
+            gridVertex(n, x, y, position, normal, textureCord);
+            fprintf(file, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.1f %.1f %.1f\n", position[0], position[1], position[2],
+                    textureCord[0], textureCord[1], normal[0], normal[1], normal[2]);
+        }
+    }
+    for (int y = 0; y < n; y++)
+    {
+        for (int x = 0; x < n; x++)
+        {
+            int a = y * (n + 1) + x + 1;
+            int b = a + 1;
+            int c = a + n + 2;
+            int d = a + n + 1;
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+static void appendBytes(std::vector<unsigned char>* out, const void* data, size_t bytes)
+{
+    out->insert(out->end(), (const unsigned char*) data, (const unsigned char*) data + bytes);
+}
+
+bool writeGridGlb(const std::string& path, int n)
+{
+    int vertices = (n + 1) * (n + 1);
+    std::vector<float> positions(vertices * 3), normals(vertices * 3), textureCords(vertices * 2);
+    for (int y = 0; y <= n; y++)
+    {
+        for (int x = 0; x <= n; x++)
+        {
+            int i = y * (n + 1) + x;
+            gridVertex(n, x, y, &positions[i * 3], &normals[i * 3], &textureCords[i * 2]);
+        }
+    }
+    std::vector<unsigned int> indices;
+    for (int y = 0; y < n; y++)
+    {
+        for (int x = 0; x < n; x++)
+        {
+            unsigned int a = y * (n + 1) + x;
+            unsigned int quad[6] = {a, a + 1, a + n + 2, a, a + n + 2, a + n + 1};
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+    size_t sizes[4] = {positions.size() * 4, normals.size() * 4, textureCords.size() * 4, indices.size() * 4};
+    char json[2048];
+    snprintf(json, sizeof(json),
+             "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":%zu}],"
+             "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%zu},"
+             "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+             "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+             "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+             "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\"},"
+             "{\"bufferView\":1,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\"},"
+             "{\"bufferView\":2,\"componentType\":5126,\"count\":%d,\"type\":\"VEC2\"},"
+             "{\"bufferView\":3,\"componentType\":5125,\"count\":%zu,\"type\":\"SCALAR\"}],"
+             "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},"
+             "\"indices\":3,\"mode\":4}]}]}",
+             sizes[0] + sizes[1] + sizes[2] + sizes[3], sizes[0], sizes[0], sizes[1], sizes[0] + sizes[1], sizes[2],
+             sizes[0] + sizes[1] + sizes[2], sizes[3], vertices, vertices, vertices, indices.size());
+    std::string jsonChunk = json;
+    jsonChunk.resize((jsonChunk.size() + 3) & ~(size_t) 3, ' ');
+    unsigned int binaryBytes = (unsigned int) (sizes[0] + sizes[1] + sizes[2] + sizes[3]);
+    unsigned int header[5] = {0x46546C67, 2, (unsigned int) (12 + 8 + jsonChunk.size() + 8 + binaryBytes),
+                              (unsigned int) jsonChunk.size(), 0x4E4F534A};
+    unsigned int binaryHeader[2] = {binaryBytes, 0x004E4942};
+    std::vector<unsigned char> file;
+    appendBytes(&file, header, sizeof(header));
+    appendBytes(&file, jsonChunk.data(), jsonChunk.size());
+    appendBytes(&file, binaryHeader, sizeof(binaryHeader));
+    appendBytes(&file, &positions[0], sizes[0]);
+    appendBytes(&file, &normals[0], sizes[1]);
+    appendBytes(&file, &textureCords[0], sizes[2]);
+    appendBytes(&file, &indices[0], sizes[3]);
+    FILE* stream = fopen(path.c_str(), "wb");
+    if (stream == NULL)
+    {
+        return false;
+    }
+    bool written = fwrite(&file[0], 1, file.size(), stream) == file.size();
+    return fclose(stream) == 0 && written;
+}
+
+static bool sameMesh(const ImportedMesh& a, const ImportedMesh& b)
+{
+    return a.vertexCount == b.vertexCount && a.indexCount == b.indexCount && a.indexType == b.indexType &&
+           a.positions == b.positions && a.normals == b.normals && a.textureCords == b.textureCords &&
+           a.indices == b.indices && a.shortIndices == b.shortIndices;
+}
+
+static void benchmarkImport(const char* name, const std::string& path, int n)
+{
+    int threads = (int) std::thread::hardware_concurrency();
+    threads = threads > 0 ? threads : 1;
+    ImportedMesh single;
+    ImportedMesh parallel;
+    const int threadCounts[2] = {1, threads};
+    for (int run = 0; run < (threads > 1 ? 2 : 1); run++)
+    {
+        ImportedMesh* mesh = run == 0 ? &single : &parallel;
+        MeshImportStats stats;
+        double start = benchmarkNowNanoseconds();
+        if (!importMesh(path.c_str(), threadCounts[run], mesh, &stats))
+        {
+            fprintf(stderr, "Could not import %s\n", path.c_str());
+            return;
+        }
+        double milliseconds = (benchmarkNowNanoseconds() - start) / 1e6;
+        std::string prefix = std::string("import.") + name + (run == 0 ? "" : ".parallel");
+        benchmarkReport((prefix + ".mbPerSecond").c_str(), stats.triangles, "mbPerSecond",
+                        stats.fileBytes / 1e6 / (milliseconds / 1000.0));
+        benchmarkReport((prefix + ".parse").c_str(), stats.triangles, "ms", stats.parseMilliseconds);
+        benchmarkReport((prefix + ".dedup").c_str(), stats.triangles, "ms", stats.dedupMilliseconds);
+        if (mesh->vertexCount != (n + 1) * (n + 1) || stats.triangles != 2 * n * n ||
+            mesh->indexType != ((n + 1) * (n + 1) > 65536 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT))
+        {
+            fprintf(stderr, "%s imported %d vertices and %d triangles\n", path.c_str(), mesh->vertexCount,
+                    stats.triangles);
+        }
+    }
+    benchmarkReport((std::string("import.") + name + ".bytes").c_str(), 2 * n * n, "bytes",
+                    (double) (single.positions.size() * 4 + single.normals.size() * 4 + single.textureCords.size() * 4 +
+                              single.indices.size() * 4 + single.shortIndices.size() * 2));
+    if (threads > 1 && !sameMesh(single, parallel))
+    {
+        fprintf(stderr, "Parallel import of %s differs from single-threaded import\n", path.c_str());
+    }
+}
+
+// 相对索引、五边形和缺少纹理坐标的面
+static bool checkSmallObj()
+{
+    static const char obj[] = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0.5 1.5 0\nv 0 1 0\nvn 0 0 1\n"
+                              "f -5//-1 -4//-1 -3//-1 -2//-1 -1//-1\r\n# comment\nf 1//1 2//1 3//1\n";
+    ImportedMesh mesh;
+    MeshImportStats stats;
+    if (!importObj(obj, sizeof(obj) - 1, 1, &mesh, &stats))
+    {
+        return false;
+    }
+    return stats.triangles == 4 && mesh.vertexCount == 5 && mesh.hasNormals && !mesh.hasTextureCords &&
+           mesh.indexType == GL_UNSIGNED_SHORT && mesh.shortIndices[9] == 0 && mesh.shortIndices[11] == 2;
+}
+
+void runImportBenchmarks()
+{
+    if (!checkSmallObj())
+    {
+        fprintf(stderr, "Small OBJ imported incorrectly\n");
+    }
+    char directory[] = "/tmp/learnopengl-meshes-XXXXXX";
+    if (mkdtemp(directory) == NULL)
+    {
+        fprintf(stderr, "Could not create mesh directory\n");
+        return;
+    }
+    for (int n = 256; n <= 1024; n *= 4)
+    {
+        std::string objPath = std::string(directory) + "/grid.obj";
+        std::string glbPath = std::string(directory) + "/grid.glb";
+        if (!writeGridObj(objPath, n) || !writeGridGlb(glbPath, n))
+        {
+            fprintf(stderr, "Could not write test meshes\n");
+            break;
+        }
+        benchmarkImport("obj", objPath, n);
+        benchmarkImport("glb", glbPath, n);
+        unlink(objPath.c_str());
+        unlink(glbPath.c_str());
+    }
+    rmdir(directory);
+}
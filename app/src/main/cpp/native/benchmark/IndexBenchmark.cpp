@@ -0,0 +1,167 @@
+/**
+ * 索引优化的性能测试：1024×1024个四边形的网格面片（约210万个三角形），按两种顺序给出：
+ * 逐行扫描（和课程里手写的indices一样）以及三角形和顶点编号都随机打乱（像没有整理过的导入结果）。
+ * 报告顶点缓存优化、过度绘制优化、顶点读取重排各自的吞吐量（百万三角形每秒），以及优化前后的ACMR、ATVR、
+ * 过度绘制和顶点读取量。同时检查优化只改变了三角形的顺序，并报告lesson5立方体手写索引优化前后的ACMR。
+ */
+#include <GLES3/gl3.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../include/IndexOptimizer.h"
+
+static const int gridSize = 1024;
+
+struct IndexedGrid
+{
+    int vertexCount;
+    std::vector<float> positions;
+    std::vector<unsigned int> indices;
+};
+
+static void createGrid(IndexedGrid* grid, bool shuffled)
+{
+    int n = gridSize;
+    grid->vertexCount = (n + 1) * (n + 1);
+    grid->positions.resize((size_t) grid->vertexCount * 3);
+    for (int y = 0; y <= n; y++)
+    {
+        for (int x = 0; x <= n; x++)
+        {
+            float* position = &grid->positions[((size_t) y * (n + 1) + x) * 3];
+            position[0] = (float) x / n * 10.0f - 5.0f;
+            position[1] = 0.25f * (float) ((x * 7 + y * 13) % 17) / 17.0f;
+            position[2] = (float) y / n * 10.0f - 5.0f;
+        }
+    }
+    grid->indices.clear();
+    for (int y = 0; y < n; y++)
+    {
+        for (int x = 0; x < n; x++)
+        {
+            unsigned int a = y * (n + 1) + x;
+            unsigned int quad[6] = {a, a + n + 2, a + 1, a, a + n + 1, a + n + 2};
+            grid->indices.insert(grid->indices.end(), quad, quad + 6);
+        }
+    }
+    if (!shuffled)
+    {
+        return;
+    }
+    srand(1);
+    int triangles = (int) grid->indices.size() / 3;
+    for (int i = triangles - 1; i > 0; i--)
+    {
+        int j = (int) (((long long) rand() * (RAND_MAX + 1LL) + rand()) % (i + 1));
+        std::swap_ranges(&grid->indices[i * 3], &grid->indices[i * 3] + 3, &grid->indices[j * 3]);
+    }
+    std::vector<unsigned int> order(grid->vertexCount);
+    for (int v = 0; v < grid->vertexCount; v++)
+    {
+        order[v] = v;
+    }
+    for (int v = grid->vertexCount - 1; v > 0; v--)
+    {
+        std::swap(order[v], order[((long long) rand() * (RAND_MAX + 1LL) + rand()) % (v + 1)]);
+    }
+    std::vector<float> positions(grid->positions.size());
+    remapVertices(&positions[0], &grid->positions[0], grid->vertexCount, sizeof(float) * 3, &order[0]);
+    grid->positions.swap(positions);
+    remapIndices(&grid->indices[0], (int) grid->indices.size(), &order[0]);
+}
+
+static void reportAnalysis(const std::string& prefix, const IndexedGrid& grid)
+{
+    int indexCount = (int) grid.indices.size();
+    VertexCacheStats cache;
+    OverdrawStats overdraw;
+    VertexFetchStats fetch;
+    analyzeVertexCache(&grid.indices[0], indexCount, grid.vertexCount, &cache);
+    analyzeOverdraw(&grid.indices[0], indexCount, &grid.positions[0], grid.vertexCount, &overdraw);
+    analyzeVertexFetch(&grid.indices[0], indexCount, grid.vertexCount, sizeof(float) * 3, &fetch);
+    benchmarkReport((prefix + ".acmr").c_str(), cache.triangles, "acmr", cache.acmr);
+    benchmarkReport((prefix + ".atvr").c_str(), cache.triangles, "atvr", cache.atvr);
+    benchmarkReport((prefix + ".overdraw").c_str(), cache.triangles, "overdraw", overdraw.overdraw);
+    benchmarkReport((prefix + ".overfetch").c_str(), cache.triangles, "overfetch", fetch.overfetch);
+}
+
+static std::vector<std::pair<unsigned long long, unsigned int> > sortedTriangles(const std::vector<unsigned int>& indices)
+{
+    std::vector<std::pair<unsigned long long, unsigned int> > triangles(indices.size() / 3);
+    for (size_t t = 0; t < triangles.size(); t++)
+    {
+        triangles[t].first = (unsigned long long) indices[t * 3] << 32 | indices[t * 3 + 1];
+        triangles[t].second = indices[t * 3 + 2];
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+// 排序后的三角形列表相同，说明只改变了三角形的顺序
+static bool sameTriangles(const std::vector<unsigned int>& a, const std::vector<unsigned int>& b)
+{
+    return sortedTriangles(a) == sortedTriangles(b);
+}
+
+static void benchmarkOptimizer(const char* name, bool shuffled)
+{
+    IndexedGrid grid;
+    createGrid(&grid, shuffled);
+    std::string prefix = std::string("index.") + name;
+    int indexCount = (int) grid.indices.size();
+    int triangles = indexCount / 3;
+    reportAnalysis(prefix + ".before", grid);
+    std::vector<unsigned int> original = grid.indices;
+
+    double start = benchmarkNowNanoseconds();
+    optimizeVertexCache(&grid.indices[0], &grid.indices[0], indexCount, grid.vertexCount);
+    double cacheNanoseconds = benchmarkNowNanoseconds() - start;
+    std::vector<unsigned int> reordered(indexCount);
+    start = benchmarkNowNanoseconds();
+    optimizeOverdraw(&reordered[0], &grid.indices[0], indexCount, &grid.positions[0], grid.vertexCount,
+                     defaultOverdrawThreshold);
+    double overdrawNanoseconds = benchmarkNowNanoseconds() - start;
+    if (!sameTriangles(original, reordered))
+    {
+        fprintf(stderr, "Index optimization of the %s grid changed its triangles\n", name);
+    }
+    start = benchmarkNowNanoseconds();
+    std::vector<unsigned int> remap(grid.vertexCount);
+    int vertexCount = optimizeVertexFetchRemap(&remap[0], &reordered[0], indexCount, grid.vertexCount);
+    remapIndices(&reordered[0], indexCount, &remap[0]);
+    std::vector<float> positions((size_t) vertexCount * 3);
+    remapVertices(&positions[0], &grid.positions[0], grid.vertexCount, sizeof(float) * 3, &remap[0]);
+    double fetchNanoseconds = benchmarkNowNanoseconds() - start;
+    benchmarkReport((prefix + ".vertexCache").c_str(), triangles, "mtrisPerSecond", triangles / cacheNanoseconds * 1e3);
+    benchmarkReport((prefix + ".overdraw").c_str(), triangles, "mtrisPerSecond", triangles / overdrawNanoseconds * 1e3);
+    benchmarkReport((prefix + ".vertexFetch").c_str(), triangles, "mtrisPerSecond", triangles / fetchNanoseconds * 1e3);
+
+    grid.vertexCount = vertexCount;
+    grid.positions.swap(positions);
+    grid.indices.swap(reordered);
+    reportAnalysis(prefix + ".after", grid);
+}
+
+static void benchmarkCubeIndices()
+{
+    extern GLushort indices[36];
+    std::vector<unsigned int> cube(indices, indices + 36);
+    VertexCacheStats before;
+    VertexCacheStats after;
+    analyzeVertexCache(&cube[0], 36, 24, &before);
+    optimizeVertexCache(&cube[0], &cube[0], 36, 24);
+    analyzeVertexCache(&cube[0], 36, 24, &after);
+    benchmarkReport("index.cube.before.acmr", before.triangles, "acmr", before.acmr);
+    benchmarkReport("index.cube.after.acmr", after.triangles, "acmr", after.acmr);
+}
+
+void runIndexBenchmarks()
+{
+    benchmarkCubeIndices();
+    benchmarkOptimizer("scan", false);
+    benchmarkOptimizer("shuffled", true);
+}
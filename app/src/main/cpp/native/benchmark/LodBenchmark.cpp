@@ -0,0 +1,130 @@
+/**
+ * 网格简化的性能测试：512×256段的UV球（约26万个三角形），经线0和360度处的顶点位置相同、纹理坐标不同，是一条接缝。
+ * 报告生成LOD链的吞吐量（百万三角形每秒）和每级的三角形数、误差，并检查接缝两侧的三角形没有被折叠到对面
+ * （用到u = 1的顶点的三角形，其他顶点的u都不小于0.5，u = 0的一侧同理）。lesson5的立方体每个角都是三个面的交点，
+ * 应该保持12个三角形、只有一级。
+ */
+#include <GLES3/gl3.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../include/MeshSimplify.h"
+
+static const int sphereSegments = 512;
+static const int sphereRings = 256;
+static const float sphereWeights[5] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f}; // 法线和纹理坐标
+
+void createSphere(SphereMesh* sphere, int segments, int rings)
+{
+    sphere->vertexCount = (segments + 1) * (rings + 1);
+    sphere->positions.resize((size_t) sphere->vertexCount * 3);
+    sphere->attributes.resize((size_t) sphere->vertexCount * 5);
+    for (int y = 0; y <= rings; y++)
+    {
+        for (int x = 0; x <= segments; x++)
+        {
+            float theta = (float) y / rings * (float) M_PI;
+            float phi = (float) (x % segments) / segments * 2.0f * (float) M_PI; // 首尾两列位置完全相同
+            int v = y * (segments + 1) + x;
+            float* position = &sphere->positions[(size_t) v * 3];
+            float* attribute = &sphere->attributes[(size_t) v * 5];
+            position[0] = sinf(theta) * cosf(phi);
+            position[1] = cosf(theta);
+            position[2] = sinf(theta) * sinf(phi);
+            attribute[0] = position[0];
+            attribute[1] = position[1];
+            attribute[2] = position[2];
+            attribute[3] = (float) x / segments;
+            attribute[4] = (float) y / rings;
+        }
+    }
+    sphere->indices.clear();
+    for (int y = 0; y < rings; y++)
+    {
+        for (int x = 0; x < segments; x++)
+        {
+            unsigned int a = y * (segments + 1) + x;
+            unsigned int c = a + segments + 1;
+            unsigned int quad[6] = {a, a + 1, c + 1, a, c + 1, c};
+            sphere->indices.insert(sphere->indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+// 三角形里有u为0（或1）的顶点时，其他顶点都应该在同一侧
+static bool seamPreserved(const SphereMesh& sphere, const unsigned int* indices, int indexCount)
+{
+    for (int i = 0; i < indexCount; i += 3)
+    {
+        bool low = false;
+        bool high = false;
+        float minU = 1.0f;
+        float maxU = 0.0f;
+        for (int k = 0; k < 3; k++)
+        {
+            float u = sphere.attributes[(size_t) indices[i + k] * 5 + 3];
+            low = low || u == 0.0f;
+            high = high || u == 1.0f;
+            minU = std::min(minU, u);
+            maxU = std::max(maxU, u);
+        }
+        if ((low && maxU > 0.5f) || (high && minU < 0.5f))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void benchmarkSphereLods()
+{
+    SphereMesh sphere;
+    createSphere(&sphere, sphereSegments, sphereRings);
+    int triangles = (int) sphere.indices.size() / 3;
+    SimplifyAttributes attributes = {&sphere.attributes[0], 5, sphereWeights};
+    MeshLodChain chain;
+    double start = benchmarkNowNanoseconds();
+    buildLodChain(&chain, &sphere.indices[0], (int) sphere.indices.size(), &sphere.positions[0], sphere.vertexCount,
+                  &attributes, maxMeshLods, defaultLodReduction, 0.1f);
+    double nanoseconds = benchmarkNowNanoseconds() - start;
+    benchmarkReport("lod.sphere.build", triangles, "mtrisPerSecond", triangles / nanoseconds * 1e3);
+    benchmarkReport("lod.sphere.levels", triangles, "lods", chain.lodCount);
+    for (int i = 0; i < chain.lodCount; i++)
+    {
+        const MeshCacheLod& lod = chain.lods[i];
+        std::string prefix = "lod.sphere." + std::to_string(i);
+        benchmarkReport((prefix + ".triangles").c_str(), triangles, "triangles", lod.indexCount / 3);
+        benchmarkReport((prefix + ".error").c_str(), triangles, "error", lod.error);
+        if (!seamPreserved(sphere, &chain.indices[lod.firstIndex], (int) lod.indexCount))
+        {
+            fprintf(stderr, "LOD %d of the sphere folded triangles across the UV seam\n", i);
+        }
+    }
+}
+
+static void benchmarkCubeLods()
+{
+    extern GLfloat cubeVertices[72];
+    extern GLfloat colour[72];
+    extern GLushort indices[36];
+    std::vector<unsigned int> cube(indices, indices + 36);
+    static const float colourWeights[3] = {1.0f, 1.0f, 1.0f};
+    SimplifyAttributes attributes = {colour, 3, colourWeights};
+    MeshLodChain chain;
+    buildLodChain(&chain, &cube[0], 36, cubeVertices, 24, &attributes, maxMeshLods, defaultLodReduction, 1.0f);
+    if (chain.lodCount != 1 || chain.lods[0].indexCount != 36)
+    {
+        fprintf(stderr, "The lesson5 cube was simplified to %d LODs\n", chain.lodCount);
+    }
+    benchmarkReport("lod.cube.levels", 12, "lods", chain.lodCount);
+}
+
+void runLodBenchmarks()
+{
+    benchmarkCubeLods();
+    benchmarkSphereLods();
+}
@@ -0,0 +1,138 @@
+/**
+ * 矩阵运算的性能测试：对每个测试项分别用1、10、100……直到maxCount个矩阵来测，输出每个矩阵的平均耗时（ns/op）。
+ */
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../include/CameraUtil.h"
+
+struct BenchmarkCase
+{
+    const char* name;
+    BenchmarkFunction function;
+};
+
+// 测试数据，按最大数量分配一次，各测试项共用
+static std::vector<float> inputMatrices;
+static std::vector<float> outputMatrices;
+static std::vector<float> angles;
+static std::vector<float> positionX; // 位置按SoA存放，批量接口可以直接使用
+static std::vector<float> positionY;
+static std::vector<float> positionZ;
+static std::vector<float> sinCosBuffer;
+static float viewMatrix[16];
+
+static void benchmarkMultiply(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        matrixMultiply(&outputMatrices[16 * i], viewMatrix, &inputMatrices[16 * i]);
+    }
+}
+
+static void benchmarkPerspective(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        matrixPerspective(&outputMatrices[16 * i], 45.0f + angles[i] * 0.01f, 1.5f, 0.1f, 100.0f);
+    }
+}
+
+static void benchmarkInverse(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        matrixInverse(&outputMatrices[16 * i], &inputMatrices[16 * i]);
+    }
+}
+
+// 原来各课renderFrame里的写法，作为对照
+static void benchmarkChainedRotateTranslate(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        float* matrix = &outputMatrices[16 * i];
+        matrixIdentityFunction(matrix);
+        matrixRotateX(matrix, angles[i]);
+        matrixRotateY(matrix, angles[i]);
+        matrixTranslate(matrix, positionX[i], positionY[i], positionZ[i]);
+    }
+}
+
+static void benchmarkEulerTransform(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        matrixEulerTransform(&outputMatrices[16 * i], angles[i], angles[i], 0.0f,
+                             positionX[i], positionY[i], positionZ[i], 1.0f, 1.0f, 1.0f);
+    }
+}
+
+static void benchmarkQuaternionTransform(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        float halfAngle = angles[i] * (float)(M_PI / 360.0);
+        matrixQuaternionTransform(&outputMatrices[16 * i], 0.0f, sinf(halfAngle), 0.0f, cosf(halfAngle),
+                                  positionX[i], positionY[i], positionZ[i], 1.0f, 1.0f, 1.0f);
+    }
+}
+
+static void benchmarkEulerTransformBatch(int count)
+{
+    TransformArrays transforms = {&angles[0], &angles[0], &angles[0],
+                                  &positionX[0], &positionY[0], &positionZ[0], NULL, NULL, NULL};
+    matrixEulerTransformBatch(&outputMatrices[0], &transforms, count, &sinCosBuffer[0]);
+}
+
+static void benchmarkTransformVec4Array(int count)
+{
+    // 把输入矩阵当作4 * count个四维向量来变换，报告的是每4个向量（一个矩阵大小的数据）的耗时
+    matrixTransformVec4Array(&outputMatrices[0], viewMatrix, &inputMatrices[0], 4 * count);
+}
+
+static const BenchmarkCase benchmarkCases[] = {
+        {"matrixMultiply", benchmarkMultiply},
+        {"matrixPerspective", benchmarkPerspective},
+        {"matrixInverse", benchmarkInverse},
+        {"chainedRotateTranslate", benchmarkChainedRotateTranslate},
+        {"matrixEulerTransform", benchmarkEulerTransform},
+        {"matrixQuaternionTransform", benchmarkQuaternionTransform},
+        {"matrixEulerTransformBatch", benchmarkEulerTransformBatch},
+        {"matrixTransformVec4Array", benchmarkTransformVec4Array},
+};
+
+void runMathBenchmarks()
+{
+    int maxCount = benchmarkOptions.maxCount;
+    // 准备测试数据，用固定的种子保证每次运行的数据一致
+    srand(1);
+    inputMatrices.resize(16 * (size_t)maxCount);
+    outputMatrices.resize(16 * (size_t)maxCount);
+    angles.resize(maxCount);
+    positionX.resize(maxCount);
+    positionY.resize(maxCount);
+    positionZ.resize(maxCount);
+    sinCosBuffer.resize(6 * (size_t)maxCount);
+    for (int i = 0; i < maxCount; i++)
+    {
+        angles[i] = (float)(rand() % 36000) / 100.0f;
+        positionX[i] = (float)(rand() % 200) / 10.0f - 10.0f;
+        positionY[i] = (float)(rand() % 200) / 10.0f - 10.0f;
+        positionZ[i] = -(float)(rand() % 1000) / 10.0f;
+        matrixEulerTransform(&inputMatrices[16 * i], angles[i], angles[i] * 0.5f, 0.0f,
+                             positionX[i], positionY[i], positionZ[i], 1.0f, 1.0f, 1.0f);
+    }
+    matrixEulerTransform(viewMatrix, 10.0f, 20.0f, 0.0f, 0.0f, -1.0f, -5.0f, 1.0f, 1.0f, 1.0f);
+
+    int caseCount = sizeof(benchmarkCases) / sizeof(benchmarkCases[0]);
+    for (int c = 0; c < caseCount; c++)
+    {
+        for (int count = 1; count <= maxCount; count *= 10)
+        {
+            benchmarkReport(benchmarkCases[c].name, count, "nsPerOp", benchmarkMeasure(benchmarkCases[c].function, count));
+        }
+    }
+}
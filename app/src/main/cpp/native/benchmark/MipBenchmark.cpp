@@ -0,0 +1,97 @@
+/**
+ * mipmap生成的性能测试：1K到8K的正方形RGBA8图片，分别用box和Kaiser过滤器、单线程和按CPU核数多线程生成完整的mipmap链，
+ * 报告每条链的耗时（ms）和平均到每个源像素的耗时（ns）。一条8K的链要几秒，所以不用benchmarkMeasure的重复计时，
+ * 每组只取两次中较快的一次。
+ *
+ * 另外检查sRGB过滤是否正确：黑白棋盘格缩小一级应该是sRGB的188左右（线性亮度50%），直接平均编码值会得到128。
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../include/MipUtil.h"
+
+static const int minMipSize = 1024;
+static const int maxMipSize = 8192;
+
+static std::vector<unsigned char> image;
+static MipChain chain;
+
+static double timeMipChain(int size, bool srgb, MipFilter filter, int threads)
+{
+    double best = 0.0;
+    for (int run = 0; run < 2; run++)
+    {
+        double start = benchmarkNowNanoseconds();
+        generateMipChain(&image[0], size, size, srgb, filter, threads, &chain);
+        double elapsed = benchmarkNowNanoseconds() - start;
+        best = run == 0 || elapsed < best ? elapsed : best;
+    }
+    return best;
+}
+
+static void reportMipChain(const char* name, int size, bool srgb, MipFilter filter, int threads)
+{
+    double nanoseconds = timeMipChain(size, srgb, filter, threads);
+    char metricName[64];
+    snprintf(metricName, sizeof(metricName), "%s.ms", name);
+    benchmarkReport(metricName, size, "milliseconds", nanoseconds / 1e6);
+    benchmarkReport(name, size, "nsPerPixel", nanoseconds / ((double) size * size));
+}
+
+static bool checkSrgbFiltering()
+{
+    const int size = 8;
+    std::vector<unsigned char> checker(size * size * 4);
+    for (int i = 0; i < size * size; i++)
+    {
+        unsigned char value = ((i % size) + (i / size)) % 2 == 0 ? 255 : 0;
+        checker[i * 4] = checker[i * 4 + 1] = checker[i * 4 + 2] = value;
+        checker[i * 4 + 3] = 255;
+    }
+    MipChain checked;
+    generateMipChain(&checker[0], size, size, true, MIP_FILTER_BOX, 1, &checked);
+    int value = checked.pixels[checked.offset[1]];
+    benchmarkReport("mipChain.srgbCheckerLevel1", size, "value", value);
+    return value >= 186 && value <= 190 && checked.levelCount == 4;
+}
+
+void runMipBenchmarks()
+{
+    image.resize((size_t) maxMipSize * maxMipSize * 4);
+    srand(1);
+    // 平滑的渐变加噪声，让过滤的结果不是常数
+    for (int y = 0; y < maxMipSize; y++)
+    {
+        for (int x = 0; x < maxMipSize; x++)
+        {
+            unsigned char* pixel = &image[((size_t) y * maxMipSize + x) * 4];
+            pixel[0] = (unsigned char) (x * 255 / maxMipSize);
+            pixel[1] = (unsigned char) (y * 255 / maxMipSize);
+            pixel[2] = (unsigned char) (rand() & 255);
+            pixel[3] = 255;
+        }
+    }
+    if (!checkSrgbFiltering())
+    {
+        fprintf(stderr, "sRGB mipmap filtering is not averaging in linear space\n");
+    }
+    int threads = (int) std::thread::hardware_concurrency();
+    threads = threads > 0 ? threads : 1;
+    benchmarkReport("mipChain.threads", threads, "threads", threads);
+    for (int size = minMipSize; size <= maxMipSize; size *= 2)
+    {
+        reportMipChain("mipChain.box.linear", size, false, MIP_FILTER_BOX, 1);
+        reportMipChain("mipChain.box.srgb", size, true, MIP_FILTER_BOX, 1);
+        reportMipChain("mipChain.kaiser.srgb", size, true, MIP_FILTER_KAISER, 1);
+        if (threads > 1)
+        {
+            reportMipChain("mipChain.box.srgb.parallel", size, true, MIP_FILTER_BOX, threads);
+            reportMipChain("mipChain.kaiser.srgb.parallel", size, true, MIP_FILTER_KAISER, threads);
+        }
+    }
+    std::vector<unsigned char>().swap(image);
+    std::vector<unsigned char>().swap(chain.pixels);
+}
@@ -0,0 +1,158 @@
+/**
+ * 软件光栅化的性能测试（见SoftRaster.cpp），不需要GPU：
+ *    - 256×128段的UV球（约6.5万个小三角形，逐顶点光照、深度测试）画到512×512，分别用1、2、4个线程和CPU核数个线程，
+ *      报告每秒百万三角形，并检查各线程数画出的图像逐字节相同
+ *    - 32层从后往前叠放的全屏四边形（每层都通过深度测试），报告每秒百万像素，主要是填充和着色的开销
+ */
+#include <GLES3/gl3.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../include/CameraUtil.h"
+#include "../include/SoftRaster.h"
+
+static const int softFramebufferSize = 512;
+static const int fillLayers = 32;
+
+static unsigned long long hashColour(const SoftFramebuffer* framebuffer)
+{
+    unsigned long long hash = 1469598103934665603ull;
+    for (size_t i = 0; i < framebuffer->colour.size(); i++)
+    {
+        hash = (hash ^ framebuffer->colour[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// 重复画一帧直到超过最短测试时间（至少3帧），返回平均每帧毫秒数
+static double measureSoftFrames(SoftFramebuffer* framebuffer, const SoftDraw* draws, int drawCount)
+{
+    int frames = 0;
+    double elapsed = 0.0;
+    double start = benchmarkNowNanoseconds();
+    do
+    {
+        clearSoftFramebuffer(framebuffer, 0.0f, 0.0f, 0.0f, 1.0f);
+        for (int i = 0; i < drawCount; i++)
+        {
+            softDraw(framebuffer, &draws[i]);
+        }
+        frames++;
+        elapsed = benchmarkNowNanoseconds() - start;
+    } while (frames < 3 || elapsed < benchmarkOptions.minTimeMilliseconds * 1e6);
+    return elapsed / 1e6 / frames;
+}
+
+void runSoftBenchmarks()
+{
+    SoftFramebuffer framebuffer;
+    if (!createSoftFramebuffer(&framebuffer, softFramebufferSize, softFramebufferSize))
+    {
+        return;
+    }
+    SphereMesh sphere;
+    createSphere(&sphere, 256, 128);
+    std::vector<float> normals((size_t) sphere.vertexCount * 3);
+    for (int v = 0; v < sphere.vertexCount; v++)
+    {
+        memcpy(&normals[(size_t) v * 3], &sphere.attributes[(size_t) v * 5], sizeof(float) * 3);
+    }
+    static const float light[3] = {0.0f, 1.0f, 1.0f};
+    static const float eye[3] = {0.0f, 0.0f, 1.0f};
+    static const float ambient[3] = {0.1f, 0.1f, 0.1f};
+    static const float white[3] = {1.0f, 1.0f, 1.0f};
+    static const float orange[3] = {1.0f, 0.5f, 0.0f};
+    LightingMaterial material = {{1.0f, 1.0f, 1.0f}, 2.0f, 0, false};
+    LightingUniforms lighting;
+    computeLightingUniforms(&lighting, light, eye, ambient, white, white, &material);
+    float projection[16];
+    float modelView[16];
+    matrixPerspective(projection, 45.0f, 1.0f, 0.1f, 100.0f);
+    matrixEulerTransform(modelView, 30.0f, 30.0f, 0.0f, 0.0f, 0.0f, -3.0f, 1.0f, 1.0f, 1.0f);
+
+    SoftDraw sphereDraw;
+    memset(&sphereDraw, 0, sizeof(sphereDraw));
+    sphereDraw.positions = &sphere.positions[0];
+    sphereDraw.positionSize = 3;
+    sphereDraw.constantColour = orange;
+    sphereDraw.normals = &normals[0];
+    sphereDraw.vertexCount = sphere.vertexCount;
+    sphereDraw.indices = &sphere.indices[0];
+    sphereDraw.indexType = GL_UNSIGNED_INT;
+    sphereDraw.count = (int) sphere.indices.size();
+    sphereDraw.projection = projection;
+    sphereDraw.modelView = modelView;
+    sphereDraw.lighting = &lighting;
+    sphereDraw.depthTest = true;
+
+    int hardwareThreads = std::max(1, (int) std::thread::hardware_concurrency());
+    int threadCounts[4] = {1, 2, 4, hardwareThreads};
+    unsigned long long referenceHash = 0;
+    int mismatches = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (i == 3 && hardwareThreads <= 4)
+        {
+            break; // 已经测过
+        }
+        startSoftRasterThreads(threadCounts[i]);
+        resetSoftRasterStats();
+        double milliseconds = measureSoftFrames(&framebuffer, &sphereDraw, 1);
+        char name[64];
+        snprintf(name, sizeof(name), "softRaster.sphere.threads%d", threadCounts[i]);
+        benchmarkReport(name, sphereDraw.count / 3, "mtrisPerSecond", sphereDraw.count / 3 / milliseconds / 1e3);
+        unsigned long long hash = hashColour(&framebuffer);
+        if (i == 0)
+        {
+            referenceHash = hash;
+        }
+        mismatches += hash != referenceHash;
+        SoftRasterStats stats;
+        getSoftRasterStats(&stats);
+        snprintf(name, sizeof(name), "softRaster.sphere.threads%d.steals", threadCounts[i]);
+        benchmarkReport(name, stats.triangles, "steals", stats.steals);
+    }
+    benchmarkReport("softRaster.sphere.deterministic", sphereDraw.count / 3, "mismatches", mismatches);
+
+    // 两个三角形组成的全屏四边形，z从远到近，每一层都会覆盖上一层
+    static const float quad[12] = {-1.0f, -1.0f, 0.0f, 1.0f, -1.0f, 0.0f, 1.0f, 1.0f, 0.0f, -1.0f, 1.0f, 0.0f};
+    static const GLushort quadIndices[6] = {0, 1, 2, 0, 2, 3};
+    std::vector<float> layers(fillLayers * 12);
+    std::vector<float> colours(fillLayers * 12);
+    std::vector<GLushort> indices(fillLayers * 6);
+    for (int layer = 0; layer < fillLayers; layer++)
+    {
+        for (int v = 0; v < 4; v++)
+        {
+            layers[layer * 12 + v * 3] = quad[v * 3];
+            layers[layer * 12 + v * 3 + 1] = quad[v * 3 + 1];
+            layers[layer * 12 + v * 3 + 2] = 0.9f - 1.8f * layer / fillLayers;
+            colours[layer * 12 + v * 3] = (float) layer / fillLayers;
+            colours[layer * 12 + v * 3 + 1] = (float) v / 4;
+            colours[layer * 12 + v * 3 + 2] = 0.5f;
+        }
+        for (int i = 0; i < 6; i++)
+        {
+            indices[layer * 6 + i] = (GLushort) (layer * 4 + quadIndices[i]);
+        }
+    }
+    SoftDraw fillDraw;
+    memset(&fillDraw, 0, sizeof(fillDraw));
+    fillDraw.positions = &layers[0];
+    fillDraw.positionSize = 3;
+    fillDraw.colours = &colours[0];
+    fillDraw.vertexCount = fillLayers * 4;
+    fillDraw.indices = &indices[0];
+    fillDraw.indexType = GL_UNSIGNED_SHORT;
+    fillDraw.count = fillLayers * 6;
+    fillDraw.depthTest = true;
+    startSoftRasterThreads(0);
+    double milliseconds = measureSoftFrames(&framebuffer, &fillDraw, 1);
+    double pixels = (double) fillLayers * softFramebufferSize * softFramebufferSize;
+    benchmarkReport("softRaster.fill", fillLayers, "mpixelsPerSecond", pixels / milliseconds / 1e3);
+    stopSoftRasterThreads();
+}
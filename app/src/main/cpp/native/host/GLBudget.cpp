@@ -0,0 +1,234 @@
+/**
+ * 统计每课renderFrame每帧发出的GL工作量，并检查是否超出预算，只在主机构建中编译。
+ *
+ * 本程序链接了GLRecorder并导出全部符号，随后用dlopen加载的课程动态库（以及它依赖的Utils）中的GL调用
+ * 都会解析到GLRecorder的桩实现上，所以不需要设备、GPU，也不需要EGL上下文。
+ * 每课先调用一次setupGraphics，再连续渲染若干帧，输出setup的计数和每帧计数的最大值（JSON）。
+ *
+ * 用法：GLBudget [--frames N] [--library-dir DIR] [--budget Lesson.metric=value ...]
+ * 例如 --budget Light.clientVertexBytes=1200 表示Light每帧从客户端数组复制的顶点数据不能超过1200字节，
+ * 有任何一项超出预算时返回1，可以直接在CI里使用。
+ * 课程通过StateCache.h设置状态时，同时输出渲染期间状态缓存发出和省略的调用总数。
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "../include/GLRecorder.h"
+#include "../include/StateCache.h"
+
+typedef bool (*SetupGraphicsFunction)(int width, int height);
+typedef void (*RenderFrameFunction)();
+typedef void (*GetStateCacheStatsFunction)(StateCacheStats* stats);
+typedef void (*ResetStateCacheStatsFunction)();
+
+static const char* lessons[] = {"Triangle", "Cube", "TextureCube", "Light", "InstancedCube"};
+
+struct Budget
+{
+    std::string lesson;
+    std::string metric;
+    long long limit;
+};
+
+// 按名字取计数，名字与RecorderFrameCounts的成员名相同，未知名字返回-1
+static long long countByName(const RecorderFrameCounts& counts, const std::string& name)
+{
+    if (name == "calls") return counts.calls;
+    if (name == "drawCalls") return counts.drawCalls;
+    if (name == "programBinds") return counts.programBinds;
+    if (name == "uniformUploads") return counts.uniformUploads;
+    if (name == "attributeRebinds") return counts.attributeRebinds;
+    if (name == "attributeToggles") return counts.attributeToggles;
+    if (name == "textureBinds") return counts.textureBinds;
+    if (name == "bufferBinds") return counts.bufferBinds;
+    if (name == "vertexArrayBinds") return counts.vertexArrayBinds;
+    if (name == "stateChanges") return counts.stateChanges;
+    if (name == "clientVertexBytes") return counts.clientVertexBytes;
+    if (name == "clientIndexBytes") return counts.clientIndexBytes;
+    if (name == "uploadBytes") return counts.uploadBytes;
+    return -1;
+}
+
+static const char* metricNames[] = {
+        "calls", "drawCalls", "programBinds", "uniformUploads", "attributeRebinds", "attributeToggles",
+        "textureBinds", "bufferBinds", "vertexArrayBinds", "stateChanges", "clientVertexBytes", "clientIndexBytes", "uploadBytes"
+};
+
+static void printCounts(const RecorderFrameCounts& counts)
+{
+    int metricCount = sizeof(metricNames) / sizeof(metricNames[0]);
+    printf("{");
+    for (int i = 0; i < metricCount; i++)
+    {
+        printf("%s\"%s\": %lld", i ? ", " : "", metricNames[i], countByName(counts, metricNames[i]));
+    }
+    printf("}");
+}
+
+// 逐项取最大值
+static void maxCounts(RecorderFrameCounts* result, const RecorderFrameCounts& counts)
+{
+#define MAX_FIELD(field) result->field = counts.field > result->field ? counts.field : result->field
+    MAX_FIELD(calls);
+    MAX_FIELD(drawCalls);
+    MAX_FIELD(programBinds);
+    MAX_FIELD(uniformUploads);
+    MAX_FIELD(attributeRebinds);
+    MAX_FIELD(attributeToggles);
+    MAX_FIELD(textureBinds);
+    MAX_FIELD(bufferBinds);
+    MAX_FIELD(vertexArrayBinds);
+    MAX_FIELD(stateChanges);
+    MAX_FIELD(clientVertexBytes);
+    MAX_FIELD(clientIndexBytes);
+    MAX_FIELD(uploadBytes);
+#undef MAX_FIELD
+}
+
+// 默认在可执行文件所在目录查找课程动态库
+static std::string executableDirectory()
+{
+    char path[1024];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length <= 0)
+    {
+        return ".";
+    }
+    path[length] = '\0';
+    char* slash = strrchr(path, '/');
+    if (slash != NULL)
+    {
+        *slash = '\0';
+    }
+    return path;
+}
+
+int main(int argc, char** argv)
+{
+    int frames = 60;
+    std::string libraryDirectory = executableDirectory();
+    std::vector<Budget> budgets;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--library-dir") == 0 && i + 1 < argc)
+        {
+            libraryDirectory = argv[++i];
+        }
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+        {
+            std::string budget = argv[++i];
+            size_t dot = budget.find('.');
+            size_t equals = budget.find('=');
+            if (dot == std::string::npos || equals == std::string::npos || equals < dot)
+            {
+                fprintf(stderr, "Invalid budget %s, expected Lesson.metric=value\n", budget.c_str());
+                return 2;
+            }
+            Budget parsed = {budget.substr(0, dot), budget.substr(dot + 1, equals - dot - 1),
+                             atoll(budget.c_str() + equals + 1)};
+            budgets.push_back(parsed);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--frames N] [--library-dir DIR] [--budget Lesson.metric=value ...]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    int failures = 0;
+    int lessonCount = sizeof(lessons) / sizeof(lessons[0]);
+    printf("{\n  \"frames\": %d,\n  \"lessons\": [\n", frames);
+    for (int l = 0; l < lessonCount; l++)
+    {
+        std::string path = libraryDirectory + "/lib" + lessons[l] + ".so";
+        void* library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (library == NULL)
+        {
+            fprintf(stderr, "Could not load %s: %s\n", path.c_str(), dlerror());
+            return 2;
+        }
+        // 课程导出的是C++函数，这里按C++的符号名查找
+        SetupGraphicsFunction setupGraphics = (SetupGraphicsFunction) dlsym(library, "_Z13setupGraphicsii");
+        RenderFrameFunction renderFrame = (RenderFrameFunction) dlsym(library, "_Z11renderFramev");
+        if (setupGraphics == NULL || renderFrame == NULL)
+        {
+            fprintf(stderr, "%s does not export setupGraphics/renderFrame\n", path.c_str());
+            return 2;
+        }
+
+        // 状态缓存在课程依赖的Utils里，课程不一定使用它
+        GetStateCacheStatsFunction getStateCacheStats =
+                (GetStateCacheStatsFunction) dlsym(library, "_Z18getStateCacheStatsP15StateCacheStats");
+        ResetStateCacheStatsFunction resetStateCacheStats =
+                (ResetStateCacheStatsFunction) dlsym(library, "_Z20resetStateCacheStatsv");
+
+        recorderReset();
+        setupGraphics(1280, 720);
+        RecorderFrameCounts setupCounts;
+        recorderFrameCounts(&setupCounts);
+        if (resetStateCacheStats != NULL)
+        {
+            resetStateCacheStats();
+        }
+        RecorderFrameCounts frameCounts;
+        memset(&frameCounts, 0, sizeof(frameCounts));
+        for (int frame = 0; frame < frames; frame++)
+        {
+            recorderBeginFrame();
+            renderFrame();
+            RecorderFrameCounts counts;
+            recorderFrameCounts(&counts);
+            maxCounts(&frameCounts, counts);
+        }
+
+        printf("    {\"name\": \"%s\", \"setup\": ", lessons[l]);
+        printCounts(setupCounts);
+        printf(", \"perFrame\": ");
+        printCounts(frameCounts);
+        if (getStateCacheStats != NULL)
+        {
+            StateCacheStats stats;
+            getStateCacheStats(&stats);
+            int issued = 0;
+            int elided = 0;
+            for (int c = 0; c < STATE_CATEGORY_COUNT; c++)
+            {
+                issued += stats.issued[c];
+                elided += stats.elided[c];
+            }
+            printf(", \"stateCache\": {\"issued\": %d, \"elided\": %d}", issued, elided);
+        }
+        printf("}%s\n", l + 1 < lessonCount ? "," : "");
+        for (size_t b = 0; b < budgets.size(); b++)
+        {
+            if (budgets[b].lesson != lessons[l])
+            {
+                continue;
+            }
+            long long value = countByName(frameCounts, budgets[b].metric);
+            if (value < 0)
+            {
+                fprintf(stderr, "Unknown metric %s\n", budgets[b].metric.c_str());
+                return 2;
+            }
+            if (value > budgets[b].limit)
+            {
+                fprintf(stderr, "Budget exceeded: %s.%s = %lld per frame, budget %lld\n",
+                        lessons[l], budgets[b].metric.c_str(), value, budgets[b].limit);
+                failures++;
+            }
+        }
+        dlclose(library);
+    }
+    printf("  ]\n}\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,513 @@
+/**
+ * 记录型GL桩实现，见GLRecorder.h。
+ *
+ * 这里只维护统计需要的最少状态：当前绑定的缓冲区（用来区分客户端数组和缓冲区对象）、每个VAO的顶点属性指针设置、
+ * 以及缓冲区数据的副本（索引放在缓冲区里而顶点在客户端数组时，需要读出最大索引才能算出复制了多少顶点数据）。
+ * 着色器编译和链接总是成功，属性和uniform的位置按名字第一次出现的顺序分配。
+ */
+#include <GLES3/gl3.h>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../include/GLRecorder.h"
+
+static const int maxVertexAttributes = 16;
+
+struct RecordedAttribute
+{
+    bool enabled;
+    GLint size;
+    GLenum type;
+    GLsizei stride;
+    const void* pointer;
+    GLuint buffer; // 为0时pointer是客户端数组
+};
+
+// 顶点数组对象（VAO）的状态，0号是默认的VAO
+struct RecordedVertexArray
+{
+    RecordedAttribute attributes[maxVertexAttributes];
+    GLuint elementArrayBuffer;
+};
+
+static std::vector<RecordedCommand> commands;
+static RecorderFrameCounts frameCounts;
+static std::map<GLuint, RecordedVertexArray> vertexArrays;
+static RecordedAttribute* attributes = NULL; // 当前绑定的VAO的属性
+static GLuint arrayBuffer = 0;
+static GLuint elementArrayBuffer = 0; // 当前VAO的索引缓冲区
+static GLuint uniformBuffer = 0;
+static GLuint vertexArray = 0;
+static std::map<GLuint, std::vector<unsigned char> > bufferData;
+// 名字到位置的映射和下一个可用的位置，按程序和种类分开编号，同一个程序里不同的名字不会得到相同的位置
+enum LocationKind
+{
+    LOCATION_ATTRIBUTE,
+    LOCATION_UNIFORM,
+    LOCATION_BLOCK,
+    LOCATION_KIND_COUNT
+};
+static std::map<std::string, GLint> locations;
+static std::map<GLuint, std::vector<GLint> > nextLocations;
+static GLuint nextObject = 1;
+
+static void record(RecordedCall call, unsigned int argument, unsigned int bytes)
+{
+    if (attributes == NULL)
+    {
+        recorderReset();
+    }
+    RecordedCommand command;
+    command.call = (unsigned short) call;
+    command.unused = 0;
+    command.argument = argument;
+    command.bytes = bytes;
+    commands.push_back(command);
+    frameCounts.calls++;
+}
+
+void recorderReset()
+{
+    commands.clear();
+    memset(&frameCounts, 0, sizeof(frameCounts));
+    vertexArrays.clear();
+    memset(&vertexArrays[0], 0, sizeof(RecordedVertexArray));
+    attributes = vertexArrays[0].attributes;
+    arrayBuffer = 0;
+    elementArrayBuffer = 0;
+    uniformBuffer = 0;
+    vertexArray = 0;
+    bufferData.clear();
+    locations.clear();
+    nextLocations.clear();
+    nextObject = 1;
+}
+
+void recorderBeginFrame()
+{
+    commands.clear();
+    memset(&frameCounts, 0, sizeof(frameCounts));
+}
+
+void recorderFrameCounts(RecorderFrameCounts* counts)
+{
+    *counts = frameCounts;
+}
+
+const RecordedCommand* recorderCommands(int* count)
+{
+    *count = (int) commands.size();
+    return commands.empty() ? NULL : &commands[0];
+}
+
+static int typeSize(GLenum type)
+{
+    switch (type)
+    {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+            return 1;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+// 绘制vertexCount个顶点时，客户端数组里需要被驱动复制的字节数
+static long long clientVertexBytes(long long vertexCount)
+{
+    long long bytes = 0;
+    for (int i = 0; i < maxVertexAttributes; i++)
+    {
+        const RecordedAttribute& attribute = attributes[i];
+        if (attribute.enabled && attribute.buffer == 0 && attribute.pointer != NULL)
+        {
+            long long elementSize = attribute.type == GL_INT_2_10_10_10_REV || attribute.type == GL_UNSIGNED_INT_2_10_10_10_REV
+                                    ? 4 : (long long) attribute.size * typeSize(attribute.type);
+            long long stride = attribute.stride ? attribute.stride : elementSize;
+            bytes += (vertexCount - 1) * stride + elementSize;
+        }
+    }
+    return bytes;
+}
+
+static unsigned int maxIndex(const void* indices, GLsizei count, GLenum type)
+{
+    unsigned int result = 0;
+    for (GLsizei i = 0; i < count; i++)
+    {
+        unsigned int index = type == GL_UNSIGNED_BYTE ? ((const GLubyte*) indices)[i]
+                           : type == GL_UNSIGNED_SHORT ? ((const GLushort*) indices)[i]
+                           : ((const GLuint*) indices)[i];
+        result = index > result ? index : result;
+    }
+    return result;
+}
+
+static GLint locationOf(GLuint program, LocationKind kind, const GLchar* name)
+{
+    char key[32];
+    snprintf(key, sizeof(key), "%u:%d:", program, (int) kind);
+    std::string fullName = std::string(key) + name;
+    std::map<std::string, GLint>::iterator found = locations.find(fullName);
+    if (found != locations.end())
+    {
+        return found->second;
+    }
+    std::vector<GLint>& next = nextLocations[program];
+    next.resize(LOCATION_KIND_COUNT, 0);
+    GLint location = next[kind]++;
+    if (kind == LOCATION_ATTRIBUTE)
+    {
+        location %= maxVertexAttributes; // 属性位置要能索引attributes数组
+    }
+    locations[fullName] = location;
+    return location;
+}
+
+// --- 着色器和程序 ---
+
+GL_APICALL GLuint GL_APIENTRY glCreateShader(GLenum type) { record(RECORDED_OTHER, type, 0); return nextObject++; }
+GL_APICALL void GL_APIENTRY glShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) { record(RECORDED_OTHER, shader, 0); }
+GL_APICALL void GL_APIENTRY glCompileShader(GLuint shader) { record(RECORDED_OTHER, shader, 0); }
+GL_APICALL void GL_APIENTRY glDeleteShader(GLuint shader) { record(RECORDED_OTHER, shader, 0); }
+GL_APICALL void GL_APIENTRY glGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+    if (length) *length = 0;
+    if (bufSize > 0) infoLog[0] = '\0';
+}
+GL_APICALL void GL_APIENTRY glGetShaderiv(GLuint shader, GLenum pname, GLint* params)
+{
+    *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+GL_APICALL GLuint GL_APIENTRY glCreateProgram() { record(RECORDED_OTHER, 0, 0); return nextObject++; }
+GL_APICALL void GL_APIENTRY glAttachShader(GLuint program, GLuint shader) { record(RECORDED_OTHER, program, 0); }
+GL_APICALL void GL_APIENTRY glDetachShader(GLuint program, GLuint shader) { record(RECORDED_OTHER, program, 0); }
+GL_APICALL void GL_APIENTRY glLinkProgram(GLuint program) { record(RECORDED_OTHER, program, 0); }
+GL_APICALL void GL_APIENTRY glDeleteProgram(GLuint program) { record(RECORDED_OTHER, program, 0); }
+GL_APICALL void GL_APIENTRY glProgramParameteri(GLuint program, GLenum pname, GLint value) { record(RECORDED_OTHER, program, 0); }
+GL_APICALL void GL_APIENTRY glGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+    if (length) *length = 0;
+    if (bufSize > 0) infoLog[0] = '\0';
+}
+GL_APICALL void GL_APIENTRY glGetProgramiv(GLuint program, GLenum pname, GLint* params)
+{
+    *params = pname == GL_LINK_STATUS ? GL_TRUE : 0;
+}
+GL_APICALL GLint GL_APIENTRY glGetAttribLocation(GLuint program, const GLchar* name) { return locationOf(program, LOCATION_ATTRIBUTE, name); }
+GL_APICALL GLint GL_APIENTRY glGetUniformLocation(GLuint program, const GLchar* name) { return locationOf(program, LOCATION_UNIFORM, name); }
+GL_APICALL GLuint GL_APIENTRY glGetUniformBlockIndex(GLuint program, const GLchar* name)
+{
+    return (GLuint) locationOf(program, LOCATION_BLOCK, name);
+}
+GL_APICALL void GL_APIENTRY glUniformBlockBinding(GLuint program, GLuint blockIndex, GLuint blockBinding)
+{
+    record(RECORDED_OTHER, program, 0);
+}
+GL_APICALL void GL_APIENTRY glUseProgram(GLuint program)
+{
+    record(RECORDED_USE_PROGRAM, program, 0);
+    frameCounts.programBinds++;
+}
+
+// --- uniform ---
+
+static void recordUniform(GLint location, unsigned int bytes)
+{
+    record(RECORDED_UNIFORM, (unsigned int) location, bytes);
+    frameCounts.uniformUploads++;
+}
+GL_APICALL void GL_APIENTRY glUniform1i(GLint location, GLint v0) { recordUniform(location, 4); }
+GL_APICALL void GL_APIENTRY glUniform1f(GLint location, GLfloat v0) { recordUniform(location, 4); }
+GL_APICALL void GL_APIENTRY glUniform2f(GLint location, GLfloat v0, GLfloat v1) { recordUniform(location, 8); }
+GL_APICALL void GL_APIENTRY glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) { recordUniform(location, 12); }
+GL_APICALL void GL_APIENTRY glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) { recordUniform(location, 16); }
+GL_APICALL void GL_APIENTRY glUniform1fv(GLint location, GLsizei count, const GLfloat* value) { recordUniform(location, 4 * count); }
+GL_APICALL void GL_APIENTRY glUniform3fv(GLint location, GLsizei count, const GLfloat* value) { recordUniform(location, 12 * count); }
+GL_APICALL void GL_APIENTRY glUniform4fv(GLint location, GLsizei count, const GLfloat* value) { recordUniform(location, 16 * count); }
+GL_APICALL void GL_APIENTRY glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) { recordUniform(location, 36 * count); }
+GL_APICALL void GL_APIENTRY glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) { recordUniform(location, 64 * count); }
+
+// --- 顶点属性和缓冲区 ---
+
+GL_APICALL void GL_APIENTRY glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+    record(RECORDED_VERTEX_ATTRIB_POINTER, index, 0);
+    frameCounts.attributeRebinds++;
+    if (index < (GLuint) maxVertexAttributes)
+    {
+        attributes[index].size = size;
+        attributes[index].type = type;
+        attributes[index].stride = stride;
+        attributes[index].pointer = pointer;
+        attributes[index].buffer = arrayBuffer;
+    }
+}
+GL_APICALL void GL_APIENTRY glEnableVertexAttribArray(GLuint index)
+{
+    record(RECORDED_VERTEX_ATTRIB_TOGGLE, index, 0);
+    frameCounts.attributeToggles++;
+    if (index < (GLuint) maxVertexAttributes)
+    {
+        attributes[index].enabled = true;
+    }
+}
+GL_APICALL void GL_APIENTRY glDisableVertexAttribArray(GLuint index)
+{
+    record(RECORDED_VERTEX_ATTRIB_TOGGLE, index, 0);
+    frameCounts.attributeToggles++;
+    if (index < (GLuint) maxVertexAttributes)
+    {
+        attributes[index].enabled = false;
+    }
+}
+GL_APICALL void GL_APIENTRY glVertexAttribDivisor(GLuint index, GLuint divisor)
+{
+    record(RECORDED_VERTEX_ATTRIB_POINTER, index, 0);
+    frameCounts.attributeRebinds++;
+}
+// 没有启用数组的属性使用的常量值，和uniform一样按上传计数
+GL_APICALL void GL_APIENTRY glVertexAttrib4fv(GLuint index, const GLfloat* v)
+{
+    record(RECORDED_UNIFORM, index, 16);
+    frameCounts.uniformUploads++;
+}
+GL_APICALL void GL_APIENTRY glGenBuffers(GLsizei n, GLuint* buffers)
+{
+    record(RECORDED_OTHER, n, 0);
+    for (GLsizei i = 0; i < n; i++)
+    {
+        buffers[i] = nextObject++;
+    }
+}
+GL_APICALL void GL_APIENTRY glDeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    record(RECORDED_OTHER, n, 0);
+    for (GLsizei i = 0; i < n; i++)
+    {
+        bufferData.erase(buffers[i]);
+        arrayBuffer = arrayBuffer == buffers[i] ? 0 : arrayBuffer;
+        uniformBuffer = uniformBuffer == buffers[i] ? 0 : uniformBuffer;
+        if (elementArrayBuffer == buffers[i])
+        {
+            elementArrayBuffer = 0;
+            vertexArrays[vertexArray].elementArrayBuffer = 0;
+        }
+    }
+}
+GL_APICALL void GL_APIENTRY glBindBuffer(GLenum target, GLuint buffer)
+{
+    record(RECORDED_BIND_BUFFER, buffer, 0);
+    frameCounts.bufferBinds++;
+    if (target == GL_ARRAY_BUFFER)
+    {
+        arrayBuffer = buffer;
+    }
+    else if (target == GL_ELEMENT_ARRAY_BUFFER)
+    {
+        elementArrayBuffer = buffer;
+        vertexArrays[vertexArray].elementArrayBuffer = buffer;
+    }
+    else if (target == GL_UNIFORM_BUFFER)
+    {
+        uniformBuffer = buffer;
+    }
+}
+// 绑定到uniform块的绑定点，同时也改变GL_UNIFORM_BUFFER的绑定
+GL_APICALL void GL_APIENTRY glBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    glBindBuffer(target, buffer);
+}
+GL_APICALL void GL_APIENTRY glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    glBindBuffer(target, buffer);
+}
+GL_APICALL void GL_APIENTRY glGenVertexArrays(GLsizei n, GLuint* arrays)
+{
+    record(RECORDED_OTHER, n, 0);
+    for (GLsizei i = 0; i < n; i++)
+    {
+        arrays[i] = nextObject++;
+        memset(&vertexArrays[arrays[i]], 0, sizeof(RecordedVertexArray));
+    }
+}
+GL_APICALL void GL_APIENTRY glDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+    record(RECORDED_OTHER, n, 0);
+    for (GLsizei i = 0; i < n; i++)
+    {
+        if (arrays[i] != 0)
+        {
+            vertexArrays.erase(arrays[i]);
+        }
+    }
+}
+GL_APICALL void GL_APIENTRY glBindVertexArray(GLuint array)
+{
+    record(RECORDED_BIND_VERTEX_ARRAY, array, 0);
+    frameCounts.vertexArrayBinds++;
+    vertexArray = array;
+    attributes = vertexArrays[array].attributes;
+    elementArrayBuffer = vertexArrays[array].elementArrayBuffer;
+}
+static GLuint boundBuffer(GLenum target)
+{
+    return target == GL_ARRAY_BUFFER ? arrayBuffer : target == GL_ELEMENT_ARRAY_BUFFER ? elementArrayBuffer
+         : target == GL_UNIFORM_BUFFER ? uniformBuffer : 0;
+}
+GL_APICALL void GL_APIENTRY glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    record(RECORDED_BUFFER_DATA, boundBuffer(target), (unsigned int) size);
+    frameCounts.uploadBytes += data ? size : 0;
+    std::vector<unsigned char>& copy = bufferData[boundBuffer(target)];
+    copy.assign(size, 0);
+    if (data && size > 0)
+    {
+        memcpy(&copy[0], data, size);
+    }
+}
+GL_APICALL void GL_APIENTRY glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    record(RECORDED_BUFFER_DATA, boundBuffer(target), (unsigned int) size);
+    frameCounts.uploadBytes += size;
+    std::vector<unsigned char>& copy = bufferData[boundBuffer(target)];
+    if (offset + size <= (GLintptr) copy.size() && size > 0)
+    {
+        memcpy(&copy[offset], data, size);
+    }
+}
+
+// 映射直接返回副本里的内存，刷新时才算作上传（驱动在这时把数据交给GPU）
+GL_APICALL void* GL_APIENTRY glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    record(RECORDED_OTHER, boundBuffer(target), 0);
+    std::vector<unsigned char>& copy = bufferData[boundBuffer(target)];
+    if (length <= 0 || offset + length > (GLintptr) copy.size())
+    {
+        return NULL;
+    }
+    return &copy[offset];
+}
+GL_APICALL void GL_APIENTRY glFlushMappedBufferRange(GLenum target, GLintptr offset, GLsizeiptr length)
+{
+    record(RECORDED_BUFFER_DATA, boundBuffer(target), (unsigned int) length);
+    frameCounts.uploadBytes += length;
+}
+GL_APICALL GLboolean GL_APIENTRY glUnmapBuffer(GLenum target)
+{
+    record(RECORDED_OTHER, boundBuffer(target), 0);
+    return GL_TRUE;
+}
+
+// 没有GPU，栅栏总是已经触发
+GL_APICALL GLsync GL_APIENTRY glFenceSync(GLenum condition, GLbitfield flags)
+{
+    record(RECORDED_OTHER, 0, 0);
+    return (GLsync) (size_t) nextObject++;
+}
+GL_APICALL GLenum GL_APIENTRY glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    record(RECORDED_OTHER, 0, 0);
+    return GL_ALREADY_SIGNALED;
+}
+GL_APICALL void GL_APIENTRY glDeleteSync(GLsync sync)
+{
+    record(RECORDED_OTHER, 0, 0);
+}
+
+// --- 纹理 ---
+
+GL_APICALL void GL_APIENTRY glGenTextures(GLsizei n, GLuint* textures)
+{
+    record(RECORDED_OTHER, n, 0);
+    for (GLsizei i = 0; i < n; i++)
+    {
+        textures[i] = nextObject++;
+    }
+}
+GL_APICALL void GL_APIENTRY glDeleteTextures(GLsizei n, const GLuint* textures) { record(RECORDED_OTHER, n, 0); }
+GL_APICALL void GL_APIENTRY glActiveTexture(GLenum texture) { record(RECORDED_STATE, texture, 0); frameCounts.stateChanges++; }
+GL_APICALL void GL_APIENTRY glBindTexture(GLenum target, GLuint texture)
+{
+    record(RECORDED_BIND_TEXTURE, texture, 0);
+    frameCounts.textureBinds++;
+}
+GL_APICALL void GL_APIENTRY glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    int channels = format == GL_RGBA ? 4 : format == GL_RGB ? 3 : format == GL_LUMINANCE_ALPHA ? 2 : 1;
+    unsigned int bytes = pixels ? (unsigned int) (width * height * channels * typeSize(type)) : 0;
+    record(RECORDED_TEXTURE_DATA, level, bytes);
+    frameCounts.uploadBytes += bytes;
+}
+GL_APICALL void GL_APIENTRY glCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void* data)
+{
+    record(RECORDED_TEXTURE_DATA, level, imageSize);
+    frameCounts.uploadBytes += imageSize;
+}
+GL_APICALL void GL_APIENTRY glTexParameteri(GLenum target, GLenum pname, GLint param) { record(RECORDED_STATE, pname, 0); frameCounts.stateChanges++; }
+GL_APICALL void GL_APIENTRY glPixelStorei(GLenum pname, GLint param) { record(RECORDED_STATE, pname, 0); frameCounts.stateChanges++; }
+GL_APICALL void GL_APIENTRY glGenerateMipmap(GLenum target) { record(RECORDED_OTHER, target, 0); }
+
+// --- 全局状态 ---
+
+GL_APICALL void GL_APIENTRY glEnable(GLenum cap) { record(RECORDED_STATE, cap, 0); frameCounts.stateChanges++; }
+GL_APICALL void GL_APIENTRY glDisable(GLenum cap) { record(RECORDED_STATE, cap, 0); frameCounts.stateChanges++; }
+GL_APICALL void GL_APIENTRY glViewport(GLint x, GLint y, GLsizei width, GLsizei height) { record(RECORDED_STATE, 0, 0); frameCounts.stateChanges++; }
+GL_APICALL void GL_APIENTRY glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) { record(RECORDED_STATE, 0, 0); frameCounts.stateChanges++; }
+GL_APICALL void GL_APIENTRY glClear(GLbitfield mask) { record(RECORDED_CLEAR, mask, 0); }
+GL_APICALL GLenum GL_APIENTRY glGetError() { return GL_NO_ERROR; }
+GL_APICALL void GL_APIENTRY glGetIntegerv(GLenum pname, GLint* data) { *data = 0; }
+GL_APICALL const GLubyte* GL_APIENTRY glGetString(GLenum name)
+{
+    return (const GLubyte*) (name == GL_VERSION ? "OpenGL ES 3.0 GLRecorder" : "GLRecorder");
+}
+
+// --- 绘制 ---
+
+GL_APICALL void GL_APIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    long long bytes = count > 0 ? clientVertexBytes((long long) first + count) : 0;
+    record(RECORDED_DRAW_ARRAYS, count, (unsigned int) bytes);
+    frameCounts.drawCalls++;
+    frameCounts.clientVertexBytes += bytes;
+}
+GL_APICALL void GL_APIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    const void* indexData = indices;
+    long long indexBytes = (long long) count * typeSize(type);
+    if (elementArrayBuffer != 0)
+    {
+        // 索引在缓冲区里，indices是偏移量
+        std::vector<unsigned char>& copy = bufferData[elementArrayBuffer];
+        size_t offset = (size_t) indices;
+        indexData = offset + indexBytes <= copy.size() ? &copy[offset] : NULL;
+    }
+    else
+    {
+        frameCounts.clientIndexBytes += indexBytes;
+    }
+    long long bytes = 0;
+    if (indexData != NULL && count > 0)
+    {
+        bytes = clientVertexBytes((long long) maxIndex(indexData, count, type) + 1);
+    }
+    record(RECORDED_DRAW_ELEMENTS, count, (unsigned int) (bytes + (elementArrayBuffer ? 0 : indexBytes)));
+    frameCounts.drawCalls++;
+    frameCounts.clientVertexBytes += bytes;
+}
+// 实例化绘制按一次绘制调用统计，每实例属性一般放在缓冲区里，不计算客户端数据
+GL_APICALL void GL_APIENTRY glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
+{
+    glDrawArrays(mode, first, count);
+}
+GL_APICALL void GL_APIENTRY glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount)
+{
+    glDrawElements(mode, count, type, indices);
+}
@@ -0,0 +1,93 @@
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstddef>
+
+#include "../include/HostContext.h"
+#include "../include/LogUtil.h"
+
+static EGLDisplay hostDisplay = EGL_NO_DISPLAY;
+static EGLContext hostContext = EGL_NO_CONTEXT;
+static EGLSurface hostSurface = EGL_NO_SURFACE;
+
+// 优先使用Mesa的surfaceless平台，不依赖X11或Wayland，没有这个扩展时使用默认显示
+static EGLDisplay openDisplay()
+{
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+    {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (display != EGL_NO_DISPLAY)
+        {
+            return display;
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool createHostContext(int width, int height)
+{
+    hostDisplay = openDisplay();
+    if (hostDisplay == EGL_NO_DISPLAY || !eglInitialize(hostDisplay, NULL, NULL))
+    {
+        LOGE("Could not initialise EGL display");
+        return false;
+    }
+    eglBindAPI(EGL_OPENGL_ES_API);
+    const EGLint versions[] = {3, 2};
+    for (int i = 0; i < 2 && hostContext == EGL_NO_CONTEXT; i++)
+    {
+        EGLint configAttributes[] = {
+                EGL_RED_SIZE, 8,
+                EGL_GREEN_SIZE, 8,
+                EGL_BLUE_SIZE, 8,
+                EGL_ALPHA_SIZE, 8,
+                EGL_DEPTH_SIZE, 16,
+                EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                EGL_RENDERABLE_TYPE, versions[i] == 3 ? EGL_OPENGL_ES3_BIT_KHR : EGL_OPENGL_ES2_BIT,
+                EGL_NONE
+        };
+        EGLConfig config;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(hostDisplay, configAttributes, &config, 1, &configCount) || configCount == 0)
+        {
+            continue;
+        }
+        EGLint contextAttributes[] = {EGL_CONTEXT_CLIENT_VERSION, versions[i], EGL_NONE};
+        hostContext = eglCreateContext(hostDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+        if (hostContext != EGL_NO_CONTEXT)
+        {
+            EGLint surfaceAttributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+            hostSurface = eglCreatePbufferSurface(hostDisplay, config, surfaceAttributes);
+        }
+    }
+    if (hostContext == EGL_NO_CONTEXT || hostSurface == EGL_NO_SURFACE ||
+        !eglMakeCurrent(hostDisplay, hostSurface, hostSurface, hostContext))
+    {
+        LOGE("Could not create host GLES context (EGL error 0x%x)", eglGetError());
+        destroyHostContext();
+        return false;
+    }
+    return true;
+}
+
+void destroyHostContext()
+{
+    if (hostDisplay == EGL_NO_DISPLAY)
+    {
+        return;
+    }
+    eglMakeCurrent(hostDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (hostSurface != EGL_NO_SURFACE)
+    {
+        eglDestroySurface(hostDisplay, hostSurface);
+    }
+    if (hostContext != EGL_NO_CONTEXT)
+    {
+        eglDestroyContext(hostDisplay, hostContext);
+    }
+    eglTerminate(hostDisplay);
+    hostDisplay = EGL_NO_DISPLAY;
+    hostContext = EGL_NO_CONTEXT;
+    hostSurface = EGL_NO_SURFACE;
+}
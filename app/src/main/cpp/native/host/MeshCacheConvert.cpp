@@ -0,0 +1,384 @@
+/**
+ * 生成二进制网格缓存（见MeshCache.cpp），只在主机构建中编译。运行时mmap生成的文件，把顶点和索引直接交给glBufferData。
+ *
+ * 输入有两种：
+ *    - 导入的模型（OBJ或glb，见MeshImport.cpp），使用其中的位置、法线、纹理坐标
+ *    - 课程动态库导出的静态数组，例如lesson2的libCube.so里的cubeVertices、colour、indices，
+ *      每个--attribute给出数组名、含义和分量个数（默认位置、法线、颜色3个，纹理坐标2个），--indices给出GLushort索引数组
+ * 默认所有属性存成float；--packed时位置和纹理坐标存成half，法线存成int2101010，颜色存成unorm8（需要GLES3）。
+ * --optimize时先用IndexOptimizer重排索引和顶点，并打印优化前后的ACMR、ATVR、过度绘制和顶点读取量。
+ * --lods时用MeshSimplify生成最多count级LOD（误差不超过包围盒对角线的5%），各级索引连续存放在同一个索引块里。
+ *
+ * 用法：MeshCacheConvert (--mesh model.obj|model.glb | --library libCube.so --attribute name:semantic[:components] ...
+ *                        [--indices name]) [--packed] [--optimize [threshold]] [--lods count] --output out.mesh
+ *       semantic为position、normal、texcord或colour
+ */
+#include <GLES3/gl3.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <link.h>
+#include <string>
+#include <vector>
+
+#include "../include/IndexOptimizer.h"
+#include "../include/MeshCache.h"
+#include "../include/MeshImport.h"
+#include "../include/MeshSimplify.h"
+
+static const char* semanticNames[MESH_SEMANTIC_COUNT] = {"position", "normal", "texcord", "colour"};
+static const int defaultComponents[MESH_SEMANTIC_COUNT] = {3, 3, 2, 3};
+static const float lodErrorFraction = 0.05f; // LOD误差上限相对包围盒对角线的比例
+static const VertexElementFormat packedFormats[MESH_SEMANTIC_COUNT] = {VERTEX_HALF, VERTEX_INT_2_10_10_10,
+                                                                       VERTEX_HALF, VERTEX_UNORM8};
+
+struct LibraryAttribute
+{
+    std::string name;
+    MeshSemantic semantic;
+    int components;
+};
+
+// 解析name:semantic[:components]
+static bool parseAttribute(const char* text, LibraryAttribute* attribute)
+{
+    std::string value = text;
+    size_t first = value.find(':');
+    if (first == std::string::npos || first == 0)
+    {
+        fprintf(stderr, "Attribute %s should be name:semantic[:components]\n", text);
+        return false;
+    }
+    size_t second = value.find(':', first + 1);
+    std::string semantic = value.substr(first + 1, second == std::string::npos ? std::string::npos : second - first - 1);
+    attribute->name = value.substr(0, first);
+    for (int i = 0; i < MESH_SEMANTIC_COUNT; i++)
+    {
+        if (semantic == semanticNames[i])
+        {
+            attribute->semantic = (MeshSemantic) i;
+            attribute->components = second == std::string::npos ? defaultComponents[i] : atoi(text + second + 1);
+            if (attribute->components < 1 || attribute->components > 4 || (i == MESH_POSITION && attribute->components != 3))
+            {
+                fprintf(stderr, "Attribute %s has an invalid component count\n", text);
+                return false;
+            }
+            return true;
+        }
+    }
+    fprintf(stderr, "Unknown semantic %s\n", semantic.c_str());
+    return false;
+}
+
+// 从动态库中读取一个导出的数组，数组大小来自ELF符号表里记录的符号大小
+static bool readLibraryArray(void* library, const char* name, const void** data, size_t* bytes)
+{
+    void* symbol = dlsym(library, name);
+    Dl_info info;
+    const ElfW(Sym)* entry = NULL;
+    if (symbol == NULL || dladdr1(symbol, &info, (void**) &entry, RTLD_DL_SYMENT) == 0 || entry == NULL)
+    {
+        fprintf(stderr, "Library does not export %s\n", name);
+        return false;
+    }
+    *data = symbol;
+    *bytes = entry->st_size;
+    return true;
+}
+
+static void addAttribute(MeshCacheSource* source, MeshSemantic semantic, int components, bool packed, const float* data)
+{
+    MeshCacheAttribute& attribute = source->attributes[source->attributeCount++];
+    attribute.semantic = semantic;
+    attribute.components = components;
+    attribute.format = packed ? packedFormats[semantic] : VERTEX_FLOAT;
+    attribute.data = data;
+}
+
+static void printAnalysis(const char* label, const std::vector<unsigned int>& indices, const float* positions,
+                          int vertexCount, size_t vertexBytes)
+{
+    VertexCacheStats cache;
+    OverdrawStats overdraw;
+    VertexFetchStats fetch;
+    analyzeVertexCache(&indices[0], (int) indices.size(), vertexCount, &cache);
+    analyzeOverdraw(&indices[0], (int) indices.size(), positions, vertexCount, &overdraw);
+    analyzeVertexFetch(&indices[0], (int) indices.size(), vertexCount, vertexBytes, &fetch);
+    printf("%-7s ACMR %.3f, ATVR %.3f, overdraw %.3f, overfetch %.3f\n", label, cache.acmr, cache.atvr,
+           overdraw.overdraw, fetch.overfetch);
+}
+
+// 导入的网格优化前后的索引，统一成32位方便分析
+static std::vector<unsigned int> importedIndices(const ImportedMesh& mesh)
+{
+    if (mesh.indexType == GL_UNSIGNED_SHORT)
+    {
+        return std::vector<unsigned int>(mesh.shortIndices.begin(), mesh.shortIndices.end());
+    }
+    return mesh.indices;
+}
+
+// 除位置以外的属性拼成简化时使用的属性，权重都为1
+static void interleaveAttributes(const MeshCacheSource& source, std::vector<float>* data, std::vector<float>* weights,
+                                 SimplifyAttributes* attributes)
+{
+    int components = 0;
+    for (int i = 0; i < source.attributeCount; i++)
+    {
+        components += source.attributes[i].semantic == MESH_POSITION ? 0 : source.attributes[i].components;
+    }
+    data->resize((size_t) source.vertexCount * components + 1);
+    weights->assign(components + 1, 1.0f);
+    int offset = 0;
+    for (int i = 0; i < source.attributeCount; i++)
+    {
+        const MeshCacheAttribute& attribute = source.attributes[i];
+        if (attribute.semantic == MESH_POSITION)
+        {
+            continue;
+        }
+        for (int v = 0; v < source.vertexCount; v++)
+        {
+            memcpy(&(*data)[(size_t) v * components + offset], attribute.data + (size_t) v * attribute.components,
+                   sizeof(float) * attribute.components);
+        }
+        offset += attribute.components;
+    }
+    attributes->data = &(*data)[0];
+    attributes->components = components;
+    attributes->weights = &(*weights)[0];
+}
+
+// 生成LOD链，记录到source里，indices换成所有级的索引
+static void buildLods(MeshCacheSource* source, std::vector<unsigned int>* indices, const float* positions, int lodCount)
+{
+    float boundsMin[3] = {positions[0], positions[1], positions[2]};
+    float boundsMax[3] = {positions[0], positions[1], positions[2]};
+    for (int v = 1; v < source->vertexCount; v++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            boundsMin[k] = std::min(boundsMin[k], positions[v * 3 + k]);
+            boundsMax[k] = std::max(boundsMax[k], positions[v * 3 + k]);
+        }
+    }
+    float diagonal = sqrtf((boundsMax[0] - boundsMin[0]) * (boundsMax[0] - boundsMin[0]) +
+                           (boundsMax[1] - boundsMin[1]) * (boundsMax[1] - boundsMin[1]) +
+                           (boundsMax[2] - boundsMin[2]) * (boundsMax[2] - boundsMin[2]));
+    std::vector<float> data;
+    std::vector<float> weights;
+    SimplifyAttributes attributes;
+    interleaveAttributes(*source, &data, &weights, &attributes);
+    MeshLodChain chain;
+    buildLodChain(&chain, &(*indices)[0], (int) indices->size(), positions, source->vertexCount,
+                  attributes.components > 0 ? &attributes : NULL, lodCount, defaultLodReduction,
+                  diagonal * lodErrorFraction);
+    for (int i = 0; i < chain.lodCount; i++)
+    {
+        printf("LOD %d: %u triangles, error %g\n", i, chain.lods[i].indexCount / 3, chain.lods[i].error);
+    }
+    source->lodCount = chain.lodCount;
+    memcpy(source->lods, chain.lods, sizeof(MeshCacheLod) * chain.lodCount);
+    indices->swap(chain.indices);
+}
+
+int main(int argc, char** argv)
+{
+    const char* meshPath = NULL;
+    const char* libraryPath = NULL;
+    const char* indicesName = NULL;
+    const char* outputPath = NULL;
+    std::vector<LibraryAttribute> attributes;
+    bool packed = false;
+    bool optimize = false;
+    float overdrawThreshold = defaultOverdrawThreshold;
+    int lodCount = 1;
+    bool usage = false;
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--mesh") == 0 && hasValue)
+        {
+            meshPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--library") == 0 && hasValue)
+        {
+            libraryPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--attribute") == 0 && hasValue)
+        {
+            LibraryAttribute attribute;
+            if (!parseAttribute(argv[++i], &attribute)) return 2;
+            attributes.push_back(attribute);
+        }
+        else if (strcmp(argv[i], "--indices") == 0 && hasValue)
+        {
+            indicesName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--packed") == 0)
+        {
+            packed = true;
+        }
+        else if (strcmp(argv[i], "--optimize") == 0)
+        {
+            optimize = true;
+            if (hasValue && atof(argv[i + 1]) > 0.0)
+            {
+                overdrawThreshold = (float) atof(argv[++i]);
+            }
+        }
+        else if (strcmp(argv[i], "--lods") == 0 && hasValue)
+        {
+            lodCount = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--output") == 0 && hasValue)
+        {
+            outputPath = argv[++i];
+        }
+        else
+        {
+            usage = true;
+            break;
+        }
+    }
+    if (usage || outputPath == NULL || (meshPath == NULL) == (libraryPath == NULL) ||
+        (libraryPath != NULL && attributes.empty()) || attributes.size() > (size_t) maxVertexElements ||
+        lodCount < 1 || lodCount > maxMeshLods)
+    {
+        fprintf(stderr, "usage: %s (--mesh model.obj|model.glb | --library libCube.so\n"
+                        "       --attribute name:position|normal|texcord|colour[:components] ... [--indices name])\n"
+                        "       [--packed] [--optimize [threshold]] [--lods count] --output out.mesh\n", argv[0]);
+        return 2;
+    }
+
+    MeshCacheSource source;
+    memset(&source, 0, sizeof(source));
+    source.mode = GL_TRIANGLES;
+    ImportedMesh imported;
+    if (meshPath != NULL)
+    {
+        MeshImportStats stats;
+        if (!importMesh(meshPath, 0, &imported, &stats)) return 1;
+        printf("%s: %zu bytes, %d triangles, %d vertices after dedup\n", meshPath, stats.fileBytes, stats.triangles,
+               imported.vertexCount);
+        size_t vertexBytes = sizeof(float) * (3 + (imported.hasNormals ? 3 : 0) + (imported.hasTextureCords ? 2 : 0));
+        if (optimize)
+        {
+            printAnalysis("before", importedIndices(imported), &imported.positions[0], imported.vertexCount, vertexBytes);
+            optimizeImportedMesh(&imported, overdrawThreshold);
+            printAnalysis("after", importedIndices(imported), &imported.positions[0], imported.vertexCount, vertexBytes);
+        }
+        source.vertexCount = imported.vertexCount;
+        addAttribute(&source, MESH_POSITION, 3, packed, &imported.positions[0]);
+        if (imported.hasNormals)
+        {
+            addAttribute(&source, MESH_NORMAL, 3, packed, &imported.normals[0]);
+        }
+        if (imported.hasTextureCords)
+        {
+            addAttribute(&source, MESH_TEXTURE_CORD, 2, packed, &imported.textureCords[0]);
+        }
+        std::vector<unsigned int> indices = importedIndices(imported);
+        if (lodCount > 1)
+        {
+            buildLods(&source, &indices, &imported.positions[0], lodCount);
+        }
+        std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+        source.indexType = imported.indexType;
+        source.indexCount = (int) indices.size();
+        source.indices = imported.indexType == GL_UNSIGNED_INT ? (const void*) &indices[0]
+                                                               : (const void*) &shortIndices[0];
+        if (!writeMeshCache(outputPath, &source)) return 1;
+    }
+    else
+    {
+        void* library = dlopen(libraryPath, RTLD_NOW | RTLD_LOCAL);
+        if (library == NULL)
+        {
+            fprintf(stderr, "Could not load %s: %s\n", libraryPath, dlerror());
+            return 2;
+        }
+        // 复制一份，--optimize时要重排
+        std::vector<float> arrays[maxVertexElements];
+        const float* positions = NULL;
+        size_t vertexBytes = 0;
+        for (size_t i = 0; i < attributes.size(); i++)
+        {
+            const void* data;
+            size_t bytes;
+            if (!readLibraryArray(library, attributes[i].name.c_str(), &data, &bytes)) return 2;
+            int vertexCount = (int) (bytes / sizeof(float) / attributes[i].components);
+            if (i > 0 && vertexCount != source.vertexCount)
+            {
+                fprintf(stderr, "%s has %d vertices, expected %d\n", attributes[i].name.c_str(), vertexCount,
+                        source.vertexCount);
+                return 2;
+            }
+            source.vertexCount = vertexCount;
+            arrays[i].assign((const float*) data, (const float*) data + (size_t) vertexCount * attributes[i].components);
+            vertexBytes += sizeof(float) * attributes[i].components;
+            positions = attributes[i].semantic == MESH_POSITION ? &arrays[i][0] : positions;
+        }
+        if (positions == NULL)
+        {
+            fprintf(stderr, "A position attribute is required\n");
+            return 2;
+        }
+        std::vector<unsigned int> indices;
+        if (indicesName != NULL)
+        {
+            const void* data;
+            size_t bytes;
+            if (!readLibraryArray(library, indicesName, &data, &bytes)) return 2;
+            indices.assign((const GLushort*) data, (const GLushort*) data + bytes / sizeof(GLushort));
+        }
+        if (optimize && !indices.empty())
+        {
+            int indexCount = (int) indices.size();
+            printAnalysis("before", indices, positions, source.vertexCount, vertexBytes);
+            std::vector<unsigned int> reordered(indexCount);
+            optimizeVertexCache(&indices[0], &indices[0], indexCount, source.vertexCount);
+            optimizeOverdraw(&reordered[0], &indices[0], indexCount, positions, source.vertexCount, overdrawThreshold);
+            std::vector<unsigned int> remap(source.vertexCount);
+            int vertexCount = optimizeVertexFetchRemap(&remap[0], &reordered[0], indexCount, source.vertexCount);
+            remapIndices(&reordered[0], indexCount, &remap[0]);
+            for (size_t i = 0; i < attributes.size(); i++)
+            {
+                std::vector<float> remapped((size_t) vertexCount * attributes[i].components);
+                remapVertices(&remapped[0], &arrays[i][0], source.vertexCount, sizeof(float) * attributes[i].components,
+                              &remap[0]);
+                arrays[i].swap(remapped);
+                positions = attributes[i].semantic == MESH_POSITION ? &arrays[i][0] : positions;
+            }
+            source.vertexCount = vertexCount;
+            indices.swap(reordered);
+            printAnalysis("after", indices, positions, source.vertexCount, vertexBytes);
+        }
+        for (size_t i = 0; i < attributes.size(); i++)
+        {
+            addAttribute(&source, attributes[i].semantic, attributes[i].components, packed, &arrays[i][0]);
+        }
+        if (lodCount > 1 && !indices.empty())
+        {
+            buildLods(&source, &indices, positions, lodCount);
+        }
+        std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+        source.indexType = GL_UNSIGNED_SHORT;
+        source.indexCount = (int) shortIndices.size();
+        source.indices = shortIndices.empty() ? NULL : &shortIndices[0];
+        if (!writeMeshCache(outputPath, &source)) return 1;
+    }
+
+    MeshCacheFile file;
+    if (!openMeshCache(outputPath, true, &file)) return 1;
+    const MeshCacheHeader* header = file.header;
+    printf("%s: %zu bytes, %u vertices (%u bytes each), %u indices in %u LODs, bounds (%g %g %g)-(%g %g %g), radius %g\n",
+           outputPath, file.bytes, header->vertexCount, header->stride, header->indexCount, header->lodCount, header->boundsMin[0],
+           header->boundsMin[1], header->boundsMin[2], header->boundsMax[0], header->boundsMax[1], header->boundsMax[2],
+           header->boundingSphere[3]);
+    closeMeshCache(&file);
+    return 0;
+}
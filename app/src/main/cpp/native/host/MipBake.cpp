@@ -0,0 +1,165 @@
+/**
+ * 离线生成mipmap：读入一张RGBA8图片，用generateMipChain生成到1x1为止的完整mipmap链，写成KTX2文件，只在主机构建中编译。
+ * 烘焙好的文件在TextureStream里直接按级上传，运行时不需要再生成，也可以用更慢但更清晰的Kaiser过滤器。
+ *
+ * 输入可以是RGBA8的KTX/KTX2文件（只用第0级，sRGB格式按sRGB过滤），也可以是原始的RGBA8像素（--raw 宽 高）。
+ * 原始像素默认按sRGB颜色处理，法线贴图、遮罩之类的数据纹理要加--linear。
+ *
+ * 用法：MipBake (input.ktx | input.ktx2 | --raw W H input.rgba) --output out.ktx2
+ *               [--filter box|kaiser] [--linear] [--threads N]
+ */
+#include <GLES3/gl3.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../include/MipUtil.h"
+#include "../include/TextureStream.h"
+
+static bool readFile(const char* path, std::vector<unsigned char>* data)
+{
+    FILE* stream = fopen(path, "rb");
+    if (stream == NULL)
+    {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+    fseek(stream, 0, SEEK_END);
+    long bytes = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+    data->resize(bytes > 0 ? (size_t) bytes : 0);
+    bool ok = !data->empty() && fread(&(*data)[0], 1, data->size(), stream) == data->size();
+    fclose(stream);
+    if (!ok)
+    {
+        fprintf(stderr, "Could not read %s\n", path);
+    }
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const char* inputPath = NULL;
+    const char* outputPath = NULL;
+    int rawWidth = 0;
+    int rawHeight = 0;
+    bool linear = false;
+    MipFilter filter = MIP_FILTER_KAISER;
+    int threads = 0;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--raw") == 0 && i + 2 < argc)
+        {
+            rawWidth = atoi(argv[++i]);
+            rawHeight = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--output") == 0 && hasValue)
+        {
+            outputPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && hasValue)
+        {
+            i++;
+            valid = strcmp(argv[i], "box") == 0 || strcmp(argv[i], "kaiser") == 0;
+            filter = strcmp(argv[i], "box") == 0 ? MIP_FILTER_BOX : MIP_FILTER_KAISER;
+        }
+        else if (strcmp(argv[i], "--linear") == 0)
+        {
+            linear = true;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (argv[i][0] != '-' && inputPath == NULL)
+        {
+            inputPath = argv[i];
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+    if (!valid || inputPath == NULL || outputPath == NULL)
+    {
+        fprintf(stderr, "usage: %s (input.ktx | input.ktx2 | --raw W H input.rgba) --output out.ktx2\n"
+                        "       [--filter box|kaiser] [--linear] [--threads N]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<unsigned char> input;
+    if (!readFile(inputPath, &input))
+    {
+        return 2;
+    }
+    const unsigned char* pixels;
+    int width;
+    int height;
+    bool srgb;
+    if (rawWidth > 0 || rawHeight > 0)
+    {
+        if (rawWidth <= 0 || rawHeight <= 0 || input.size() != (size_t) rawWidth * rawHeight * 4)
+        {
+            fprintf(stderr, "%s has %zu bytes, expected %dx%dx4\n", inputPath, input.size(), rawWidth, rawHeight);
+            return 2;
+        }
+        pixels = &input[0];
+        width = rawWidth;
+        height = rawHeight;
+        srgb = !linear;
+    }
+    else
+    {
+        KtxImage image;
+        if (!parseKtx(&input[0], input.size(), &image))
+        {
+            return 2;
+        }
+        if (image.compressed)
+        {
+            fprintf(stderr, "%s is compressed (0x%x), only RGBA8 can be filtered\n", inputPath, image.internalFormat);
+            return 2;
+        }
+        pixels = image.levels[0].data;
+        width = image.width;
+        height = image.height;
+        srgb = image.internalFormat == GL_SRGB8_ALPHA8 && !linear;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    MipChain chain;
+    if (!generateMipChain(pixels, width, height, srgb, filter, threads, &chain))
+    {
+        return 2;
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    KtxImage baked;
+    baked.internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    baked.compressed = false;
+    baked.blockWidth = 1;
+    baked.blockHeight = 1;
+    baked.width = width;
+    baked.height = height;
+    baked.levelCount = chain.levelCount;
+    for (int level = 0; level < chain.levelCount; level++)
+    {
+        baked.levels[level].data = &chain.pixels[chain.offset[level]];
+        baked.levels[level].bytes = (size_t) chain.width[level] * chain.height[level] * 4;
+        baked.levels[level].width = chain.width[level];
+        baked.levels[level].height = chain.height[level];
+    }
+    if (!writeKtx2(outputPath, &baked))
+    {
+        return 2;
+    }
+    printf("%s: %dx%d %s, %d levels, %s filter, %.1f ms, %zu bytes\n", outputPath, width, height,
+           srgb ? "sRGB" : "linear", chain.levelCount, filter == MIP_FILTER_BOX ? "box" : "kaiser", milliseconds,
+           chain.pixels.size());
+    return 0;
+}
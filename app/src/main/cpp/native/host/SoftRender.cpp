@@ -0,0 +1,356 @@
+/**
+ * 用软件光栅化（见SoftRaster.cpp）渲染课程画面，写成PPM或和基准图像比较，只在主机构建中编译，不需要GPU。
+ *
+ * 顶点、颜色、法线、纹理坐标、索引和纹理直接读取课程动态库导出的数组，矩阵和课程renderFrame画第angle帧时相同
+ * （绕X、Y轴各转angle度，往Z轴负方向移动10个单位，45度视角），lesson4的光照参数和Light.cpp相同。
+ * lesson5的立方体位置随时间变化，不在这里渲染。
+ *    --output dir：把每课的画面写成dir/<课程>.ppm，可以作为基准图像
+ *    --golden dir：和dir/<课程>.ppm比较，任一通道差值超过--tolerance的像素多于--max-different个时返回1
+ *    --compare-gl：再用EGL离屏上下文运行课程本身（Mesa llvmpipe）画到第angle帧，报告和软件光栅化结果不同的像素个数，
+ *                  用来确认软件光栅化和GL的画面一致（边缘像素的覆盖规则和颜色舍入可能有少量差别）
+ *
+ * 用法：SoftRender [--library-dir dir] [--scene name] [--size N] [--angle A] [--threads N] [--output dir]
+ *                  [--golden dir] [--tolerance T] [--max-different N] [--compare-gl]
+ */
+#include <GLES3/gl3.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <link.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "../include/CameraUtil.h"
+#include "../include/HostContext.h"
+#include "../include/Scene.h"
+#include "../include/ShaderVariant.h"
+#include "../include/SoftRaster.h"
+
+static const char* lessonNames[] = {"Triangle", "Cube", "TextureCube", "Light"};
+
+// 和Triangle.cpp的块着色器相同
+static const float triangleColour[3] = {1.0f, 0.0f, 0.0f};
+// 和Light.cpp相同
+static const LightingMaterial cubeMaterial = {{1.0f, 1.0f, 1.0f}, 2.0f, 0, false};
+static const float inverseLightDirection[3] = {0.0f, 1.0f, 1.0f};
+static const float inverseEyeDirection[3] = {0.0f, 0.0f, 1.0f};
+static const float ambientLightIntensity[3] = {0.1f, 0.1f, 0.1f};
+static const float diffuseLightIntensity[3] = {1.0f, 1.0f, 1.0f};
+static const float specularLightIntensity[3] = {1.0f, 1.0f, 1.0f};
+
+// 从动态库中读取一个导出的数组，数组大小来自ELF符号表里记录的符号大小
+static bool readLibraryArray(void* library, const char* name, const void** data, size_t* bytes)
+{
+    void* symbol = dlsym(library, name);
+    Dl_info info;
+    const ElfW(Sym)* entry = NULL;
+    if (symbol == NULL || dladdr1(symbol, &info, (void**) &entry, RTLD_DL_SYMENT) == 0 || entry == NULL)
+    {
+        fprintf(stderr, "Library does not export %s\n", name);
+        return false;
+    }
+    *data = symbol;
+    *bytes = entry->st_size;
+    return true;
+}
+
+// 按课程名填写绘制参数，数组都指向库里的数据，矩阵和光照写入调用方提供的存储
+static bool lessonDraw(void* library, const char* name, float angle, float* projection, float* modelView,
+                       LightingUniforms* lighting, SoftTexture* texture, SoftDraw* draw)
+{
+    memset(draw, 0, sizeof(*draw));
+    const void* data;
+    size_t bytes;
+    matrixPerspective(projection, 45, 1.0f, 0.1f, 100); // 画面是正方形
+    matrixEulerTransform(modelView, angle, angle, 0.0f, 0.0f, 0.0f, -10.0f, 1.0f, 1.0f, 1.0f);
+    if (strcmp(name, "Triangle") == 0)
+    {
+        if (!readLibraryArray(library, "triangleVertices", &data, &bytes)) return false;
+        draw->positions = (const float*) data;
+        draw->positionSize = 2;
+        draw->vertexCount = (int) (bytes / sizeof(float) / 2);
+        draw->count = draw->vertexCount;
+        draw->constantColour = triangleColour;
+        return true; // 没有矩阵和深度测试
+    }
+    bool light = strcmp(name, "Light") == 0;
+    if (!readLibraryArray(library, light ? "vertices" : "cubeVertices", &data, &bytes)) return false;
+    draw->positions = (const float*) data;
+    draw->positionSize = 3;
+    draw->vertexCount = (int) (bytes / sizeof(float) / 3);
+    if (!readLibraryArray(library, "indices", &data, &bytes)) return false;
+    draw->indices = data;
+    draw->indexType = GL_UNSIGNED_SHORT;
+    draw->count = (int) (bytes / sizeof(GLushort));
+    draw->projection = projection;
+    draw->modelView = modelView;
+    draw->depthTest = true;
+    if (strcmp(name, "TextureCube") == 0)
+    {
+        if (!readLibraryArray(library, "textureCords", &data, &bytes)) return false;
+        draw->textureCoordinates = (const float*) data;
+        if (!readLibraryArray(library, "simpleTexturePixels", &data, &bytes)) return false;
+        texture->width = 3;
+        texture->height = 3;
+        texture->rgba = (const unsigned char*) data;
+        draw->texture = texture;
+        return true;
+    }
+    if (!readLibraryArray(library, "colour", &data, &bytes)) return false;
+    draw->colours = (const float*) data;
+    if (light)
+    {
+        if (!readLibraryArray(library, "normals", &data, &bytes)) return false;
+        draw->normals = (const float*) data;
+        computeLightingUniforms(lighting, inverseLightDirection, inverseEyeDirection, ambientLightIntensity,
+                                diffuseLightIntensity, specularLightIntensity, &cubeMaterial);
+        draw->lighting = lighting;
+    }
+    return true;
+}
+
+static bool writePpm(const std::string& path, int width, int height, const std::vector<unsigned char>& rgba)
+{
+    FILE* stream = fopen(path.c_str(), "wb");
+    if (stream == NULL)
+    {
+        fprintf(stderr, "Could not open %s\n", path.c_str());
+        return false;
+    }
+    fprintf(stream, "P6\n%d %d\n255\n", width, height);
+    bool written = true;
+    for (size_t i = 0; i < rgba.size() && written; i += 4)
+    {
+        written = fwrite(&rgba[i], 1, 3, stream) == 3;
+    }
+    return fclose(stream) == 0 && written;
+}
+
+static bool readPpm(const std::string& path, int* width, int* height, std::vector<unsigned char>* rgba)
+{
+    FILE* stream = fopen(path.c_str(), "rb");
+    if (stream == NULL)
+    {
+        fprintf(stderr, "Could not open %s\n", path.c_str());
+        return false;
+    }
+    int maximum = 0;
+    bool ok = fscanf(stream, "P6 %d %d %d", width, height, &maximum) == 3 && maximum == 255 && fgetc(stream) != EOF
+              && *width > 0 && *height > 0;
+    if (ok)
+    {
+        rgba->resize((size_t) *width * *height * 4);
+        for (size_t i = 0; i < rgba->size() && ok; i += 4)
+        {
+            ok = fread(&(*rgba)[i], 1, 3, stream) == 3;
+            (*rgba)[i + 3] = 255;
+        }
+    }
+    fclose(stream);
+    if (!ok)
+    {
+        fprintf(stderr, "%s is not a binary PPM image\n", path.c_str());
+    }
+    return ok;
+}
+
+// 任一RGB通道差值超过tolerance的像素个数
+static int countDifferentPixels(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b, int tolerance)
+{
+    int different = 0;
+    for (size_t i = 0; i + 3 < a.size() && i + 3 < b.size(); i += 4)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            if (abs((int) a[i + c] - (int) b[i + c]) > tolerance)
+            {
+                different++;
+                break;
+            }
+        }
+    }
+    return different;
+}
+
+// 用课程自己的代码在GL上画到第angle帧，读回的像素按第一行在最上面排列
+static bool renderWithGL(const char* name, int size, int angle, std::vector<unsigned char>* rgba)
+{
+    if (!selectScene(name, size, size))
+    {
+        return false;
+    }
+    for (int frame = 0; frame <= angle; frame++) // 第0帧的角度为0，每帧加1度
+    {
+        currentScene()->render();
+    }
+    std::vector<unsigned char> pixels((size_t) size * size * 4);
+    glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+    rgba->resize(pixels.size());
+    for (int y = 0; y < size; y++)
+    {
+        memcpy(&(*rgba)[(size_t) y * size * 4], &pixels[(size_t) (size - 1 - y) * size * 4], (size_t) size * 4);
+    }
+    closeScene();
+    return true;
+}
+
+static std::string executableDirectory()
+{
+    char path[512];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length <= 0)
+    {
+        return ".";
+    }
+    path[length] = '\0';
+    char* separator = strrchr(path, '/');
+    if (separator != NULL)
+    {
+        *separator = '\0';
+    }
+    return path;
+}
+
+int main(int argc, char** argv)
+{
+    std::string libraryDirectory = executableDirectory();
+    const char* sceneFilter = NULL;
+    const char* outputDirectory = NULL;
+    const char* goldenDirectory = NULL;
+    int size = 256;
+    int angle = 30;
+    int threads = 0;
+    int tolerance = 2;
+    int maxDifferent = 0;
+    bool compareGL = false;
+    bool usage = false;
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--library-dir") == 0 && hasValue)
+        {
+            libraryDirectory = argv[++i];
+        }
+        else if (strcmp(argv[i], "--scene") == 0 && hasValue)
+        {
+            sceneFilter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--size") == 0 && hasValue)
+        {
+            size = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--angle") == 0 && hasValue)
+        {
+            angle = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--output") == 0 && hasValue)
+        {
+            outputDirectory = argv[++i];
+        }
+        else if (strcmp(argv[i], "--golden") == 0 && hasValue)
+        {
+            goldenDirectory = argv[++i];
+        }
+        else if (strcmp(argv[i], "--tolerance") == 0 && hasValue)
+        {
+            tolerance = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-different") == 0 && hasValue)
+        {
+            maxDifferent = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--compare-gl") == 0)
+        {
+            compareGL = true;
+        }
+        else
+        {
+            usage = true;
+            break;
+        }
+    }
+    if (usage || size <= 0 || angle < 0 || angle > 360)
+    {
+        fprintf(stderr, "usage: %s [--library-dir dir] [--scene name] [--size N] [--angle A] [--threads N]\n"
+                        "       [--output dir] [--golden dir] [--tolerance T] [--max-different N] [--compare-gl]\n",
+                argv[0]);
+        return 2;
+    }
+    if (compareGL && !createHostContext(size, size))
+    {
+        return 2;
+    }
+    setSceneLibraryDirectory(libraryDirectory.c_str());
+    startSoftRasterThreads(threads);
+    SoftFramebuffer framebuffer;
+    if (!createSoftFramebuffer(&framebuffer, size, size))
+    {
+        return 2;
+    }
+    int failed = 0;
+    for (size_t l = 0; l < sizeof(lessonNames) / sizeof(lessonNames[0]); l++)
+    {
+        const char* name = lessonNames[l];
+        if (sceneFilter != NULL && strcmp(sceneFilter, name) != 0)
+        {
+            continue;
+        }
+        std::string path = libraryDirectory + "/lib" + name + ".so";
+        void* library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (library == NULL)
+        {
+            fprintf(stderr, "Could not load %s: %s\n", path.c_str(), dlerror());
+            return 2;
+        }
+        float projection[16];
+        float modelView[16];
+        LightingUniforms lighting;
+        SoftTexture texture;
+        SoftDraw draw;
+        if (!lessonDraw(library, name, (float) angle, projection, modelView, &lighting, &texture, &draw))
+        {
+            return 2;
+        }
+        resetSoftRasterStats();
+        clearSoftFramebuffer(&framebuffer, 0.0f, 0.0f, 0.0f, 1.0f);
+        softDraw(&framebuffer, &draw);
+        SoftRasterStats stats;
+        getSoftRasterStats(&stats);
+        printf("%s: %d triangles, %d culled, %lld pixels\n", name, stats.triangles, stats.culled, stats.pixels);
+        std::string file = std::string(name) + ".ppm";
+        if (outputDirectory != NULL && !writePpm(std::string(outputDirectory) + "/" + file, size, size, framebuffer.colour))
+        {
+            return 2;
+        }
+        if (goldenDirectory != NULL)
+        {
+            int width, height;
+            std::vector<unsigned char> golden;
+            if (!readPpm(std::string(goldenDirectory) + "/" + file, &width, &height, &golden)) return 2;
+            int different = width == size && height == size ? countDifferentPixels(framebuffer.colour, golden, tolerance)
+                                                            : size * size;
+            printf("    golden: %d different pixels\n", different);
+            failed += different > maxDifferent;
+        }
+        if (compareGL)
+        {
+            std::vector<unsigned char> rendered;
+            if (!renderWithGL(name, size, angle, &rendered)) return 2;
+            int different = countDifferentPixels(framebuffer.colour, rendered, tolerance);
+            printf("    GL: %d different pixels (%.3f%%)\n", different, 100.0 * different / (size * size));
+        }
+        dlclose(library);
+    }
+    stopSoftRasterThreads();
+    if (compareGL)
+    {
+        destroyHostContext();
+    }
+    return failed > 0 ? 1 : 0;
+}
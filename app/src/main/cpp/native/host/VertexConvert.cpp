@@ -0,0 +1,321 @@
+/**
+ * 把分开存放的float顶点属性转换成交错、量化的顶点数据（见VertexFormat.cpp），并检查量化对光照结果的影响，只在主机构建中编译。
+ *
+ * 输入有两种：
+ *    - 三个原始float32文件（小端，每个顶点3个分量），分别是位置、法线、颜色
+ *    - 课程动态库，读取它导出的vertices、normals、colour数组，例如lesson4的libLight.so
+ * 转换后把数据再解码回来，与原数据比较位置误差、法线夹角误差、颜色误差，
+ * 并用与lesson4顶点着色器相同的Phong光照公式，在一圈旋转角度下比较逐顶点的光照颜色，
+ * 最大误差超过--tolerance时返回1（默认0.5/255，即不改变8位帧缓冲里的像素值）。
+ *
+ * 用法：VertexConvert (--library libLight.so | --positions p.bin --normals n.bin --colours c.bin)
+ *                     [--position-format float|half] [--normal-format float|snorm8|int2101010]
+ *                     [--colour-format float|unorm8] [--tolerance T] [--output packed.bin]
+ */
+#include <GLES3/gl3.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <link.h>
+#include <vector>
+
+#include "../include/CameraUtil.h"
+#include "../include/VertexFormat.h"
+
+struct FormatName
+{
+    const char* name;
+    VertexElementFormat format;
+};
+
+static const FormatName formatNames[] = {
+        {"float", VERTEX_FLOAT},
+        {"half", VERTEX_HALF},
+        {"snorm8", VERTEX_SNORM8},
+        {"unorm8", VERTEX_UNORM8},
+        {"int2101010", VERTEX_INT_2_10_10_10},
+};
+
+static bool parseFormat(const char* name, VertexElementFormat* format)
+{
+    for (size_t i = 0; i < sizeof(formatNames) / sizeof(formatNames[0]); i++)
+    {
+        if (strcmp(name, formatNames[i].name) == 0)
+        {
+            *format = formatNames[i].format;
+            return true;
+        }
+    }
+    fprintf(stderr, "Unknown vertex format %s\n", name);
+    return false;
+}
+
+static const char* formatName(VertexElementFormat format)
+{
+    for (size_t i = 0; i < sizeof(formatNames) / sizeof(formatNames[0]); i++)
+    {
+        if (formatNames[i].format == format)
+        {
+            return formatNames[i].name;
+        }
+    }
+    return "unknown";
+}
+
+static bool readFloats(const char* path, std::vector<float>* values)
+{
+    FILE* stream = fopen(path, "rb");
+    if (stream == NULL)
+    {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+    fseek(stream, 0, SEEK_END);
+    long bytes = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+    values->resize(bytes / sizeof(float));
+    bool ok = values->empty() || fread(&(*values)[0], sizeof(float), values->size(), stream) == values->size();
+    fclose(stream);
+    if (!ok)
+    {
+        fprintf(stderr, "Could not read %s\n", path);
+    }
+    return ok;
+}
+
+// 从动态库中读取一个导出的float数组，数组大小来自ELF符号表里记录的符号大小
+static bool readLibraryArray(void* library, const char* name, std::vector<float>* values)
+{
+    void* symbol = dlsym(library, name);
+    Dl_info info;
+    const ElfW(Sym)* entry = NULL;
+    if (symbol == NULL || dladdr1(symbol, &info, (void**) &entry, RTLD_DL_SYMENT) == 0 || entry == NULL)
+    {
+        fprintf(stderr, "Library does not export %s\n", name);
+        return false;
+    }
+    const float* data = (const float*) symbol;
+    values->assign(data, data + entry->st_size / sizeof(float));
+    return true;
+}
+
+static void normalize3(float* v)
+{
+    float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (length > 0.0f)
+    {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+static float dot3(const float* a, const float* b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// 与lesson4顶点着色器相同的逐顶点Phong光照：环境光0.1、白色漫反射、白色镜面反射（指数2），结果按帧缓冲截断到0~1
+static void lightVertex(const float* modelView, const float* normal, const float* colour, float* result)
+{
+    float transformed[3];
+    for (int i = 0; i < 3; i++)
+    {
+        transformed[i] = modelView[i] * normal[0] + modelView[4 + i] * normal[1] + modelView[8 + i] * normal[2];
+    }
+    normalize3(transformed);
+    float light[3] = {0.0f, 1.0f, 1.0f};
+    normalize3(light);
+    float normalDotLight = fmaxf(0.0f, dot3(transformed, light));
+    // reflect(-L, N) = -L - 2 * dot(N, -L) * N
+    float reflection[3];
+    for (int i = 0; i < 3; i++)
+    {
+        reflection[i] = -light[i] + 2.0f * normalDotLight * transformed[i];
+    }
+    float specular = powf(fmaxf(0.0f, reflection[2]), 2.0f);
+    for (int i = 0; i < 3; i++)
+    {
+        float value = normalDotLight * colour[i] + 0.1f * colour[i] + specular;
+        result[i] = value < 0.0f ? 0.0f : value > 1.0f ? 1.0f : value;
+    }
+}
+
+// 法线不要求是单位向量（lesson4的法线分量都是±1），比较的是方向。用atan2(|a×b|, a·b)，夹角很小时比acos精确
+static float angleDegrees(const float* a, const float* b)
+{
+    float cross[3] = {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+    return atan2f(sqrtf(dot3(cross, cross)), dot3(a, b)) * 180.0f / (float) M_PI;
+}
+
+int main(int argc, char** argv)
+{
+    const char* libraryPath = NULL;
+    const char* inputPaths[3] = {NULL, NULL, NULL};
+    const char* outputPath = NULL;
+    VertexElementFormat formats[3] = {VERTEX_HALF, VERTEX_INT_2_10_10_10, VERTEX_UNORM8};
+    float tolerance = 0.5f / 255.0f;
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--library") == 0 && hasValue)
+        {
+            libraryPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--positions") == 0 && hasValue)
+        {
+            inputPaths[0] = argv[++i];
+        }
+        else if (strcmp(argv[i], "--normals") == 0 && hasValue)
+        {
+            inputPaths[1] = argv[++i];
+        }
+        else if (strcmp(argv[i], "--colours") == 0 && hasValue)
+        {
+            inputPaths[2] = argv[++i];
+        }
+        else if (strcmp(argv[i], "--position-format") == 0 && hasValue)
+        {
+            if (!parseFormat(argv[++i], &formats[0])) return 2;
+        }
+        else if (strcmp(argv[i], "--normal-format") == 0 && hasValue)
+        {
+            if (!parseFormat(argv[++i], &formats[1])) return 2;
+        }
+        else if (strcmp(argv[i], "--colour-format") == 0 && hasValue)
+        {
+            if (!parseFormat(argv[++i], &formats[2])) return 2;
+        }
+        else if (strcmp(argv[i], "--tolerance") == 0 && hasValue)
+        {
+            tolerance = (float) atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--output") == 0 && hasValue)
+        {
+            outputPath = argv[++i];
+        }
+        else
+        {
+            libraryPath = NULL;
+            inputPaths[0] = NULL;
+            break;
+        }
+    }
+    if (libraryPath == NULL && (inputPaths[0] == NULL || inputPaths[1] == NULL || inputPaths[2] == NULL))
+    {
+        fprintf(stderr, "usage: %s (--library libLight.so | --positions p.bin --normals n.bin --colours c.bin)\n"
+                        "       [--position-format float|half] [--normal-format float|snorm8|int2101010]\n"
+                        "       [--colour-format float|unorm8] [--tolerance T] [--output packed.bin]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<float> sources[3];
+    if (libraryPath != NULL)
+    {
+        void* library = dlopen(libraryPath, RTLD_NOW | RTLD_LOCAL);
+        if (library == NULL)
+        {
+            fprintf(stderr, "Could not load %s: %s\n", libraryPath, dlerror());
+            return 2;
+        }
+        const char* names[3] = {"vertices", "normals", "colour"};
+        for (int i = 0; i < 3; i++)
+        {
+            if (!readLibraryArray(library, names[i], &sources[i])) return 2;
+        }
+    }
+    else
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            if (!readFloats(inputPaths[i], &sources[i])) return 2;
+        }
+    }
+    int vertexCount = (int) (sources[0].size() / 3);
+    if (vertexCount == 0 || sources[1].size() != sources[0].size() || sources[2].size() != sources[0].size())
+    {
+        fprintf(stderr, "Positions, normals and colours must have the same number of 3-component vertices\n");
+        return 2;
+    }
+
+    VertexLayout layout;
+    initVertexLayout(&layout);
+    for (int i = 0; i < 3; i++)
+    {
+        if (!addVertexElement(&layout, i, 3, formats[i])) return 2;
+    }
+    const float* sourcePointers[3] = {&sources[0][0], &sources[1][0], &sources[2][0]};
+    std::vector<unsigned char> packed((size_t) layout.stride * vertexCount);
+    packVertices(&layout, sourcePointers, vertexCount, &packed[0]);
+    std::vector<float> decoded[3];
+    float* decodedPointers[3];
+    for (int i = 0; i < 3; i++)
+    {
+        decoded[i].resize(sources[i].size());
+        decodedPointers[i] = &decoded[i][0];
+    }
+    unpackVertices(&layout, &packed[0], vertexCount, decodedPointers);
+
+    float maxPositionError = 0.0f;
+    float maxNormalDegrees = 0.0f;
+    float maxColourError = 0.0f;
+    for (int v = 0; v < vertexCount; v++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            maxPositionError = fmaxf(maxPositionError, fabsf(decoded[0][v * 3 + c] - sources[0][v * 3 + c]));
+            maxColourError = fmaxf(maxColourError, fabsf(decoded[2][v * 3 + c] - sources[2][v * 3 + c]));
+        }
+        maxNormalDegrees = fmaxf(maxNormalDegrees, angleDegrees(&decoded[1][v * 3], &sources[1][v * 3]));
+    }
+    // 与lesson4的renderFrame一样绕X轴和Y轴旋转，每度取一次
+    float maxLitError = 0.0f;
+    float modelView[16];
+    for (int angle = 0; angle < 360; angle++)
+    {
+        matrixEulerTransform(modelView, (float) angle, (float) angle, 0.0f, 0.0f, 0.0f, -10.0f, 1.0f, 1.0f, 1.0f);
+        for (int v = 0; v < vertexCount; v++)
+        {
+            float expected[3];
+            float actual[3];
+            lightVertex(modelView, &sources[1][v * 3], &sources[2][v * 3], expected);
+            lightVertex(modelView, &decoded[1][v * 3], &decoded[2][v * 3], actual);
+            for (int c = 0; c < 3; c++)
+            {
+                maxLitError = fmaxf(maxLitError, fabsf(actual[c] - expected[c]));
+            }
+        }
+    }
+
+    if (outputPath != NULL)
+    {
+        FILE* stream = fopen(outputPath, "wb");
+        if (stream == NULL || fwrite(&packed[0], 1, packed.size(), stream) != packed.size())
+        {
+            fprintf(stderr, "Could not write %s\n", outputPath);
+            if (stream != NULL) fclose(stream);
+            return 2;
+        }
+        fclose(stream);
+    }
+
+    const char* names[3] = {"position", "normal", "colour"};
+    printf("{\n  \"vertexCount\": %d,\n  \"stride\": %d,\n  \"elements\": [", vertexCount, layout.stride);
+    for (int i = 0; i < 3; i++)
+    {
+        printf("%s{\"name\": \"%s\", \"format\": \"%s\", \"offset\": %d, \"bytes\": %d}", i ? ", " : "",
+               names[i], formatName(formats[i]), layout.elements[i].offset, layout.elements[i].bytes);
+    }
+    printf("],\n  \"sourceBytes\": %d,\n  \"packedBytes\": %d,\n", vertexCount * 36, (int) packed.size());
+    printf("  \"maxPositionError\": %g,\n  \"maxNormalErrorDegrees\": %g,\n  \"maxColourError\": %g,\n",
+           maxPositionError, maxNormalDegrees, maxColourError);
+    printf("  \"maxLitError\": %g,\n  \"tolerance\": %g\n}\n", maxLitError, tolerance);
+    if (maxLitError > tolerance)
+    {
+        fprintf(stderr, "Lit colour changed by %g, tolerance %g\n", maxLitError, tolerance);
+        return 1;
+    }
+    return 0;
+}
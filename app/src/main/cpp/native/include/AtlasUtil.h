@@ -0,0 +1,59 @@
+#ifndef LEARNOPENGL_ATLASUTIL_H
+#define LEARNOPENGL_ATLASUTIL_H
+
+#include <GLES3/gl3.h>
+#include <vector>
+
+// 要放进图集的一张RGBA8图片
+struct AtlasImage
+{
+    const unsigned char* rgba;
+    int width;
+    int height;
+};
+
+struct AtlasOptions
+{
+    int pageSize; // 每页的宽高（2的幂，ES2上才能用mipmap）
+    int padding; // 图片四周复制边缘像素的宽度，防止双线性过滤和缩小的mipmap采到相邻的图片
+    int alignment; // 每张图片（含padding）的位置和大小对齐到这个像素数（2的幂），前log2(alignment)级mipmap里图片之间不会混色
+};
+
+// 一张图片在图集中的位置，uv = uvOffset + uv * uvScale把原来的纹理坐标映射到所在页中
+struct AtlasEntry
+{
+    int page;
+    int x; // 图片（不含padding）左下角在页中的像素位置
+    int y;
+    int width;
+    int height;
+    float uvOffset[2];
+    float uvScale[2];
+};
+
+struct TextureAtlas
+{
+    int pageSize;
+    int pageCount;
+    std::vector<AtlasEntry> entries; // 和输入图片一一对应，就是纹理坐标的重映射表
+    std::vector<std::vector<unsigned char> > pages; // 每页pageSize×pageSize的RGBA8
+    long long imagePixels; // 所有图片（不含padding）的像素数
+};
+
+/**
+ * 用skyline（最低、最左优先）把图片装进若干页，高的图片先放，放不下当前各页时开一页新的。
+ * 图片加padding后比一页还大时返回false。
+ */
+bool buildTextureAtlas(const AtlasImage* images, int count, const AtlasOptions* options, TextureAtlas* atlas);
+// 把count个纹理坐标（u, v交替）映射到entry所在的区域，out可以和uvs相同。坐标应该在[0, 1]内，图集中不能用GL_REPEAT
+void remapAtlasUVs(const AtlasEntry* entry, const float* uvs, int count, float* out);
+// 图片像素占全部页面的比例
+float atlasEfficiency(const TextureAtlas* atlas);
+// 按绘制顺序每次换纹理就要绑定一次，返回绑定次数。textures[i]是第i次绘制用的纹理（或者图片）编号
+int countTextureBinds(const int* textures, int draws);
+// 同样的绘制顺序改用图集后的绑定次数，images[i]是第i次绘制用的图片在atlas->entries中的下标
+int countAtlasBinds(const TextureAtlas* atlas, const int* images, int draws);
+// 为每页生成mipmap链（srgb时在线性空间做box过滤）并创建纹理，textures至少pageCount个。srgb时在GLES3上用GL_SRGB8_ALPHA8
+bool uploadAtlasPages(const TextureAtlas* atlas, bool srgb, GLuint* textures);
+
+#endif //LEARNOPENGL_ATLASUTIL_H
@@ -9,6 +9,36 @@ void matrixRotateY(float* matrix, float angle);
 void matrixRotateZ(float* matrix, float angle);
 void matrixScale(float* matrix, float x, float y, float z);
 
+// 以下运算在NEON/SSE/AVX上有SIMD实现，没有SIMD时回退到标量代码（见SimdUtil.h）。
+// matrixMultiply、matrixTranspose、matrixTransformVec4Array与标量版本运算顺序一致，不开FMA时逐位相同，
+// 编译器把乘加合并成FMA时每个元素相对误差不超过1e-6。matrixInverse两种算法不同（SIMD版按2×2分块求逆），差别和矩阵的
+// 条件数κ（1范数）成正比：和标量版本的最大差别除以逆矩阵的最大元素，实测不超过2e-7 × κ。平移、旋转、缩放组成的变换矩阵
+// 条件数小，差别在1e-6以内；接近奇异的矩阵（例如元素随机的矩阵里κ上万的）差别可以到1e-2量级。
+void matrixTranspose(float* destination, const float* source);
+bool matrixInverse(float* destination, const float* source);
+void matrixTransformVec4Array(float* destination, const float* matrix, const float* vectors, int count);
+
+// 用一个公式直接构建模型视图矩阵 M = T * Rz * Ry * Rx * S，代替恒等矩阵加多次旋转平移相乘
+void matrixEulerTransform(float* matrix, float angleX, float angleY, float angleZ,
+                          float x, float y, float z, float scaleX, float scaleY, float scaleZ);
+void matrixQuaternionTransform(float* matrix, float qx, float qy, float qz, float qw,
+                               float x, float y, float z, float scaleX, float scaleY, float scaleZ);
+
+// 批量变换的SoA数据，每个成员是长度为count的数组，scale为NULL时表示不缩放
+struct TransformArrays
+{
+    const float* angleX;
+    const float* angleY;
+    const float* angleZ;
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* scaleX;
+    const float* scaleY;
+    const float* scaleZ;
+};
+void matrixEulerTransformBatch(float* matrices, const TransformArrays* transforms, int count, float* sinCosBuffer);
+
 void matrixPerspective(float* matrix, float fieldOfView, float aspectRatio, float zNear, float zFar);
 
 #endif //LEARNOPENGL_CAMERAUTIL_H
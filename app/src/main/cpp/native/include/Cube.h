@@ -3,5 +3,9 @@
 
 bool setupGraphics(int width, int height);
 void renderFrame();
+// 上下文不变，只是surface大小变了
+void resizeGraphics(int width, int height);
+// 上下文还在时释放setupGraphics创建的GL资源
+void teardownGraphics();
 
 #endif //LEARNOPENGL_CUBE_H
@@ -0,0 +1,62 @@
+#ifndef LEARNOPENGL_CULLUTIL_H
+#define LEARNOPENGL_CULLUTIL_H
+
+#include <vector>
+
+// 视锥的6个平面（左、右、下、上、近、远），每个平面是(a, b, c, d)，已归一化，ax + by + cz + d >= 0表示在内侧
+struct Frustum
+{
+    float planes[6][4];
+};
+
+struct BoundingSphere
+{
+    float x, y, z;
+    float radius;
+};
+
+static const int cullHierarchyWidth = 4; // 每个节点的子节点个数，等于SIMD一次测试的包围盒个数
+static const int maxCullLeafObjects = 8;
+
+// 4叉BVH节点，子节点的包围盒按SoA存放，一次SIMD测试4个
+struct CullNode
+{
+    float minX[cullHierarchyWidth], minY[cullHierarchyWidth], minZ[cullHierarchyWidth];
+    float maxX[cullHierarchyWidth], maxY[cullHierarchyWidth], maxZ[cullHierarchyWidth];
+    int child[cullHierarchyWidth]; // 内部节点时是nodes的下标；叶子时是第一个物体在排序后数组中的位置
+    int count[cullHierarchyWidth]; // 叶子中的物体个数，内部节点为0，空位为-1
+};
+
+// 物体包围球上的包围盒层次，物体的包围球按叶子顺序重新排列成SoA
+struct CullHierarchy
+{
+    std::vector<CullNode> nodes; // nodes[0]是根节点
+    std::vector<int> objects; // 排序后第i个位置对应的原始物体下标
+    std::vector<float> sphereX, sphereY, sphereZ, sphereRadius; // 末尾补齐，SIMD可以多读几个
+    int objectCount;
+};
+
+struct CullStats
+{
+    int objects;
+    int visible;
+    int nodesVisited;
+    int boxesTested;
+    int spheresTested;
+    double milliseconds;
+};
+
+// viewProjection是列主序的投影矩阵×视图矩阵，得到世界坐标（传入投影×模型视图矩阵时是模型坐标）中的视锥平面
+void extractFrustumPlanes(Frustum* frustum, const float* viewProjection);
+bool sphereInFrustum(const Frustum* frustum, const BoundingSphere* sphere);
+
+void buildCullHierarchy(CullHierarchy* hierarchy, const BoundingSphere* spheres, int count);
+// 包围球移动后更新层次中的包围盒，结构不变（物体大范围移动后应该重新build）
+void refitCullHierarchy(CullHierarchy* hierarchy, const BoundingSphere* spheres);
+// 把可见物体的原始下标写入visible（至少objectCount个），返回可见物体个数，stats可以为NULL
+int cullHierarchy(const CullHierarchy* hierarchy, const Frustum* frustum, int* visible, CullStats* stats);
+// 不使用层次，逐个测试全部包围球（SoA），用于物体很少的场景以及和层次比较
+int cullSpheres(const Frustum* frustum, const float* x, const float* y, const float* z, const float* radius,
+                int count, int* visible);
+
+#endif //LEARNOPENGL_CULLUTIL_H
@@ -0,0 +1,41 @@
+#ifndef LEARNOPENGL_FRAMEPROFILER_H
+#define LEARNOPENGL_FRAMEPROFILER_H
+
+// 一帧中分别计时的阶段，同一阶段在一帧中可以计时多次，时间累加
+enum FramePhase
+{
+    FRAME_PHASE_CLEAR, // 清屏
+    FRAME_PHASE_MATRIX, // 计算和上传矩阵
+    FRAME_PHASE_STATE, // 程序、纹理等状态设置
+    FRAME_PHASE_DRAW, // 绘制调用
+    FRAME_PHASE_CPU, // beginFrameProfile到endFrameProfile的CPU时间
+    FRAME_PHASE_GPU, // GPU时间，需要GL_EXT_disjoint_timer_query，结果晚几帧才能拿到
+    FRAME_PHASE_COUNT
+};
+
+static const int frameProfileWindow = 240; // 滚动统计最近多少帧
+
+// 最近frameProfileWindow帧每个阶段耗时的分位数，单位毫秒，没有数据的阶段为0
+struct FrameProfile
+{
+    int frames;
+    bool gpuTimers; // GPU计时是否可用
+    float p50[FRAME_PHASE_COUNT];
+    float p95[FRAME_PHASE_COUNT];
+    float p99[FRAME_PHASE_COUNT];
+};
+
+// 紧凑格式：frames、gpuTimers(0/1)，然后每个阶段依次是p50、p95、p99
+static const int frameProfileFloats = 2 + 3 * FRAME_PHASE_COUNT;
+
+// 每个新的GL上下文在GL线程上调用一次（selectScene会自动调用），清空统计；有GL_EXT_disjoint_timer_query时创建查询对象（主机构建只有CPU计时）
+void initFrameProfiler();
+void beginFrameProfile();
+void endFrameProfile();
+void beginFramePhase(FramePhase phase);
+void endFramePhase(FramePhase phase);
+void getFrameProfile(FrameProfile* profile);
+// 写入frameProfileFloats个float
+void packFrameProfile(const FrameProfile* profile, float* out);
+
+#endif //LEARNOPENGL_FRAMEPROFILER_H
@@ -0,0 +1,63 @@
+#ifndef LEARNOPENGL_GLRECORDER_H
+#define LEARNOPENGL_GLRECORDER_H
+
+/**
+ * 记录型GL桩实现，只在主机构建中使用。
+ * GLRecorder.cpp自己实现了课程用到的GLES2/GLES3接口，链接进可执行文件并导出符号后，
+ * 之后加载的课程动态库里的GL调用都会解析到这里而不是真正的驱动，不需要设备和GPU就能统计每帧的GL工作量。
+ * 每次调用都记录到内存里的命令列表中，同时按帧累计各类调用的数量。
+ */
+
+enum RecordedCall
+{
+    RECORDED_OTHER = 0,
+    RECORDED_CLEAR,
+    RECORDED_USE_PROGRAM,
+    RECORDED_UNIFORM,
+    RECORDED_VERTEX_ATTRIB_POINTER,
+    RECORDED_VERTEX_ATTRIB_TOGGLE,
+    RECORDED_BIND_TEXTURE,
+    RECORDED_BIND_BUFFER,
+    RECORDED_BIND_VERTEX_ARRAY,
+    RECORDED_BUFFER_DATA,
+    RECORDED_TEXTURE_DATA,
+    RECORDED_DRAW_ARRAYS,
+    RECORDED_DRAW_ELEMENTS,
+    RECORDED_STATE, // glEnable、glClearColor、glViewport等状态设置
+};
+
+// 命令列表中的一项，只记录类型和最主要的参数（程序id、绘制的顶点数等），以及这次调用传输的字节数
+struct RecordedCommand
+{
+    unsigned short call; // RecordedCall
+    unsigned short unused;
+    unsigned int argument;
+    unsigned int bytes;
+};
+
+struct RecorderFrameCounts
+{
+    int calls; // 所有GL调用
+    int drawCalls;
+    int programBinds; // glUseProgram
+    int uniformUploads; // glUniform*
+    int attributeRebinds; // glVertexAttribPointer
+    int attributeToggles; // glEnableVertexAttribArray/glDisableVertexAttribArray
+    int textureBinds;
+    int bufferBinds;
+    int vertexArrayBinds;
+    int stateChanges;
+    long long clientVertexBytes; // 绘制时驱动需要从客户端数组复制的顶点数据
+    long long clientIndexBytes; // 绘制时驱动需要从客户端数组复制的索引数据
+    long long uploadBytes; // glBufferData、glTexImage2D等显式上传的数据
+};
+
+// 清空命令列表和所有GL对象状态，重新开始记录
+void recorderReset();
+// 开始新的一帧，清零本帧计数并清空命令列表
+void recorderBeginFrame();
+// 取得从上次recorderBeginFrame到现在的计数
+void recorderFrameCounts(RecorderFrameCounts* counts);
+const RecordedCommand* recorderCommands(int* count);
+
+#endif //LEARNOPENGL_GLRECORDER_H
@@ -0,0 +1,9 @@
+#ifndef LEARNOPENGL_HOSTCONTEXT_H
+#define LEARNOPENGL_HOSTCONTEXT_H
+
+// 主机（Linux）构建使用的离屏EGL上下文，在没有显示器的机器上用Mesa的llvmpipe软件渲染运行GLES代码。
+// 优先创建GLES3上下文，失败时退回GLES2。
+bool createHostContext(int width, int height);
+void destroyHostContext();
+
+#endif //LEARNOPENGL_HOSTCONTEXT_H
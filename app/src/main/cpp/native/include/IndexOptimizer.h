@@ -0,0 +1,67 @@
+#ifndef LEARNOPENGL_INDEXOPTIMIZER_H
+#define LEARNOPENGL_INDEXOPTIMIZER_H
+
+#include <cstddef>
+
+#include "MeshImport.h"
+
+static const int vertexCacheSize = 16; // 分析时模拟的变换后顶点缓存（FIFO）大小，和多数移动GPU相近
+static const float defaultOverdrawThreshold = 1.05f; // 为了减少过度绘制，允许ACMR变差的比例
+
+struct VertexCacheStats
+{
+    int triangles;
+    int vertices; // 被索引引用到的顶点个数
+    int transforms; // 顶点着色器执行次数（缓存未命中次数）
+    float acmr; // 每个三角形平均变换的顶点数，0.5~3，越小越好
+    float atvr; // 每个顶点平均变换的次数，最好是1
+};
+
+struct OverdrawStats
+{
+    int covered; // 6个方向上被覆盖的像素数
+    int shaded; // 通过深度测试的片元数
+    float overdraw; // shaded / covered，最好是1
+};
+
+struct VertexFetchStats
+{
+    size_t bytesFetched; // 按64字节缓存行计算的顶点数据读取量
+    float overfetch; // bytesFetched / 顶点数据总大小，最好是1
+};
+
+// 模拟FIFO顶点缓存
+void analyzeVertexCache(const unsigned int* indices, int indexCount, int vertexCount, VertexCacheStats* stats);
+/**
+ * 从包围盒的6个轴向，把网格光栅化到256×256的深度缓冲（剔除背面），统计每个像素被着色几次。
+ * positions每个顶点3个float。
+ */
+void analyzeOverdraw(const unsigned int* indices, int indexCount, const float* positions, int vertexCount,
+                     OverdrawStats* stats);
+// 变换后缓存未命中时按vertexBytes读取顶点，模拟128KB直接映射的顶点读取缓存
+void analyzeVertexFetch(const unsigned int* indices, int indexCount, int vertexCount, size_t vertexBytes,
+                        VertexFetchStats* stats);
+
+/**
+ * 按Forsyth的线性时间算法重排三角形，提高变换后顶点缓存的命中率。destination可以和indices相同。
+ */
+void optimizeVertexCache(unsigned int* destination, const unsigned int* indices, int indexCount, int vertexCount);
+/**
+ * 在optimizeVertexCache的结果上减少过度绘制：按缓存重新开始的位置把三角形分成簇，ACMR不超过threshold倍时再细分，
+ * 然后按簇的朝向把朝外的簇排在前面，先画的遮住后画的。destination不能和indices相同。
+ */
+void optimizeOverdraw(unsigned int* destination, const unsigned int* indices, int indexCount, const float* positions,
+                      int vertexCount, float threshold);
+/**
+ * 按顶点第一次被引用的顺序重新编号，remap[旧下标]是新下标，没被引用的顶点为~0u；返回用到的顶点数。
+ */
+int optimizeVertexFetchRemap(unsigned int* remap, const unsigned int* indices, int indexCount, int vertexCount);
+void remapIndices(unsigned int* indices, int indexCount, const unsigned int* remap);
+// destination至少有optimizeVertexFetchRemap返回的个数，每个顶点vertexBytes字节，不能和vertices相同
+void remapVertices(void* destination, const void* vertices, int vertexCount, size_t vertexBytes,
+                   const unsigned int* remap);
+
+// 依次做上面三步，导入的网格直接替换成优化后的结果，顶点数变少时可能改用16位索引
+void optimizeImportedMesh(ImportedMesh* mesh, float overdrawThreshold);
+
+#endif //LEARNOPENGL_INDEXOPTIMIZER_H
@@ -0,0 +1,24 @@
+#ifndef LEARNOPENGL_INSTANCEDCUBE_H
+#define LEARNOPENGL_INSTANCEDCUBE_H
+
+#include "CullUtil.h"
+#include "StreamBuffer.h"
+
+bool setupGraphics(int width, int height);
+void renderFrame();
+// 上下文不变，只是surface大小变了
+void resizeGraphics(int width, int height);
+// 上下文还在时释放setupGraphics创建的GL资源
+void teardownGraphics();
+// 立方体个数，默认1000
+void setInstanceCount(int count);
+// false时每个立方体一次glDrawElements，用来和实例化绘制比较
+void setInstancingEnabled(bool enabled);
+// 实例化绘制时矩阵直接写进环形流式缓冲区（默认），false时退回orphan加glBufferSubData，用来比较两种上传方式
+void setInstanceStreamingEnabled(bool enabled);
+void getInstanceStreamStats(StreamBufferStats* stats);
+void resetInstanceStreamStats();
+// 上一帧视锥剔除的统计
+void getInstanceCullStats(CullStats* stats);
+
+#endif //LEARNOPENGL_INSTANCEDCUBE_H
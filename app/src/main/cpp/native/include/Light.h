@@ -1,7 +1,20 @@
 #ifndef LEARNOPENGL_LIGHT_H
 #define LEARNOPENGL_LIGHT_H
 
+// 渲染一帧需要的全部数据，由模拟线程写入，发布后不再修改
+struct LightSnapshot
+{
+    float modelViewMatrix[16];
+};
+
 bool setupGraphics(int width, int height);
 void renderFrame();
+// 上下文不变，只是surface大小变了
+void resizeGraphics(int width, int height);
+// 上下文还在时释放setupGraphics创建的GL资源
+void teardownGraphics();
+void updateScene(double stepSeconds);
+void writeSnapshot(LightSnapshot* snapshot);
+void renderSnapshot(const LightSnapshot* snapshot);
 
 #endif //LEARNOPENGL_LIGHT_H
@@ -3,4 +3,20 @@
 
 GLuint createProgram(const char* vertexSource, const char * fragmentSource);
 
+// 着色器程序二进制缓存的统计数据，见LoadUtil.cpp
+struct ProgramCacheStats
+{
+    int hits; // 从缓存加载成功的次数
+    int misses; // 从源码编译的次数
+    int rejected; // 缓存文件存在但被驱动拒绝的次数（同时也计入misses）
+    int stores; // 写入缓存的次数
+    double hitMilliseconds; // 命中时加载花费的总时间
+    double missMilliseconds; // 未命中时编译链接并写入缓存花费的总时间
+};
+
+// 设置缓存目录（目录需要已存在），传NULL关闭缓存。默认不使用缓存。
+void setProgramCacheDirectory(const char* directory);
+void getProgramCacheStats(ProgramCacheStats* stats);
+void resetProgramCacheStats();
+
 #endif //LEARNOPENGL_LOADUTIL_H
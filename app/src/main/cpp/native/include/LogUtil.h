@@ -1,9 +1,16 @@
 #ifndef LEARNOPENGL_LOGUTIL_H
 #define LEARNOPENGL_LOGUTIL_H
 
-#include <android/log.h>
 #define LOG_TAG "libNative"
+#if defined(__ANDROID__)
+#include <android/log.h>
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+// 主机（Linux）构建没有logcat，日志输出到stderr，格式与logcat的brief格式相同
+#include <cstdio>
+#define LOGI(...) (fprintf(stderr, "I/" LOG_TAG ": "), fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define LOGE(...) (fprintf(stderr, "E/" LOG_TAG ": "), fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#endif
 
 #endif //LEARNOPENGL_LOGUTIL_H
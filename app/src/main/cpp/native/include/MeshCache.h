@@ -0,0 +1,122 @@
+#ifndef LEARNOPENGL_MESHCACHE_H
+#define LEARNOPENGL_MESHCACHE_H
+
+#include <GLES3/gl3.h>
+#include <cstddef>
+
+#include "MeshUtil.h"
+#include "VertexFormat.h"
+
+static const unsigned int meshCacheVersion = 1; // 格式变化时加1，旧文件会被拒绝，需要重新转换
+static const int maxMeshLods = 8;
+static const size_t meshCacheAlignment = 64; // 各块数据在文件中的对齐，映射后的指针也是这样对齐的
+
+// 顶点属性的含义，加载时由调用者换成着色器里的location
+enum MeshSemantic
+{
+    MESH_POSITION,
+    MESH_NORMAL,
+    MESH_TEXTURE_CORD,
+    MESH_COLOUR,
+    MESH_SEMANTIC_COUNT
+};
+
+/**
+ * 文件头，所有字段都是小端的4或8字节，偏移都相对于文件开头。checksum覆盖它后面的全部内容（包括文件头的其余部分）。
+ * 文件头后面依次是elementCount个MeshCacheElement、lodCount个MeshCacheLod、顶点数据、索引数据，每块按meshCacheAlignment对齐。
+ */
+struct MeshCacheHeader
+{
+    char magic[8]; // "LOGLMESH"
+    unsigned int version;
+    unsigned int headerBytes;
+    unsigned long long checksum;
+    unsigned long long fileBytes;
+    unsigned int mode; // GL_TRIANGLES等
+    unsigned int indexType; // GL_UNSIGNED_SHORT或GL_UNSIGNED_INT，没有索引时为0
+    unsigned int vertexCount;
+    unsigned int indexCount; // 所有LOD的索引总数
+    unsigned int stride; // 交错顶点的步长
+    unsigned int elementCount;
+    unsigned int lodCount;
+    unsigned int reserved;
+    unsigned long long elementsOffset;
+    unsigned long long lodsOffset;
+    unsigned long long vertexOffset;
+    unsigned long long vertexBytes;
+    unsigned long long indexOffset;
+    unsigned long long indexBytes;
+    float boundsMin[3]; // 位置的包围盒
+    float boundsMax[3];
+    float boundingSphere[4]; // 包围盒中心和包围所有顶点的半径，可以直接用于CullUtil
+};
+
+// 交错顶点中的一个属性，和VertexElement相同，只是location换成了semantic
+struct MeshCacheElement
+{
+    unsigned int semantic;
+    unsigned int components;
+    unsigned int format; // VertexElementFormat
+    unsigned int offset;
+    unsigned int bytes;
+    unsigned int reserved;
+};
+
+// 一级细节的索引范围，第0级最精细
+struct MeshCacheLod
+{
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    float error; // 简化带来的误差（模型空间的距离），第0级为0
+    unsigned int reserved;
+};
+
+// 写入时的一个属性：浮点源数据按format打包
+struct MeshCacheAttribute
+{
+    MeshSemantic semantic;
+    int components;
+    VertexElementFormat format;
+    const float* data; // 每个顶点components个
+};
+
+struct MeshCacheSource
+{
+    GLenum mode;
+    int vertexCount;
+    int attributeCount;
+    MeshCacheAttribute attributes[maxVertexElements]; // 必须有MESH_POSITION（3个float分量）用来计算包围盒
+    const void* indices; // 可以为NULL
+    int indexCount;
+    GLenum indexType;
+    int lodCount; // 0表示只有一级，包含全部索引
+    MeshCacheLod lods[maxMeshLods];
+};
+
+// 映射到内存的缓存文件，各指针直接指向映射的内容
+struct MeshCacheFile
+{
+    void* mapping;
+    size_t bytes;
+    const MeshCacheHeader* header;
+    const MeshCacheElement* elements;
+    const MeshCacheLod* lods;
+    const void* vertices;
+    const void* indices;
+};
+
+bool writeMeshCache(const char* path, const MeshCacheSource* source);
+/**
+ * 映射缓存文件并检查文件头和各块的范围，不复制也不解析数据。verifyChecksum为true时还会读一遍全部内容计算校验和
+ * （顺便把页面读进内存），文件损坏或版本不对时返回false。
+ */
+bool openMeshCache(const char* path, bool verifyChecksum, MeshCacheFile* file);
+void closeMeshCache(MeshCacheFile* file);
+/**
+ * 把映射的顶点和第lod级的索引直接交给glBufferData，locations按MeshSemantic给出属性位置（小于0的不使用）。
+ * lod小于0时上传所有级的索引，drawMesh画第0级，其他级用drawMeshRange按file->lods画。
+ */
+bool createCachedMesh(Mesh* mesh, const MeshCacheFile* file, const GLint* locations, int lod);
+unsigned long long meshCacheChecksum(const void* data, size_t bytes);
+
+#endif //LEARNOPENGL_MESHCACHE_H
@@ -0,0 +1,53 @@
+#ifndef LEARNOPENGL_MESHIMPORT_H
+#define LEARNOPENGL_MESHIMPORT_H
+
+#include <GLES3/gl3.h>
+#include <cstddef>
+#include <vector>
+
+#include "MeshUtil.h"
+
+/**
+ * 导入后的带索引网格，和课程里的cubeVertices、textureCords、indices一样是分开的数组，直接交给createMesh。
+ * 位置、法线、纹理坐标完全相同的顶点只保留一个。
+ */
+struct ImportedMesh
+{
+    int vertexCount;
+    bool hasNormals; // 文件里没有法线或纹理坐标时对应的数组为空
+    bool hasTextureCords;
+    std::vector<float> positions; // 每个顶点3个
+    std::vector<float> normals; // 每个顶点3个
+    std::vector<float> textureCords; // 每个顶点2个
+    GLenum indexType; // 顶点不超过65536个时是GL_UNSIGNED_SHORT，否则是GL_UNSIGNED_INT
+    std::vector<unsigned short> shortIndices; // indexType为GL_UNSIGNED_SHORT时使用
+    std::vector<unsigned int> indices; // indexType为GL_UNSIGNED_INT时使用
+    int indexCount;
+};
+
+struct MeshImportStats
+{
+    size_t fileBytes;
+    int threads;
+    int triangles;
+    int corners; // 去重前的顶点个数（每个三角形3个）
+    double parseMilliseconds; // 映射、解析并展开成逐角顶点的时间
+    double dedupMilliseconds;
+};
+
+/**
+ * 导入Wavefront OBJ（多边形按扇形切成三角形）或glTF 2.0二进制（.glb，所有网格的三角形图元合并在一起，不应用节点变换）。
+ * 文件用mmap映射，按块分给threads个线程解析（0表示按CPU核数），然后用开放寻址哈希表去掉重复的顶点。
+ * 按文件开头判断格式，失败时返回false并打印原因，stats可以为NULL。
+ */
+bool importMesh(const char* path, int threads, ImportedMesh* mesh, MeshImportStats* stats);
+// 解析内存中的文件内容，importMesh映射文件后调用这两个函数
+bool importObj(const char* data, size_t size, int threads, ImportedMesh* mesh, MeshImportStats* stats);
+bool importGlb(const unsigned char* data, size_t size, int threads, ImportedMesh* mesh, MeshImportStats* stats);
+/**
+ * 上传导入的网格，location小于0的属性不使用。32位索引在GLES2上需要GL_OES_element_index_uint，不支持时返回false。
+ */
+bool createImportedMesh(Mesh* mesh, const ImportedMesh* imported, GLint positionLocation, GLint normalLocation,
+                        GLint textureCordLocation);
+
+#endif //LEARNOPENGL_MESHIMPORT_H
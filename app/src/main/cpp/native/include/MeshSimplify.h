@@ -0,0 +1,69 @@
+#ifndef LEARNOPENGL_MESHSIMPLIFY_H
+#define LEARNOPENGL_MESHSIMPLIFY_H
+
+#include <vector>
+
+#include "MeshCache.h"
+
+static const float defaultLodReduction = 0.5f; // 每级三角形数是上一级的一半
+static const float defaultLodPixelError = 1.0f; // 简化误差投影到屏幕上不超过1像素
+
+/**
+ * 简化时额外考虑的顶点属性（法线、纹理坐标、颜色等拼在一起），每个顶点components个float，weights给出每个分量的权重：
+ * 属性相差1相当于位置相差weight。
+ */
+struct SimplifyAttributes
+{
+    const float* data;
+    int components;
+    const float* weights;
+};
+
+/**
+ * 用二次误差度量（QEM）做边折叠，把三角形数减到targetIndexCount / 3左右，或者误差超过targetError（模型空间的距离）时停止。
+ * 只删除三角形、不产生新顶点，结果仍然引用原来的顶点数组。位置相同但属性不同的顶点（接缝，例如lesson4里每个面单独的顶点）
+ * 只能沿接缝一起折叠，网格边界只能沿边界折叠，更复杂的位置不动。
+ * attributes可以为NULL。返回新的索引个数，resultError是实际的最大误差，可以为NULL。destination可以和indices相同。
+ */
+int simplifyMesh(unsigned int* destination, const unsigned int* indices, int indexCount, const float* positions,
+                 int vertexCount, const SimplifyAttributes* attributes, int targetIndexCount, float targetError,
+                 float* resultError);
+
+// 连续存放的各级索引，lods[0]是原网格；每级都做过顶点缓存优化
+struct MeshLodChain
+{
+    std::vector<unsigned int> indices;
+    int lodCount;
+    MeshCacheLod lods[maxMeshLods];
+};
+
+/**
+ * 逐级简化生成LOD链，每级三角形数是上一级的reduction倍，误差超过maxError、三角形数基本不再减少或达到maxLods时停止。
+ * lods[i].error是第i级相对原网格的误差上限（各级误差累加）。
+ */
+void buildLodChain(MeshLodChain* chain, const unsigned int* indices, int indexCount, const float* positions,
+                   int vertexCount, const SimplifyAttributes* attributes, int maxLods, float reduction, float maxError);
+
+/**
+ * 透视投影下距离为1处，模型空间的单位长度在屏幕上占多少像素。fieldOfView和matrixPerspective一样是垂直视角（度）。
+ */
+float lodErrorScale(float fieldOfView, int viewportHeight);
+/**
+ * 选择误差投影到屏幕上不超过maxPixelError的最粗的一级。distance是物体到相机的距离，scale是模型的缩放。
+ */
+int selectLod(const MeshCacheLod* lods, int lodCount, float distance, float scale, float errorScale,
+              float maxPixelError);
+
+// 一帧的LOD统计
+struct LodStats
+{
+    int objects;
+    long long trianglesFull; // 全部用第0级时的三角形数
+    long long trianglesDrawn;
+    int objectsPerLod[maxMeshLods];
+};
+
+void resetLodStats(LodStats* stats);
+void countLod(LodStats* stats, const MeshCacheLod* lods, int lod);
+
+#endif //LEARNOPENGL_MESHSIMPLIFY_H
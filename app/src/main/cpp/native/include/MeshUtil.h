@@ -0,0 +1,63 @@
+#ifndef LEARNOPENGL_MESHUTIL_H
+#define LEARNOPENGL_MESHUTIL_H
+
+#include <GLES3/gl3.h>
+
+struct VertexLayout;
+
+static const int maxMeshAttributes = 8;
+
+// 一个顶点属性的数据，data是客户端数组（例如课程里的cubeVertices），只在createMesh时读取一次
+struct MeshAttribute
+{
+    GLint location; // glGetAttribLocation得到的位置，小于0时忽略这个属性
+    GLint size; // 每个顶点的分量个数
+    GLenum type;
+    GLboolean normalized;
+    const void* data;
+    GLsizeiptr bytes; // data的总字节数
+    GLsizei stride; // 交错顶点的步长，各属性分开存放时为0
+};
+
+// 上传到GPU的静态网格，顶点数据和索引数据各放在一个缓冲区对象中，属性设置记录在顶点数组对象（VAO）里
+struct Mesh
+{
+    GLuint vertexArray; // GLES2上下文没有VAO，此时为0，绘制时按attributes重新设置属性
+    GLuint vertexBuffer;
+    GLuint indexBuffer; // 没有索引时为0，用glDrawArrays绘制
+    GLenum mode; // 图元类型，如GL_TRIANGLES
+    GLsizei count; // 有索引时是索引个数，否则是顶点个数
+    GLenum indexType;
+    int attributeCount;
+    MeshAttribute attributes[maxMeshAttributes]; // data保存的是属性在vertexBuffer中的偏移
+};
+
+bool createMesh(Mesh* mesh, GLenum mode, const MeshAttribute* attributes, int attributeCount,
+                GLsizei vertexCount, const void* indices, GLsizei indexCount, GLenum indexType);
+// 顶点数据已经按layout交错打包好（见VertexFormat.h的packVertices），整块上传到一个缓冲区
+bool createInterleavedMesh(Mesh* mesh, GLenum mode, const VertexLayout* layout, const void* vertices,
+                           GLsizei vertexCount, const void* indices, GLsizei indexCount, GLenum indexType);
+void bindMesh(const Mesh* mesh);
+void drawMesh(const Mesh* mesh);
+// 只画索引缓冲区中从firstIndex开始的count个索引，例如MeshSimplify.h生成的某一级LOD
+void drawMeshRange(const Mesh* mesh, GLsizei firstIndex, GLsizei count);
+void deleteMesh(Mesh* mesh);
+
+// 每个实例一个mat4的属性缓冲区，用于glDrawElementsInstanced，见MeshUtil.cpp
+struct InstanceBuffer
+{
+    GLuint buffer;
+    GLint location; // mat4属性占用location到location + 3四个位置
+    GLsizei capacity; // 缓冲区能容纳的实例个数
+};
+
+// 创建实例缓冲区并记录到网格的VAO里，需要GLES3
+bool attachInstanceMatrices(Mesh* mesh, InstanceBuffer* instances, GLint location, GLsizei capacity);
+// 上传count个列主序矩阵（每个16个float），超出容量时缓冲区会自动扩大
+void updateInstanceMatrices(InstanceBuffer* instances, const float* matrices, GLsizei count);
+// 让实例矩阵属性改从buffer的offset处读取（例如StreamBuffer.h里这一帧分配的位置），而不是instances自己的缓冲区
+void pointInstanceMatrices(const Mesh* mesh, const InstanceBuffer* instances, GLuint buffer, GLintptr offset);
+void drawMeshInstanced(const Mesh* mesh, GLsizei instanceCount);
+void deleteInstanceBuffer(InstanceBuffer* instances);
+
+#endif //LEARNOPENGL_MESHUTIL_H
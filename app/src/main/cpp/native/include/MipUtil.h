@@ -0,0 +1,33 @@
+#ifndef LEARNOPENGL_MIPUTIL_H
+#define LEARNOPENGL_MIPUTIL_H
+
+#include <cstddef>
+#include <vector>
+
+enum MipFilter
+{
+    MIP_FILTER_BOX, // 2x2平均，最快
+    MIP_FILTER_KAISER // 8抽头Kaiser窗sinc，更锐利，混叠更少
+};
+
+static const int maxMipLevels = 16;
+
+// RGBA8的完整mipmap链，各级依次紧挨着放在pixels里
+struct MipChain
+{
+    int levelCount;
+    int width[maxMipLevels];
+    int height[maxMipLevels];
+    size_t offset[maxMipLevels]; // 每一级在pixels中的起始位置
+    std::vector<unsigned char> pixels;
+};
+
+/**
+ * 从RGBA8图像生成到1x1为止的mipmap链（第0级是原图的副本）。
+ * srgb为true时RGB按sRGB编码处理：先转换到线性空间再过滤，结果再编码回sRGB，避免暗部变亮、亮部变暗；alpha始终是线性的。
+ * 每一级从上一级（线性浮点）生成，同一级按行分给threads个线程（0表示按CPU核数），返回false表示尺寸不合法。
+ */
+bool generateMipChain(const unsigned char* rgba, int width, int height, bool srgb, MipFilter filter, int threads,
+                      MipChain* chain);
+
+#endif //LEARNOPENGL_MIPUTIL_H
@@ -0,0 +1,112 @@
+#ifndef LEARNOPENGL_RENDERQUEUE_H
+#define LEARNOPENGL_RENDERQUEUE_H
+
+#include <GLES3/gl3.h>
+#include <vector>
+
+#include "MeshUtil.h"
+#include "StreamBuffer.h"
+
+/**
+ * 按排序键提交绘制的渲染队列，见RenderQueue.cpp。场景代码每帧把要画的物体（材质、网格、模型视图矩阵）提交进来，
+ * 队列按64位排序键基数排序，把状态相同的相邻物体合并成一次实例化绘制，再统一提交给GL。
+ */
+
+// 排序键从高到低：层（4位）、半透明（1位），不透明物体接着是程序、纹理、网格、深度（从近到远），
+// 半透明物体接着是反转的深度（从远到近）、程序、纹理、网格
+static const int renderLayerCount = 16;
+static const int renderDepthBits = 24;
+
+struct RenderMaterial
+{
+    GLuint program;
+    GLuint texture; // 绑定到纹理单元0，为0时不绑定
+    bool translucent; // 开启混合（SRC_ALPHA, ONE_MINUS_SRC_ALPHA）、不写深度，从远到近绘制
+    GLint projectionLocation; // 切换到这个程序后设置投影矩阵，为-1时不设置（例如从Camera uniform块读取）
+    GLint modelViewLocation; // 不能实例化的程序逐个物体设置的uniform mat4
+    /**
+     * 程序里每实例的attribute mat4的位置，不为-1时按实例化绘制，网格必须已经用attachInstanceMatrices在这个位置
+     * 加好了实例属性（所有物体都画成实例，只有一个物体时实例数为1）
+     */
+    GLint instanceLocation;
+};
+
+// 一个绘制包，matrix是modelView在本帧矩阵区里的下标（乘16）
+struct DrawPacket
+{
+    unsigned long long key;
+    const RenderMaterial* material;
+    const Mesh* mesh;
+    int matrix;
+};
+
+// 状态切换次数，按提交顺序和排序后的顺序各统计一次
+struct RenderStateChanges
+{
+    int programs;
+    int textures;
+    int meshes;
+    int blendToggles; // 不透明和半透明之间的切换
+    int drawCalls;
+};
+
+// 合并后的一次绘制：排序后从first开始的count个物体，实例化时offset是实例矩阵在流式缓冲区里的位置
+struct RenderBatch
+{
+    int first;
+    int count;
+    GLintptr offset;
+};
+
+struct RenderQueueStats
+{
+    int frames;
+    int packets;
+    int batches; // 合并后的绘制次数
+    int instancedPackets; // 通过实例化绘制的物体
+    RenderStateChanges unsorted; // 如果按提交顺序逐个绘制
+    RenderStateChanges sorted; // 实际提交的
+    int overflows; // 实例矩阵放不进流式缓冲区而没有画的批次
+    double sortMilliseconds;
+    double submitMilliseconds; // 写实例矩阵和提交GL调用的CPU时间
+};
+
+struct RenderQueue
+{
+    // 每帧的数据区，flush后清空，容量保留，稳定之后每帧不再分配内存
+    std::vector<DrawPacket> packets;
+    std::vector<float> matrices;
+    std::vector<unsigned long long> sortKeys; // 排序用的键和下标，以及基数排序的临时空间
+    std::vector<unsigned int> order;
+    std::vector<unsigned long long> scratchKeys;
+    std::vector<unsigned int> scratchOrder;
+    std::vector<RenderBatch> batches;
+    float nearDistance;
+    float farDistance;
+    bool sort; // false时按提交顺序绘制，用来比较
+    bool batch; // false时每个物体一次绘制
+    StreamBuffer instances; // 实例矩阵
+    RenderQueueStats stats;
+};
+
+// sort和batch默认打开。实例矩阵用的流式缓冲区需要GLES3，失败时只能画不实例化的材质
+bool createRenderQueue(RenderQueue* queue);
+void deleteRenderQueue(RenderQueue* queue);
+// 开始新的一帧，深度按视图空间里到相机的距离在[nearDistance, farDistance]之间量化
+void beginRenderQueue(RenderQueue* queue, float nearDistance, float farDistance);
+// 组合排序键，depth是到相机的距离
+unsigned long long renderSortKey(const RenderQueue* queue, int layer, const RenderMaterial* material, const Mesh* mesh,
+                                 float depth);
+// 提交一个物体，modelView复制到本帧的矩阵区里，深度取自modelView的平移部分（视图空间z）
+void submitDraw(RenderQueue* queue, int layer, const RenderMaterial* material, const Mesh* mesh, const float* modelView);
+// 排序（基数排序，稳定）、合并并绘制本帧提交的所有物体，projection给设置了projectionLocation的材质
+void flushRenderQueue(RenderQueue* queue, const float* projection);
+/**
+ * 稳定的LSD基数排序，每次8位，keys原地排好，order返回每个位置原来的下标；所有键在某个字节上都相同时跳过这一趟。
+ * scratchKeys和scratchOrder是长度至少为count的临时空间
+ */
+void radixSortKeys(unsigned long long* keys, unsigned int* order, int count,
+                   unsigned long long* scratchKeys, unsigned int* scratchOrder);
+void resetRenderQueueStats(RenderQueue* queue);
+
+#endif //LEARNOPENGL_RENDERQUEUE_H
@@ -0,0 +1,50 @@
+#ifndef LEARNOPENGL_SCENE_H
+#define LEARNOPENGL_SCENE_H
+
+#include <cstddef>
+
+/**
+ * 每课的场景接口，见SceneRegistry.cpp。课程的动态库里定义一个Scene并用SceneRegistration注册自己，
+ * 选中时才用dlopen加载，切换到别的场景时释放GL资源并卸载。
+ */
+struct Scene
+{
+    const char* name; // 和动态库同名，例如"Light"对应libLight.so
+    bool (*setup)(int width, int height); // 新的GL上下文上创建资源
+    void (*resize)(int width, int height); // 上下文不变，只是surface大小变了
+    void (*render)(); // 单线程渲染一帧（并推进场景）
+    void (*teardown)(); // 上下文还在时释放setup创建的GL资源
+    // 可选：支持模拟线程的场景（见SimulationUtil.h），update为NULL时每帧直接调用render
+    void (*update)(double stepSeconds);
+    size_t snapshotBytes;
+    void (*writeSnapshot)(void* snapshot);
+    void (*renderSnapshot)(const void* snapshot);
+};
+
+// 定义成课程动态库里的静态对象：加载时注册，卸载时注销
+struct SceneRegistration
+{
+    const Scene* scene;
+    explicit SceneRegistration(const Scene* registered);
+    ~SceneRegistration();
+};
+
+void registerScene(const Scene* scene);
+void unregisterScene(const Scene* scene);
+
+// 可以选择的场景个数和名字（所有课程，不需要已经加载）
+int sceneCount();
+const char* sceneName(int index);
+// 动态库所在的目录，为NULL（默认）时按库名交给dlopen搜索，Android上就是APK的库目录
+void setSceneLibraryDirectory(const char* directory);
+/**
+ * 切换到name对应的场景：释放并卸载当前场景，需要时dlopen它的动态库，然后在当前GL上下文上setup。
+ * 已经是当前场景时，同一个上下文只调用resize，上下文重建后重新setup。失败时没有当前场景，返回false。
+ */
+bool selectScene(const char* name, int width, int height);
+// 释放并卸载当前场景（需要GL上下文还在）
+void closeScene();
+// 当前场景，没有时返回NULL
+const Scene* currentScene();
+
+#endif //LEARNOPENGL_SCENE_H
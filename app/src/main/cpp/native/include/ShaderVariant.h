@@ -0,0 +1,114 @@
+#ifndef LEARNOPENGL_SHADERVARIANT_H
+#define LEARNOPENGL_SHADERVARIANT_H
+
+#include <GLES3/gl3.h>
+#include <string>
+
+/**
+ * 着色器变体，见ShaderVariant.cpp。同一份GLSL模板用#ifdef区分功能，按需要的功能组合在源码前加#define，
+ * 只编译实际用到的组合。
+ */
+enum ShaderFeature
+{
+    SHADER_PER_PIXEL_LIGHTING = 1 << 0, // 光照在块着色器里逐像素计算，否则逐顶点计算后插值
+    SHADER_SPECULAR = 1 << 1, // 镜面反射
+    SHADER_TEXTURE = 1 << 2, // 颜色乘以纹理
+    SHADER_UNIFORM_BLOCKS = 1 << 3, // 相机、光照和物体数据从共享的uniform块读取（UniformBlocks.h），源码改写成GLSL ES 3.00，需要GLES3
+    SHADER_FEATURE_COUNT = 4
+};
+
+static const int maxShaderVariants = 32; // 所有模板加起来最多缓存的变体个数
+
+// 模板的源码，和createProgram的参数一样，可以在开头写#version
+struct ShaderTemplate
+{
+    const char* vertexSource;
+    const char* fragmentSource;
+};
+
+struct ShaderVariantStats
+{
+    int built; // 编译的变体个数
+    int hits; // 直接返回已编译变体的次数
+    double buildMilliseconds; // 编译花费的总时间（开启程序缓存时包括从缓存加载）
+};
+
+/**
+ * lesson4的Phong光照模板（逐顶点/逐像素、镜面反射、纹理），属性为vertexPosition、vertexNormal、vertexColour，
+ * 有纹理时还有vertexTextureCord；uniform为projection、modelView和LightingLocations里的光照参数，
+ * SHADER_UNIFORM_BLOCKS时它们改为Camera、Object和Lighting块的成员。
+ */
+extern const ShaderTemplate phongTemplate;
+
+// 在源码前（有#version时在它后面）加上features对应的#define，例如SHADER_SPECULAR对应#define SPECULAR 1
+std::string shaderVariantSource(const char* source, unsigned int features);
+/**
+ * 把GLSL ES 1.00的源码改写成3.00：开头加#version 300 es（原来的#version行去掉），attribute、varying换成in、out，
+ * texture2D换成texture，gl_FragColor换成声明的输出变量。已经是3.00及以上的源码原样返回。
+ * stage为GL_VERTEX_SHADER或GL_FRAGMENT_SHADER
+ */
+std::string upgradeShaderSource(const std::string& source, GLenum stage);
+/**
+ * 返回模板的一个变体，第一次请求时才编译，之后直接返回同一个程序。编译用createProgram，开启了程序缓存（LoadUtil.h）时
+ * 每个变体的二进制也会分别缓存到磁盘。编译失败时返回0，下次请求会重新尝试。
+ * SHADER_UNIFORM_BLOCKS的变体用upgradeShaderSource改写，编译后块已经连到固定的绑定点（bindProgramUniformBlocks）。
+ */
+GLuint getShaderVariant(const ShaderTemplate* shaderTemplate, unsigned int features);
+// 新的GL上下文，之前的程序已经不存在，只清空记录
+void resetShaderVariants();
+// 删除所有编译过的变体
+void deleteShaderVariants();
+void getShaderVariantStats(ShaderVariantStats* stats);
+void resetShaderVariantStats();
+
+// 材质的光照参数，用来选择变体和计算uniform
+struct LightingMaterial
+{
+    float specularColour[3]; // 镜面反射的颜色常量，全为0时不需要镜面反射
+    float shininess;
+    GLuint texture; // 为0时没有纹理
+    bool perPixel; // 需要逐像素光照（高光更准确，但块着色器更贵）
+};
+
+// 满足材质需要的最便宜的变体
+unsigned int materialShaderFeatures(const LightingMaterial* material);
+
+/**
+ * 光照中每帧不变的量，在CPU上每帧算一次，而不是每个顶点（或像素）重复计算。方向都已经归一化，
+ * specular是镜面反射颜色常量乘以光强。
+ */
+struct LightingUniforms
+{
+    float inverseLightDirection[3];
+    float inverseEyeDirection[3];
+    float ambientLightIntensity[3];
+    float diffuseLightIntensity[3];
+    float specularColour[3];
+    float shininess;
+};
+
+// 光照模板里uniform的位置，模板中没有（或被编译器去掉）的为-1
+struct LightingLocations
+{
+    GLint inverseLightDirection;
+    GLint inverseEyeDirection;
+    GLint ambientLightIntensity;
+    GLint diffuseLightIntensity;
+    GLint specularColour;
+    GLint shininess;
+    GLint materialTexture;
+};
+
+/**
+ * lightDirection和eyeDirection是从表面指向光源、相机的方向（视图空间），不需要归一化；
+ * ambient、diffuse、specular是三种光的强度。
+ */
+void computeLightingUniforms(LightingUniforms* uniforms, const float* lightDirection, const float* eyeDirection,
+                             const float* ambient, const float* diffuse, const float* specular,
+                             const LightingMaterial* material);
+// uniform名和LightingUniforms的成员名相同，纹理采样器名为materialTexture（使用纹理单元0）
+void getLightingLocations(GLuint program, LightingLocations* locations);
+// 通过StateCache设置，值没有变化时不调用驱动，需要先cachedUseProgram
+void applyLightingUniforms(const LightingLocations* locations, const LightingUniforms* uniforms);
+
+#endif //LEARNOPENGL_SHADERVARIANT_H
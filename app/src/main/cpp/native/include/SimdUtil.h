@@ -0,0 +1,97 @@
+#ifndef LEARNOPENGL_SIMDUTIL_H
+#define LEARNOPENGL_SIMDUTIL_H
+
+/**
+ * 四元素浮点向量的SIMD封装，编译期根据目标平台选择实现：
+ *    - arm64/armv7（__ARM_NEON）使用NEON
+ *    - x86-64（__SSE2__）使用SSE，开启-mavx时额外提供AVX的8元素接口
+ *    - 其余平台或定义了LEARNOPENGL_NO_SIMD时只定义SIMD_SCALAR，调用方自行走标量代码
+ * 这里只封装矩阵运算、视锥剔除和mipmap生成用到的几种操作，simdMulAdd故意不使用融合乘加（FMA），
+ * 这样SIMD结果的运算顺序和舍入方式与原来的标量循环一致。
+ */
+
+#if defined(LEARNOPENGL_NO_SIMD)
+#define SIMD_SCALAR 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_SSE 1
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_AVX 1
+#endif
+#else
+#define SIMD_SCALAR 1
+#endif
+
+#if defined(SIMD_NEON)
+
+typedef float32x4_t SimdFloat4;
+
+static inline SimdFloat4 simdLoad(const float* p) { return vld1q_f32(p); }
+static inline void simdStore(float* p, SimdFloat4 v) { vst1q_f32(p, v); }
+static inline SimdFloat4 simdSplat(float f) { return vdupq_n_f32(f); }
+static inline SimdFloat4 simdSet(float x, float y, float z, float w)
+{
+    float temp[4] = {x, y, z, w};
+    return vld1q_f32(temp);
+}
+static inline SimdFloat4 simdAdd(SimdFloat4 a, SimdFloat4 b) { return vaddq_f32(a, b); }
+static inline SimdFloat4 simdSub(SimdFloat4 a, SimdFloat4 b) { return vsubq_f32(a, b); }
+static inline SimdFloat4 simdMul(SimdFloat4 a, SimdFloat4 b) { return vmulq_f32(a, b); }
+// a + b * c，vmlaq_f32在AArch64上是分开的乘和加，不会融合
+static inline SimdFloat4 simdMulAdd(SimdFloat4 a, SimdFloat4 b, SimdFloat4 c) { return vmlaq_f32(a, b, c); }
+static inline SimdFloat4 simdMin(SimdFloat4 a, SimdFloat4 b) { return vminq_f32(a, b); }
+static inline SimdFloat4 simdMax(SimdFloat4 a, SimdFloat4 b) { return vmaxq_f32(a, b); }
+static inline SimdFloat4 simdDiv(SimdFloat4 a, SimdFloat4 b)
+{
+#if defined(__aarch64__)
+    return vdivq_f32(a, b);
+#else
+    SimdFloat4 r = vrecpeq_f32(b);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    return vmulq_f32(a, r);
+#endif
+}
+// 小于0的元素的位掩码，第i位对应第i个元素
+static inline int simdNegativeMask(SimdFloat4 v)
+{
+    static const uint32_t bits[4] = {1, 2, 4, 8};
+    uint32x4_t mask = vandq_u32(vcltq_f32(v, vdupq_n_f32(0.0f)), vld1q_u32(bits));
+#if defined(__aarch64__)
+    return (int) vaddvq_u32(mask);
+#else
+    uint32x2_t sum = vadd_u32(vget_low_u32(mask), vget_high_u32(mask));
+    return (int) vget_lane_u32(vpadd_u32(sum, sum), 0);
+#endif
+}
+// 广播第n个元素
+#define SIMD_SPLAT_LANE(v, n) vdupq_n_f32(vgetq_lane_f32(v, n))
+// 取{a[x], a[y], b[z], b[w]}，语义与_mm_shuffle_ps一致
+#define SIMD_SHUFFLE(a, b, x, y, z, w) __builtin_shufflevector(a, b, x, y, (z) + 4, (w) + 4)
+
+#elif defined(SIMD_SSE)
+
+typedef __m128 SimdFloat4;
+
+static inline SimdFloat4 simdLoad(const float* p) { return _mm_loadu_ps(p); }
+static inline void simdStore(float* p, SimdFloat4 v) { _mm_storeu_ps(p, v); }
+static inline SimdFloat4 simdSplat(float f) { return _mm_set1_ps(f); }
+static inline SimdFloat4 simdSet(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+static inline SimdFloat4 simdAdd(SimdFloat4 a, SimdFloat4 b) { return _mm_add_ps(a, b); }
+static inline SimdFloat4 simdSub(SimdFloat4 a, SimdFloat4 b) { return _mm_sub_ps(a, b); }
+static inline SimdFloat4 simdMul(SimdFloat4 a, SimdFloat4 b) { return _mm_mul_ps(a, b); }
+static inline SimdFloat4 simdMulAdd(SimdFloat4 a, SimdFloat4 b, SimdFloat4 c) { return _mm_add_ps(a, _mm_mul_ps(b, c)); }
+static inline SimdFloat4 simdMin(SimdFloat4 a, SimdFloat4 b) { return _mm_min_ps(a, b); }
+static inline SimdFloat4 simdMax(SimdFloat4 a, SimdFloat4 b) { return _mm_max_ps(a, b); }
+static inline SimdFloat4 simdDiv(SimdFloat4 a, SimdFloat4 b) { return _mm_div_ps(a, b); }
+static inline int simdNegativeMask(SimdFloat4 v) { return _mm_movemask_ps(_mm_cmplt_ps(v, _mm_setzero_ps())); }
+#define SIMD_SPLAT_LANE(v, n) _mm_shuffle_ps(v, v, _MM_SHUFFLE(n, n, n, n))
+#define SIMD_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+
+#endif
+
+#endif //LEARNOPENGL_SIMDUTIL_H
@@ -0,0 +1,54 @@
+#ifndef LEARNOPENGL_SIMULATIONUTIL_H
+#define LEARNOPENGL_SIMULATIONUTIL_H
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * 无锁三缓冲：一个线程写、一个线程读，写的一方总有一块空闲的缓冲区可写，读的一方总能拿到最新发布的一块，
+ * 双方都不会等待对方。三块缓冲区分别由写者、读者持有，第三块（middle）在两者之间交换。
+ */
+struct TripleBuffer
+{
+    unsigned char* slots; // 3 * slotBytes
+    size_t slotBytes;
+    std::atomic<unsigned int> middle; // 低2位是中间缓冲区的下标，freshBit表示它是读者还没拿到的新数据
+    unsigned int writeIndex; // 只由写者访问
+    unsigned int readIndex; // 只由读者访问
+};
+
+bool createTripleBuffer(TripleBuffer* buffer, size_t slotBytes);
+void deleteTripleBuffer(TripleBuffer* buffer);
+// 写者：取得可写的缓冲区，写完后调用publishTripleBuffer
+void* tripleBufferWriteSlot(TripleBuffer* buffer);
+void publishTripleBuffer(TripleBuffer* buffer);
+// 读者：取得最新发布的缓冲区，没有新数据时返回上一次的，在下一次调用前内容不会被修改
+const void* tripleBufferLatest(TripleBuffer* buffer);
+
+// 推进一个固定步长的场景状态，只在模拟线程上调用
+typedef void (*SimulationUpdate)(double stepSeconds);
+// 把当前场景状态写入快照
+typedef void (*SimulationSnapshot)(void* snapshot);
+
+struct SimulationStats
+{
+    long long steps; // 执行的固定步数
+    long long published; // 发布的快照数
+    long long consumed; // 渲染线程拿到的新快照数
+    long long skippedSteps; // 落后太多被丢掉的步数
+    double maxUpdateMilliseconds; // 单次更新（若干步加写快照）最长的耗时
+};
+
+/**
+ * 启动模拟线程，按stepSeconds的固定步长调用update，每轮更新后写一份快照并发布。
+ * 返回前已经发布了初始快照，latestSimulationSnapshot不会返回NULL。已经启动时会先停止原来的线程。
+ */
+bool startSimulation(SimulationUpdate update, SimulationSnapshot snapshot, size_t snapshotBytes, double stepSeconds);
+void stopSimulation();
+// 暂停时模拟线程休眠，恢复后从当前时间继续，不会补上暂停期间的步数
+void setSimulationPaused(bool paused);
+// 渲染线程调用，取得最新的快照，模拟没有启动时返回NULL
+const void* latestSimulationSnapshot();
+void getSimulationStats(SimulationStats* stats);
+
+#endif //LEARNOPENGL_SIMULATIONUTIL_H
@@ -0,0 +1,80 @@
+#ifndef LEARNOPENGL_SOFTRASTER_H
+#define LEARNOPENGL_SOFTRASTER_H
+
+#include <GLES3/gl3.h>
+#include <vector>
+
+#include "ShaderVariant.h"
+
+/**
+ * CPU上的分块软件光栅化，见SoftRaster.cpp。输入和课程的绘制数据一样（索引三角形、投影和模型视图矩阵、逐顶点颜色、
+ * lesson4的Phong光照、最近点采样的纹理），用在没有GPU的机器上渲染课程画面、和基准图像比较以及测三角形吞吐量。
+ */
+static const int softTileSize = 64; // 分块边长（像素），每个分块由一个线程光栅化
+
+// 颜色RGBA8，第一行是画面最上面一行（和glReadPixels相反）；深度为窗口坐标[0, 1]
+struct SoftFramebuffer
+{
+    int width;
+    int height;
+    std::vector<unsigned char> colour;
+    std::vector<float> depth;
+};
+
+// RGBA8纹理，第一行对应纹理坐标t=0（和glTexImage2D一样），按GL_NEAREST、GL_REPEAT采样
+struct SoftTexture
+{
+    int width;
+    int height;
+    const unsigned char* rgba;
+};
+
+struct SoftDraw
+{
+    const float* positions;
+    int positionSize; // 每个顶点2或3个分量，和glVertexAttribPointer一样，缺少的z为0
+    const float* colours; // 每个顶点3个，为NULL时所有顶点都用constantColour
+    const float* constantColour; // 3个，也为NULL时为白色
+    const float* normals; // 每个顶点3个，有光照时需要
+    const float* textureCoordinates; // 每个顶点2个，有纹理时需要
+    int vertexCount;
+    const void* indices; // 为NULL时按顺序每3个顶点一个三角形（glDrawArrays）
+    GLenum indexType; // GL_UNSIGNED_SHORT或GL_UNSIGNED_INT
+    int count; // 索引个数（没有索引时为顶点个数）
+    const float* projection; // 为NULL时为单位矩阵
+    const float* modelView; // 为NULL时为单位矩阵
+    const LightingUniforms* lighting; // 不为NULL时按phongTemplate的逐顶点光照计算颜色，specularColour全为0时没有镜面反射
+    const SoftTexture* texture; // 不为NULL时颜色乘以纹理
+    bool depthTest; // GL_LESS，通过时写入深度
+    bool cullBackFaces; // 剔除背面，逆时针（GL_CCW）为正面
+};
+
+struct SoftRasterStats
+{
+    int triangles; // 提交的三角形
+    int culled; // 背面、在视锥外或面积为0，没有进入分块的三角形
+    int binned; // 三角形和分块重叠的次数
+    long long pixels; // 写入的像素
+    int steals; // 线程从别的线程的队列里偷来的任务
+};
+
+/**
+ * 启动光栅化线程池，threads<=0时为CPU核数，调用softDraw的线程也算一个；没有启动时softDraw只在调用线程上运行。
+ * 同一时间只能有一个线程调用softDraw。
+ */
+void startSoftRasterThreads(int threads);
+void stopSoftRasterThreads();
+int softRasterThreadCount();
+
+bool createSoftFramebuffer(SoftFramebuffer* framebuffer, int width, int height);
+// 颜色清成指定值，深度清成1.0
+void clearSoftFramebuffer(SoftFramebuffer* framebuffer, float red, float green, float blue, float alpha);
+/**
+ * 画一批三角形，返回时framebuffer已经写好。顶点变换和分块光栅化在线程池上并行，
+ * 同一个分块内的三角形按提交顺序处理，所以结果和线程数无关。
+ */
+void softDraw(SoftFramebuffer* framebuffer, const SoftDraw* draw);
+void getSoftRasterStats(SoftRasterStats* stats);
+void resetSoftRasterStats();
+
+#endif //LEARNOPENGL_SOFTRASTER_H
@@ -0,0 +1,66 @@
+#ifndef LEARNOPENGL_STATECACHE_H
+#define LEARNOPENGL_STATECACHE_H
+
+#include <GLES3/gl3.h>
+
+/**
+ * GL状态缓存，见StateCache.cpp。cached*函数与同名的gl*函数参数相同（glUniform*去掉了transpose和count以外的参数差异），
+ * 和上一次设置的值相同时不调用驱动。
+ * 使用缓存后，这些状态都要通过cached*修改，直接调用gl*改了状态之后要调用resetStateCache。
+ */
+
+// 被省略的调用按类别统计
+enum StateCategory
+{
+    STATE_PROGRAM = 0, // glUseProgram
+    STATE_TEXTURE, // glActiveTexture、glBindTexture
+    STATE_BUFFER, // glBindBuffer
+    STATE_VERTEX_ARRAY, // glBindVertexArray
+    STATE_ATTRIBUTE, // glVertexAttribPointer、glEnable/DisableVertexAttribArray
+    STATE_UNIFORM, // glUniform*
+    STATE_FIXED_FUNCTION, // glClearColor、glEnable/glDisable、glViewport
+    STATE_CATEGORY_COUNT
+};
+
+struct StateCacheStats
+{
+    int issued[STATE_CATEGORY_COUNT]; // 真正调用了驱动的次数
+    int elided[STATE_CATEGORY_COUNT]; // 值没有变化而省略的次数
+};
+
+// 忘掉所有记录的状态（新建或重建GL上下文之后，或者绕过缓存直接修改了状态之后调用），下一次设置一定会调用驱动
+void resetStateCache();
+void getStateCacheStats(StateCacheStats* stats);
+void resetStateCacheStats();
+
+void cachedUseProgram(GLuint program);
+void cachedActiveTexture(GLenum unit);
+void cachedBindTexture(GLenum target, GLuint texture);
+void cachedBindBuffer(GLenum target, GLuint buffer);
+void cachedBindVertexArray(GLuint vertexArray);
+void cachedEnableVertexAttribArray(GLuint index);
+void cachedDisableVertexAttribArray(GLuint index);
+void cachedVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+
+// 作用于当前程序（最后一次cachedUseProgram的程序），值按字节比较
+void cachedUniform1i(GLint location, GLint value);
+void cachedUniform1f(GLint location, GLfloat value);
+void cachedUniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z);
+void cachedUniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+void cachedUniform3fv(GLint location, GLsizei count, const GLfloat* value);
+void cachedUniform4fv(GLint location, GLsizei count, const GLfloat* value);
+void cachedUniformMatrix3fv(GLint location, GLsizei count, const GLfloat* value);
+void cachedUniformMatrix4fv(GLint location, GLsizei count, const GLfloat* value);
+
+void cachedClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+void cachedEnable(GLenum capability);
+void cachedDisable(GLenum capability);
+void cachedViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+// 删除对象并同步缓存：GL会把被删除的对象从绑定点上解绑，而它的id之后可能被新对象复用
+void cachedDeleteProgram(GLuint program);
+void cachedDeleteTextures(GLsizei count, const GLuint* textures);
+void cachedDeleteBuffers(GLsizei count, const GLuint* buffers);
+void cachedDeleteVertexArrays(GLsizei count, const GLuint* vertexArrays);
+
+#endif //LEARNOPENGL_STATECACHE_H
@@ -0,0 +1,60 @@
+#ifndef LEARNOPENGL_STREAMBUFFER_H
+#define LEARNOPENGL_STREAMBUFFER_H
+
+#include <GLES3/gl3.h>
+#include <vector>
+
+/**
+ * 每帧都会变化的数据（实例矩阵、uniform、粒子和UI顶点）用的环形流式缓冲区，见StreamBuffer.cpp。
+ * 一个缓冲区对象分成frameCount段，每帧写一段，段上的栅栏（glFenceSync）保证GPU用完之前不会被覆盖，
+ * 写入方直接把数据写进映射出来的内存，不需要先写到CPU数组再复制。需要GLES3。
+ */
+static const int maxStreamFrames = 4;
+static const GLsizeiptr streamRegionAlignment = 256; // 每段的起点按这个对齐，不小于常见的GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+
+struct StreamBufferStats
+{
+    int frames;
+    int stalls; // 等待栅栏超过0.1毫秒（GPU还在用这一段）的帧数
+    double stallMilliseconds; // 等待栅栏的总时间
+    double maxStallMilliseconds;
+    long long bytesStreamed; // 所有帧分配出去的字节数（包括对齐的空隙）
+    long long lastFrameBytes; // 上一帧分配的字节数
+    int overflows; // 这一段剩下的空间不够而失败的分配
+    int fallbackFrames; // 映射失败、改用glBufferSubData上传的帧数
+};
+
+struct StreamBuffer
+{
+    GLuint buffer;
+    GLenum target; // 映射和上传时绑定的目标，如GL_ARRAY_BUFFER、GL_UNIFORM_BUFFER
+    GLsizeiptr frameBytes; // 每段的大小
+    int frameCount;
+    int frame; // 当前这一帧写的段
+    GLsizeiptr used; // 当前这一段已经分配的字节数
+    GLsizeiptr mappedStart; // 当前映射的范围从段内的这个位置开始，到段尾结束
+    unsigned char* mapped; // 映射出来的指针（对应mappedStart），没有映射时为NULL
+    bool mapping; // false时映射不可用，分配的是staging里的内存，取消映射时用glBufferSubData上传
+    std::vector<unsigned char> staging;
+    GLsync fences[maxStreamFrames];
+    StreamBufferStats stats;
+};
+
+// 创建frameCount（2到maxStreamFrames）段、每段至少bytesPerFrame字节的缓冲区
+bool createStreamBuffer(StreamBuffer* stream, GLenum target, GLsizeiptr bytesPerFrame, int frameCount);
+// 切换到下一段，如果GPU还在读这一段（栅栏还没有触发），在这里等待
+void beginStreamFrame(StreamBuffer* stream);
+/**
+ * 在当前这一段里分配bytes字节，offset返回在缓冲区里的偏移（按alignment对齐，alignment是2的幂），
+ * 用作glVertexAttribPointer的偏移或glBindBufferRange的offset。返回的指针在unmapStreamBuffer之前可以写入，
+ * 只能写不能读（映射的内存可能是写合并的，读非常慢）。空间不够时返回NULL。
+ */
+void* streamAllocate(StreamBuffer* stream, GLsizeiptr bytes, GLsizeiptr alignment, GLintptr* offset);
+// 提交写入的数据，之后才能绘制（GLES3的缓冲区在映射时不能被GPU使用）；绘制之后还可以继续分配
+void unmapStreamBuffer(StreamBuffer* stream);
+// 在这一帧使用缓冲区的绘制都提交之后调用，给这一段插入栅栏
+void endStreamFrame(StreamBuffer* stream);
+void deleteStreamBuffer(StreamBuffer* stream);
+void resetStreamBufferStats(StreamBuffer* stream);
+
+#endif //LEARNOPENGL_STREAMBUFFER_H
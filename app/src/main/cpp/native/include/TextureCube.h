@@ -3,5 +3,10 @@
 
 bool setupGraphics(int width, int height);
 void renderFrame();
+// 上下文不变，只是surface大小变了
+void resizeGraphics(int width, int height);
+// 上下文还在时释放setupGraphics创建的GL资源
+void teardownGraphics();
+// 正方体的纹理文件由setSceneTextureFile（TextureStream.h）设置，setupGraphics时在后台加载，完成前显示内置的3x3纹理
 
 #endif //LEARNOPENGL_TEXTURECUBE_H
@@ -0,0 +1,85 @@
+#ifndef LEARNOPENGL_TEXTURESTREAM_H
+#define LEARNOPENGL_TEXTURESTREAM_H
+
+#include <GLES3/gl3.h>
+#include <cstddef>
+#include <string>
+
+static const int maxTextureLevels = 16;
+
+// KTX文件中的一级mipmap，data指向映射的文件内容
+struct KtxLevel
+{
+    const unsigned char* data;
+    size_t bytes;
+    int width;
+    int height;
+};
+
+// 解析后的KTX/KTX2文件，只支持单张2D纹理（没有数组、立方体贴图和超压缩）
+struct KtxImage
+{
+    GLenum internalFormat;
+    bool compressed; // false时是RGBA8（或sRGB的RGBA8），用glTexImage2D上传
+    int blockWidth; // 压缩块的大小，RGBA8为1
+    int blockHeight;
+    int width;
+    int height;
+    int levelCount;
+    KtxLevel levels[maxTextureLevels]; // levels[0]是最大的一级
+};
+
+/**
+ * 解析内存中的KTX（1.1）或KTX2文件，支持ETC2、ASTC（LDR，各种块大小）和RGBA8。
+ * 会检查每一级的数据大小，失败时返回false并打印原因。
+ */
+bool parseKtx(const unsigned char* data, size_t size, KtxImage* image);
+// 把image的各级写成KTX2文件（没有DFD和超压缩），用于离线烘焙mipmap
+bool writeKtx2(const char* path, const KtxImage* image);
+
+enum StreamedTextureState
+{
+    TEXTURE_PENDING, // 还在读取，或者在等待上传
+    TEXTURE_PARTIAL, // 已经上传了较小的几级，可以先用来绘制（需要ES3）
+    TEXTURE_COMPLETE,
+    TEXTURE_FAILED
+};
+
+struct TextureStreamStats
+{
+    int requested;
+    int completed;
+    int failed;
+    long long bytesMapped; // 工作线程映射的文件大小
+    long long bytesStreamed; // 提交给GL的纹理数据
+    int levelsUploaded; // 完整上传的级数
+    int framesWithUploads; // 有上传的帧数
+    int framesOverBudget; // 上传时间超过预算的帧数
+    double uploadMilliseconds; // GL线程上花在上传调用上的总时间
+    double stallMilliseconds; // 超出每帧预算的时间总和，也就是上传给渲染线程造成的额外停顿
+    double maxFrameMilliseconds; // 单帧最长的上传时间
+    int mipChainsGenerated; // 工作线程为只有一级的RGBA8纹理生成的mipmap链
+    double mipMilliseconds; // 生成mipmap链的总时间
+};
+
+// 在GL线程上调用（需要当前上下文来判断支持哪些压缩格式），工作线程只在有请求时运行
+bool startTextureStreaming();
+// 等待正在解析的文件处理完，丢掉还没上传的请求，已经创建的纹理不会被删除
+void stopTextureStreaming();
+/**
+ * 请求加载一张纹理，返回句柄。工作线程映射并解析path，格式不被当前上下文支持（例如没有ASTC）时改用fallbackPath
+ * （通常是RGBA8的KTX，可以为NULL）。
+ */
+int requestTexture(const char* path, const char* fallbackPath);
+// 在GL线程上每帧调用一次，在budgetMilliseconds内上传已经解析好的mipmap（每帧至少上传一条），返回上传的条数
+int pumpTextureUploads(double budgetMilliseconds);
+// 返回状态，PARTIAL和COMPLETE时texture是可以绑定的纹理
+StreamedTextureState getStreamedTexture(int handle, GLuint* texture);
+void getTextureStreamStats(TextureStreamStats* stats);
+void resetTextureStreamStats();
+// 课程要显示的纹理文件（lesson3），在GL线程上、场景setup之前设置，path为NULL或空时课程只用内置纹理
+void setSceneTextureFile(const char* path, const char* fallbackPath);
+// 没有设置纹理文件时返回false
+bool getSceneTextureFile(std::string* path, std::string* fallbackPath);
+
+#endif //LEARNOPENGL_TEXTURESTREAM_H
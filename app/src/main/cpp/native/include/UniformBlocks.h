@@ -0,0 +1,108 @@
+#ifndef LEARNOPENGL_UNIFORMBLOCKS_H
+#define LEARNOPENGL_UNIFORMBLOCKS_H
+
+#include <GLES3/gl3.h>
+
+#include "ShaderVariant.h"
+#include "StreamBuffer.h"
+
+/**
+ * 所有程序共用的std140 uniform块，见UniformBlocks.cpp。相机和光照每帧上传一次，绑定在固定的绑定点上，
+ * 切换程序时不需要重新上传；每个物体的数据放在单独的块里，从流式缓冲区（StreamBuffer.h）分配。需要GLES3。
+ */
+enum UniformBlockBinding
+{
+    UNIFORM_BLOCK_CAMERA = 0,
+    UNIFORM_BLOCK_LIGHTING,
+    UNIFORM_BLOCK_OBJECT,
+    UNIFORM_BLOCK_COUNT
+};
+
+// 和着色器里的块逐字节对应（std140：mat4占64字节，vec3按16字节对齐，后面的float可以填进vec3剩下的4字节）
+struct CameraBlock
+{
+    float projection[16];
+    float view[16];
+    float viewProjection[16];
+};
+
+struct LightingBlock
+{
+    float inverseLightDirection[4]; // 每个vec3后面空4字节
+    float inverseEyeDirection[4];
+    float ambientLightIntensity[4];
+    float diffuseLightIntensity[4];
+    float specularColour[3];
+    float shininess;
+};
+
+struct ObjectBlock
+{
+    float modelView[16];
+};
+
+/**
+ * 着色器里块的声明，块没有实例名，成员直接用名字访问（projection、modelView等），和用单独的uniform时一样。
+ * 同一个块在顶点和块着色器里的精度必须相同，所以成员都显式写highp。
+ */
+#define CAMERA_BLOCK_SOURCE \
+        "layout(std140) uniform Camera\n" \
+        "{\n" \
+        "    highp mat4 projection;\n" \
+        "    highp mat4 view;\n" \
+        "    highp mat4 viewProjection;\n" \
+        "};\n"
+#define LIGHTING_BLOCK_SOURCE \
+        "layout(std140) uniform Lighting\n" \
+        "{\n" \
+        "    highp vec3 inverseLightDirection;\n" \
+        "    highp vec3 inverseEyeDirection;\n" \
+        "    highp vec3 ambientLightIntensity;\n" \
+        "    highp vec3 diffuseLightIntensity;\n" \
+        "    highp vec3 specularColour;\n" \
+        "    highp float shininess;\n" \
+        "};\n"
+#define OBJECT_BLOCK_SOURCE \
+        "layout(std140) uniform Object\n" \
+        "{\n" \
+        "    highp mat4 modelView;\n" \
+        "};\n"
+
+struct UniformBlockStats
+{
+    int frames;
+    int cameraUploads; // 相机块真正上传的次数（内容没变时省略）
+    int lightingUploads;
+    int objectBlocks; // 写入的物体块
+    int objectBindings; // glBindBufferRange的次数
+};
+
+// GL上下文是否支持uniform块（GLES3）
+bool uniformBlocksSupported();
+/**
+ * 创建相机块、光照块的缓冲区和物体块用的流式缓冲区（每帧最多maxObjectsPerFrame个物体），并绑定到固定的绑定点。
+ * 新的GL上下文里调用，之前创建的对象只被忘掉而不删除。
+ */
+bool initUniformBlocks(int maxObjectsPerFrame);
+void deleteUniformBlocks();
+// 把程序里名为Camera、Lighting、Object的块连到对应的绑定点，程序里没有的块忽略。getShaderVariant会自动调用
+void bindProgramUniformBlocks(GLuint program);
+
+// 每帧开始时调用，切换物体块用的流式缓冲区段
+void beginUniformFrame();
+// 这一帧用到物体块的绘制都提交之后调用
+void endUniformFrame();
+// view为NULL时为单位矩阵（模型视图矩阵里已经包含了视图变换）。和上一次相同时不上传
+void updateCameraBlock(const float* projection, const float* view);
+void updateLightingBlock(const LightingUniforms* uniforms);
+/**
+ * 写入一个物体的块，返回在流式缓冲区里的偏移，空间不够时返回-1。多个物体可以先全部写好，再逐个bindObjectBlock并绘制，
+ * 这样每帧只映射一次缓冲区。
+ */
+GLintptr writeObjectBlock(const float* modelView);
+// 让Object块读取offset处的数据，第一次绑定前会先取消映射
+void bindObjectBlock(GLintptr offset);
+void getUniformBlockStats(UniformBlockStats* stats);
+void resetUniformBlockStats();
+
+#endif //LEARNOPENGL_UNIFORMBLOCKS_H
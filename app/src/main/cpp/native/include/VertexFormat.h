@@ -0,0 +1,49 @@
+#ifndef LEARNOPENGL_VERTEXFORMAT_H
+#define LEARNOPENGL_VERTEXFORMAT_H
+
+#include <GLES3/gl3.h>
+
+static const int maxVertexElements = 8;
+
+// 顶点属性在显存中的存储格式，见VertexFormat.cpp
+enum VertexElementFormat
+{
+    VERTEX_FLOAT, // 32位浮点
+    VERTEX_HALF, // 16位浮点，3个分量时补齐到4个（8字节）
+    VERTEX_SNORM8, // 有符号归一化8位，补齐到4字节，适合法线
+    VERTEX_UNORM8, // 无符号归一化8位，补齐到4字节，适合颜色
+    VERTEX_INT_2_10_10_10, // 有符号归一化10:10:10:2打包在4字节里，适合法线
+};
+
+struct VertexElement
+{
+    GLint location; // glGetAttribLocation得到的位置
+    GLint components; // 源数据每个顶点的分量个数（1~4）
+    VertexElementFormat format;
+    GLsizei offset; // 在交错顶点中的偏移
+    GLsizei bytes; // 在交错顶点中占用的字节数（包含补齐）
+};
+
+// 交错顶点布局：所有属性放在同一个缓冲区里，一个顶点的全部属性连续存放
+struct VertexLayout
+{
+    int elementCount;
+    VertexElement elements[maxVertexElements];
+    GLsizei stride;
+};
+
+bool packedVertexFormatsSupported();
+void initVertexLayout(VertexLayout* layout);
+bool addVertexElement(VertexLayout* layout, GLint location, GLint components, VertexElementFormat format);
+void getVertexElementType(const VertexElement* element, GLint* size, GLenum* type, GLboolean* normalized);
+// 按布局设置glVertexAttribPointer并启用属性，base是缓冲区内顶点数据的起始偏移（或客户端数组指针）
+void setupVertexLayout(const VertexLayout* layout, const void* base);
+// sources[i]是第i个属性的浮点源数据，每个顶点components个分量；output至少stride * vertexCount字节
+void packVertices(const VertexLayout* layout, const float* const* sources, int vertexCount, void* output);
+// packVertices的逆过程，用于检查量化误差
+void unpackVertices(const VertexLayout* layout, const void* input, int vertexCount, float* const* destinations);
+
+unsigned short floatToHalf(float value);
+float halfToFloat(unsigned short value);
+
+#endif //LEARNOPENGL_VERTEXFORMAT_H
@@ -11,14 +11,14 @@
  *    - 最后，我们需要启用顶点坐标，并绘制图形。
  */
 
-#include <jni.h>
-
 // EGL相应库
-#include <GLES2/gl2.h>
-#include <GLES2/gl2ext.h>
+#include <GLES3/gl3.h>
 
 #include <cstdlib>
 #include "../include/LoadUtil.h"
+#include "../include/MeshUtil.h"
+#include "../include/Scene.h"
+#include "../include/StateCache.h"
 #include "../include/LogUtil.h"
 
 // 顶点着色器源码
@@ -37,8 +37,16 @@ static const char glFragmentShader[] =
         "  gl_FragColor = vec4(1.0, 0.0, 0.0, 1.0);\n" // 设置颜色，4位代表RGBA，值域0.0~1.0，这个例子里表示红色
         "}\n";
 
+// 三角形顶点坐标（导出给宿主工具SoftRender读取），范围是[-1.0，1.0],因为三角是2D图形，所以无需考虑z轴，每两个值代表一个顶点的x和y坐标，用于渲染时绘制三角形
+GLfloat triangleVertices[] = {
+        0.0f, 1.0f, // 三角形顶部
+        -1.0f, -1.0f, // 三角形左下角
+        1.0f, -1.0f // 三角形右下角
+};
+
 GLuint simpleTriangleProgram; // 着色器程序，在setupGraphics中初始化，渲染时使用
 GLuint vPosition; // 顶点着色器的vPosition变量，在setupGraphics中初始化，渲染时GPU的着色器需要使用
+Mesh triangleMesh; // 上传到GPU的三角形顶点，在setupGraphics中创建，见MeshUtil.cpp
 
 /**
  * 创建着色器程序并设置视口（类似架起摄像机），在渲染器初始化的时候调用
@@ -48,6 +56,7 @@ GLuint vPosition; // 顶点着色器的vPosition变量，在setupGraphics中初
  */
 extern bool setupGraphics(int w, int h)
 {
+    resetStateCache(); // 新的GL上下文，之前记录的状态都作废了
     simpleTriangleProgram = createProgram(glVertexShader, glFragmentShader); // 创建好着色器程序
     if (!simpleTriangleProgram) // 确保创建成功
     {
@@ -55,26 +64,42 @@ extern bool setupGraphics(int w, int h)
         return false;
     }
     vPosition = glGetAttribLocation(simpleTriangleProgram, "vPosition"); // 通过OpenGL ES获取顶点着色器的vPosition变量
-    glViewport(0, 0, w, h); // 设置视口
+    // 顶点坐标只在这里上传一次，之后每帧直接使用GPU上的数据
+    MeshAttribute attributes[] = {
+            {(GLint) vPosition, 2, GL_FLOAT, GL_FALSE, triangleVertices, sizeof(triangleVertices)}
+    };
+    if (!createMesh(&triangleMesh, GL_TRIANGLES, attributes, 1, 3, NULL, 0, 0))
+    {
+        return false;
+    }
+    cachedViewport(0, 0, w, h); // 设置视口
     return true;
 }
 
-// 三角形顶点坐标，范围是[-1.0，1.0],因为三角是2D图形，所以无需考虑z轴，每两个值代表一个顶点的x和y坐标，用于渲染时绘制三角形
-const GLfloat triangleVertices[] = {
-        0.0f, 1.0f, // 三角形顶部
-        -1.0f, -1.0f, // 三角形左下角
-        1.0f, -1.0f // 三角形右下角
-};
-
 /**
  * 用于绘制渲染三角形
  */
 extern void renderFrame()
 {
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // 设置背景颜色为黑色
+    cachedClearColor(0.0f, 0.0f, 0.0f, 1.0f); // 设置背景颜色为黑色（和上一帧一样时不会调用驱动，见StateCache.cpp）
     glClear (GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT); // 清除颜色缓冲区和深度缓冲区
-    glUseProgram(simpleTriangleProgram); // 选择要使用的着色器程序，应用可以获取多个着色器程序。
-    glVertexAttribPointer(vPosition, 2, GL_FLOAT, GL_FALSE, 0 ,triangleVertices); // 设置顶点坐标
-    glEnableVertexAttribArray(vPosition); // 启用顶点坐标
-    glDrawArrays(GL_TRIANGLES, 0, 3); // 绘制三角形
-}
\ No newline at end of file
+    cachedUseProgram(simpleTriangleProgram); // 选择要使用的着色器程序，应用可以获取多个着色器程序。
+    drawMesh(&triangleMesh); // 绑定记录了顶点坐标设置的网格并绘制三角形
+}
+
+extern void resizeGraphics(int width, int height)
+{
+    cachedViewport(0, 0, width, height);
+}
+
+extern void teardownGraphics()
+{
+    cachedDeleteProgram(simpleTriangleProgram);
+    simpleTriangleProgram = 0;
+    deleteMesh(&triangleMesh);
+}
+
+// 注册场景，选中时才加载这个库，见SceneRegistry.cpp
+static const Scene triangleScene = {"Triangle", setupGraphics, resizeGraphics, renderFrame, teardownGraphics,
+                                    NULL, 0, NULL, NULL};
+static SceneRegistration triangleRegistration(&triangleScene);
@@ -20,10 +20,13 @@
 
 #include <cstddef>
 #include <cmath>
-#include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
 #include "../include/LoadUtil.h"
 #include "../include/LogUtil.h"
 #include "../include/CameraUtil.h"
+#include "../include/MeshUtil.h"
+#include "../include/Scene.h"
+#include "../include/StateCache.h"
 
 
 // 顶点着色器
@@ -54,26 +57,7 @@ GLint vertexColourLocation;
 GLint projectionLocation;
 GLint modelViewLocation;
 float projectionMatrix[16];
-
-// 顶点坐标
-extern bool setupGraphics(int width, int height)
-{
-    simpleCubeProgram = createProgram(glVertexShader, glFragmentShader);
-    if (simpleCubeProgram == 0)
-    {
-        LOGE ("Could not create program");
-        return false;
-    }
-    vertexLocation = glGetAttribLocation(simpleCubeProgram, "vertexPosition"); // 获取顶点坐标
-    vertexColourLocation = glGetAttribLocation(simpleCubeProgram, "vertexColour"); // 获取顶点颜色
-    projectionLocation = glGetUniformLocation(simpleCubeProgram, "projection"); // 获取投影矩阵
-    modelViewLocation = glGetUniformLocation(simpleCubeProgram, "modelView"); // 获取模型视图矩阵
-    /* Setup the perspective */
-    matrixPerspective(projectionMatrix, 45, (float)width / (float)height, 0.1f, 100);
-    glEnable(GL_DEPTH_TEST); // 开启深度测试，告知OpenGL ES显示时需要考虑深度
-    glViewport(0, 0, width, height);
-    return true;
-}
+Mesh cubeMesh; // 上传到GPU的正方体网格，见MeshUtil.cpp
 
 // 正方体矩阵，一个面由两个三角、六个点构成(范围0-1)
 GLfloat cubeVertices[] = {-1.0f,  1.0f, -1.0f, /* Back. */
@@ -144,6 +128,34 @@ GLushort indices[] = {0, 2, 3,
                       20, 23, 22
 };
 
+extern bool setupGraphics(int width, int height)
+{
+    resetStateCache(); // 新的GL上下文，之前记录的状态都作废了
+    simpleCubeProgram = createProgram(glVertexShader, glFragmentShader);
+    if (simpleCubeProgram == 0)
+    {
+        LOGE ("Could not create program");
+        return false;
+    }
+    vertexLocation = glGetAttribLocation(simpleCubeProgram, "vertexPosition"); // 获取顶点坐标
+    vertexColourLocation = glGetAttribLocation(simpleCubeProgram, "vertexColour"); // 获取顶点颜色
+    projectionLocation = glGetUniformLocation(simpleCubeProgram, "projection"); // 获取投影矩阵
+    modelViewLocation = glGetUniformLocation(simpleCubeProgram, "modelView"); // 获取模型视图矩阵
+    // 顶点坐标、颜色和索引只在这里上传一次，属性设置记录在网格的VAO里，之后每帧直接使用GPU上的数据
+    MeshAttribute attributes[] = {
+            {vertexLocation, 3, GL_FLOAT, GL_FALSE, cubeVertices, sizeof(cubeVertices)},
+            {vertexColourLocation, 3, GL_FLOAT, GL_FALSE, colour, sizeof(colour)}
+    };
+    if (!createMesh(&cubeMesh, GL_TRIANGLES, attributes, 2, 24, indices, 36, GL_UNSIGNED_SHORT))
+    {
+        return false;
+    }
+    /* Setup the perspective */
+    matrixPerspective(projectionMatrix, 45, (float)width / (float)height, 0.1f, 100);
+    cachedEnable(GL_DEPTH_TEST); // 开启深度测试，告知OpenGL ES显示时需要考虑深度
+    cachedViewport(0, 0, width, height);
+    return true;
+}
 
 float angle = 0;
 float modelViewMatrix[16];
@@ -151,24 +163,36 @@ float modelViewMatrix[16];
 // 渲染帧
 extern void renderFrame()
 {
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // 设置清屏颜色
+    cachedClearColor(0.0f, 0.0f, 0.0f, 1.0f); // 设置清屏颜色（和上一帧一样时不会调用驱动，见StateCache.cpp）
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT); // 清除深度缓冲区和颜色缓冲区
-    matrixIdentityFunction(modelViewMatrix); // 初始化模型视图矩阵
-    matrixRotateX(modelViewMatrix, angle); // 沿X轴旋转
-    matrixRotateY(modelViewMatrix, angle); // 沿Y轴旋转
-    matrixTranslate(modelViewMatrix, 0.0f, 0.0f, -10.0f); // 往Z轴负方向移动10个单位，防止画面太近看不到
-    glUseProgram(simpleCubeProgram); // 使用程序
-    glVertexAttribPointer(vertexLocation, 3, GL_FLOAT, GL_FALSE, 0, cubeVertices); // 顶点坐标
-    glEnableVertexAttribArray(vertexLocation); // 启用顶点坐标
-    glVertexAttribPointer(vertexColourLocation, 3, GL_FLOAT, GL_FALSE, 0, colour); // 顶点颜色
-    glEnableVertexAttribArray(vertexColourLocation); // 启用顶点颜色
-    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, projectionMatrix); // 投影矩阵
-    glUniformMatrix4fv(modelViewLocation, 1, GL_FALSE, modelViewMatrix); // 模型视图矩阵
+    // 沿X轴、Y轴旋转，再往Z轴负方向移动10个单位，防止画面太近看不到（直接算出结果，等价于恒等矩阵依次旋转、平移）
+    matrixEulerTransform(modelViewMatrix, angle, angle, 0.0f, 0.0f, 0.0f, -10.0f, 1.0f, 1.0f, 1.0f);
+    cachedUseProgram(simpleCubeProgram); // 使用程序
+    cachedUniformMatrix4fv(projectionLocation, 1, projectionMatrix); // 投影矩阵（只在setupGraphics里变化，之后每帧都会被省略）
+    cachedUniformMatrix4fv(modelViewLocation, 1, modelViewMatrix); // 模型视图矩阵
     // 这里不能用glDrawArrays来画，因为它需要所有的点都被定义，而我们只定义了24个点，而不是36个点（只绘制了我们能看到的面）
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, indices); // 绘制
+    drawMesh(&cubeMesh); // 绑定网格并绘制（内部是glDrawElements）
     angle += 1; // 旋转角度
     if (angle > 360)
     {
         angle -= 360;
     }
 }
+
+extern void resizeGraphics(int width, int height)
+{
+    matrixPerspective(projectionMatrix, 45, (float)width / (float)height, 0.1f, 100);
+    cachedViewport(0, 0, width, height);
+}
+
+extern void teardownGraphics()
+{
+    cachedDeleteProgram(simpleCubeProgram);
+    simpleCubeProgram = 0;
+    deleteMesh(&cubeMesh);
+}
+
+// 注册场景，选中时才加载这个库，见SceneRegistry.cpp
+static const Scene cubeScene = {"Cube", setupGraphics, resizeGraphics, renderFrame, teardownGraphics,
+                                NULL, 0, NULL, NULL};
+static SceneRegistration cubeRegistration(&cubeScene);
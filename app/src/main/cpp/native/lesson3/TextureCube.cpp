@@ -14,10 +14,16 @@
  *    - 把采样对象添加到块着色器上
 */
 
-#include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
+#include <string>
 #include "../include/LoadUtil.h"
 #include "../include/LogUtil.h"
 #include "../include/CameraUtil.h"
+#include "../include/MeshUtil.h"
+#include "../include/Scene.h"
+#include "../include/StateCache.h"
+#include "../include/TextureStream.h"
+#include "../include/TextureCube.h"
 
 // 顶点着色器
 static const char glVertexShader[] =
@@ -42,6 +48,19 @@ static const char glFragmentShader[] =
         "    gl_FragColor = texture2D(texture, textureCord);\n" // 设置颜色
         "}\n";
 
+/* 简单制造一个3x3的RAW图片,每行代表RGBA值（范围0-255），宿主工具SoftRender也从这里读取 */
+GLubyte simpleTexturePixels[9 * 4] = {
+        18, 140, 171, 255, /* 左下角 */
+        143, 143, 143, 255, /* 下面中间 */
+        255, 255, 255, 255, /* 右下角 */
+        255, 255, 0, 255, /* 中间左边 */
+        0, 255, 255, 255, /* 中间*/
+        255, 0, 255, 255, /* 中间右边 */
+        255, 0, 0, 255, /* 左上角 */
+        0, 255, 0, 255, /* 上面中间 */
+        0, 0, 255, 255, /* 右上角 */
+};
+
 /**
  * 用于加载纹理，具体流程如下：
  *    1.指定id并加载图片
@@ -56,26 +75,14 @@ static const char glFragmentShader[] =
 GLuint loadSimpleTexture() {
     /* 渲染对象id */
     GLuint textureId;
-    /* 简单制造一个3x3的RAW图片,每行代表RGBA值（范围0-255）*/
-    GLubyte pixels[9 * 4] = {
-            18, 140, 171, 255, /* 左下角 */
-            143, 143, 143, 255, /* 下面中间 */
-            255, 255, 255, 255, /* 右下角 */
-            255, 255, 0, 255, /* 中间左边 */
-            0, 255, 255, 255, /* 中间*/
-            255, 0, 255, 255, /* 中间右边 */
-            255, 0, 0, 255, /* 左上角 */
-            0, 255, 0, 255, /* 上面中间 */
-            0, 0, 255, 255, /* 右上角 */
-    };
     /* 打包数据（缩减资源） */
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     /* 生成纹理对象 */
     glGenTextures(1, &textureId);
     /* 激活纹理 */
-    glActiveTexture(GL_TEXTURE0);
+    cachedActiveTexture(GL_TEXTURE0);
     /* 绑定纹理对象 */
-    glBindTexture(GL_TEXTURE_2D, textureId);
+    cachedBindTexture(GL_TEXTURE_2D, textureId);
     /* 加载纹理，
      * 第一个参数是我们要用的纹理单位，
      * 第二个参数是纹理贴图的等级，纹理贴图是个重要的技术，以后会讨论，当前设置为0即可
@@ -84,7 +91,7 @@ GLuint loadSimpleTexture() {
      * 第六个参数你想在图片周围加的边距，在OpenGL ES中需要被设置为0
      * 第八个参数是我们需要使用的数据的类型
      * 第九个参数就是我们传入的数据 */
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 3, 3, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 3, 3, 0, GL_RGBA, GL_UNSIGNED_BYTE, simpleTexturePixels);
     /* 设置过滤模型，拉伸或者收缩模式，比如一个面超过3x3，就使用拉伸来铺满这个面 */
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -99,36 +106,9 @@ GLint modelViewLocation;
 GLint samplerLocation;
 GLuint textureId;
 GLfloat projectionMatrix[16];
-
-// 设置图像（类似lesson2，只在最后多了个加载纹理逻辑）
-extern bool setupGraphics(int width, int height)
-{
-    glProgram = createProgram(glVertexShader, glFragmentShader);
-    if (!glProgram)
-    {
-        LOGE ("Could not create program");
-        return false;
-    }
-    vertexLocation = glGetAttribLocation(glProgram, "vertexPosition");
-    textureCordLocation = glGetAttribLocation(glProgram, "vertexTextureCord");
-    projectionLocation = glGetUniformLocation(glProgram, "projection");
-    modelViewLocation = glGetUniformLocation(glProgram, "modelView");
-    samplerLocation = glGetUniformLocation(glProgram, "texture");
-    /* 设置视角 */
-    matrixPerspective(projectionMatrix, 45, (float)width / (float)height, 0.1f, 100);
-    glEnable(GL_DEPTH_TEST);
-    glViewport(0, 0, width, height);
-    /* 加载纹理 */
-    textureId = loadSimpleTexture();
-    if(textureId == 0)
-    {
-        return false;
-    }
-    else
-    {
-        return true;
-    }
-}
+static const double textureUploadBudgetMilliseconds = 2.0; // 每帧最多花在纹理上传上的时间
+static int textureHandle = -1;
+Mesh cubeMesh; // 上传到GPU的正方体网格，见MeshUtil.cpp
 
 // 正方体顶点坐标
 GLfloat cubeVertices[] = {-1.0f,  1.0f, -1.0f, /* 后面 */
@@ -202,33 +182,108 @@ GLushort indices[] = {0, 2, 3,
                       20, 23, 22
 };
 
+// 设置图像（类似lesson2，只在最后多了个加载纹理逻辑）
+extern bool setupGraphics(int width, int height)
+{
+    resetStateCache(); // 新的GL上下文，之前记录的状态都作废了
+    glProgram = createProgram(glVertexShader, glFragmentShader);
+    if (!glProgram)
+    {
+        LOGE ("Could not create program");
+        return false;
+    }
+    vertexLocation = glGetAttribLocation(glProgram, "vertexPosition");
+    textureCordLocation = glGetAttribLocation(glProgram, "vertexTextureCord");
+    projectionLocation = glGetUniformLocation(glProgram, "projection");
+    modelViewLocation = glGetUniformLocation(glProgram, "modelView");
+    samplerLocation = glGetUniformLocation(glProgram, "texture");
+    // 顶点坐标、纹理坐标和索引只在这里上传一次，之后每帧直接使用GPU上的数据
+    MeshAttribute attributes[] = {
+            {vertexLocation, 3, GL_FLOAT, GL_FALSE, cubeVertices, sizeof(cubeVertices)},
+            {textureCordLocation, 2, GL_FLOAT, GL_FALSE, textureCords, sizeof(textureCords)}
+    };
+    if (!createMesh(&cubeMesh, GL_TRIANGLES, attributes, 2, 24, indices, 36, GL_UNSIGNED_SHORT))
+    {
+        return false;
+    }
+    /* 设置视角 */
+    matrixPerspective(projectionMatrix, 45, (float)width / (float)height, 0.1f, 100);
+    cachedEnable(GL_DEPTH_TEST);
+    cachedViewport(0, 0, width, height);
+    /* 加载纹理：先用内置的3x3纹理，文件纹理在后台加载，上传完较小的几级后替换，见TextureStream.cpp */
+    startTextureStreaming();
+    std::string texturePath; // 界面设置的纹理文件（setSceneTextureFile），没有时只用内置的3x3纹理
+    std::string textureFallbackPath;
+    textureHandle = getSceneTextureFile(&texturePath, &textureFallbackPath)
+                    ? requestTexture(texturePath.c_str(), textureFallbackPath.c_str()) : -1;
+    textureId = loadSimpleTexture();
+    if(textureId == 0)
+    {
+        return false;
+    }
+    else
+    {
+        return true;
+    }
+}
+
 float modelViewMatrix[16];
 float angle = 0;
 
 
 extern void renderFrame() {
-    glVertexAttribPointer(textureCordLocation, 2, GL_FLOAT, GL_FALSE, 0, textureCords);
-    glEnableVertexAttribArray(textureCordLocation);
-    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE,projectionMatrix);
-    glUniformMatrix4fv(modelViewLocation, 1, GL_FALSE, modelViewMatrix);
-    /* 设置采样纹理为0，我们只有一个纹理（GL_TEXTURE0）就直接使用 */
-    glUniform1i(samplerLocation, 0);
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // 设置清屏颜色
+    cachedClearColor(0.0f, 0.0f, 0.0f, 1.0f); // 设置清屏颜色（和上一帧一样时不会调用驱动，见StateCache.cpp）
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT); // 清除深度缓冲区和颜色缓冲区
-    matrixIdentityFunction(modelViewMatrix); // 初始化模型视图矩阵
-    matrixRotateX(modelViewMatrix, angle); // 沿X轴旋转
-    matrixRotateY(modelViewMatrix, angle); // 沿Y轴旋转
-    matrixTranslate(modelViewMatrix, 0.0f, 0.0f, -10.0f); // 往Z轴负方向移动10个单位，防止画面太近看不到
-    glUseProgram(glProgram); // 使用程序
-    glVertexAttribPointer(vertexLocation, 3, GL_FLOAT, GL_FALSE, 0, cubeVertices); // 顶点坐标
-    glEnableVertexAttribArray(vertexLocation); // 启用顶点坐标
-    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, projectionMatrix); // 投影矩阵
-    glUniformMatrix4fv(modelViewLocation, 1, GL_FALSE, modelViewMatrix); // 模型视图矩阵
+    // 沿X轴、Y轴旋转，再往Z轴负方向移动10个单位，防止画面太近看不到（直接算出结果，等价于恒等矩阵依次旋转、平移）
+    matrixEulerTransform(modelViewMatrix, angle, angle, 0.0f, 0.0f, 0.0f, -10.0f, 1.0f, 1.0f, 1.0f);
+    cachedUseProgram(glProgram); // 使用程序，uniform是程序的状态，必须在glUseProgram之后设置
+    cachedUniformMatrix4fv(projectionLocation, 1, projectionMatrix); // 投影矩阵（只在setupGraphics里变化，之后每帧都会被省略）
+    cachedUniformMatrix4fv(modelViewLocation, 1, modelViewMatrix); // 模型视图矩阵
+    /* 设置采样纹理为0，我们只有一个纹理（GL_TEXTURE0）就直接使用 */
+    cachedUniform1i(samplerLocation, 0);
+    /* 在预算内上传后台解析好的mipmap，文件纹理可用后替换内置纹理 */
+    pumpTextureUploads(textureUploadBudgetMilliseconds);
+    GLuint streamedTexture = 0;
+    StreamedTextureState state = getStreamedTexture(textureHandle, &streamedTexture);
+    cachedActiveTexture(GL_TEXTURE0);
+    cachedBindTexture(GL_TEXTURE_2D, state == TEXTURE_PARTIAL || state == TEXTURE_COMPLETE ? streamedTexture : textureId);
     // 这里不能用glDrawArrays来画，因为它需要所有的点都被定义，而我们只定义了24个点，而不是36个点（只绘制了我们能看到的面）
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, indices); // 绘制
+    drawMesh(&cubeMesh); // 绑定网格并绘制（内部是glDrawElements）
     angle += 1; // 旋转角度
     if (angle > 360)
     {
         angle -= 360;
     }
-}
\ No newline at end of file
+}
+
+extern void resizeGraphics(int width, int height)
+{
+    matrixPerspective(projectionMatrix, 45, (float)width / (float)height, 0.1f, 100);
+    cachedViewport(0, 0, width, height);
+}
+
+extern void teardownGraphics()
+{
+    /*
+     * 先停止流式加载，丢掉还没上传完的部分，再删掉TextureStream创建的纹理。上传到一半时状态还是PENDING，
+     * 但纹理对象已经创建了，所以不管状态如何，只要有纹理就删掉
+     */
+    stopTextureStreaming();
+    GLuint streamedTexture = 0;
+    getStreamedTexture(textureHandle, &streamedTexture);
+    if (streamedTexture != 0)
+    {
+        cachedDeleteTextures(1, &streamedTexture);
+    }
+    textureHandle = -1;
+    cachedDeleteTextures(1, &textureId);
+    textureId = 0;
+    cachedDeleteProgram(glProgram);
+    glProgram = 0;
+    deleteMesh(&cubeMesh);
+}
+
+// 注册场景，选中时才加载这个库，见SceneRegistry.cpp
+static const Scene textureCubeScene = {"TextureCube", setupGraphics, resizeGraphics, renderFrame, teardownGraphics,
+                                       NULL, 0, NULL, NULL};
+static SceneRegistration textureCubeRegistration(&textureCubeScene);
@@ -15,9 +15,17 @@
  * 镜面反射：根据光的入射角和我们的视角反向的向量点积计算夹角，然后乘镜面反射光照常量计算光强
 */
 
-#include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
 #include "../include/CameraUtil.h"
+#include "../include/FrameProfiler.h"
+#include "../include/Light.h"
 #include "../include/LoadUtil.h"
+#include "../include/MeshUtil.h"
+#include "../include/Scene.h"
+#include "../include/ShaderVariant.h"
+#include "../include/StateCache.h"
+#include "../include/UniformBlocks.h"
+#include "../include/VertexFormat.h"
 #include "../include/LogUtil.h"
 
 // 顶点坐标，我们每个面加一个特殊的点，这样我们就可以计算出每个面的法线了
@@ -148,45 +156,19 @@ GLushort indices[] = {0,  2,  4,/* 后面 */
 
 
 // 下面是cube绘制
-// 顶点着色器
-static const char  glVertexShader[] =
-        "attribute vec3 vertexNormal;\n" // 顶点法线
-        "attribute vec4 vertexPosition;\n" // 顶点坐标
-        "attribute vec3 vertexColour;\n" // 顶点颜色
-        "varying vec3 fragColour;\n" // 用于传递给片段着色器颜色（varying用于传递属性给片段着色器）
-        "uniform mat4 projection;\n" // 投影矩阵（uniform类似全局变量，可在顶点着色器和块着色器中被访问，但在其中不能被修改）
-        "uniform mat4 modelView;\n" // 模型矩阵
-        "void main()\n"
-        "{\n"
-        "    vec3 transformedVertexNormal = normalize((modelView * vec4(vertexNormal, 0.0)).xyz);" // 用模型矩阵来转换顶点法线
-        "    vec3 inverseLightDirection = normalize(vec3(0.0, 1.0, 1.0));\n" // 入射光反转（我们需要一个往外发散的向量表示反射出的光的向量）
-        "    fragColour = vec3(0.0);\n" // 初始化颜色，后续根据光照各种反射模型来累加
-        "    vec3 diffuseLightIntensity = vec3(1.0, 1.0, 1.0);\n" // 漫反射光强度初始化（这个例子中用的白光）
-        "    vec3 vertexDiffuseReflectionConstant = vertexColour;\n" // 表示漫反射光的颜色常量
-        "    float normalDotLight = max(0.0, dot(transformedVertexNormal, inverseLightDirection));\n" // 点乘计算出法线和光线的夹角，cos值，和0.0做max方法过滤掉负值（反射光在背面的值）
-        "    fragColour += normalDotLight * vertexDiffuseReflectionConstant * diffuseLightIntensity;\n" // 角度*颜色常量*强度，得到漫反射光的颜色，累加到块颜色中
-        "    vec3 ambientLightIntensity = vec3(0.1, 0.1, 0.1);\n" // 环境光强度初始化
-        "    vec3 vertexAmbientReflectionConstant = vertexColour;\n" // 表示环境光的颜色常量，这个例子中用vertexColour简单表示，通常这个值需要单独指定颜色
-        "    fragColour += vertexAmbientReflectionConstant * ambientLightIntensity;\n" // 环境光颜色*环境光强度，得到环境光的颜色，累加到块颜色中，这个颜色是统一的，不会随着角度或视角变化
-        "    vec3 inverseEyeDirection = normalize(vec3(0.0, 0.0, 1.0));\n" // 反转后的视角方向，这个例子简单使用了一个固定的视角，通常这个值需要根据相机矩阵计算
-        "    vec3 specularLightIntensity = vec3(1.0, 1.0, 1.0);\n" // 镜面反射光强度
-        "    vec3 vertexSpecularReflectionConstant = vec3(1.0, 1.0, 1.0);\n" // 镜面反射光的颜色常量，这里不像上面环境光和漫反射光一样用顶点颜色，而是用白光，因为反射到视角中的光是白光
-        "    float shininess = 2.0;\n" // 指数，用于计算镜面反射光的强度，因为我们点积的值都是0-1之间的，所以这个值越大（反射的向量与视角的夹角越大），镜面反射光的结果越小
-        "    vec3 lightReflectionDirection = reflect(vec3(0) - inverseLightDirection, transformedVertexNormal);\n" // 使用reflect接口计算反射光的方向
-        "    float normalDotReflection = max(0.0, dot(inverseEyeDirection, lightReflectionDirection));\n" // 点积计算反射光和视角的夹角
-        "    fragColour += pow(normalDotReflection, shininess) * vertexSpecularReflectionConstant * specularLightIntensity;\n" // 角度*颜色常量*强度，得到镜面反射光的颜色，累加到块颜色中
-        "    clamp(fragColour, 0.0, 1.0);\n" // 确保颜色在0-1之间
-        "    gl_Position = projection * modelView * vertexPosition;\n" // GL坐标设置成投影矩阵和模型视图矩阵的乘积
-        "}\n";
-
-// 块着色器
-static const char  glFragmentShader[] =
-        "precision mediump float;\n" // 设置精度
-        "varying vec3 fragColour;\n" // 从顶点着色器传递过来的颜色（vec3没有透明属性）
-        "void main()\n"
-        "{\n"
-        "    gl_FragColor = vec4(fragColour, 1.0);\n" // 设置颜色（1.0设置的是透明属性）
-        "}\n";
+// 着色器不再写死：Phong光照写成了带#ifdef的模板（见ShaderVariant.cpp里的phongTemplate），按材质需要的功能
+// （逐顶点/逐像素、镜面反射、纹理）编译对应的变体。光线方向、视角方向、光强这些对所有顶点都一样的量不再在着色器里
+// 重复计算，而是每帧在CPU上算好作为uniform传进来。
+// GLES3上投影矩阵、光照参数和模型视图矩阵放在共享的uniform块里（见UniformBlocks.cpp），不再逐个glUniform*，
+// 以后场景里有多个程序时，切换程序不需要重新上传相机和光照；GLES2上仍然用单独的uniform。
+
+// 立方体的材质：白色高光，没有纹理，逐顶点光照就够了
+static const LightingMaterial cubeMaterial = {{1.0f, 1.0f, 1.0f}, 2.0f, 0, false};
+static const float inverseLightDirection[3] = {0.0f, 1.0f, 1.0f};
+static const float inverseEyeDirection[3] = {0.0f, 0.0f, 1.0f};
+static const float ambientLightIntensity[3] = {0.1f, 0.1f, 0.1f};
+static const float diffuseLightIntensity[3] = {1.0f, 1.0f, 1.0f};
+static const float specularLightIntensity[3] = {1.0f, 1.0f, 1.0f};
 
 GLuint lightProgram;
 GLint vertexLocation;
@@ -194,12 +176,19 @@ GLint vertexNormalLocation; // 顶点法线缓存
 GLint vertexColourLocation;
 GLint projectionLocation;
 GLint modelViewLocation;
+LightingLocations lightingLocations;
+bool lightUniformBlocks; // 使用uniform块的变体
 float projectionMatrix[16];
+Mesh lightCubeMesh; // 上传到GPU的正方体网格，见MeshUtil.cpp
 
 // 顶点坐标
 extern bool setupGraphics(int width, int height)
 {
-    lightProgram = createProgram(glVertexShader, glFragmentShader);
+    resetStateCache(); // 新的GL上下文，之前记录的状态都作废了
+    resetShaderVariants();
+    lightUniformBlocks = uniformBlocksSupported() && initUniformBlocks(16);
+    unsigned int features = materialShaderFeatures(&cubeMaterial); // 材质需要的最便宜的变体
+    lightProgram = getShaderVariant(&phongTemplate, features | (lightUniformBlocks ? SHADER_UNIFORM_BLOCKS : 0));
     if (lightProgram == 0)
     {
         LOGE ("Could not create program");
@@ -210,37 +199,130 @@ extern bool setupGraphics(int width, int height)
     vertexNormalLocation = glGetAttribLocation(lightProgram, "vertexNormal"); // 获取顶点法线坐标
     projectionLocation = glGetUniformLocation(lightProgram, "projection"); // 获取投影矩阵
     modelViewLocation = glGetUniformLocation(lightProgram, "modelView"); // 获取模型视图矩阵
+    getLightingLocations(lightProgram, &lightingLocations); // 光照参数
+    // 顶点坐标、颜色、法线和索引只在这里上传一次，之后每帧直接使用GPU上的数据。
+    // 三个属性交错存放并量化：位置用half，法线用10:10:10:2，颜色用8位，每个顶点从36字节变成16字节，见VertexFormat.cpp。
+    // 立方体的坐标、法线分量和颜色都是0和±1，量化后没有误差，着色器也不需要修改。
+    // GLES2上下文不支持half和10:10:10:2，位置退回float，法线用8位，每个顶点20字节。
+    bool packed = packedVertexFormatsSupported();
+    VertexLayout layout;
+    initVertexLayout(&layout);
+    addVertexElement(&layout, vertexLocation, 3, packed ? VERTEX_HALF : VERTEX_FLOAT);
+    addVertexElement(&layout, vertexNormalLocation, 3, packed ? VERTEX_INT_2_10_10_10 : VERTEX_SNORM8);
+    addVertexElement(&layout, vertexColourLocation, 3, VERTEX_UNORM8);
+    const float* sources[] = {vertices, normals, colour};
+    unsigned char packedVertices[30 * 20];
+    packVertices(&layout, sources, 30, packedVertices);
+    if (!createInterleavedMesh(&lightCubeMesh, GL_TRIANGLES, &layout, packedVertices, 30, indices, 72, GL_UNSIGNED_SHORT))
+    {
+        return false;
+    }
     matrixPerspective(projectionMatrix, 45, (float)width / (float)height, 0.1f, 100);
-    glEnable(GL_DEPTH_TEST); // 开启深度测试，告知OpenGL ES显示时需要考虑深度
-    glViewport(0, 0, width, height);
+    cachedEnable(GL_DEPTH_TEST); // 开启深度测试，告知OpenGL ES显示时需要考虑深度
+    cachedViewport(0, 0, width, height);
     return true;
 }
 
-float angle = 0;
-float modelViewMatrix[16];
+float angle = 0; // 场景状态，只由updateScene修改
 
-// 渲染帧
-extern void renderFrame()
+// 按固定步长推进场景（每秒转60度），可以在模拟线程上调用，见SimulationUtil.cpp
+extern void updateScene(double stepSeconds)
 {
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // 设置清屏颜色
-    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT); // 清除深度缓冲区和颜色缓冲区
-    matrixIdentityFunction(modelViewMatrix); // 初始化模型视图矩阵
-    matrixRotateX(modelViewMatrix, angle); // 沿X轴旋转
-    matrixRotateY(modelViewMatrix, angle); // 沿Y轴旋转
-    matrixTranslate(modelViewMatrix, 0.0f, 0.0f, -10.0f); // 往Z轴负方向移动10个单位，防止画面太近看不到
-    glUseProgram(lightProgram); // 使用程序
-    glVertexAttribPointer(vertexLocation, 3, GL_FLOAT, GL_FALSE, 0, vertices); // 顶点坐标
-    glEnableVertexAttribArray(vertexLocation); // 启用顶点坐标
-    glVertexAttribPointer(vertexColourLocation, 3, GL_FLOAT, GL_FALSE, 0, colour); // 顶点颜色
-    glEnableVertexAttribArray(vertexColourLocation); // 启用顶点颜色
-    glVertexAttribPointer(vertexNormalLocation, 3, GL_FLOAT, GL_FALSE, 0, normals); // 法线坐标
-    glEnableVertexAttribArray(vertexNormalLocation); // 启用顶点法线坐标
-    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, projectionMatrix); // 投影矩阵
-    glUniformMatrix4fv(modelViewLocation, 1, GL_FALSE, modelViewMatrix); // 模型视图矩阵
-    glDrawElements(GL_TRIANGLES, 72, GL_UNSIGNED_SHORT, indices); // 绘制
-    angle += 1; // 旋转角度
+    angle += (float) (60.0 * stepSeconds); // 旋转角度
     if (angle > 360)
     {
         angle -= 360;
     }
-}
\ No newline at end of file
+}
+
+// 把渲染需要的数据写入快照，和updateScene在同一个线程上调用
+extern void writeSnapshot(LightSnapshot* snapshot)
+{
+    // 沿X轴、Y轴旋转，再往Z轴负方向移动10个单位，防止画面太近看不到（直接算出结果，等价于恒等矩阵依次旋转、平移）
+    matrixEulerTransform(snapshot->modelViewMatrix, angle, angle, 0.0f, 0.0f, 0.0f, -10.0f, 1.0f, 1.0f, 1.0f);
+}
+
+// 提交一份快照，只读快照和GL对象，不访问场景状态。各阶段分别计时，见FrameProfiler.cpp
+extern void renderSnapshot(const LightSnapshot* snapshot)
+{
+    beginFramePhase(FRAME_PHASE_CLEAR);
+    cachedClearColor(0.0f, 0.0f, 0.0f, 1.0f); // 设置清屏颜色（和上一帧一样时不会调用驱动，见StateCache.cpp）
+    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT); // 清除深度缓冲区和颜色缓冲区
+    endFramePhase(FRAME_PHASE_CLEAR);
+    beginFramePhase(FRAME_PHASE_STATE);
+    cachedUseProgram(lightProgram); // 使用程序
+    endFramePhase(FRAME_PHASE_STATE);
+    beginFramePhase(FRAME_PHASE_MATRIX);
+    // 光照参数每帧在CPU上算一次（这个例子里一直不变，第一帧之后都会被省略）
+    LightingUniforms lighting;
+    computeLightingUniforms(&lighting, inverseLightDirection, inverseEyeDirection, ambientLightIntensity,
+                            diffuseLightIntensity, specularLightIntensity, &cubeMaterial);
+    if (lightUniformBlocks)
+    {
+        beginUniformFrame();
+        updateCameraBlock(projectionMatrix, NULL); // 模型视图矩阵里已经包含视图变换，内容不变时不上传
+        updateLightingBlock(&lighting);
+        bindObjectBlock(writeObjectBlock(snapshot->modelViewMatrix)); // 这一帧的模型视图矩阵写进流式缓冲区
+    }
+    else
+    {
+        cachedUniformMatrix4fv(projectionLocation, 1, projectionMatrix); // 投影矩阵（只在setupGraphics里变化，之后每帧都会被省略）
+        cachedUniformMatrix4fv(modelViewLocation, 1, snapshot->modelViewMatrix); // 模型视图矩阵
+        applyLightingUniforms(&lightingLocations, &lighting);
+    }
+    endFramePhase(FRAME_PHASE_MATRIX);
+    beginFramePhase(FRAME_PHASE_DRAW);
+    drawMesh(&lightCubeMesh); // 绑定网格并绘制（内部是glDrawElements）
+    if (lightUniformBlocks)
+    {
+        endUniformFrame();
+    }
+    endFramePhase(FRAME_PHASE_DRAW);
+}
+
+LightSnapshot frameSnapshot;
+
+// 渲染帧：单线程版本，每帧推进1/60秒（转1度），供不启动模拟线程的宿主工具使用
+extern void renderFrame()
+{
+    beginFrameProfile();
+    beginFramePhase(FRAME_PHASE_MATRIX);
+    writeSnapshot(&frameSnapshot);
+    endFramePhase(FRAME_PHASE_MATRIX);
+    renderSnapshot(&frameSnapshot);
+    endFrameProfile();
+    updateScene(1.0 / 60.0);
+}
+
+extern void resizeGraphics(int width, int height)
+{
+    matrixPerspective(projectionMatrix, 45, (float)width / (float)height, 0.1f, 100);
+    cachedViewport(0, 0, width, height);
+}
+
+extern void teardownGraphics()
+{
+    deleteShaderVariants(); // lightProgram是其中一个变体
+    lightProgram = 0;
+    if (lightUniformBlocks)
+    {
+        deleteUniformBlocks();
+        lightUniformBlocks = false;
+    }
+    deleteMesh(&lightCubeMesh);
+}
+
+static void writeLightSnapshot(void* snapshot)
+{
+    writeSnapshot((LightSnapshot*) snapshot);
+}
+
+static void renderLightSnapshot(const void* snapshot)
+{
+    renderSnapshot((const LightSnapshot*) snapshot);
+}
+
+// 注册场景，选中时才加载这个库，见SceneRegistry.cpp。场景在模拟线程上更新，渲染线程只提交快照
+static const Scene lightScene = {"Light", setupGraphics, resizeGraphics, renderFrame, teardownGraphics,
+                                 updateScene, sizeof(LightSnapshot), writeLightSnapshot, renderLightSnapshot};
+static SceneRegistration lightRegistration(&lightScene);
@@ -0,0 +1,380 @@
+/**
+ * lesson2画了一个立方体：一个modelView uniform，一次glDrawElements。如果要画几千上万个相同的立方体，
+ * 最直接的做法是循环设置modelView再绘制，每个立方体两次GL调用，CPU时间基本都花在驱动上，GPU反而在等。
+ *
+ * GLES3的实例化绘制（instancing）解决的就是这个问题：
+ *    - 把每个立方体的模型视图矩阵放进一个顶点属性缓冲区，着色器里的uniform mat4 modelView换成attribute mat4
+ *    - 用glVertexAttribDivisor让这个属性每个实例前进一次，而不是每个顶点前进一次
+ *    - 一次glDrawElementsInstanced画出全部立方体，gl_InstanceID从0开始递增
+ * 每帧只需要算好所有矩阵（matrixEulerTransformBatch一次算一批）、上传一次缓冲区、绘制一次。
+ *
+ * 看不见的立方体没有必要画，每帧先用视锥剔除（CullUtil.cpp）找出可见的立方体，只为它们计算矩阵和上传。
+ * 矩阵不先算到CPU数组里再上传，而是在环形流式缓冲区（StreamBuffer.cpp）里分配这一帧的空间，直接算到映射出来的内存里，
+ * 实例属性指针改为指向这一帧的偏移。
+ *
+ * 这节课的立方体数据和着色器与lesson2相同，只把modelView换成了每实例属性。立方体排成一个网格，各自以不同的相位旋转。
+ * setInstanceCount可以把数量调到十万个做压力测试，setInstancingEnabled(false)退回每个立方体一次绘制的做法，
+ * GLES2上下文不支持实例化，也会使用这种做法（用glVertexAttrib4fv设置属性的常量值，着色器不需要修改）。
+ */
+
+#include <cmath>
+#include <vector>
+#include <GLES3/gl3.h>
+#include "../include/InstancedCube.h"
+#include "../include/LoadUtil.h"
+#include "../include/LogUtil.h"
+#include "../include/CameraUtil.h"
+#include "../include/CullUtil.h"
+#include "../include/MeshUtil.h"
+#include "../include/Scene.h"
+#include "../include/StateCache.h"
+#include "../include/StreamBuffer.h"
+
+// 顶点着色器，与lesson2相同，只是modelView从uniform变成了每实例的属性
+static const char  glVertexShader[] =
+        "attribute vec4 vertexPosition;\n" // 顶点坐标
+        "attribute vec3 vertexColour;\n" // 顶点颜色
+        "attribute mat4 instanceModelView;\n" // 每个实例的模型视图矩阵，占用4个属性位置，每个位置一列
+        "varying vec3 fragColour;\n" // 用于传递给片段着色器颜色
+        "uniform mat4 projection;\n" // 投影矩阵
+        "void main()\n"
+        "{\n"
+        "    gl_Position = projection * instanceModelView * vertexPosition;\n"
+        "    fragColour = vertexColour;\n"
+        "}\n";
+
+// 块着色器
+static const char  glFragmentShader[] =
+        "precision mediump float;\n" // 设置精度
+        "varying vec3 fragColour;\n" // 从顶点着色器传递过来的颜色
+        "void main()\n"
+        "{\n"
+        "    gl_FragColor = vec4(fragColour, 1.0);\n"
+        "}\n";
+
+GLuint instancedCubeProgram;
+GLint vertexLocation;
+GLint vertexColourLocation;
+GLint instanceModelViewLocation;
+GLint projectionLocation;
+float projectionMatrix[16];
+Mesh cubeMesh; // 逐个绘制用的网格
+Mesh instancedCubeMesh; // 同样的数据，VAO里多了每实例矩阵属性
+InstanceBuffer cubeInstances;
+StreamBuffer instanceStream; // 每帧的实例矩阵，3段，CPU最多领先GPU两帧
+bool instancingSupported;
+bool instancingEnabled = true;
+bool instanceStreamingEnabled = true;
+
+// 正方体矩阵，一个面由两个三角、六个点构成(范围0-1)
+GLfloat cubeVertices[] = {-1.0f,  1.0f, -1.0f, /* Back. */
+                          1.0f,  1.0f, -1.0f,
+                          -1.0f, -1.0f, -1.0f,
+                          1.0f, -1.0f, -1.0f,
+                          -1.0f,  1.0f,  1.0f, /* Front. */
+                          1.0f,  1.0f,  1.0f,
+                          -1.0f, -1.0f,  1.0f,
+                          1.0f, -1.0f,  1.0f,
+                          -1.0f,  1.0f, -1.0f, /* Left. */
+                          -1.0f, -1.0f, -1.0f,
+                          -1.0f, -1.0f,  1.0f,
+                          -1.0f,  1.0f,  1.0f,
+                          1.0f,  1.0f, -1.0f, /* Right. */
+                          1.0f, -1.0f, -1.0f,
+                          1.0f, -1.0f,  1.0f,
+                          1.0f,  1.0f,  1.0f,
+                          -1.0f, -1.0f, -1.0f, /* Top. */
+                          -1.0f, -1.0f,  1.0f,
+                          1.0f, -1.0f,  1.0f,
+                          1.0f, -1.0f, -1.0f,
+                          -1.0f,  1.0f, -1.0f, /* Bottom. */
+                          -1.0f,  1.0f,  1.0f,
+                          1.0f,  1.0f,  1.0f,
+                          1.0f,  1.0f, -1.0f
+};
+
+// 每个点的颜色，一行代表一组RGB值(范围0-1)
+GLfloat colour[] = {1.0f, 0.0f, 0.0f,
+                    1.0f, 0.0f, 0.0f,
+                    1.0f, 0.0f, 0.0f,
+                    1.0f, 0.0f, 0.0f,
+                    0.0f, 1.0f, 0.0f,
+                    0.0f, 1.0f, 0.0f,
+                    0.0f, 1.0f, 0.0f,
+                    0.0f, 1.0f, 0.0f,
+                    0.0f, 0.0f, 1.0f,
+                    0.0f, 0.0f, 1.0f,
+                    0.0f, 0.0f, 1.0f,
+                    0.0f, 0.0f, 1.0f,
+                    1.0f, 1.0f, 0.0f,
+                    1.0f, 1.0f, 0.0f,
+                    1.0f, 1.0f, 0.0f,
+                    1.0f, 1.0f, 0.0f,
+                    0.0f, 1.0f, 1.0f,
+                    0.0f, 1.0f, 1.0f,
+                    0.0f, 1.0f, 1.0f,
+                    0.0f, 1.0f, 1.0f,
+                    1.0f, 0.0f, 1.0f,
+                    1.0f, 0.0f, 1.0f,
+                    1.0f, 0.0f, 1.0f,
+                    1.0f, 0.0f, 1.0f
+};
+
+// 绘制的点
+GLushort indices[] = {0, 2, 3,
+                      0, 1, 3,
+                      4, 6, 7,
+                      4, 5, 7,
+                      8, 9, 10,
+                      11, 8, 10,
+                      12, 13, 14,
+                      15, 12, 14,
+                      16, 17, 18,
+                      16, 19, 18,
+                      20, 21, 22,
+                      20, 23, 22
+};
+
+// 每个实例的变换，结构数组（SoA）的形式方便matrixEulerTransformBatch批量计算
+int instanceCount = 0;
+std::vector<float> instanceAngleZ; // 只绕X轴和Y轴旋转，全部为0
+std::vector<float> instancePhase; // 每个立方体旋转角度的偏移，让它们看起来不一样
+std::vector<float> instanceX;
+std::vector<float> instanceY;
+std::vector<float> instanceZ;
+std::vector<float> instanceScale;
+std::vector<float> instanceMatrices;
+std::vector<float> instanceSinCos;
+// 剔除后可见的立方体，变换按可见顺序重新排成SoA
+CullHierarchy instanceHierarchy;
+std::vector<BoundingSphere> instanceBounds;
+std::vector<int> visibleInstances;
+std::vector<float> visibleAngles;
+std::vector<float> visibleX;
+std::vector<float> visibleY;
+std::vector<float> visibleZ;
+std::vector<float> visibleScale;
+CullStats instanceCullStats;
+
+/**
+ * 设置立方体个数，立方体排成边长为ceil(cbrt(count))的网格，整个网格的大小固定，数量越多立方体越小
+ */
+void setInstanceCount(int count)
+{
+    if (count < 1)
+    {
+        count = 1;
+    }
+    instanceCount = count;
+    instanceAngleZ.assign(count, 0.0f);
+    instancePhase.resize(count);
+    instanceX.resize(count);
+    instanceY.resize(count);
+    instanceZ.resize(count);
+    instanceScale.resize(count);
+    instanceMatrices.resize((size_t) count * 16);
+    instanceSinCos.resize((size_t) count * 6);
+    instanceBounds.resize(count);
+    visibleInstances.resize(count);
+    visibleAngles.resize(count);
+    visibleX.resize(count);
+    visibleY.resize(count);
+    visibleZ.resize(count);
+    visibleScale.resize(count);
+    int side = (int) ceilf(cbrtf((float) count));
+    while (side * side * side < count) // cbrtf的舍入误差
+    {
+        side++;
+    }
+    const float gridSize = 8.0f;
+    float spacing = gridSize / side;
+    for (int i = 0; i < count; i++)
+    {
+        int x = i % side;
+        int y = (i / side) % side;
+        int z = i / (side * side);
+        instanceX[i] = (x - (side - 1) * 0.5f) * spacing;
+        instanceY[i] = (y - (side - 1) * 0.5f) * spacing;
+        instanceZ[i] = (z - (side - 1) * 0.5f) * spacing - 20.0f; // 往Z轴负方向移动，整个网格都在视野里
+        instanceScale[i] = spacing * 0.3f; // 立方体边长是2，留出间隙
+        instancePhase[i] = (float) ((i * 37) % 360);
+        BoundingSphere bounds = {instanceX[i], instanceY[i], instanceZ[i], instanceScale[i] * 1.7320508f}; // 边长2的立方体，半对角线是sqrt(3)
+        instanceBounds[i] = bounds;
+    }
+    buildCullHierarchy(&instanceHierarchy, &instanceBounds[0], count); // 立方体只旋转不移动，层次只需要建一次
+}
+
+void getInstanceCullStats(CullStats* stats)
+{
+    *stats = instanceCullStats;
+}
+
+void setInstancingEnabled(bool enabled)
+{
+    instancingEnabled = enabled;
+}
+
+void setInstanceStreamingEnabled(bool enabled)
+{
+    instanceStreamingEnabled = enabled;
+}
+
+void getInstanceStreamStats(StreamBufferStats* stats)
+{
+    *stats = instanceStream.stats;
+}
+
+void resetInstanceStreamStats()
+{
+    resetStreamBufferStats(&instanceStream);
+}
+
+// 流式缓冲区每段放得下count个矩阵，不够时重新创建（旧缓冲区里GPU还没读完的数据由驱动保留）
+static bool reserveInstanceStream(int count)
+{
+    GLsizeiptr bytes = (GLsizeiptr) count * 16 * sizeof(float);
+    if (instanceStream.buffer == 0 || bytes <= instanceStream.frameBytes)
+    {
+        return instanceStream.buffer != 0;
+    }
+    StreamBufferStats stats = instanceStream.stats;
+    deleteStreamBuffer(&instanceStream);
+    bool created = createStreamBuffer(&instanceStream, GL_ARRAY_BUFFER, bytes + bytes / 2, 3);
+    instanceStream.stats = stats; // 统计跨越重新创建
+    return created;
+}
+
+extern bool setupGraphics(int width, int height)
+{
+    resetStateCache(); // 新的GL上下文，之前记录的状态都作废了
+    instancedCubeProgram = createProgram(glVertexShader, glFragmentShader);
+    if (instancedCubeProgram == 0)
+    {
+        LOGE ("Could not create program");
+        return false;
+    }
+    vertexLocation = glGetAttribLocation(instancedCubeProgram, "vertexPosition");
+    vertexColourLocation = glGetAttribLocation(instancedCubeProgram, "vertexColour");
+    instanceModelViewLocation = glGetAttribLocation(instancedCubeProgram, "instanceModelView");
+    projectionLocation = glGetUniformLocation(instancedCubeProgram, "projection");
+    MeshAttribute attributes[] = {
+            {vertexLocation, 3, GL_FLOAT, GL_FALSE, cubeVertices, sizeof(cubeVertices)},
+            {vertexColourLocation, 3, GL_FLOAT, GL_FALSE, colour, sizeof(colour)}
+    };
+    if (!createMesh(&cubeMesh, GL_TRIANGLES, attributes, 2, 24, indices, 36, GL_UNSIGNED_SHORT))
+    {
+        return false;
+    }
+    // 实例化需要GLES3，不支持时只用cubeMesh逐个绘制
+    instancingSupported = createMesh(&instancedCubeMesh, GL_TRIANGLES, attributes, 2, 24, indices, 36, GL_UNSIGNED_SHORT)
+                          && attachInstanceMatrices(&instancedCubeMesh, &cubeInstances, instanceModelViewLocation, 1024);
+    if (instancingSupported)
+    {
+        createStreamBuffer(&instanceStream, GL_ARRAY_BUFFER, 1024 * 16 * sizeof(float), 3); // 失败时用orphan上传
+    }
+    if (instanceCount == 0)
+    {
+        setInstanceCount(1000);
+    }
+    matrixPerspective(projectionMatrix, 45, (float)width / (float)height, 0.1f, 100);
+    cachedEnable(GL_DEPTH_TEST);
+    cachedViewport(0, 0, width, height);
+    return true;
+}
+
+float angle = 0;
+
+extern void renderFrame()
+{
+    cachedClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+    // 模型视图矩阵里的视图部分是单位矩阵，投影矩阵的视锥平面就是世界坐标中的平面
+    Frustum frustum;
+    extractFrustumPlanes(&frustum, projectionMatrix);
+    int visibleCount = cullHierarchy(&instanceHierarchy, &frustum, &visibleInstances[0], &instanceCullStats);
+    for (int v = 0; v < visibleCount; v++)
+    {
+        int i = visibleInstances[v];
+        visibleAngles[v] = angle + instancePhase[i];
+        visibleX[v] = instanceX[i];
+        visibleY[v] = instanceY[i];
+        visibleZ[v] = instanceZ[i];
+        visibleScale[v] = instanceScale[i];
+    }
+    TransformArrays transforms = {
+            &visibleAngles[0], &visibleAngles[0], &instanceAngleZ[0],
+            &visibleX[0], &visibleY[0], &visibleZ[0],
+            &visibleScale[0], &visibleScale[0], &visibleScale[0]
+    };
+    bool instanced = instancingSupported && instancingEnabled;
+    bool streamed = false;
+    float* matrices = &instanceMatrices[0];
+    GLintptr streamOffset = 0;
+    if (instanced && instanceStreamingEnabled && visibleCount > 0 && reserveInstanceStream(visibleCount))
+    {
+        beginStreamFrame(&instanceStream); // GPU还在读这一段时在这里等待
+        float* mapped = (float*) streamAllocate(&instanceStream, (GLsizeiptr) visibleCount * 16 * sizeof(float),
+                                                16, &streamOffset);
+        if (mapped != NULL)
+        {
+            matrices = mapped;
+            streamed = true;
+        }
+    }
+    matrixEulerTransformBatch(matrices, &transforms, visibleCount, &instanceSinCos[0]);
+    cachedUseProgram(instancedCubeProgram);
+    cachedUniformMatrix4fv(projectionLocation, 1, projectionMatrix);
+    if (streamed)
+    {
+        unmapStreamBuffer(&instanceStream);
+        pointInstanceMatrices(&instancedCubeMesh, &cubeInstances, instanceStream.buffer, streamOffset);
+        drawMeshInstanced(&instancedCubeMesh, visibleCount); // 一次绘制全部可见立方体
+        endStreamFrame(&instanceStream);
+    }
+    else if (instanced)
+    {
+        pointInstanceMatrices(&instancedCubeMesh, &cubeInstances, cubeInstances.buffer, 0);
+        updateInstanceMatrices(&cubeInstances, &instanceMatrices[0], visibleCount); // 一次上传全部可见立方体的矩阵
+        drawMeshInstanced(&instancedCubeMesh, visibleCount);
+    }
+    else
+    {
+        // 属性没有启用数组时使用glVertexAttrib设置的常量值，mat4的每一列是一个属性
+        for (int i = 0; i < visibleCount; i++)
+        {
+            const float* matrix = &instanceMatrices[(size_t) i * 16];
+            for (int column = 0; column < 4; column++)
+            {
+                glVertexAttrib4fv(instanceModelViewLocation + column, matrix + column * 4);
+            }
+            drawMesh(&cubeMesh);
+        }
+    }
+    angle += 1;
+    if (angle > 360)
+    {
+        angle -= 360;
+    }
+}
+
+extern void resizeGraphics(int width, int height)
+{
+    matrixPerspective(projectionMatrix, 45, (float)width / (float)height, 0.1f, 100);
+    cachedViewport(0, 0, width, height);
+}
+
+extern void teardownGraphics()
+{
+    cachedDeleteProgram(instancedCubeProgram);
+    instancedCubeProgram = 0;
+    deleteInstanceBuffer(&cubeInstances);
+    deleteStreamBuffer(&instanceStream);
+    deleteMesh(&instancedCubeMesh);
+    deleteMesh(&cubeMesh);
+    instancingSupported = false;
+}
+
+// 注册场景，选中时才加载这个库，见SceneRegistry.cpp
+static const Scene instancedCubeScene = {"InstancedCube", setupGraphics, resizeGraphics, renderFrame,
+                                         teardownGraphics, NULL, 0, NULL, NULL};
+static SceneRegistration instancedCubeRegistration(&instancedCubeScene);
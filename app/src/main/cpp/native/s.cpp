@@ -0,0 +1,484 @@
+#include <cstdlib>
+#include <cmath>
+
+#include "../include/SimdUtil.h"
+#include "../include/CameraUtil.h"
+
+// 用于定义恒等函数，恒等函数是为了初始化时所使用的矩阵与该矩阵相乘结果为其本身（不会平移、旋转或缩放）。
+// 数学计算中，我们习惯设置矩阵是横向摆放数据，OpenGL中是竖向的所以下面的矩阵数学表示为：
+//   1.0f, 0.0f, 0.0f, 0.0f # x = 0
+//   0.0f, 1.0f, 0.0f, 0.0f # y = 0
+//   0.0f, 0.0f, 1.0f, 0.0f # z = 0
+//   0.0f, 0.0f, 0.0f, 1.0f # w = 1 //多出来的一维，为了上面三个纬度描述矩阵运动而凑整
+// 如果不习惯OpenGL的摆放方式，可以自己做一下矩阵转换。
+void matrixIdentityFunction(float* matrix)
+{
+    if(matrix == NULL)
+    {
+        return;
+    }
+    matrix[0] = 1.0f;
+    matrix[1] = 0.0f;
+    matrix[2] = 0.0f;
+    matrix[3] = 0.0f;
+    matrix[4] = 0.0f;
+    matrix[5] = 1.0f;
+    matrix[6] = 0.0f;
+    matrix[7] = 0.0f;
+    matrix[8] = 0.0f;
+    matrix[9] = 0.0f;
+    matrix[10] = 1.0f;
+    matrix[11] = 0.0f;
+    matrix[12] = 0.0f;
+    matrix[13] = 0.0f;
+    matrix[14] = 0.0f;
+    matrix[15] = 1.0f;
+}
+
+// 4x4矩阵乘法的实现（这里为什么三维的矩阵也有第4列呢？是因为无值默认给0了）
+// 两个for循环遍历1的每一行，然后遍历2的每一列，相乘后相加，并把结果放到结果矩阵相应位置中。
+// 值得注意的是为什么我们新建了个缓存矩阵来存计算的结果，这是因为所有传入的参数都是指针，
+// 如果传入的destination指针跟operand1或operand2指针相同时，我们直接修改其内容，会导致不可预期的结果。
+// 有SIMD时换一种写法：结果的第i列 = operand1的4列分别乘operand2第i列的4个数再相加，
+// 一次算4个数，相加顺序和标量循环一样。4列全部算完放在寄存器里才写回，所以同样不怕指针重叠。
+void sMul(float* destination, float* operand1, float* operand2)
+{
+#if defined(SIMD_SCALAR)
+    float theResult[16];
+    int i,j = 0;
+    for(i = 0; i < 4; i++)
+    {
+        for(j = 0; j < 4; j++)
+        {
+            theResult[4 * i + j] = operand1[j] * operand2[4 * i] + operand1[4 + j] * operand2[4 * i + 1] +
+                                   operand1[8 + j] * operand2[4 * i + 2] + operand1[12 + j] * operand2[4 * i + 3];
+        }
+    }
+    for(int i = 0; i < 16; i++)
+    {
+        destination[i] = theResult[i];
+    }
+#else
+    SimdFloat4 a0 = simdLoad(operand1);
+    SimdFloat4 a1 = simdLoad(operand1 + 4);
+    SimdFloat4 a2 = simdLoad(operand1 + 8);
+    SimdFloat4 a3 = simdLoad(operand1 + 12);
+    SimdFloat4 theResult[4];
+    for(int i = 0; i < 4; i++)
+    {
+        SimdFloat4 b = simdLoad(operand2 + 4 * i);
+        SimdFloat4 column = simdMul(a0, SIMD_SPLAT_LANE(b, 0));
+        column = simdMulAdd(column, a1, SIMD_SPLAT_LANE(b, 1));
+        column = simdMulAdd(column, a2, SIMD_SPLAT_LANE(b, 2));
+        theResult[i] = simdMulAdd(column, a3, SIMD_SPLAT_LANE(b, 3));
+    }
+    for(int i = 0; i < 4; i++)
+    {
+        simdStore(destination + 4 * i, theResult[i]);
+    }
+#endif
+}
+
+// 矩阵转置，行列互换。destination和source可以是同一个矩阵。
+void matrixTranspose(float* destination, const float* source)
+{
+#if defined(SIMD_NEON)
+    float32x4x4_t rows = vld4q_f32(source); // 交错读取，读出来的4个向量正好是4行
+    vst1q_f32(destination, rows.val[0]);
+    vst1q_f32(destination + 4, rows.val[1]);
+    vst1q_f32(destination + 8, rows.val[2]);
+    vst1q_f32(destination + 12, rows.val[3]);
+#elif defined(SIMD_SSE)
+    __m128 c0 = _mm_loadu_ps(source);
+    __m128 c1 = _mm_loadu_ps(source + 4);
+    __m128 c2 = _mm_loadu_ps(source + 8);
+    __m128 c3 = _mm_loadu_ps(source + 12);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    _mm_storeu_ps(destination, c0);
+    _mm_storeu_ps(destination + 4, c1);
+    _mm_storeu_ps(destination + 8, c2);
+    _mm_storeu_ps(destination + 12, c3);
+#else
+    float theResult[16];
+    for(int i = 0; i < 4; i++)
+    {
+        for(int j = 0; j < 4; j++)
+        {
+            theResult[4 * i + j] = source[4 * j + i];
+        }
+    }
+    for(int i = 0; i < 16; i++)
+    {
+        destination[i] = theResult[i];
+    }
+#endif
+}
+
+#if !defined(SIMD_SCALAR)
+// 下面三个是2x2矩阵的辅助运算，2x2矩阵按(m00, m01, m10, m11)放在一个向量里，A#表示A的伴随矩阵
+static inline SimdFloat4 matrix2Multiply(SimdFloat4 a, SimdFloat4 b) // A * B
+{
+    return simdAdd(simdMul(a, SIMD_SHUFFLE(b, b, 0, 3, 0, 3)),
+                   simdMul(SIMD_SHUFFLE(a, a, 1, 0, 3, 2), SIMD_SHUFFLE(b, b, 2, 1, 2, 1)));
+}
+static inline SimdFloat4 matrix2AdjointMultiply(SimdFloat4 a, SimdFloat4 b) // A# * B
+{
+    return simdSub(simdMul(SIMD_SHUFFLE(a, a, 3, 3, 0, 0), b),
+                   simdMul(SIMD_SHUFFLE(a, a, 1, 1, 2, 2), SIMD_SHUFFLE(b, b, 2, 3, 0, 1)));
+}
+static inline SimdFloat4 matrix2MultiplyAdjoint(SimdFloat4 a, SimdFloat4 b) // A * B#
+{
+    return simdSub(simdMul(a, SIMD_SHUFFLE(b, b, 3, 0, 3, 0)),
+                   simdMul(SIMD_SHUFFLE(a, a, 1, 0, 3, 2), SIMD_SHUFFLE(b, b, 2, 1, 2, 1)));
+}
+#endif
+
+/**
+ * 求4x4矩阵的逆矩阵，destination和source可以是同一个矩阵。
+ * SIMD版本把矩阵分成4个2x2的块 | A B |，用分块求逆公式算出4个块的伴随矩阵再统一除以行列式；
+ *                             | C D |
+ * 标量版本是常规的代数余子式展开。两种算法运算顺序不同，结果在1e-5的相对误差内一致。
+ * 对列主序矩阵按行主序套用公式得到的是转置矩阵的逆，也就是逆矩阵的转置，写回时按列读正好是逆矩阵本身。
+ * @return 行列式为0（矩阵不可逆）时返回false，此时destination不会被修改
+ */
+bool sInv(float* destination, const float* source)
+{
+#if defined(SIMD_SCALAR)
+    const float* m = source;
+    float inverse[16];
+    inverse[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    inverse[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    inverse[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    inverse[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    inverse[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    inverse[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    inverse[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    inverse[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    inverse[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+    inverse[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+    inverse[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+    inverse[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+    inverse[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+    inverse[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+    inverse[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+    inverse[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+    float determinant = m[0] * inverse[0] + m[1] * inverse[4] + m[2] * inverse[8] + m[3] * inverse[12];
+    if(determinant == 0.0f)
+    {
+        return false;
+    }
+    float inverseDeterminant = 1.0f / determinant;
+    for(int i = 0; i < 16; i++)
+    {
+        destination[i] = inverse[i] * inverseDeterminant;
+    }
+    return true;
+#else
+    SimdFloat4 row0 = simdLoad(source);
+    SimdFloat4 row1 = simdLoad(source + 4);
+    SimdFloat4 row2 = simdLoad(source + 8);
+    SimdFloat4 row3 = simdLoad(source + 12);
+    // 取出4个2x2子矩阵
+    SimdFloat4 a = SIMD_SHUFFLE(row0, row1, 0, 1, 0, 1);
+    SimdFloat4 b = SIMD_SHUFFLE(row0, row1, 2, 3, 2, 3);
+    SimdFloat4 c = SIMD_SHUFFLE(row2, row3, 0, 1, 0, 1);
+    SimdFloat4 d = SIMD_SHUFFLE(row2, row3, 2, 3, 2, 3);
+    // 一次算出4个子矩阵的行列式(|A|, |B|, |C|, |D|)
+    SimdFloat4 subDeterminant = simdSub(
+            simdMul(SIMD_SHUFFLE(row0, row2, 0, 2, 0, 2), SIMD_SHUFFLE(row1, row3, 1, 3, 1, 3)),
+            simdMul(SIMD_SHUFFLE(row0, row2, 1, 3, 1, 3), SIMD_SHUFFLE(row1, row3, 0, 2, 0, 2)));
+    SimdFloat4 determinantA = SIMD_SPLAT_LANE(subDeterminant, 0);
+    SimdFloat4 determinantB = SIMD_SPLAT_LANE(subDeterminant, 1);
+    SimdFloat4 determinantC = SIMD_SPLAT_LANE(subDeterminant, 2);
+    SimdFloat4 determinantD = SIMD_SPLAT_LANE(subDeterminant, 3);
+    SimdFloat4 adjointDC = matrix2AdjointMultiply(d, c); // D#C
+    SimdFloat4 adjointAB = matrix2AdjointMultiply(a, b); // A#B
+    SimdFloat4 x = simdSub(simdMul(determinantD, a), matrix2Multiply(b, adjointDC)); // X# = |D|A - B(D#C)
+    SimdFloat4 w = simdSub(simdMul(determinantA, d), matrix2Multiply(c, adjointAB)); // W# = |A|D - C(A#B)
+    SimdFloat4 y = simdSub(simdMul(determinantB, c), matrix2MultiplyAdjoint(d, adjointAB)); // Y# = |B|C - D(A#B)#
+    SimdFloat4 z = simdSub(simdMul(determinantC, b), matrix2MultiplyAdjoint(a, adjointDC)); // Z# = |C|B - A(D#C)#
+    // |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+    SimdFloat4 trace = simdMul(adjointAB, SIMD_SHUFFLE(adjointDC, adjointDC, 0, 2, 1, 3));
+    trace = simdAdd(trace, SIMD_SHUFFLE(trace, trace, 2, 3, 0, 1));
+    trace = simdAdd(trace, SIMD_SHUFFLE(trace, trace, 1, 0, 3, 2));
+    SimdFloat4 determinant = simdSub(simdAdd(simdMul(determinantA, determinantD), simdMul(determinantB, determinantC)), trace);
+    float determinantValue[4];
+    simdStore(determinantValue, determinant);
+    if(determinantValue[0] == 0.0f)
+    {
+        return false;
+    }
+    // 伴随矩阵需要的符号和1/|M|一起乘上去
+    SimdFloat4 inverseDeterminant = simdDiv(simdSet(1.0f, -1.0f, -1.0f, 1.0f), determinant);
+    x = simdMul(x, inverseDeterminant);
+    y = simdMul(y, inverseDeterminant);
+    z = simdMul(z, inverseDeterminant);
+    w = simdMul(w, inverseDeterminant);
+    // 求伴随时的元素交换和写回时的重排合并成一次shuffle
+    simdStore(destination, SIMD_SHUFFLE(x, y, 3, 1, 3, 1));
+    simdStore(destination + 4, SIMD_SHUFFLE(x, y, 2, 0, 2, 0));
+    simdStore(destination + 8, SIMD_SHUFFLE(z, w, 3, 1, 3, 1));
+    simdStore(destination + 12, SIMD_SHUFFLE(z, w, 2, 0, 2, 0));
+    return true;
+#endif
+}
+
+/**
+ * 用矩阵批量变换4维向量：destination[i] = matrix * vectors[i]，常用于在CPU上批量变换顶点。
+ * 开启AVX时一次处理两个向量，两个128位通道各放一份矩阵列，运算顺序与SSE版本相同，结果完全一致。
+ * @param destination 输出，count * 4个float，可以和vectors是同一块内存
+ * @param matrix 列主序4x4矩阵
+ * @param vectors 输入，count个(x, y, z, w)
+ * @param count 向量个数
+ */
+void matrixTransformVec4Array(float* destination, const float* matrix, const float* vectors, int count)
+{
+    int i = 0;
+#if !defined(SIMD_SCALAR)
+    SimdFloat4 column0 = simdLoad(matrix);
+    SimdFloat4 column1 = simdLoad(matrix + 4);
+    SimdFloat4 column2 = simdLoad(matrix + 8);
+    SimdFloat4 column3 = simdLoad(matrix + 12);
+#if defined(SIMD_AVX)
+    __m256 wideColumn0 = _mm256_broadcast_ps(&column0);
+    __m256 wideColumn1 = _mm256_broadcast_ps(&column1);
+    __m256 wideColumn2 = _mm256_broadcast_ps(&column2);
+    __m256 wideColumn3 = _mm256_broadcast_ps(&column3);
+    for(; i + 2 <= count; i += 2)
+    {
+        __m256 v = _mm256_loadu_ps(vectors + 4 * i);
+        __m256 result = _mm256_mul_ps(wideColumn0, _mm256_permute_ps(v, 0x00));
+        result = _mm256_add_ps(result, _mm256_mul_ps(wideColumn1, _mm256_permute_ps(v, 0x55)));
+        result = _mm256_add_ps(result, _mm256_mul_ps(wideColumn2, _mm256_permute_ps(v, 0xAA)));
+        result = _mm256_add_ps(result, _mm256_mul_ps(wideColumn3, _mm256_permute_ps(v, 0xFF)));
+        _mm256_storeu_ps(destination + 4 * i, result);
+    }
+#endif
+    for(; i < count; i++)
+    {
+        SimdFloat4 v = simdLoad(vectors + 4 * i);
+        SimdFloat4 result = simdMul(column0, SIMD_SPLAT_LANE(v, 0));
+        result = simdMulAdd(result, column1, SIMD_SPLAT_LANE(v, 1));
+        result = simdMulAdd(result, column2, SIMD_SPLAT_LANE(v, 2));
+        result = simdMulAdd(result, column3, SIMD_SPLAT_LANE(v, 3));
+        simdStore(destination + 4 * i, result);
+    }
+#else
+    for(; i < count; i++)
+    {
+        const float* v = vectors + 4 * i;
+        float x = v[0], y = v[1], z = v[2], w = v[3];
+        for(int j = 0; j < 4; j++)
+        {
+            destination[4 * i + j] = matrix[j] * x + matrix[4 + j] * y + matrix[8 + j] * z + matrix[12 + j] * w;
+        }
+    }
+#endif
+}
+
+// 矩阵移动，指的是使用最后的一列来处理x、y、z轴的移动，12、13、14分别代表x、y、z轴的移动。
+// 需要注意的是我们为何先创建缓存矩阵并把它设置为定义的矩阵，我们这样做是为了避免污染已经传入方法的矩阵。
+// 然后我们往缓存矩阵中添加新的转换值并用矩阵乘法转换成我们当前矩阵。
+void matrixTranslate(float* matrix, float x, float y, float z)
+{
+    float temporaryMatrix[16];
+    matrixIdentityFunction(temporaryMatrix);
+    temporaryMatrix[12] = x;
+    temporaryMatrix[13] = y;
+    temporaryMatrix[14] = z;
+    matrixMultiply(matrix,temporaryMatrix,matrix);
+}
+
+// 矩阵缩放，这是另一个简单的矩阵转换操作，0、5、10分别代表x、y、z轴的缩放。
+void matrixScale(float* matrix, float x, float y, float z)
+{
+    float tempMatrix[16];
+    matrixIdentityFunction(tempMatrix);
+    tempMatrix[0] = x;
+    tempMatrix[5] = y;
+    tempMatrix[10] = z;
+    matrixMultiply(matrix, tempMatrix, matrix);
+}
+
+// 矩阵旋转会显得更复杂一点，包含了三角学的知识，三角函数的使用取决于你想围绕哪个轴进行旋转。
+// 以下是分别围绕x、y、z轴旋转的方法。
+float matrixDegreesToRadians(float degrees) {
+    return M_PI * degrees / 180.0f;
+}
+void matrixRotateX(float* matrix, float angle)
+{
+    float tempMatrix[16];
+    matrixIdentityFunction(tempMatrix);
+    tempMatrix[5] = cos(matrixDegreesToRadians(angle));
+    tempMatrix[9] = -sin(matrixDegreesToRadians(angle));
+    tempMatrix[6] = sin(matrixDegreesToRadians(angle));
+    tempMatrix[10] = cos(matrixDegreesToRadians(angle));
+    matrixMultiply(matrix, tempMatrix, matrix);
+}
+void matrixRotateY(float *matrix, float angle)
+{
+    float tempMatrix[16];
+    matrixIdentityFunction(tempMatrix);
+    tempMatrix[0] = cos(matrixDegreesToRadians(angle));
+    tempMatrix[8] = sin(matrixDegreesToRadians(angle));
+    tempMatrix[2] = -sin(matrixDegreesToRadians(angle));
+    tempMatrix[10] = cos(matrixDegreesToRadians(angle));
+    matrixMultiply(matrix, tempMatrix, matrix);
+}
+void matrixRotateZ(float *matrix, float angle)
+{
+    float tempMatrix[16];
+    matrixIdentityFunction(tempMatrix);
+    tempMatrix[0] = cos(matrixDegreesToRadians(angle));
+    tempMatrix[4] = -sin(matrixDegreesToRadians(angle));
+    tempMatrix[1] = sin(matrixDegreesToRadians(angle));
+    tempMatrix[5] = cos(matrixDegreesToRadians(angle));
+    matrixMultiply(matrix, tempMatrix, matrix);
+}
+
+// 以下是直接构建模型视图矩阵的方法。
+// 渲染时常见的写法是先恒等矩阵，再依次缩放、旋转、平移，每一步都是一次完整的4x4矩阵乘法，每次旋转还要算两遍sin和cos。
+// 其实这几个变换合起来的结果可以直接写出来：M = T * Rz * Ry * Rx * S，
+// 左上3x3是旋转矩阵的每一列乘上对应的缩放，最后一列是平移，每个轴只需要算一次sin和cos，也不需要中间矩阵。
+static inline void degreesSinCos(float degrees, float* sine, float* cosine)
+{
+    float radians = (float)(M_PI / 180.0) * degrees;
+    *sine = sinf(radians); // 同一个角度的sinf和cosf编译器会合并成一次sincosf调用
+    *cosine = cosf(radians);
+}
+
+static inline void writeTransform(float* matrix,
+                                  float r00, float r01, float r02,
+                                  float r10, float r11, float r12,
+                                  float r20, float r21, float r22,
+                                  float x, float y, float z,
+                                  float scaleX, float scaleY, float scaleZ)
+{
+    matrix[0] = r00 * scaleX;
+    matrix[1] = r10 * scaleX;
+    matrix[2] = r20 * scaleX;
+    matrix[3] = 0.0f;
+    matrix[4] = r01 * scaleY;
+    matrix[5] = r11 * scaleY;
+    matrix[6] = r21 * scaleY;
+    matrix[7] = 0.0f;
+    matrix[8] = r02 * scaleZ;
+    matrix[9] = r12 * scaleZ;
+    matrix[10] = r22 * scaleZ;
+    matrix[11] = 0.0f;
+    matrix[12] = x;
+    matrix[13] = y;
+    matrix[14] = z;
+    matrix[15] = 1.0f;
+}
+
+/**
+ * 由欧拉角、平移和缩放直接构建模型视图矩阵，结果等价于：
+ *   matrixIdentityFunction(matrix);
+ *   matrixScale(matrix, scaleX, scaleY, scaleZ);
+ *   matrixRotateX(matrix, angleX);
+ *   matrixRotateY(matrix, angleY);
+ *   matrixRotateZ(matrix, angleZ);
+ *   matrixTranslate(matrix, x, y, z);
+ * 原来的旋转用double计算sin和cos，这里用float，结果的差别在float精度范围内（相对误差约1e-6）。
+ * @param angleX angleY angleZ 绕各轴旋转的角度（单位是度）
+ */
+void matrixEulerTransform(float* matrix, float angleX, float angleY, float angleZ,
+                          float x, float y, float z, float scaleX, float scaleY, float scaleZ)
+{
+    float sx, cx, sy, cy, sz, cz;
+    degreesSinCos(angleX, &sx, &cx);
+    degreesSinCos(angleY, &sy, &cy);
+    degreesSinCos(angleZ, &sz, &cz);
+    writeTransform(matrix,
+                   cy * cz, cz * sy * sx - sz * cx, cz * sy * cx + sz * sx,
+                   cy * sz, sz * sy * sx + cz * cx, sz * sy * cx - cz * sx,
+                   -sy, cy * sx, cy * cx,
+                   x, y, z, scaleX, scaleY, scaleZ);
+}
+
+/**
+ * 由单位四元数(qx, qy, qz, qw)、平移和缩放直接构建模型视图矩阵，即 M = T * R(q) * S。
+ * 四元数没有归一化时旋转部分会带上额外的缩放，调用方需要保证传入的是单位四元数。
+ */
+void matrixQuaternionTransform(float* matrix, float qx, float qy, float qz, float qw,
+                               float x, float y, float z, float scaleX, float scaleY, float scaleZ)
+{
+    float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+    float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+    float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+    writeTransform(matrix,
+                   1.0f - 2.0f * (yy + zz), 2.0f * (xy - wz), 2.0f * (xz + wy),
+                   2.0f * (xy + wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz - wx),
+                   2.0f * (xz - wy), 2.0f * (yz + wx), 1.0f - 2.0f * (xx + yy),
+                   x, y, z, scaleX, scaleY, scaleZ);
+}
+
+/**
+ * 批量构建模型视图矩阵，transforms里每个属性是一个长度为count的数组（SoA布局），
+ * 第i个矩阵写到matrices + 16 * i。先按轴把所有的sin和cos算好，再一次性组装矩阵，
+ * 这样两个循环里都是连续访问，组装的循环没有函数调用，编译器可以自动向量化。
+ * @param sinCosBuffer 长度至少为6 * count的临时空间
+ */
+void matrixEulerTransformBatch(float* matrices, const TransformArrays* transforms, int count, float* sinCosBuffer)
+{
+    float* sinX = sinCosBuffer;
+    float* cosX = sinCosBuffer + count;
+    float* sinY = sinCosBuffer + 2 * count;
+    float* cosY = sinCosBuffer + 3 * count;
+    float* sinZ = sinCosBuffer + 4 * count;
+    float* cosZ = sinCosBuffer + 5 * count;
+    for(int i = 0; i < count; i++)
+    {
+        degreesSinCos(transforms->angleX[i], &sinX[i], &cosX[i]);
+        degreesSinCos(transforms->angleY[i], &sinY[i], &cosY[i]);
+        degreesSinCos(transforms->angleZ[i], &sinZ[i], &cosZ[i]);
+    }
+    for(int i = 0; i < count; i++)
+    {
+        float sx = sinX[i], cx = cosX[i], sy = sinY[i], cy = cosY[i], sz = sinZ[i], cz = cosZ[i];
+        float scaleX = transforms->scaleX ? transforms->scaleX[i] : 1.0f;
+        float scaleY = transforms->scaleY ? transforms->scaleY[i] : 1.0f;
+        float scaleZ = transforms->scaleZ ? transforms->scaleZ[i] : 1.0f;
+        writeTransform(matrices + 16 * i,
+                       cy * cz, cz * sy * sx - sz * cx, cz * sy * cx + sz * sx,
+                       cy * sz, sz * sy * sx + cz * cx, sz * sy * cx - cz * sx,
+                       -sy, cy * sx, cy * cx,
+                       transforms->x[i], transforms->y[i], transforms->z[i], scaleX, scaleY, scaleZ);
+    }
+}
+
+// 矩阵视角投影的具体实现
+void matrixFrustum(float* matrix, float left, float right, float bottom, float top, float zNear, float zFar)
+{
+    float temp, xDistance, yDistance, zDistance;
+    temp = 2.0 * zNear;
+    xDistance = right - left;
+    yDistance = top - bottom;
+    zDistance = zFar - zNear;
+    matrixIdentityFunction(matrix);
+    matrix[0] = temp / xDistance;
+    matrix[5] = temp / yDistance;
+    matrix[8] = (right + left) / xDistance;
+    matrix[9] = (top + bottom) / yDistance;
+    matrix[10] = (-zFar - zNear) / zDistance;
+    matrix[11] = -1.0f;
+    matrix[14] = (-temp * zFar) / zDistance;
+    matrix[15] = 0.0f;
+}
+
+/**
+ * 矩阵视角设置，做出近大远小的效果
+ * @param matrix 要做投影的矩阵
+ * @param fieldOfView 看视图的角度。
+ * @param aspectRatio 宽高比，通常是你屏幕或显示表面的宽/高，为了适配各种设备而给的参数。
+ * @param zNear 近平面，表示对象在消失和被裁剪前离相机有多近。
+ * @param zFar 远平面，表示对象在不再绘制前离相机有多远。
+ */
+void matrixPerspective(float* matrix, float fieldOfView, float aspectRatio, float zNear, float zFar)
+{
+    float ymax, xmax;
+    ymax = zNear * tanf(fieldOfView * M_PI / 360.0f);
+    xmax = ymax * aspectRatio;
+    matrixFrustum(matrix, -xmax, xmax, -ymax, ymax, zNear, zFar);
+}
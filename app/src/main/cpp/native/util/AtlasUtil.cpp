@@ -0,0 +1,261 @@
+/**
+ * --- 纹理图集 ---
+ *
+ * 每张小纹理单独一个纹理对象时，换一次纹理就要重新绑定，相邻的绘制也就不能合并。把很多小图片装进几张大的页面里，
+ * 用同一页的绘制不需要换纹理，只需要在加载网格时把纹理坐标映射到图片所在的区域（remapAtlasUVs）。
+ *
+ * 装箱用skyline算法：每页记录一条由水平线段组成的“天际线”，表示每一列已经占用到的高度。放一张图片时在每个线段的左端点
+ * 试放，取放下后顶端最低的位置（一样低时取最左边的），然后把图片覆盖的线段换成一段新的。图片按高度从高到低放，
+ * 同一行的高度比较整齐，浪费的空间少。
+ *
+ * 每张图片四周复制padding个像素的边缘，位置和大小对齐到alignment：双线性过滤在图片边缘采样时取到的是复制的边缘而不是
+ * 相邻的图片；生成mipmap时，第k级的每个像素来自第0级2^k×2^k的区域，只要这个区域不跨过图片的边界（k <= log2(alignment)），
+ * 就不会混进相邻图片的颜色。
+ */
+#include <algorithm>
+#include <cstring>
+
+#include "../include/AtlasUtil.h"
+#include "../include/MipUtil.h"
+#include "../include/StateCache.h"
+#include "../include/LogUtil.h"
+
+// 天际线的一段：从x开始宽width的列已经占用到了高度y
+struct SkylineSegment
+{
+    int x;
+    int y;
+    int width;
+};
+
+typedef std::vector<SkylineSegment> Skyline;
+
+// 在第index段的左端点放宽width高height的矩形，返回放下后的底边高度，放不下时返回-1
+static int skylineFit(const Skyline& skyline, size_t index, int width, int height, int pageSize)
+{
+    int x = skyline[index].x;
+    if (x + width > pageSize)
+    {
+        return -1;
+    }
+    int y = 0;
+    int remaining = width;
+    for (size_t i = index; remaining > 0; i++)
+    {
+        y = std::max(y, skyline[i].y);
+        remaining -= skyline[i].width;
+    }
+    return y + height <= pageSize ? y : -1;
+}
+
+// 找到放下后顶端最低（其次最左）的位置，返回段的下标，放不下时返回-1
+static int skylineFind(const Skyline& skyline, int width, int height, int pageSize, int* y)
+{
+    int best = -1;
+    int bestTop = pageSize + 1;
+    for (size_t i = 0; i < skyline.size(); i++)
+    {
+        int fit = skylineFit(skyline, i, width, height, pageSize);
+        if (fit >= 0 && fit + height < bestTop)
+        {
+            best = (int) i;
+            bestTop = fit + height;
+            *y = fit;
+        }
+    }
+    return best;
+}
+
+static void skylineInsert(Skyline* skyline, int index, int y, int width, int height)
+{
+    SkylineSegment segment = {(*skyline)[index].x, y + height, width};
+    skyline->insert(skyline->begin() + index, segment);
+    // 被新段盖住的部分去掉，最后一段可能只被盖住一半
+    int right = segment.x + segment.width;
+    size_t i = index + 1;
+    while (i < skyline->size() && (*skyline)[i].x < right)
+    {
+        SkylineSegment& next = (*skyline)[i];
+        int overlap = right - next.x;
+        if (overlap < next.width)
+        {
+            next.x += overlap;
+            next.width -= overlap;
+            break;
+        }
+        skyline->erase(skyline->begin() + i);
+    }
+    // 合并高度相同的相邻段
+    for (i = 0; i + 1 < skyline->size();)
+    {
+        if ((*skyline)[i].y == (*skyline)[i + 1].y)
+        {
+            (*skyline)[i].width += (*skyline)[i + 1].width;
+            skyline->erase(skyline->begin() + i + 1);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+// 把图片复制到页中(x, y)，四周padding个像素取最近的边缘像素
+static void copyPadded(const AtlasImage* image, int padding, int pageSize, int x, int y, unsigned char* page)
+{
+    for (int row = -padding; row < image->height + padding; row++)
+    {
+        int sourceRow = std::min(std::max(row, 0), image->height - 1);
+        const unsigned char* source = image->rgba + (size_t) sourceRow * image->width * 4;
+        unsigned char* destination = page + ((size_t) (y + row) * pageSize + x) * 4;
+        for (int column = -padding; column < 0; column++)
+        {
+            memcpy(destination + column * 4, source, 4);
+        }
+        memcpy(destination, source, (size_t) image->width * 4);
+        for (int column = image->width; column < image->width + padding; column++)
+        {
+            memcpy(destination + column * 4, source + (image->width - 1) * 4, 4);
+        }
+    }
+}
+
+static bool tallerFirst(const std::pair<int, int>& a, const std::pair<int, int>& b)
+{
+    return a.first > b.first;
+}
+
+bool buildTextureAtlas(const AtlasImage* images, int count, const AtlasOptions* options, TextureAtlas* atlas)
+{
+    int pageSize = options->pageSize;
+    int padding = options->padding;
+    int alignment = std::max(1, options->alignment);
+    atlas->pageSize = pageSize;
+    atlas->pageCount = 0;
+    atlas->entries.resize(count);
+    atlas->pages.clear();
+    atlas->imagePixels = 0;
+    // (高度, 下标)，稳定排序保证同样的输入得到同样的图集
+    std::vector<std::pair<int, int> > order(count);
+    for (int i = 0; i < count; i++)
+    {
+        order[i] = std::make_pair(images[i].height, i);
+    }
+    std::stable_sort(order.begin(), order.end(), tallerFirst);
+    std::vector<Skyline> skylines;
+    for (int n = 0; n < count; n++)
+    {
+        const AtlasImage& image = images[order[n].second];
+        int width = (image.width + 2 * padding + alignment - 1) / alignment * alignment;
+        int height = (image.height + 2 * padding + alignment - 1) / alignment * alignment;
+        if (image.width <= 0 || image.height <= 0 || width > pageSize || height > pageSize)
+        {
+            LOGE("Image %d (%dx%d) does not fit in a %d atlas page", order[n].second, image.width, image.height,
+                 pageSize);
+            return false;
+        }
+        int page = 0;
+        int segment = -1;
+        int y = 0;
+        for (; page < atlas->pageCount; page++)
+        {
+            segment = skylineFind(skylines[page], width, height, pageSize, &y);
+            if (segment >= 0)
+            {
+                break;
+            }
+        }
+        if (segment < 0)
+        {
+            SkylineSegment empty = {0, 0, pageSize};
+            skylines.push_back(Skyline(1, empty));
+            atlas->pages.push_back(std::vector<unsigned char>((size_t) pageSize * pageSize * 4, 0));
+            atlas->pageCount++;
+            segment = 0;
+            y = 0;
+        }
+        int x = skylines[page][segment].x;
+        skylineInsert(&skylines[page], segment, y, width, height);
+        copyPadded(&image, padding, pageSize, x + padding, y + padding, &atlas->pages[page][0]);
+        AtlasEntry& entry = atlas->entries[order[n].second];
+        entry.page = page;
+        entry.x = x + padding;
+        entry.y = y + padding;
+        entry.width = image.width;
+        entry.height = image.height;
+        entry.uvOffset[0] = (float) entry.x / pageSize;
+        entry.uvOffset[1] = (float) entry.y / pageSize;
+        entry.uvScale[0] = (float) entry.width / pageSize;
+        entry.uvScale[1] = (float) entry.height / pageSize;
+        atlas->imagePixels += (long long) image.width * image.height;
+    }
+    return true;
+}
+
+void remapAtlasUVs(const AtlasEntry* entry, const float* uvs, int count, float* out)
+{
+    for (int i = 0; i < count; i++)
+    {
+        out[i * 2] = entry->uvOffset[0] + uvs[i * 2] * entry->uvScale[0];
+        out[i * 2 + 1] = entry->uvOffset[1] + uvs[i * 2 + 1] * entry->uvScale[1];
+    }
+}
+
+float atlasEfficiency(const TextureAtlas* atlas)
+{
+    if (atlas->pageCount == 0)
+    {
+        return 0.0f;
+    }
+    return (float) ((double) atlas->imagePixels / ((double) atlas->pageCount * atlas->pageSize * atlas->pageSize));
+}
+
+int countTextureBinds(const int* textures, int draws)
+{
+    int binds = 0;
+    for (int i = 0; i < draws; i++)
+    {
+        binds += i == 0 || textures[i] != textures[i - 1];
+    }
+    return binds;
+}
+
+int countAtlasBinds(const TextureAtlas* atlas, const int* images, int draws)
+{
+    int binds = 0;
+    for (int i = 0; i < draws; i++)
+    {
+        binds += i == 0 || atlas->entries[images[i]].page != atlas->entries[images[i - 1]].page;
+    }
+    return binds;
+}
+
+bool uploadAtlasPages(const TextureAtlas* atlas, bool srgb, GLuint* textures)
+{
+    // generateMipChain在线性空间过滤后写回sRGB编码的字节，纹理也要按sRGB格式创建，采样时才会解码回线性值。
+    // GLES2没有GL_SRGB8_ALPHA8，只能按普通RGBA上传
+    const char* version = (const char*) glGetString(GL_VERSION);
+    bool srgbTextures = srgb && version != NULL && strncmp(version, "OpenGL ES 3", 11) == 0;
+    GLint internalFormat = srgbTextures ? GL_SRGB8_ALPHA8 : GL_RGBA;
+    glGenTextures(atlas->pageCount, textures);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (int page = 0; page < atlas->pageCount; page++)
+    {
+        MipChain chain;
+        if (!generateMipChain(&atlas->pages[page][0], atlas->pageSize, atlas->pageSize, srgb, MIP_FILTER_BOX, 0, &chain))
+        {
+            return false;
+        }
+        cachedBindTexture(GL_TEXTURE_2D, textures[page]);
+        for (int level = 0; level < chain.levelCount; level++)
+        {
+            glTexImage2D(GL_TEXTURE_2D, level, internalFormat, chain.width[level], chain.height[level], 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, &chain.pixels[chain.offset[level]]);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    return true;
+}
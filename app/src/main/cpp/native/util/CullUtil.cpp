@@ -0,0 +1,493 @@
+/**
+ * --- 视锥剔除 ---
+ *
+ * 透视投影能看到的范围是一个截头的四棱锥（视锥），由6个平面围成。完全在某个平面外侧的物体一定看不见，
+ * 没有必要交给GPU：顶点着色器照样要处理它的每个顶点，之后才在裁剪阶段被丢掉。
+ *
+ * 视锥平面可以直接从投影×视图矩阵中取出（Gribb/Hartmann的方法）：裁剪空间中点在视锥内的条件是
+ * -w <= x <= w、-w <= y <= w、-w <= z <= w，把x、y、z、w展开成矩阵的行与坐标的点积，
+ * 例如左平面 w + x >= 0 就是 (第4行 + 第1行)·(x, y, z, 1) >= 0，这样得到的就是世界坐标中的平面方程。
+ *
+ * 物体用包围球表示：球心到平面的有符号距离小于-radius时，整个球都在平面外侧。
+ * 物体有几万个而大部分不在视野里时，逐个测试也很浪费，这里在包围球上建一个4叉的包围盒层次（BVH）：
+ *    - 每个节点有4个子节点，4个子包围盒按SoA存放，一次SIMD运算就能让4个盒子同时和一个平面比较
+ *    - 盒子和平面比较时只需要看离平面最远和最近的两个顶点（由平面法线每个分量的符号决定）：
+ *      最远的顶点都在外侧，盒子就在外侧，整棵子树跳过；最近的顶点都在内侧，盒子完全在视锥内，整棵子树不用再测试
+ *    - 叶子里最多8个物体，用SIMD一次测试4个（AVX时8个）包围球
+ * 剔除的结果是可见物体的下标列表，同时统计耗时和测试次数，方便调整叶子大小等参数。
+ */
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <time.h>
+
+#include "../include/SimdUtil.h"
+#include "../include/CullUtil.h"
+
+static double currentMilliseconds()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+}
+
+void extractFrustumPlanes(Frustum* frustum, const float* m)
+{
+    // 列主序，第i行是(m[i], m[4 + i], m[8 + i], m[12 + i])
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            frustum->planes[2 * i][j] = m[4 * j + 3] + m[4 * j + i];
+            frustum->planes[2 * i + 1][j] = m[4 * j + 3] - m[4 * j + i];
+        }
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        float* plane = frustum->planes[i];
+        float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (length > 0.0f)
+        {
+            plane[0] /= length;
+            plane[1] /= length;
+            plane[2] /= length;
+            plane[3] /= length;
+        }
+    }
+}
+
+bool sphereInFrustum(const Frustum* frustum, const BoundingSphere* sphere)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        const float* plane = frustum->planes[i];
+        if (plane[0] * sphere->x + plane[1] * sphere->y + plane[2] * sphere->z + plane[3] < -sphere->radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- 建立层次 ---
+
+struct CullBuilder
+{
+    CullHierarchy* hierarchy;
+    const BoundingSphere* spheres;
+    std::vector<int> order; // 物体下标，建立过程中按空间划分重新排列
+};
+
+struct SphereAxisLess
+{
+    const BoundingSphere* spheres;
+    int axis;
+    bool operator()(int a, int b) const
+    {
+        return (&spheres[a].x)[axis] < (&spheres[b].x)[axis];
+    }
+};
+
+static void boundsOf(const CullBuilder& builder, int begin, int end, float* minimum, float* maximum)
+{
+    for (int k = 0; k < 3; k++)
+    {
+        minimum[k] = FLT_MAX;
+        maximum[k] = -FLT_MAX;
+    }
+    for (int i = begin; i < end; i++)
+    {
+        const BoundingSphere& sphere = builder.spheres[builder.order[i]];
+        const float* centre = &sphere.x;
+        for (int k = 0; k < 3; k++)
+        {
+            minimum[k] = std::min(minimum[k], centre[k] - sphere.radius);
+            maximum[k] = std::max(maximum[k], centre[k] + sphere.radius);
+        }
+    }
+}
+
+// 按包围盒最长的轴在中位数处把[begin, end)分成两半，返回分割位置
+static int splitRange(CullBuilder& builder, int begin, int end)
+{
+    float minimum[3], maximum[3];
+    boundsOf(builder, begin, end, minimum, maximum);
+    int axis = 0;
+    for (int k = 1; k < 3; k++)
+    {
+        if (maximum[k] - minimum[k] > maximum[axis] - minimum[axis])
+        {
+            axis = k;
+        }
+    }
+    int middle = begin + (end - begin) / 2;
+    SphereAxisLess less = {builder.spheres, axis};
+    std::nth_element(builder.order.begin() + begin, builder.order.begin() + middle, builder.order.begin() + end, less);
+    return middle;
+}
+
+static void setEmptySlot(CullNode& node, int slot)
+{
+    // 反向的盒子：离任何平面最远的顶点也在外侧，测试时自然被剔除
+    node.minX[slot] = node.minY[slot] = node.minZ[slot] = FLT_MAX;
+    node.maxX[slot] = node.maxY[slot] = node.maxZ[slot] = -FLT_MAX;
+    node.child[slot] = 0;
+    node.count[slot] = -1;
+}
+
+static int buildNode(CullBuilder& builder, int begin, int end)
+{
+    int nodeIndex = (int) builder.hierarchy->nodes.size();
+    builder.hierarchy->nodes.push_back(CullNode());
+    // 分两次对半分成4份
+    int middle = splitRange(builder, begin, end);
+    int ranges[cullHierarchyWidth + 1] = {begin, begin, middle, middle, end};
+    if (middle - begin > maxCullLeafObjects)
+    {
+        ranges[1] = splitRange(builder, begin, middle);
+    }
+    if (end - middle > maxCullLeafObjects)
+    {
+        ranges[3] = splitRange(builder, middle, end);
+    }
+    for (int slot = 0; slot < cullHierarchyWidth; slot++)
+    {
+        int childBegin = ranges[slot];
+        int childEnd = ranges[slot + 1];
+        if (childBegin == childEnd)
+        {
+            setEmptySlot(builder.hierarchy->nodes[nodeIndex], slot);
+            continue;
+        }
+        float minimum[3], maximum[3];
+        boundsOf(builder, childBegin, childEnd, minimum, maximum);
+        int child = childBegin;
+        int count = childEnd - childBegin;
+        if (count > maxCullLeafObjects)
+        {
+            child = buildNode(builder, childBegin, childEnd); // 会让nodes重新分配，之后再取引用
+            count = 0;
+        }
+        CullNode& node = builder.hierarchy->nodes[nodeIndex];
+        node.minX[slot] = minimum[0];
+        node.minY[slot] = minimum[1];
+        node.minZ[slot] = minimum[2];
+        node.maxX[slot] = maximum[0];
+        node.maxY[slot] = maximum[1];
+        node.maxZ[slot] = maximum[2];
+        node.child[slot] = child;
+        node.count[slot] = count;
+    }
+    return nodeIndex;
+}
+
+// 按排序后的顺序把包围球写成SoA
+static void gatherSpheres(CullHierarchy* hierarchy, const BoundingSphere* spheres)
+{
+    for (int i = 0; i < hierarchy->objectCount; i++)
+    {
+        const BoundingSphere& sphere = spheres[hierarchy->objects[i]];
+        hierarchy->sphereX[i] = sphere.x;
+        hierarchy->sphereY[i] = sphere.y;
+        hierarchy->sphereZ[i] = sphere.z;
+        hierarchy->sphereRadius[i] = sphere.radius;
+    }
+}
+
+void buildCullHierarchy(CullHierarchy* hierarchy, const BoundingSphere* spheres, int count)
+{
+    hierarchy->nodes.clear();
+    hierarchy->objectCount = count;
+    CullBuilder builder = {hierarchy, spheres, std::vector<int>(count)};
+    for (int i = 0; i < count; i++)
+    {
+        builder.order[i] = i;
+    }
+    if (count > 0)
+    {
+        buildNode(builder, 0, count);
+    }
+    hierarchy->objects = builder.order;
+    // 补齐8个，叶子的SIMD测试可以整组读取；补齐部分的结果会被丢掉
+    size_t padded = (size_t) count + 8;
+    hierarchy->sphereX.assign(padded, 0.0f);
+    hierarchy->sphereY.assign(padded, 0.0f);
+    hierarchy->sphereZ.assign(padded, 0.0f);
+    hierarchy->sphereRadius.assign(padded, 0.0f);
+    gatherSpheres(hierarchy, spheres);
+}
+
+void refitCullHierarchy(CullHierarchy* hierarchy, const BoundingSphere* spheres)
+{
+    gatherSpheres(hierarchy, spheres);
+    // 子节点的下标总是大于父节点，倒序处理保证子节点先更新
+    for (int n = (int) hierarchy->nodes.size() - 1; n >= 0; n--)
+    {
+        CullNode& node = hierarchy->nodes[n];
+        for (int slot = 0; slot < cullHierarchyWidth; slot++)
+        {
+            if (node.count[slot] < 0)
+            {
+                continue;
+            }
+            float minimum[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+            float maximum[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+            if (node.count[slot] > 0)
+            {
+                for (int i = node.child[slot]; i < node.child[slot] + node.count[slot]; i++)
+                {
+                    float centre[3] = {hierarchy->sphereX[i], hierarchy->sphereY[i], hierarchy->sphereZ[i]};
+                    for (int k = 0; k < 3; k++)
+                    {
+                        minimum[k] = std::min(minimum[k], centre[k] - hierarchy->sphereRadius[i]);
+                        maximum[k] = std::max(maximum[k], centre[k] + hierarchy->sphereRadius[i]);
+                    }
+                }
+            }
+            else
+            {
+                const CullNode& child = hierarchy->nodes[node.child[slot]];
+                for (int c = 0; c < cullHierarchyWidth; c++)
+                {
+                    if (child.count[c] < 0)
+                    {
+                        continue;
+                    }
+                    minimum[0] = std::min(minimum[0], child.minX[c]);
+                    minimum[1] = std::min(minimum[1], child.minY[c]);
+                    minimum[2] = std::min(minimum[2], child.minZ[c]);
+                    maximum[0] = std::max(maximum[0], child.maxX[c]);
+                    maximum[1] = std::max(maximum[1], child.maxY[c]);
+                    maximum[2] = std::max(maximum[2], child.maxZ[c]);
+                }
+            }
+            node.minX[slot] = minimum[0];
+            node.minY[slot] = minimum[1];
+            node.minZ[slot] = minimum[2];
+            node.maxX[slot] = maximum[0];
+            node.maxY[slot] = maximum[1];
+            node.maxZ[slot] = maximum[2];
+        }
+    }
+}
+
+// --- 测试 ---
+
+/**
+ * 测试first开始的count个包围球，可见的写入visible（ids为NULL时写first + i，否则写ids[first + i]），返回写入个数。
+ * padded为true时数组末尾有补齐，最后一组不足SIMD宽度也可以整组读取。
+ */
+static int testSpheres(const Frustum* frustum, const float* x, const float* y, const float* z, const float* radius,
+                       int first, int count, bool padded, const int* ids, int* visible)
+{
+    int written = 0;
+    int i = first;
+    int end = first + count;
+#if defined(SIMD_AVX)
+    for (; i < end && (padded || i + 8 <= end); i += 8)
+    {
+        __m256 sphereX = _mm256_loadu_ps(x + i);
+        __m256 sphereY = _mm256_loadu_ps(y + i);
+        __m256 sphereZ = _mm256_loadu_ps(z + i);
+        __m256 sphereRadius = _mm256_loadu_ps(radius + i);
+        int outside = 0;
+        for (int p = 0; p < 6; p++)
+        {
+            const float* plane = frustum->planes[p];
+            __m256 distance = _mm256_add_ps(_mm256_set1_ps(plane[3]), sphereRadius);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane[0]), sphereX));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane[1]), sphereY));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane[2]), sphereZ));
+            outside |= _mm256_movemask_ps(_mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+        int lanes = std::min(8, end - i);
+        for (int lane = 0; lane < lanes; lane++)
+        {
+            if (!(outside & (1 << lane)))
+            {
+                visible[written++] = ids ? ids[i + lane] : i + lane;
+            }
+        }
+    }
+#endif
+#if !defined(SIMD_SCALAR)
+    for (; i < end && (padded || i + 4 <= end); i += 4)
+    {
+        SimdFloat4 sphereX = simdLoad(x + i);
+        SimdFloat4 sphereY = simdLoad(y + i);
+        SimdFloat4 sphereZ = simdLoad(z + i);
+        SimdFloat4 sphereRadius = simdLoad(radius + i);
+        int outside = 0;
+        for (int p = 0; p < 6; p++)
+        {
+            const float* plane = frustum->planes[p];
+            SimdFloat4 distance = simdAdd(simdSplat(plane[3]), sphereRadius);
+            distance = simdMulAdd(distance, simdSplat(plane[0]), sphereX);
+            distance = simdMulAdd(distance, simdSplat(plane[1]), sphereY);
+            distance = simdMulAdd(distance, simdSplat(plane[2]), sphereZ);
+            outside |= simdNegativeMask(distance);
+        }
+        int lanes = std::min(4, end - i);
+        for (int lane = 0; lane < lanes; lane++)
+        {
+            if (!(outside & (1 << lane)))
+            {
+                visible[written++] = ids ? ids[i + lane] : i + lane;
+            }
+        }
+    }
+#endif
+    for (; i < end; i++)
+    {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++)
+        {
+            const float* plane = frustum->planes[p];
+            inside = plane[3] + radius[i] + plane[0] * x[i] + plane[1] * y[i] + plane[2] * z[i] >= 0.0f;
+        }
+        if (inside)
+        {
+            visible[written++] = ids ? ids[i] : i;
+        }
+    }
+    return written;
+}
+
+int cullSpheres(const Frustum* frustum, const float* x, const float* y, const float* z, const float* radius,
+                int count, int* visible)
+{
+    return testSpheres(frustum, x, y, z, radius, 0, count, false, NULL, visible);
+}
+
+/**
+ * 4个子包围盒和6个平面比较，outside的第i位表示第i个盒子在视锥外，intersect的第i位表示它和视锥边界相交
+ */
+static void testBoxes(const Frustum* frustum, const CullNode& node, int* outside, int* intersect)
+{
+    *outside = 0;
+    *intersect = 0;
+#if !defined(SIMD_SCALAR)
+    SimdFloat4 minimum[3] = {simdLoad(node.minX), simdLoad(node.minY), simdLoad(node.minZ)};
+    SimdFloat4 maximum[3] = {simdLoad(node.maxX), simdLoad(node.maxY), simdLoad(node.maxZ)};
+    for (int p = 0; p < 6; p++)
+    {
+        const float* plane = frustum->planes[p];
+        // 法线分量为正时，该轴上离平面内侧最远的是max，最近的是min
+        SimdFloat4 farthest = simdSplat(plane[3]);
+        SimdFloat4 nearest = farthest;
+        for (int k = 0; k < 3; k++)
+        {
+            SimdFloat4 coefficient = simdSplat(plane[k]);
+            bool positive = plane[k] >= 0.0f;
+            farthest = simdMulAdd(farthest, coefficient, positive ? maximum[k] : minimum[k]);
+            nearest = simdMulAdd(nearest, coefficient, positive ? minimum[k] : maximum[k]);
+        }
+        *outside |= simdNegativeMask(farthest);
+        *intersect |= simdNegativeMask(nearest);
+    }
+#else
+    const float* minimum[3] = {node.minX, node.minY, node.minZ};
+    const float* maximum[3] = {node.maxX, node.maxY, node.maxZ};
+    for (int slot = 0; slot < cullHierarchyWidth; slot++)
+    {
+        for (int p = 0; p < 6; p++)
+        {
+            const float* plane = frustum->planes[p];
+            float farthest = plane[3];
+            float nearest = plane[3];
+            for (int k = 0; k < 3; k++)
+            {
+                bool positive = plane[k] >= 0.0f;
+                farthest += plane[k] * (positive ? maximum[k][slot] : minimum[k][slot]);
+                nearest += plane[k] * (positive ? minimum[k][slot] : maximum[k][slot]);
+            }
+            *outside |= (farthest < 0.0f) << slot;
+            *intersect |= (nearest < 0.0f) << slot;
+        }
+    }
+#endif
+}
+
+// 子树完全在视锥内，不用测试，直接输出全部物体
+static int appendSubtree(const CullHierarchy* hierarchy, int nodeIndex, int* visible, CullStats* stats)
+{
+    const CullNode& node = hierarchy->nodes[nodeIndex];
+    int written = 0;
+    stats->nodesVisited++;
+    for (int slot = 0; slot < cullHierarchyWidth; slot++)
+    {
+        if (node.count[slot] > 0)
+        {
+            memcpy(visible + written, &hierarchy->objects[node.child[slot]], node.count[slot] * sizeof(int));
+            written += node.count[slot];
+        }
+        else if (node.count[slot] == 0)
+        {
+            written += appendSubtree(hierarchy, node.child[slot], visible + written, stats);
+        }
+    }
+    return written;
+}
+
+int cullHierarchy(const CullHierarchy* hierarchy, const Frustum* frustum, int* visible, CullStats* stats)
+{
+    CullStats local;
+    if (stats == NULL)
+    {
+        stats = &local;
+    }
+    memset(stats, 0, sizeof(CullStats));
+    double start = currentMilliseconds();
+    int written = 0;
+    if (hierarchy->objectCount > 0)
+    {
+        // 4叉树的深度不会超过log4(物体个数)，64层足够
+        int stack[64 * cullHierarchyWidth];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const CullNode& node = hierarchy->nodes[stack[--top]];
+            stats->nodesVisited++;
+            stats->boxesTested += cullHierarchyWidth;
+            int outside, intersect;
+            testBoxes(frustum, node, &outside, &intersect);
+            for (int slot = 0; slot < cullHierarchyWidth; slot++)
+            {
+                if (node.count[slot] < 0 || (outside & (1 << slot)))
+                {
+                    continue;
+                }
+                bool inside = !(intersect & (1 << slot));
+                if (node.count[slot] == 0)
+                {
+                    if (inside)
+                    {
+                        written += appendSubtree(hierarchy, node.child[slot], visible + written, stats);
+                    }
+                    else
+                    {
+                        stack[top++] = node.child[slot];
+                    }
+                }
+                else if (inside)
+                {
+                    memcpy(visible + written, &hierarchy->objects[node.child[slot]], node.count[slot] * sizeof(int));
+                    written += node.count[slot];
+                }
+                else
+                {
+                    stats->spheresTested += node.count[slot];
+                    written += testSpheres(frustum, &hierarchy->sphereX[0], &hierarchy->sphereY[0], &hierarchy->sphereZ[0],
+                                           &hierarchy->sphereRadius[0], node.child[slot], node.count[slot], true,
+                                           &hierarchy->objects[0], visible + written);
+                }
+            }
+        }
+    }
+    stats->objects = hierarchy->objectCount;
+    stats->visible = written;
+    stats->milliseconds = currentMilliseconds() - start;
+    return written;
+}
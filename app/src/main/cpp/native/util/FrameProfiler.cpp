@@ -0,0 +1,267 @@
+/**
+ * --- 帧耗时统计 ---
+ *
+ * 每帧记录各阶段（清屏、矩阵、状态设置、绘制）的CPU时间，以及整帧的CPU时间和GPU时间，
+ * 放进每个阶段一个滚动直方图里，随时可以取出最近frameProfileWindow帧的p50/p95/p99，用于上报帧时间数据。
+ *
+ * 直方图的桶按对数划分，每个2倍区间分8个桶（相邻桶相差约9%），从1微秒到约1秒，记录和取分位数都不需要排序。
+ * 每个阶段另外保存最近frameProfileWindow个样本，窗口满了以后记录新样本时把最旧的样本从直方图里减掉。
+ *
+ * GPU时间：设备支持GL_EXT_disjoint_timer_query时，每帧用一个GL_TIME_ELAPSED_EXT查询包住，
+ * 查询对象轮流使用，结果通常晚几帧才能拿到，拿到时再记录。GPU_DISJOINT（降频、切换上下文等）期间的结果不可信，直接丢掉。
+ * 主机构建只有CPU计时。
+ *
+ * 记录在GL线程上进行，读取可以在其它线程（JNI调用），两者之间用一把锁，每帧只在endFrameProfile里加锁一次。
+ */
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#if defined(__ANDROID__)
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#endif
+
+#include "../include/FrameProfiler.h"
+#include "../include/LogUtil.h"
+
+static const int bucketsPerOctave = 8;
+static const int bucketCount = 20 * bucketsPerOctave; // 1微秒到2^20微秒
+
+struct RollingHistogram
+{
+    int buckets[bucketCount];
+    float samples[frameProfileWindow]; // 微秒
+    int next;
+    int count;
+};
+
+static RollingHistogram histograms[FRAME_PHASE_COUNT];
+static std::mutex profileMutex;
+
+typedef std::chrono::steady_clock Clock;
+static Clock::time_point frameStart;
+static Clock::time_point phaseStart[FRAME_PHASE_COUNT];
+static float phaseMicroseconds[FRAME_PHASE_COUNT]; // 当前帧各阶段累计的时间
+
+static int bucketOf(float microseconds)
+{
+    if (microseconds <= 1.0f)
+    {
+        return 0;
+    }
+    int bucket = (int) (log2f(microseconds) * bucketsPerOctave);
+    return bucket < bucketCount ? bucket : bucketCount - 1;
+}
+
+static void recordSample(RollingHistogram* histogram, float microseconds)
+{
+    if (histogram->count == frameProfileWindow)
+    {
+        histogram->buckets[bucketOf(histogram->samples[histogram->next])]--;
+    }
+    else
+    {
+        histogram->count++;
+    }
+    histogram->samples[histogram->next] = microseconds;
+    histogram->buckets[bucketOf(microseconds)]++;
+    histogram->next = (histogram->next + 1) % frameProfileWindow;
+}
+
+// 返回第percent百分位所在桶的中点（几何平均），单位毫秒
+static float percentile(const RollingHistogram* histogram, int percent)
+{
+    if (histogram->count == 0)
+    {
+        return 0.0f;
+    }
+    int rank = (histogram->count * percent + 99) / 100; // 向上取整，至少为1
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+    int seen = 0;
+    for (int i = 0; i < bucketCount; i++)
+    {
+        seen += histogram->buckets[i];
+        if (seen >= rank)
+        {
+            return exp2f(((float) i + 0.5f) / bucketsPerOctave) / 1000.0f;
+        }
+    }
+    return exp2f((float) bucketCount / bucketsPerOctave) / 1000.0f;
+}
+
+static const int gpuQueryCount = 4; // GPU一般落后CPU两三帧，4个查询轮流用足够了
+
+#if defined(__ANDROID__)
+static PFNGLGENQUERIESEXTPROC genQueries;
+static PFNGLDELETEQUERIESEXTPROC deleteQueries;
+static PFNGLBEGINQUERYEXTPROC beginQuery;
+static PFNGLENDQUERYEXTPROC endQuery;
+static PFNGLGETQUERYOBJECTIVEXTPROC getQueryObjectiv;
+static PFNGLGETQUERYOBJECTUI64VEXTPROC getQueryObjectui64v;
+static GLuint gpuQueries[gpuQueryCount];
+static bool gpuQueryPending[gpuQueryCount];
+static int gpuQueryNext; // 下一个要使用的查询，也是最早发出、还没拿到结果的查询
+static bool gpuQueryActive;
+#endif
+static bool gpuTimers = false;
+
+static void initGpuTimers()
+{
+#if defined(__ANDROID__)
+    if (gpuTimers)
+    {
+        deleteQueries(gpuQueryCount, gpuQueries); // 上下文重建后这些名字已经无效，删除会被忽略
+    }
+    const char* extensions = (const char*) glGetString(GL_EXTENSIONS);
+    gpuTimers = extensions != NULL && strstr(extensions, "GL_EXT_disjoint_timer_query") != NULL;
+    if (!gpuTimers)
+    {
+        LOGI("GL_EXT_disjoint_timer_query not supported, GPU frame time disabled");
+        return;
+    }
+    genQueries = (PFNGLGENQUERIESEXTPROC) eglGetProcAddress("glGenQueriesEXT");
+    deleteQueries = (PFNGLDELETEQUERIESEXTPROC) eglGetProcAddress("glDeleteQueriesEXT");
+    beginQuery = (PFNGLBEGINQUERYEXTPROC) eglGetProcAddress("glBeginQueryEXT");
+    endQuery = (PFNGLENDQUERYEXTPROC) eglGetProcAddress("glEndQueryEXT");
+    getQueryObjectiv = (PFNGLGETQUERYOBJECTIVEXTPROC) eglGetProcAddress("glGetQueryObjectivEXT");
+    getQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VEXTPROC) eglGetProcAddress("glGetQueryObjectui64vEXT");
+    if (genQueries == NULL || deleteQueries == NULL || beginQuery == NULL || endQuery == NULL ||
+        getQueryObjectiv == NULL || getQueryObjectui64v == NULL)
+    {
+        LOGE("GL_EXT_disjoint_timer_query advertised but entry points missing");
+        gpuTimers = false;
+        return;
+    }
+    genQueries(gpuQueryCount, gpuQueries);
+    memset(gpuQueryPending, 0, sizeof(gpuQueryPending));
+    gpuQueryNext = 0;
+    gpuQueryActive = false;
+    GLint disjoint;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint); // 读取一次，清掉之前的GPU_DISJOINT状态
+#endif
+}
+
+#if defined(__ANDROID__)
+// 依次取回已经完成的查询结果，返回拿到的GPU时间个数
+static int collectGpuTimes(float* microseconds)
+{
+    int collected = 0;
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint); // 读取后状态被清除
+    for (int i = 0; i < gpuQueryCount; i++)
+    {
+        int query = (gpuQueryNext + i) % gpuQueryCount;
+        if (!gpuQueryPending[query])
+        {
+            continue;
+        }
+        GLint available = 0;
+        getQueryObjectiv(gpuQueries[query], GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+        if (!available)
+        {
+            break; // 查询按顺序完成，后面的也还没有结果
+        }
+        GLuint64 nanoseconds = 0;
+        getQueryObjectui64v(gpuQueries[query], GL_QUERY_RESULT_EXT, &nanoseconds);
+        gpuQueryPending[query] = false;
+        if (!disjoint)
+        {
+            microseconds[collected++] = (float) nanoseconds / 1000.0f;
+        }
+    }
+    return collected;
+}
+#endif
+
+void initFrameProfiler()
+{
+    {
+        std::lock_guard<std::mutex> lock(profileMutex);
+        memset(histograms, 0, sizeof(histograms));
+    }
+    initGpuTimers();
+}
+
+void beginFrameProfile()
+{
+    memset(phaseMicroseconds, 0, sizeof(phaseMicroseconds));
+#if defined(__ANDROID__)
+    // 轮到的查询还没拿到结果（GPU落后太多）时这一帧不计GPU时间
+    if (gpuTimers && !gpuQueryPending[gpuQueryNext])
+    {
+        beginQuery(GL_TIME_ELAPSED_EXT, gpuQueries[gpuQueryNext]);
+        gpuQueryActive = true;
+    }
+#endif
+    frameStart = Clock::now();
+}
+
+void endFrameProfile()
+{
+    phaseMicroseconds[FRAME_PHASE_CPU] = std::chrono::duration<float, std::micro>(Clock::now() - frameStart).count();
+    float gpuMicroseconds[gpuQueryCount];
+    int gpuSamples = 0;
+#if defined(__ANDROID__)
+    if (gpuQueryActive)
+    {
+        endQuery(GL_TIME_ELAPSED_EXT);
+        gpuQueryPending[gpuQueryNext] = true;
+        gpuQueryNext = (gpuQueryNext + 1) % gpuQueryCount;
+        gpuQueryActive = false;
+    }
+    if (gpuTimers)
+    {
+        gpuSamples = collectGpuTimes(gpuMicroseconds);
+    }
+#endif
+    std::lock_guard<std::mutex> lock(profileMutex);
+    for (int phase = 0; phase < FRAME_PHASE_GPU; phase++)
+    {
+        recordSample(&histograms[phase], phaseMicroseconds[phase]);
+    }
+    for (int i = 0; i < gpuSamples; i++)
+    {
+        recordSample(&histograms[FRAME_PHASE_GPU], gpuMicroseconds[i]);
+    }
+}
+
+void beginFramePhase(FramePhase phase)
+{
+    phaseStart[phase] = Clock::now();
+}
+
+void endFramePhase(FramePhase phase)
+{
+    phaseMicroseconds[phase] += std::chrono::duration<float, std::micro>(Clock::now() - phaseStart[phase]).count();
+}
+
+void getFrameProfile(FrameProfile* profile)
+{
+    std::lock_guard<std::mutex> lock(profileMutex);
+    profile->frames = histograms[FRAME_PHASE_CPU].count;
+    profile->gpuTimers = gpuTimers;
+    for (int phase = 0; phase < FRAME_PHASE_COUNT; phase++)
+    {
+        profile->p50[phase] = percentile(&histograms[phase], 50);
+        profile->p95[phase] = percentile(&histograms[phase], 95);
+        profile->p99[phase] = percentile(&histograms[phase], 99);
+    }
+}
+
+void packFrameProfile(const FrameProfile* profile, float* out)
+{
+    out[0] = (float) profile->frames;
+    out[1] = profile->gpuTimers ? 1.0f : 0.0f;
+    for (int phase = 0; phase < FRAME_PHASE_COUNT; phase++)
+    {
+        out[2 + phase * 3] = profile->p50[phase];
+        out[3 + phase * 3] = profile->p95[phase];
+        out[4 + phase * 3] = profile->p99[phase];
+    }
+}
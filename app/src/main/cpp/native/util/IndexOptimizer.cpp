@@ -0,0 +1,535 @@
+/**
+ * --- 索引优化 ---
+ *
+ * 顶点着色器的结果放在一个很小的变换后缓存里，连续的三角形共用顶点时才会命中。课程里手写的indices和导入的网格
+ * 都没有考虑这一点，这里分三步重排：
+ *    1.optimizeVertexCache：Forsyth的线性时间算法。每个顶点按它在（模拟的LRU）缓存中的位置和还没画的三角形个数打分，
+ *      每次从缓存里的顶点相邻的三角形中选分数最高的一个输出，只更新缓存中的顶点，所以是线性时间；
+ *      找不到时（网格的一块画完了）按原顺序取下一个没画的三角形
+ *    2.optimizeOverdraw：Sander等人的做法（TIPSY）。在缓存优化后的顺序上，三个顶点都未命中的位置缓存相当于重新开始，
+ *      在这里切开不会让ACMR变差；切出的簇再按ACMR不超过threshold倍的条件细分。每个簇按面积加权的中心和法线，
+ *      中心在法线方向上离网格中心越远的簇越可能在外面、挡住别的簇，排在前面
+ *    3.optimizeVertexFetchRemap：按顶点第一次被引用的顺序重排顶点数据，读顶点时缓存行的利用率更高
+ * 分析函数模拟同样的缓存，报告ACMR、ATVR、过度绘制和顶点读取量，用来比较优化前后。
+ */
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "../include/IndexOptimizer.h"
+
+static const int optimizerCacheSize = 16; // 打分时模拟的LRU缓存大小
+static const int maxValence = 32; // 剩余三角形数超过它时按它计算
+static const int overdrawGridSize = 256;
+static const size_t fetchCacheLine = 64;
+static const int fetchCacheLines = 128 * 1024 / 64;
+
+struct ScoreTables
+{
+    float cache[optimizerCacheSize + 1]; // 下标0表示不在缓存中
+    float valence[maxValence + 1];
+
+    ScoreTables()
+    {
+        cache[0] = 0.0f;
+        for (int i = 0; i < optimizerCacheSize; i++)
+        {
+            // 最近一个三角形的3个顶点固定分数，避免总是紧挨着用同一条边；之后按位置衰减
+            cache[i + 1] = i < 3 ? 0.75f : powf(1.0f - (float) (i - 3) / (optimizerCacheSize - 3), 1.5f);
+        }
+        valence[0] = 0.0f;
+        for (int i = 1; i <= maxValence; i++)
+        {
+            // 剩余三角形少的顶点优先，尽快画完孤立的三角形
+            valence[i] = 2.0f / sqrtf((float) i);
+        }
+    }
+};
+
+static float vertexScore(const ScoreTables& tables, int cachePosition, int liveTriangles)
+{
+    if (liveTriangles == 0)
+    {
+        return -1.0f;
+    }
+    return tables.cache[cachePosition + 1] + tables.valence[std::min(liveTriangles, maxValence)];
+}
+
+void analyzeVertexCache(const unsigned int* indices, int indexCount, int vertexCount, VertexCacheStats* stats)
+{
+    memset(stats, 0, sizeof(VertexCacheStats));
+    // FIFO缓存用时间戳模拟：未命中时时间加1，顶点的时间戳在最近vertexCacheSize次未命中以内就还在缓存里
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<char> used(vertexCount, 0);
+    unsigned int time = vertexCacheSize + 1;
+    for (int i = 0; i < indexCount; i++)
+    {
+        unsigned int v = indices[i];
+        if (time - cacheTime[v] > (unsigned int) vertexCacheSize)
+        {
+            cacheTime[v] = time++;
+            stats->transforms++;
+        }
+        stats->vertices += used[v] == 0;
+        used[v] = 1;
+    }
+    stats->triangles = indexCount / 3;
+    stats->acmr = stats->triangles > 0 ? (float) stats->transforms / stats->triangles : 0.0f;
+    stats->atvr = stats->vertices > 0 ? (float) stats->transforms / stats->vertices : 0.0f;
+}
+
+/**
+ * 面积为负时三角形内的边函数都小于0。正好落在边上的像素中心（网格顶点经常和像素中心重合）按把它向(+x, +y²)
+ * 方向稍微挪动后的位置判断，共用一条边或一个顶点的三角形中只有一个会画这个像素。
+ */
+static inline bool insideEdge(float w, float dx, float dy)
+{
+    return w < 0.0f || (w == 0.0f && (dy > 0.0f || (dy == 0.0f && dx < 0.0f)));
+}
+
+// 光栅化一个三角形，像素中心在三角形内（含边上）且深度更小时写入
+static void rasterizeTriangle(const float* a, const float* b, const float* c, float* depth, int* shaded)
+{
+    float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+    if (area >= 0.0f)
+    {
+        return; // 背面和退化的三角形
+    }
+    int minX = std::max(0, (int) floorf(std::min(a[0], std::min(b[0], c[0]))));
+    int maxX = std::min(overdrawGridSize - 1, (int) ceilf(std::max(a[0], std::max(b[0], c[0]))));
+    int minY = std::max(0, (int) floorf(std::min(a[1], std::min(b[1], c[1]))));
+    int maxY = std::min(overdrawGridSize - 1, (int) ceilf(std::max(a[1], std::max(b[1], c[1]))));
+    for (int y = minY; y <= maxY; y++)
+    {
+        float py = y + 0.5f;
+        for (int x = minX; x <= maxX; x++)
+        {
+            float px = x + 0.5f;
+            float wa = (c[0] - b[0]) * (py - b[1]) - (c[1] - b[1]) * (px - b[0]);
+            float wb = (a[0] - c[0]) * (py - c[1]) - (a[1] - c[1]) * (px - c[0]);
+            float wc = (b[0] - a[0]) * (py - a[1]) - (b[1] - a[1]) * (px - a[0]);
+            if (!insideEdge(wa, c[0] - b[0], c[1] - b[1]) || !insideEdge(wb, a[0] - c[0], a[1] - c[1]) ||
+                !insideEdge(wc, b[0] - a[0], b[1] - a[1]))
+            {
+                continue;
+            }
+            float z = (wa * a[2] + wb * b[2] + wc * c[2]) / area;
+            float& stored = depth[y * overdrawGridSize + x];
+            if (z < stored)
+            {
+                stored = z;
+                (*shaded)++;
+            }
+        }
+    }
+}
+
+void analyzeOverdraw(const unsigned int* indices, int indexCount, const float* positions, int vertexCount,
+                     OverdrawStats* stats)
+{
+    memset(stats, 0, sizeof(OverdrawStats));
+    float boundsMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float boundsMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (int v = 0; v < vertexCount; v++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            boundsMin[k] = std::min(boundsMin[k], positions[v * 3 + k]);
+            boundsMax[k] = std::max(boundsMax[k], positions[v * 3 + k]);
+        }
+    }
+    float extent = std::max(boundsMax[0] - boundsMin[0], std::max(boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2]));
+    if (vertexCount == 0 || extent <= 0.0f)
+    {
+        return;
+    }
+    float scale = overdrawGridSize / extent;
+    std::vector<float> depth(overdrawGridSize * overdrawGridSize);
+    std::vector<float> projected((size_t) vertexCount * 3);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        for (int direction = 0; direction < 2; direction++)
+        {
+            // 轴按循环顺序排列保持右手系；反方向看时x镜像、深度取反，正面的三角形面积仍然为负
+            for (int v = 0; v < vertexCount; v++)
+            {
+                float a = (positions[v * 3 + (axis + 1) % 3] - boundsMin[(axis + 1) % 3]) * scale;
+                float b = (positions[v * 3 + (axis + 2) % 3] - boundsMin[(axis + 2) % 3]) * scale;
+                float c = positions[v * 3 + axis] - boundsMin[axis];
+                projected[v * 3] = direction == 0 ? a : overdrawGridSize - a;
+                projected[v * 3 + 1] = b;
+                projected[v * 3 + 2] = direction == 0 ? c : -c;
+            }
+            std::fill(depth.begin(), depth.end(), FLT_MAX);
+            for (int i = 0; i + 2 < indexCount; i += 3)
+            {
+                rasterizeTriangle(&projected[indices[i] * 3], &projected[indices[i + 1] * 3],
+                                  &projected[indices[i + 2] * 3], &depth[0], &stats->shaded);
+            }
+            for (size_t p = 0; p < depth.size(); p++)
+            {
+                stats->covered += depth[p] != FLT_MAX;
+            }
+        }
+    }
+    stats->overdraw = stats->covered > 0 ? (float) stats->shaded / stats->covered : 0.0f;
+}
+
+void analyzeVertexFetch(const unsigned int* indices, int indexCount, int vertexCount, size_t vertexBytes,
+                        VertexFetchStats* stats)
+{
+    memset(stats, 0, sizeof(VertexFetchStats));
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    unsigned int time = vertexCacheSize + 1;
+    size_t tags[fetchCacheLines];
+    memset(tags, 0, sizeof(tags));
+    for (int i = 0; i < indexCount; i++)
+    {
+        unsigned int v = indices[i];
+        if (time - cacheTime[v] <= (unsigned int) vertexCacheSize)
+        {
+            continue; // 变换后缓存命中，不需要读顶点
+        }
+        cacheTime[v] = time++;
+        size_t first = v * vertexBytes / fetchCacheLine;
+        size_t last = ((size_t) v * vertexBytes + vertexBytes - 1) / fetchCacheLine;
+        for (size_t line = first; line <= last; line++)
+        {
+            size_t& tag = tags[line % fetchCacheLines];
+            if (tag != line + 1)
+            {
+                tag = line + 1;
+                stats->bytesFetched += fetchCacheLine;
+            }
+        }
+    }
+    size_t total = (size_t) vertexCount * vertexBytes;
+    stats->overfetch = total > 0 ? (float) stats->bytesFetched / total : 0.0f;
+}
+
+void optimizeVertexCache(unsigned int* destination, const unsigned int* indices, int indexCount, int vertexCount)
+{
+    static const ScoreTables tables;
+    int triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+    // 每个顶点相邻的三角形，liveTriangles[v]个还没画的排在前面
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    for (int i = 0; i < triangleCount * 3; i++)
+    {
+        adjacencyOffsets[indices[i] + 1]++;
+    }
+    for (int v = 0; v < vertexCount; v++)
+    {
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    std::vector<int> liveTriangles(vertexCount, 0);
+    for (int i = 0; i < triangleCount * 3; i++)
+    {
+        unsigned int v = indices[i];
+        adjacency[adjacencyOffsets[v] + liveTriangles[v]++] = (unsigned int) (i / 3);
+    }
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> scores(vertexCount);
+    for (int v = 0; v < vertexCount; v++)
+    {
+        scores[v] = vertexScore(tables, -1, liveTriangles[v]);
+    }
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<unsigned int> output(triangleCount * 3);
+    unsigned int cache[optimizerCacheSize + 3];
+    unsigned int nextCache[optimizerCacheSize + 3];
+    int cacheCount = 0;
+    int cursor = 0;
+    int current = 0;
+    for (int emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+    {
+        const unsigned int* triangle = indices + current * 3;
+        memcpy(&output[emittedCount * 3], triangle, sizeof(unsigned int) * 3);
+        emitted[current] = 1;
+        int nextCount = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = triangle[k];
+            // 从v的相邻列表中移除这个三角形（退化三角形会在列表里出现多次，每个角移除一次）
+            unsigned int* list = &adjacency[adjacencyOffsets[v]];
+            for (int j = 0; j < liveTriangles[v]; j++)
+            {
+                if (list[j] == (unsigned int) current)
+                {
+                    list[j] = list[--liveTriangles[v]];
+                    break;
+                }
+            }
+            if (std::find(nextCache, nextCache + nextCount, v) == nextCache + nextCount)
+            {
+                nextCache[nextCount++] = v;
+            }
+        }
+        for (int i = 0; i < cacheCount; i++)
+        {
+            unsigned int v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+            {
+                nextCache[nextCount++] = v;
+            }
+        }
+        // 只有缓存中的顶点（和刚被挤出去的）分数会变
+        for (int i = 0; i < nextCount; i++)
+        {
+            unsigned int v = nextCache[i];
+            cachePosition[v] = i < optimizerCacheSize ? i : -1;
+            scores[v] = vertexScore(tables, cachePosition[v], liveTriangles[v]);
+        }
+        cacheCount = std::min(nextCount, optimizerCacheSize);
+        memcpy(cache, nextCache, sizeof(unsigned int) * cacheCount);
+        int best = -1;
+        float bestScore = 0.0f;
+        for (int i = 0; i < cacheCount; i++)
+        {
+            unsigned int v = cache[i];
+            const unsigned int* list = &adjacency[adjacencyOffsets[v]];
+            for (int j = 0; j < liveTriangles[v]; j++)
+            {
+                const unsigned int* candidate = indices + list[j] * 3;
+                float score = scores[candidate[0]] + scores[candidate[1]] + scores[candidate[2]];
+                if (score > bestScore)
+                {
+                    best = (int) list[j];
+                    bestScore = score;
+                }
+            }
+        }
+        if (best < 0)
+        {
+            while (cursor < triangleCount && emitted[cursor])
+            {
+                cursor++;
+            }
+            best = cursor;
+        }
+        current = best;
+    }
+    memcpy(destination, &output[0], sizeof(unsigned int) * triangleCount * 3);
+}
+
+struct TriangleCluster
+{
+    int first; // 第一个三角形
+    int count;
+    float sortKey;
+};
+
+static bool compareClusters(const TriangleCluster& a, const TriangleCluster& b)
+{
+    return a.sortKey > b.sortKey;
+}
+
+// 按当前的缓存状态处理一个三角形，返回未命中的顶点数
+static int simulateTriangle(const unsigned int* triangle, std::vector<unsigned int>* cacheTime, unsigned int* time)
+{
+    int misses = 0;
+    for (int k = 0; k < 3; k++)
+    {
+        unsigned int& stamp = (*cacheTime)[triangle[k]];
+        if (*time - stamp > (unsigned int) vertexCacheSize)
+        {
+            stamp = (*time)++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+void optimizeOverdraw(unsigned int* destination, const unsigned int* indices, int indexCount, const float* positions,
+                      int vertexCount, float threshold)
+{
+    int triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+    // 三个顶点都未命中的三角形是硬边界，从这里开始的簇不依赖前面的缓存状态
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    unsigned int time = vertexCacheSize + 1;
+    std::vector<unsigned char> misses(triangleCount);
+    std::vector<int> hardBoundaries;
+    for (int t = 0; t < triangleCount; t++)
+    {
+        misses[t] = (unsigned char) simulateTriangle(indices + t * 3, &cacheTime, &time);
+        if (t == 0 || misses[t] == 3)
+        {
+            hardBoundaries.push_back(t);
+        }
+    }
+    hardBoundaries.push_back(triangleCount);
+    // 软边界：在硬边界之间，从冷缓存开始的ACMR降到整个硬簇的threshold倍以内时就可以切开
+    std::vector<TriangleCluster> clusters;
+    for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+    {
+        int start = hardBoundaries[h];
+        int end = hardBoundaries[h + 1];
+        int hardMisses = 0;
+        for (int t = start; t < end; t++)
+        {
+            hardMisses += misses[t];
+        }
+        float limit = threshold * hardMisses / (end - start);
+        time += vertexCacheSize + 1;
+        int clusterStart = start;
+        int runningMisses = 0;
+        for (int t = start; t < end; t++)
+        {
+            runningMisses += simulateTriangle(indices + t * 3, &cacheTime, &time);
+            int runningTriangles = t - clusterStart + 1;
+            if (t + 1 < end && runningMisses <= limit * runningTriangles)
+            {
+                TriangleCluster cluster = {clusterStart, runningTriangles, 0.0f};
+                clusters.push_back(cluster);
+                clusterStart = t + 1;
+                runningMisses = 0;
+                time += vertexCacheSize + 1;
+            }
+        }
+        TriangleCluster cluster = {clusterStart, end - clusterStart, 0.0f};
+        clusters.push_back(cluster);
+    }
+    float meshCentroid[3] = {0.0f, 0.0f, 0.0f};
+    for (int v = 0; v < vertexCount; v++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            meshCentroid[k] += positions[v * 3 + k] / vertexCount;
+        }
+    }
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        TriangleCluster& cluster = clusters[c];
+        float centroid[3] = {0.0f, 0.0f, 0.0f};
+        float normal[3] = {0.0f, 0.0f, 0.0f};
+        float area = 0.0f;
+        for (int t = cluster.first; t < cluster.first + cluster.count; t++)
+        {
+            const float* a = positions + indices[t * 3] * 3;
+            const float* b = positions + indices[t * 3 + 1] * 3;
+            const float* d = positions + indices[t * 3 + 2] * 3;
+            float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            float e2[3] = {d[0] - a[0], d[1] - a[1], d[2] - a[2]};
+            // 叉积的长度是面积的两倍，直接作为面积加权的法线
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            float weight = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; k++)
+            {
+                centroid[k] += (a[k] + b[k] + d[k]) * (weight / 3.0f);
+                normal[k] += n[k];
+            }
+            area += weight;
+        }
+        float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (area > 0.0f && length > 0.0f)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                cluster.sortKey += (centroid[k] / area - meshCentroid[k]) * normal[k] / length;
+            }
+        }
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), compareClusters);
+    unsigned int* output = destination;
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        memcpy(output, indices + clusters[c].first * 3, sizeof(unsigned int) * clusters[c].count * 3);
+        output += clusters[c].count * 3;
+    }
+}
+
+int optimizeVertexFetchRemap(unsigned int* remap, const unsigned int* indices, int indexCount, int vertexCount)
+{
+    memset(remap, 0xFF, sizeof(unsigned int) * vertexCount);
+    unsigned int next = 0;
+    for (int i = 0; i < indexCount; i++)
+    {
+        if (remap[indices[i]] == ~0u)
+        {
+            remap[indices[i]] = next++;
+        }
+    }
+    return (int) next;
+}
+
+void remapIndices(unsigned int* indices, int indexCount, const unsigned int* remap)
+{
+    for (int i = 0; i < indexCount; i++)
+    {
+        indices[i] = remap[indices[i]];
+    }
+}
+
+void remapVertices(void* destination, const void* vertices, int vertexCount, size_t vertexBytes,
+                   const unsigned int* remap)
+{
+    for (int v = 0; v < vertexCount; v++)
+    {
+        if (remap[v] != ~0u)
+        {
+            memcpy((unsigned char*) destination + remap[v] * vertexBytes, (const unsigned char*) vertices + v * vertexBytes,
+                   vertexBytes);
+        }
+    }
+}
+
+static void remapArray(std::vector<float>* values, int components, int vertexCount, int remappedCount,
+                       const unsigned int* remap)
+{
+    if (values->empty())
+    {
+        return;
+    }
+    std::vector<float> remapped((size_t) remappedCount * components);
+    remapVertices(&remapped[0], &(*values)[0], vertexCount, sizeof(float) * components, remap);
+    values->swap(remapped);
+}
+
+void optimizeImportedMesh(ImportedMesh* mesh, float overdrawThreshold)
+{
+    if (mesh->indexCount == 0)
+    {
+        return;
+    }
+    std::vector<unsigned int> indices;
+    if (mesh->indexType == GL_UNSIGNED_SHORT)
+    {
+        indices.assign(mesh->shortIndices.begin(), mesh->shortIndices.end());
+    }
+    else
+    {
+        indices.swap(mesh->indices);
+    }
+    std::vector<unsigned int> reordered(indices.size());
+    optimizeVertexCache(&indices[0], &indices[0], mesh->indexCount, mesh->vertexCount);
+    optimizeOverdraw(&reordered[0], &indices[0], mesh->indexCount, &mesh->positions[0], mesh->vertexCount,
+                     overdrawThreshold);
+    std::vector<unsigned int> remap(mesh->vertexCount);
+    int remappedCount = optimizeVertexFetchRemap(&remap[0], &reordered[0], mesh->indexCount, mesh->vertexCount);
+    remapIndices(&reordered[0], mesh->indexCount, &remap[0]);
+    remapArray(&mesh->positions, 3, mesh->vertexCount, remappedCount, &remap[0]);
+    remapArray(&mesh->normals, 3, mesh->vertexCount, remappedCount, &remap[0]);
+    remapArray(&mesh->textureCords, 2, mesh->vertexCount, remappedCount, &remap[0]);
+    mesh->vertexCount = remappedCount;
+    mesh->shortIndices.clear();
+    if (remappedCount <= 65536)
+    {
+        mesh->indexType = GL_UNSIGNED_SHORT;
+        mesh->shortIndices.assign(reordered.begin(), reordered.end());
+    }
+    else
+    {
+        mesh->indexType = GL_UNSIGNED_INT;
+        mesh->indices.swap(reordered);
+    }
+}
@@ -1,6 +1,10 @@
-#include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
 
+#include "../include/LoadUtil.h"
 #include "../include/LogUtil.h"
 
 /**
@@ -40,12 +44,13 @@ GLuint loadShader(GLenum shaderType, const char* shaderSource)
 }
 
 /**
- * 创建着色器程序（持有着色器的东西）
+ * 从源码编译并链接着色器程序
  * @param vertexSource
  * @param fragmentSource
+ * @param retrievable 为true时提示驱动保留程序二进制，链接后可以用glGetProgramBinary取出来写入缓存
  * @return
  */
-GLuint createProgram(const char* vertexSource, const char * fragmentSource)
+static GLuint linkProgramFromSource(const char* vertexSource, const char * fragmentSource, bool retrievable)
 {
     GLuint vertexShader = loadShader(GL_VERTEX_SHADER, vertexSource); // 加载顶点着色器
     if (!vertexShader) // 确保加载成功
@@ -62,6 +67,10 @@ GLuint createProgram(const char* vertexSource, const char * fragmentSource)
     {
         glAttachShader(program , vertexShader); // 将顶点着色器添加到着色器程序
         glAttachShader(program, fragmentShader); // 将块着色器添加到着色器程序
+        if (retrievable)
+        {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); // 必须在链接前设置
+        }
         glLinkProgram(program); // 链接着色器程序
         GLint linkStatus = GL_FALSE; // 用于检查链接是否成功
         glGetProgramiv(program , GL_LINK_STATUS, &linkStatus); // 检查链接是否成功
@@ -85,3 +94,209 @@ GLuint createProgram(const char* vertexSource, const char * fragmentSource)
     }
     return program; // 返回着色器程序
 }
+
+/*
+ * --- 着色器程序二进制缓存 ---
+ *
+ * 每次setupGraphics（包括每次Surface重建）都要从源码编译链接着色器，着色器复杂之后这是冷启动和恢复时最耗时的部分。
+ * GLES3提供了glGetProgramBinary/glProgramBinary，可以把驱动链接好的程序二进制取出来存到磁盘上，下次直接加载。
+ *
+ * 缓存文件名是以下内容的64位FNV-1a哈希：顶点着色器源码、块着色器源码、GL_VENDOR、GL_RENDERER、GL_VERSION，
+ * 驱动升级后GL_VERSION会变化，自然就不会命中旧的缓存。即使哈希命中，驱动也有可能拒绝二进制（链接状态为失败），
+ * 这时删除缓存文件并回退到源码编译，再写入新的缓存。
+ *
+ * 文件格式：ProgramCacheHeader + 二进制数据。写入时先写临时文件再rename，避免进程被杀时留下半个文件。
+ */
+
+static const unsigned int programCacheMagic = 0x4250474C; // "LGPB"
+static const unsigned int programCacheVersion = 1;
+
+struct ProgramCacheHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long key; // 与文件名相同的哈希，防止文件被改名
+    unsigned int binaryFormat; // glGetProgramBinary返回的格式
+    unsigned int binaryLength;
+};
+
+static char programCacheDirectory[512] = {0}; // 为空表示不使用缓存
+static ProgramCacheStats programCacheStats;
+
+void setProgramCacheDirectory(const char* directory)
+{
+    if (directory == NULL)
+    {
+        programCacheDirectory[0] = '\0';
+        return;
+    }
+    snprintf(programCacheDirectory, sizeof(programCacheDirectory), "%s", directory);
+}
+
+void getProgramCacheStats(ProgramCacheStats* stats)
+{
+    *stats = programCacheStats;
+}
+
+void resetProgramCacheStats()
+{
+    memset(&programCacheStats, 0, sizeof(programCacheStats));
+}
+
+static double currentMilliseconds()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+}
+
+static unsigned long long hashString(unsigned long long hash, const char* string)
+{
+    const unsigned char* p = (const unsigned char*) (string ? string : "");
+    do // 连同结尾的'\0'一起计算，避免"ab"+"c"和"a"+"bc"得到相同的哈希
+    {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    } while (*p++);
+    return hash;
+}
+
+// 当前上下文是否支持程序二进制（GLES2上下文里GL_NUM_PROGRAM_BINARY_FORMATS是无效枚举，formats保持为0）
+static bool programBinarySupported()
+{
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    while (glGetError() != GL_NO_ERROR) {} // 清掉GLES2上下文产生的GL_INVALID_ENUM
+    return formats > 0;
+}
+
+static void programCachePath(char* path, size_t size, unsigned long long key)
+{
+    snprintf(path, size, "%s/%016llx.bin", programCacheDirectory, key);
+}
+
+// 从缓存文件加载程序，失败返回0。文件损坏或被驱动拒绝时删除文件。
+static GLuint loadProgramBinary(unsigned long long key, bool* rejected)
+{
+    char path[600];
+    programCachePath(path, sizeof(path), key);
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    ProgramCacheHeader header;
+    void* binary = NULL;
+    GLuint program = 0;
+    if (fread(&header, sizeof(header), 1, file) == 1 && header.magic == programCacheMagic &&
+        header.version == programCacheVersion && header.key == key && header.binaryLength > 0)
+    {
+        binary = malloc(header.binaryLength);
+        if (binary && fread(binary, 1, header.binaryLength, file) == header.binaryLength)
+        {
+            program = glCreateProgram();
+            glProgramBinary(program, header.binaryFormat, binary, header.binaryLength);
+            GLint linkStatus = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+            if (linkStatus != GL_TRUE)
+            {
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+    }
+    free(binary);
+    fclose(file);
+    if (program == 0)
+    {
+        LOGI("Program binary cache entry %s rejected, falling back to source", path);
+        remove(path);
+        *rejected = true;
+    }
+    return program;
+}
+
+static bool storeProgramBinary(GLuint program, unsigned long long key)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return false;
+    }
+    void* binary = malloc(length);
+    if (binary == NULL)
+    {
+        return false;
+    }
+    ProgramCacheHeader header;
+    GLenum binaryFormat = 0;
+    GLsizei binaryLength = 0;
+    glGetProgramBinary(program, length, &binaryLength, &binaryFormat, binary);
+    header.magic = programCacheMagic;
+    header.version = programCacheVersion;
+    header.key = key;
+    header.binaryFormat = binaryFormat;
+    header.binaryLength = binaryLength;
+    char path[600];
+    char temporaryPath[610];
+    programCachePath(path, sizeof(path), key);
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", path);
+    bool stored = false;
+    FILE* file = fopen(temporaryPath, "wb");
+    if (file != NULL)
+    {
+        stored = binaryLength > 0 && fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(binary, 1, binaryLength, file) == (size_t) binaryLength;
+        stored = (fclose(file) == 0) && stored;
+        stored = stored && rename(temporaryPath, path) == 0;
+        if (!stored)
+        {
+            remove(temporaryPath);
+        }
+    }
+    free(binary);
+    return stored;
+}
+
+/**
+ * 创建着色器程序（持有着色器的东西）
+ * 设置了缓存目录并且上下文支持程序二进制时，先尝试从缓存加载，没有命中再从源码编译并写入缓存。
+ * @param vertexSource
+ * @param fragmentSource
+ * @return
+ */
+GLuint createProgram(const char* vertexSource, const char * fragmentSource)
+{
+    if (programCacheDirectory[0] == '\0' || !programBinarySupported())
+    {
+        return linkProgramFromSource(vertexSource, fragmentSource, false);
+    }
+    double start = currentMilliseconds();
+    unsigned long long key = 14695981039346656037ULL;
+    key = hashString(key, vertexSource);
+    key = hashString(key, fragmentSource);
+    key = hashString(key, (const char*) glGetString(GL_VENDOR));
+    key = hashString(key, (const char*) glGetString(GL_RENDERER));
+    key = hashString(key, (const char*) glGetString(GL_VERSION));
+    bool rejected = false;
+    GLuint program = loadProgramBinary(key, &rejected);
+    if (program)
+    {
+        programCacheStats.hits++;
+        programCacheStats.hitMilliseconds += currentMilliseconds() - start;
+        return program;
+    }
+    if (rejected)
+    {
+        programCacheStats.rejected++;
+    }
+    program = linkProgramFromSource(vertexSource, fragmentSource, true);
+    if (program && storeProgramBinary(program, key))
+    {
+        programCacheStats.stores++;
+    }
+    programCacheStats.misses++;
+    programCacheStats.missMilliseconds += currentMilliseconds() - start;
+    return program;
+}
@@ -0,0 +1,385 @@
+/**
+ * --- 二进制网格缓存 ---
+ *
+ * OBJ、glb每次启动都要解析、去重、打包，网格大时要几百毫秒。缓存文件里存的就是最终要交给GL的数据：
+ * 打包好的交错顶点（VertexFormat.h的布局）和索引，加上布局描述、包围盒和各级LOD的索引范围。
+ * 加载时只需要mmap，检查文件头，然后把映射的指针直接传给glBufferData，没有解析也没有堆上的复制，
+ * 读文件的速度就是磁盘（或页缓存）的速度。
+ *
+ * 校验和是4路交错的64位乘法-循环移位哈希，每次处理32字节，比逐字节的CRC快很多；校验会读一遍整个文件，
+ * 文件可信（例如刚由本机转换）时可以跳过，代价只剩上传时的缺页。
+ */
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../include/MeshCache.h"
+#include "../include/LogUtil.h"
+
+static const char meshCacheMagic[8] = {'L', 'O', 'G', 'L', 'M', 'E', 'S', 'H'};
+static const size_t checksumStart = offsetof(MeshCacheHeader, fileBytes); // 校验和字段之后的内容都参与校验
+
+static const unsigned long long checksumPrime1 = 0x9E3779B185EBCA87ULL;
+static const unsigned long long checksumPrime2 = 0xC2B2AE3D27D4EB4FULL;
+
+static inline unsigned long long rotateLeft(unsigned long long value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline unsigned long long checksumRound(unsigned long long lane, unsigned long long word)
+{
+    return rotateLeft(lane + word * checksumPrime2, 31) * checksumPrime1;
+}
+
+unsigned long long meshCacheChecksum(const void* data, size_t bytes)
+{
+    const unsigned char* p = (const unsigned char*) data;
+    unsigned long long lanes[4] = {checksumPrime1 + checksumPrime2, checksumPrime2, 0, 0ULL - checksumPrime1};
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32)
+    {
+        unsigned long long words[4];
+        memcpy(words, p + i, sizeof(words));
+        for (int lane = 0; lane < 4; lane++)
+        {
+            lanes[lane] = checksumRound(lanes[lane], words[lane]);
+        }
+    }
+    unsigned long long hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) +
+                              rotateLeft(lanes[3], 18) + bytes;
+    for (; i < bytes; i++)
+    {
+        hash = rotateLeft(hash ^ (p[i] * checksumPrime1), 11) * checksumPrime2;
+    }
+    hash ^= hash >> 33;
+    hash *= checksumPrime2;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+static size_t alignOffset(size_t offset)
+{
+    return (offset + meshCacheAlignment - 1) & ~(meshCacheAlignment - 1);
+}
+
+static int indexBytes(GLenum indexType)
+{
+    return indexType == GL_UNSIGNED_INT ? 4 : indexType == GL_UNSIGNED_SHORT ? 2 : indexType == GL_UNSIGNED_BYTE ? 1 : 0;
+}
+
+static void computeBounds(const MeshCacheSource* source, MeshCacheHeader* header)
+{
+    const float* positions = NULL;
+    for (int i = 0; i < source->attributeCount; i++)
+    {
+        if (source->attributes[i].semantic == MESH_POSITION && source->attributes[i].components == 3)
+        {
+            positions = source->attributes[i].data;
+        }
+    }
+    for (int c = 0; c < 3; c++)
+    {
+        header->boundsMin[c] = positions != NULL && source->vertexCount > 0 ? FLT_MAX : 0.0f;
+        header->boundsMax[c] = positions != NULL && source->vertexCount > 0 ? -FLT_MAX : 0.0f;
+    }
+    for (int v = 0; positions != NULL && v < source->vertexCount; v++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            header->boundsMin[c] = std::min(header->boundsMin[c], positions[v * 3 + c]);
+            header->boundsMax[c] = std::max(header->boundsMax[c], positions[v * 3 + c]);
+        }
+    }
+    float radiusSquared = 0.0f;
+    for (int c = 0; c < 3; c++)
+    {
+        header->boundingSphere[c] = (header->boundsMin[c] + header->boundsMax[c]) * 0.5f;
+    }
+    for (int v = 0; positions != NULL && v < source->vertexCount; v++)
+    {
+        float dx = positions[v * 3] - header->boundingSphere[0];
+        float dy = positions[v * 3 + 1] - header->boundingSphere[1];
+        float dz = positions[v * 3 + 2] - header->boundingSphere[2];
+        radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+    }
+    header->boundingSphere[3] = sqrtf(radiusSquared);
+}
+
+bool writeMeshCache(const char* path, const MeshCacheSource* source)
+{
+    int bytesPerIndex = indexBytes(source->indexType);
+    if (source->vertexCount <= 0 || source->attributeCount <= 0 || source->attributeCount > maxVertexElements ||
+        (source->indices != NULL && bytesPerIndex == 0) || source->lodCount > maxMeshLods)
+    {
+        LOGE("Invalid mesh cache source");
+        return false;
+    }
+    VertexLayout layout;
+    initVertexLayout(&layout);
+    const float* sources[maxVertexElements];
+    for (int i = 0; i < source->attributeCount; i++)
+    {
+        const MeshCacheAttribute& attribute = source->attributes[i];
+        // 写文件时location字段存放semantic
+        if (!addVertexElement(&layout, attribute.semantic, attribute.components, attribute.format))
+        {
+            return false;
+        }
+        sources[i] = attribute.data;
+    }
+    MeshCacheLod lods[maxMeshLods];
+    int lodCount = source->lodCount;
+    if (lodCount == 0)
+    {
+        MeshCacheLod all = {0, source->indices != NULL ? (unsigned int) source->indexCount : 0, 0.0f, 0};
+        lods[0] = all;
+        lodCount = 1;
+    }
+    else
+    {
+        memcpy(lods, source->lods, sizeof(MeshCacheLod) * lodCount);
+    }
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, meshCacheMagic, sizeof(meshCacheMagic));
+    header.version = meshCacheVersion;
+    header.headerBytes = sizeof(MeshCacheHeader);
+    header.mode = source->mode;
+    header.indexType = source->indices != NULL ? source->indexType : 0;
+    header.vertexCount = (unsigned int) source->vertexCount;
+    header.indexCount = source->indices != NULL ? (unsigned int) source->indexCount : 0;
+    header.stride = (unsigned int) layout.stride;
+    header.elementCount = (unsigned int) layout.elementCount;
+    header.lodCount = (unsigned int) lodCount;
+    header.elementsOffset = alignOffset(sizeof(MeshCacheHeader));
+    header.lodsOffset = alignOffset(header.elementsOffset + sizeof(MeshCacheElement) * header.elementCount);
+    header.vertexOffset = alignOffset(header.lodsOffset + sizeof(MeshCacheLod) * header.lodCount);
+    header.vertexBytes = (unsigned long long) layout.stride * source->vertexCount;
+    header.indexOffset = alignOffset(header.vertexOffset + header.vertexBytes);
+    header.indexBytes = (unsigned long long) header.indexCount * bytesPerIndex;
+    header.fileBytes = header.indexOffset + header.indexBytes;
+    computeBounds(source, &header);
+
+    std::vector<unsigned char> file(header.fileBytes, 0);
+    for (int i = 0; i < layout.elementCount; i++)
+    {
+        const VertexElement& element = layout.elements[i];
+        MeshCacheElement stored = {(unsigned int) element.location, (unsigned int) element.components,
+                                   (unsigned int) element.format, (unsigned int) element.offset,
+                                   (unsigned int) element.bytes, 0};
+        memcpy(&file[header.elementsOffset + sizeof(MeshCacheElement) * i], &stored, sizeof(stored));
+    }
+    memcpy(&file[header.lodsOffset], lods, sizeof(MeshCacheLod) * lodCount);
+    packVertices(&layout, sources, source->vertexCount, &file[header.vertexOffset]);
+    if (header.indexBytes > 0)
+    {
+        memcpy(&file[header.indexOffset], source->indices, header.indexBytes);
+    }
+    memcpy(&file[0], &header, sizeof(header));
+    header.checksum = meshCacheChecksum(&file[checksumStart], file.size() - checksumStart);
+    memcpy(&file[0], &header, sizeof(header));
+
+    // 先写临时文件再rename（和程序二进制缓存一样），进程在写到一半时被杀也不会留下半个缓存文件
+    std::string temporaryPath = std::string(path) + ".tmp";
+    FILE* stream = fopen(temporaryPath.c_str(), "wb");
+    if (stream == NULL)
+    {
+        LOGE("Could not create %s", temporaryPath.c_str());
+        return false;
+    }
+    bool written = fwrite(&file[0], 1, file.size(), stream) == file.size();
+    written = fclose(stream) == 0 && written;
+    if (!written || rename(temporaryPath.c_str(), path) != 0)
+    {
+        LOGE("Could not write %s", path);
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+static const unsigned int maxCachedVertexStride = 2048; // GLES3保证支持的最大顶点步长
+
+// [offset, offset + size)在[0, bytes)范围内，写成不会溢出的形式，文件头里的值可能是任意的
+static bool rangeInFile(unsigned long long offset, unsigned long long size, size_t bytes)
+{
+    return offset <= bytes && size <= bytes - offset;
+}
+
+// 检查文件头里的偏移和大小都在文件范围内，后面直接使用这些指针。不校验校验和时文件内容完全不可信
+static bool validHeader(const MeshCacheHeader* header, size_t bytes)
+{
+    if (memcmp(header->magic, meshCacheMagic, sizeof(meshCacheMagic)) != 0)
+    {
+        LOGE("Not a mesh cache file");
+        return false;
+    }
+    if (header->version != meshCacheVersion || header->headerBytes != sizeof(MeshCacheHeader))
+    {
+        LOGE("Mesh cache version %u, expected %u", header->version, meshCacheVersion);
+        return false;
+    }
+    int bytesPerIndex = indexBytes(header->indexType);
+    // 个数先限制在最大值以内再相乘；stride、vertexCount、indexCount都是32位，乘积不会超过64位
+    bool valid = header->fileBytes == bytes && header->elementCount > 0 &&
+                 header->elementCount <= (unsigned int) maxVertexElements && header->lodCount > 0 &&
+                 header->lodCount <= (unsigned int) maxMeshLods &&
+                 rangeInFile(header->elementsOffset, sizeof(MeshCacheElement) * header->elementCount, bytes) &&
+                 rangeInFile(header->lodsOffset, sizeof(MeshCacheLod) * header->lodCount, bytes) &&
+                 header->vertexBytes == (unsigned long long) header->stride * header->vertexCount &&
+                 rangeInFile(header->vertexOffset, header->vertexBytes, bytes) &&
+                 header->indexBytes == (unsigned long long) header->indexCount * bytesPerIndex &&
+                 rangeInFile(header->indexOffset, header->indexBytes, bytes) &&
+                 header->vertexOffset % meshCacheAlignment == 0 && header->indexOffset % meshCacheAlignment == 0 &&
+                 header->elementsOffset % sizeof(unsigned int) == 0 && header->lodsOffset % sizeof(unsigned int) == 0 &&
+                 header->stride > 0 && header->stride <= maxCachedVertexStride;
+    // 属性的格式和在顶点里的范围也会直接交给glVertexAttribPointer
+    const MeshCacheElement* elements =
+            valid ? (const MeshCacheElement*) ((const unsigned char*) header + header->elementsOffset) : NULL;
+    for (unsigned int i = 0; valid && i < header->elementCount; i++)
+    {
+        const MeshCacheElement& element = elements[i];
+        valid = element.format <= (unsigned int) VERTEX_INT_2_10_10_10 && element.components >= 1 &&
+                element.components <= 4 && (element.format != VERTEX_INT_2_10_10_10 || element.components <= 3) &&
+                element.bytes > 0 && element.offset % sizeof(unsigned int) == 0 &&
+                rangeInFile(element.offset, element.bytes, header->stride);
+    }
+    if (!valid)
+    {
+        LOGE("Mesh cache header is inconsistent with a %zu byte file", bytes);
+    }
+    return valid;
+}
+
+bool openMeshCache(const char* path, bool verifyChecksum, MeshCacheFile* file)
+{
+    memset(file, 0, sizeof(MeshCacheFile));
+    int descriptor = open(path, O_RDONLY);
+    if (descriptor < 0)
+    {
+        LOGE("Could not open mesh cache %s", path);
+        return false;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || (size_t) status.st_size < sizeof(MeshCacheHeader))
+    {
+        LOGE("Mesh cache %s is truncated", path);
+        close(descriptor);
+        return false;
+    }
+    size_t bytes = (size_t) status.st_size;
+    void* mapping = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (mapping == MAP_FAILED)
+    {
+        LOGE("Could not map mesh cache %s", path);
+        return false;
+    }
+    madvise(mapping, bytes, MADV_WILLNEED);
+    file->mapping = mapping;
+    file->bytes = bytes;
+    const unsigned char* data = (const unsigned char*) mapping;
+    const MeshCacheHeader* header = (const MeshCacheHeader*) data;
+    if (!validHeader(header, bytes) ||
+        (verifyChecksum && meshCacheChecksum(data + checksumStart, bytes - checksumStart) != header->checksum))
+    {
+        LOGE("Mesh cache %s is invalid or corrupt", path);
+        closeMeshCache(file);
+        return false;
+    }
+    file->header = header;
+    file->elements = (const MeshCacheElement*) (data + header->elementsOffset);
+    file->lods = (const MeshCacheLod*) (data + header->lodsOffset);
+    file->vertices = data + header->vertexOffset;
+    file->indices = header->indexBytes > 0 ? data + header->indexOffset : NULL;
+    for (unsigned int i = 0; i < header->lodCount; i++)
+    {
+        if ((unsigned long long) file->lods[i].firstIndex + file->lods[i].indexCount > header->indexCount)
+        {
+            LOGE("Mesh cache %s has an invalid LOD %u", path, i);
+            closeMeshCache(file);
+            return false;
+        }
+    }
+    return true;
+}
+
+void closeMeshCache(MeshCacheFile* file)
+{
+    if (file->mapping != NULL)
+    {
+        munmap(file->mapping, file->bytes);
+    }
+    memset(file, 0, sizeof(MeshCacheFile));
+}
+
+bool createCachedMesh(Mesh* mesh, const MeshCacheFile* file, const GLint* locations, int lod)
+{
+    const MeshCacheHeader* header = file->header;
+    if (lod >= (int) header->lodCount)
+    {
+        LOGE("Mesh cache has no LOD %d", lod);
+        return false;
+    }
+    VertexLayout layout;
+    layout.elementCount = (int) header->elementCount;
+    layout.stride = (GLsizei) header->stride;
+    for (int i = 0; i < layout.elementCount; i++)
+    {
+        const MeshCacheElement& stored = file->elements[i];
+        VertexElement& element = layout.elements[i];
+        element.location = stored.semantic < (unsigned int) MESH_SEMANTIC_COUNT ? locations[stored.semantic] : -1;
+        element.components = (GLint) stored.components;
+        element.format = (VertexElementFormat) stored.format;
+        element.offset = (GLsizei) stored.offset;
+        element.bytes = (GLsizei) stored.bytes;
+        if (element.location >= 0 && (element.format == VERTEX_HALF || element.format == VERTEX_INT_2_10_10_10) &&
+            !packedVertexFormatsSupported())
+        {
+            LOGE("Mesh cache uses packed vertex formats, which need GLES3");
+            return false;
+        }
+    }
+    if (header->indexType == GL_UNSIGNED_INT)
+    {
+        const char* version = (const char*) glGetString(GL_VERSION);
+        const char* extensions = (const char*) glGetString(GL_EXTENSIONS);
+        bool es3 = version != NULL && strncmp(version, "OpenGL ES ", 10) == 0 && version[10] >= '3';
+        if (!es3 && (extensions == NULL || strstr(extensions, "GL_OES_element_index_uint") == NULL))
+        {
+            LOGE("Mesh cache has %u vertices, 32-bit indices are not supported", header->vertexCount);
+            return false;
+        }
+    }
+    MeshCacheLod range = file->lods[lod < 0 ? 0 : lod];
+    if (lod < 0)
+    {
+        range.firstIndex = 0;
+        range.indexCount = header->indexCount;
+    }
+    const unsigned char* indices = (const unsigned char*) file->indices;
+    if (indices != NULL)
+    {
+        indices += (size_t) range.firstIndex * indexBytes(header->indexType);
+    }
+    if (!createInterleavedMesh(mesh, header->mode, &layout, file->vertices, (GLsizei) header->vertexCount, indices,
+                               (GLsizei) range.indexCount, header->indexType))
+    {
+        return false;
+    }
+    if (lod < 0 && indices != NULL)
+    {
+        mesh->count = (GLsizei) file->lods[0].indexCount;
+    }
+    return true;
+}
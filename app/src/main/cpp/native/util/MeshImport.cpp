@@ -0,0 +1,1144 @@
+/**
+ * --- 网格导入 ---
+ *
+ * 课程里的几何体都是手写的静态数组，索引是GLushort，最多65536个顶点。这里导入OBJ和glTF二进制文件，
+ * 生成和课程相同布局（位置、法线、纹理坐标分开存放，加一个索引数组）的网格，顶点多时改用32位索引。
+ *
+ * 文件用mmap映射，不复制到堆上。解析分三步，前两步都按块并行：
+ *    1.OBJ按行边界把文件切成threads块，每块数出v、vt、vn的行数和三角形个数，前缀和得到每块数据写到哪里，
+ *      负数（相对）索引也能在块内直接换算成绝对索引
+ *    2.每块解析自己的数据，直接写进全局数组的对应位置；浮点数用自己的解析函数，不走strtof（慢，而且受locale影响）
+ *    3.按三角形的角并行展开成逐角顶点（位置、法线、纹理坐标共8个float）。glb的数据本来就是二进制的，直接从这一步开始
+ * 最后在一个线程里用开放寻址（线性探测）的哈希表去重：表的大小是角数的两倍以上的2的幂，装载率不超过一半，
+ * 按8个float的比特比较，相同的角共用一个顶点。
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "../include/MeshImport.h"
+#include "../include/LogUtil.h"
+
+static const int cornerFloats = 8; // 位置3、法线3、纹理坐标2
+static const size_t minChunkBytes = 1 << 20; // 每块至少1MB，小文件不值得开线程
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static int resolveThreads(int threads, size_t work, size_t minWork)
+{
+    if (threads <= 0)
+    {
+        threads = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    size_t useful = std::max((size_t) 1, work / minWork);
+    return (int) std::min((size_t) threads, useful);
+}
+
+// 把[0, count)分成threads段并行执行function(first, last)，第一段在当前线程上运行
+template<typename Function>
+static void parallelFor(int threads, size_t count, Function function)
+{
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++)
+    {
+        pool.push_back(std::thread(function, count * i / threads, count * (i + 1) / threads));
+    }
+    function(0, count / threads);
+    for (size_t i = 0; i < pool.size(); i++)
+    {
+        pool[i].join();
+    }
+}
+
+static unsigned int hashCorner(const float* corner)
+{
+    unsigned int bits[cornerFloats];
+    memcpy(bits, corner, sizeof(bits));
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < cornerFloats; i++)
+    {
+        hash = (hash ^ bits[i]) * 16777619u;
+        hash ^= hash >> 15;
+    }
+    return hash;
+}
+
+// 去掉重复的角，生成顶点数组和索引
+static void buildIndexedMesh(const std::vector<float>& corners, bool hasNormals, bool hasTextureCords,
+                             ImportedMesh* mesh)
+{
+    size_t cornerCount = corners.size() / cornerFloats;
+    size_t tableSize = 1024;
+    while (tableSize < cornerCount * 2)
+    {
+        tableSize *= 2;
+    }
+    std::vector<int> table(tableSize, -1);
+    std::vector<float> unique;
+    unique.reserve(corners.size() / 4); // 常见的网格每个顶点被6个左右的角共用
+    mesh->indices.resize(cornerCount);
+    int vertexCount = 0;
+    for (size_t i = 0; i < cornerCount; i++)
+    {
+        const float* corner = &corners[i * cornerFloats];
+        size_t slot = hashCorner(corner) & (tableSize - 1);
+        while (table[slot] >= 0 && memcmp(&unique[(size_t) table[slot] * cornerFloats], corner, sizeof(float) * cornerFloats) != 0)
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] < 0)
+        {
+            table[slot] = vertexCount++;
+            unique.insert(unique.end(), corner, corner + cornerFloats);
+        }
+        mesh->indices[i] = (unsigned int) table[slot];
+    }
+    mesh->vertexCount = vertexCount;
+    mesh->indexCount = (int) cornerCount;
+    mesh->hasNormals = hasNormals;
+    mesh->hasTextureCords = hasTextureCords;
+    mesh->positions.resize((size_t) vertexCount * 3);
+    mesh->normals.resize(hasNormals ? (size_t) vertexCount * 3 : 0);
+    mesh->textureCords.resize(hasTextureCords ? (size_t) vertexCount * 2 : 0);
+    for (int v = 0; v < vertexCount; v++)
+    {
+        const float* vertex = &unique[(size_t) v * cornerFloats];
+        memcpy(&mesh->positions[(size_t) v * 3], vertex, sizeof(float) * 3);
+        if (hasNormals)
+        {
+            memcpy(&mesh->normals[(size_t) v * 3], vertex + 3, sizeof(float) * 3);
+        }
+        if (hasTextureCords)
+        {
+            memcpy(&mesh->textureCords[(size_t) v * 2], vertex + 6, sizeof(float) * 2);
+        }
+    }
+    mesh->shortIndices.clear();
+    if (vertexCount <= 65536)
+    {
+        mesh->indexType = GL_UNSIGNED_SHORT;
+        mesh->shortIndices.assign(mesh->indices.begin(), mesh->indices.end());
+        std::vector<unsigned int>().swap(mesh->indices);
+    }
+    else
+    {
+        mesh->indexType = GL_UNSIGNED_INT;
+    }
+}
+
+// ---------------- OBJ ----------------
+
+// 一块OBJ文本的统计和解析状态
+struct ObjChunk
+{
+    const char* begin;
+    const char* end;
+    size_t positions; // 块内v、vt、vn的行数
+    size_t textureCords;
+    size_t normals;
+    size_t triangles;
+    size_t positionBase; // 之前各块的总数，也就是块内第一个元素的全局下标
+    size_t textureCordBase;
+    size_t normalBase;
+    size_t triangleBase;
+    bool failed;
+    int failedLine; // 块内的行号，用于报错
+};
+
+static inline const char* skipSpaces(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+    {
+        p++;
+    }
+    return p;
+}
+
+static inline const char* nextLine(const char* p, const char* end)
+{
+    const char* newline = (const char*) memchr(p, '\n', end - p);
+    return newline != NULL ? newline + 1 : end;
+}
+
+static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13,
+                                     1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// 解析十进制数（可以有符号、小数和指数），成功时移动cursor
+static bool parseNumber(const char** cursor, const char* end, double* value)
+{
+    const char* p = skipSpaces(*cursor, end);
+    bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        p++;
+    }
+    unsigned long long mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+    {
+        if (mantissa < 100000000000000000ULL)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+        }
+        else
+        {
+            exponent++; // 超出精度的整数位只计入数量级
+        }
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+        {
+            if (mantissa < 100000000000000000ULL)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            }
+        }
+    }
+    if (digits == 0)
+    {
+        return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p + 1;
+        bool negativeExponent = q < end && *q == '-';
+        if (q < end && (*q == '-' || *q == '+'))
+        {
+            q++;
+        }
+        int written = 0;
+        int e = 0;
+        for (; q < end && *q >= '0' && *q <= '9'; q++, written++)
+        {
+            e = std::min(e * 10 + (*q - '0'), 1000);
+        }
+        if (written > 0)
+        {
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+    double result = (double) mantissa;
+    if (exponent < 0)
+    {
+        result = exponent >= -22 ? result / powersOfTen[-exponent] : result * pow(10.0, exponent);
+    }
+    else if (exponent > 0)
+    {
+        result = exponent <= 22 ? result * powersOfTen[exponent] : result * pow(10.0, exponent);
+    }
+    *value = negative ? -result : result;
+    *cursor = p;
+    return true;
+}
+
+static inline bool parseFloat(const char** cursor, const char* end, float* value)
+{
+    double number;
+    if (!parseNumber(cursor, end, &number))
+    {
+        return false;
+    }
+    *value = (float) number;
+    return true;
+}
+
+static bool parseInt(const char** cursor, const char* end, long long* value)
+{
+    const char* p = *cursor;
+    bool negative = p < end && *p == '-';
+    if (negative)
+    {
+        p++;
+    }
+    if (p >= end || *p < '0' || *p > '9')
+    {
+        return false;
+    }
+    long long result = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+        result = std::min(result * 10 + (*p - '0'), 1LL << 40);
+    }
+    *value = negative ? -result : result;
+    *cursor = p;
+    return true;
+}
+
+// 行首的关键字，只关心v、vt、vn、f
+enum ObjKeyword
+{
+    OBJ_OTHER,
+    OBJ_POSITION,
+    OBJ_TEXTURE_CORD,
+    OBJ_NORMAL,
+    OBJ_FACE
+};
+
+static ObjKeyword objKeyword(const char** cursor, const char* end)
+{
+    const char* p = skipSpaces(*cursor, end);
+    ObjKeyword keyword = OBJ_OTHER;
+    int length = 0;
+    if (p < end && *p == 'v')
+    {
+        if (p + 1 < end && (p[1] == ' ' || p[1] == '\t'))
+        {
+            keyword = OBJ_POSITION;
+            length = 1;
+        }
+        else if (p + 2 < end && (p[2] == ' ' || p[2] == '\t') && (p[1] == 't' || p[1] == 'n'))
+        {
+            keyword = p[1] == 't' ? OBJ_TEXTURE_CORD : OBJ_NORMAL;
+            length = 2;
+        }
+    }
+    else if (p + 1 < end && *p == 'f' && (p[1] == ' ' || p[1] == '\t'))
+    {
+        keyword = OBJ_FACE;
+        length = 1;
+    }
+    *cursor = p + length;
+    return keyword;
+}
+
+// 数一行f里有几个角（空白分隔的词）
+static int countFaceCorners(const char* p, const char* end)
+{
+    int corners = 0;
+    while (true)
+    {
+        p = skipSpaces(p, end);
+        if (p >= end || *p == '\r' || *p == '\n' || *p == '#')
+        {
+            return corners;
+        }
+        corners++;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+        {
+            p++;
+        }
+    }
+}
+
+static void countObjChunk(ObjChunk* chunk)
+{
+    chunk->positions = chunk->textureCords = chunk->normals = chunk->triangles = 0;
+    for (const char* line = chunk->begin; line < chunk->end; line = nextLine(line, chunk->end))
+    {
+        const char* p = line;
+        switch (objKeyword(&p, chunk->end))
+        {
+            case OBJ_POSITION:
+                chunk->positions++;
+                break;
+            case OBJ_TEXTURE_CORD:
+                chunk->textureCords++;
+                break;
+            case OBJ_NORMAL:
+                chunk->normals++;
+                break;
+            case OBJ_FACE:
+            {
+                int corners = countFaceCorners(p, chunk->end);
+                chunk->triangles += corners >= 3 ? corners - 2 : 0;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+// OBJ的索引从1开始，负数表示从当前已定义的最后一个往前数，换算成从0开始的下标，没有时为-1
+static bool resolveObjIndex(long long value, size_t defined, size_t total, int* index)
+{
+    long long resolved = value > 0 ? value - 1 : (long long) defined + value;
+    if (value == 0 || resolved < 0 || resolved >= (long long) total)
+    {
+        return false;
+    }
+    *index = (int) resolved;
+    return true;
+}
+
+struct ObjArrays
+{
+    std::vector<float> positions;
+    std::vector<float> textureCords;
+    std::vector<float> normals;
+    std::vector<int> faces; // 每个角3个下标（位置、纹理坐标、法线），没有的为-1
+};
+
+static void parseObjChunk(ObjChunk* chunk, ObjArrays* arrays)
+{
+    size_t positions = chunk->positionBase;
+    size_t textureCords = chunk->textureCordBase;
+    size_t normals = chunk->normalBase;
+    size_t totalPositions = arrays->positions.size() / 3;
+    size_t totalTextureCords = arrays->textureCords.size() / 2;
+    size_t totalNormals = arrays->normals.size() / 3;
+    int* face = arrays->faces.empty() ? NULL : &arrays->faces[chunk->triangleBase * 9];
+    int lineNumber = 0;
+    chunk->failed = false;
+    for (const char* line = chunk->begin; line < chunk->end; line = nextLine(line, chunk->end), lineNumber++)
+    {
+        const char* p = line;
+        bool ok = true;
+        switch (objKeyword(&p, chunk->end))
+        {
+            case OBJ_POSITION:
+            {
+                float* out = &arrays->positions[positions++ * 3];
+                ok = parseFloat(&p, chunk->end, out) && parseFloat(&p, chunk->end, out + 1) &&
+                     parseFloat(&p, chunk->end, out + 2);
+                break;
+            }
+            case OBJ_TEXTURE_CORD:
+            {
+                float* out = &arrays->textureCords[textureCords++ * 2];
+                ok = parseFloat(&p, chunk->end, out);
+                if (ok && !parseFloat(&p, chunk->end, out + 1))
+                {
+                    out[1] = 0.0f; // 一维纹理坐标
+                }
+                break;
+            }
+            case OBJ_NORMAL:
+            {
+                float* out = &arrays->normals[normals++ * 3];
+                ok = parseFloat(&p, chunk->end, out) && parseFloat(&p, chunk->end, out + 1) &&
+                     parseFloat(&p, chunk->end, out + 2);
+                break;
+            }
+            case OBJ_FACE:
+            {
+                // 读出各个角，按扇形(0, i - 1, i)输出三角形
+                int first[3];
+                int previous[3];
+                int corner = 0;
+                while (ok)
+                {
+                    p = skipSpaces(p, chunk->end);
+                    if (p >= chunk->end || *p == '\r' || *p == '\n' || *p == '#')
+                    {
+                        break;
+                    }
+                    int current[3] = {-1, -1, -1};
+                    long long value;
+                    ok = parseInt(&p, chunk->end, &value) && resolveObjIndex(value, positions, totalPositions, &current[0]);
+                    for (int k = 1; k < 3 && ok && p < chunk->end && *p == '/'; k++)
+                    {
+                        p++;
+                        if (p < chunk->end && *p == '/')
+                        {
+                            continue; // v//vn
+                        }
+                        ok = parseInt(&p, chunk->end, &value) &&
+                             resolveObjIndex(value, k == 1 ? textureCords : normals,
+                                             k == 1 ? totalTextureCords : totalNormals, &current[k]);
+                    }
+                    if (!ok)
+                    {
+                        break;
+                    }
+                    if (corner == 0)
+                    {
+                        memcpy(first, current, sizeof(first));
+                    }
+                    else if (corner >= 2)
+                    {
+                        memcpy(face, first, sizeof(first));
+                        memcpy(face + 3, previous, sizeof(previous));
+                        memcpy(face + 6, current, sizeof(current));
+                        face += 9;
+                    }
+                    memcpy(previous, current, sizeof(previous));
+                    corner++;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        if (!ok)
+        {
+            chunk->failed = true;
+            chunk->failedLine = lineNumber;
+            return;
+        }
+    }
+}
+
+bool importObj(const char* data, size_t size, int threads, ImportedMesh* mesh, MeshImportStats* stats)
+{
+    Clock::time_point start = Clock::now();
+    threads = resolveThreads(threads, size, minChunkBytes);
+    // 按行边界切块
+    std::vector<ObjChunk> chunks(threads);
+    const char* end = data + size;
+    const char* begin = data;
+    for (int i = 0; i < threads; i++)
+    {
+        const char* chunkEnd = i == threads - 1 ? end : nextLine(std::max(begin, data + size * (i + 1) / threads), end);
+        chunks[i].begin = begin;
+        chunks[i].end = chunkEnd;
+        begin = chunkEnd;
+    }
+    parallelFor(threads, chunks.size(), [&chunks](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++)
+        {
+            countObjChunk(&chunks[i]);
+        }
+    });
+    size_t positions = 0, textureCords = 0, normals = 0, triangles = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        chunks[i].positionBase = positions;
+        chunks[i].textureCordBase = textureCords;
+        chunks[i].normalBase = normals;
+        chunks[i].triangleBase = triangles;
+        positions += chunks[i].positions;
+        textureCords += chunks[i].textureCords;
+        normals += chunks[i].normals;
+        triangles += chunks[i].triangles;
+    }
+    if (triangles == 0 || triangles > (size_t) 0x7fffffff / 3)
+    {
+        LOGE("OBJ has %zu triangles", triangles);
+        return false;
+    }
+    ObjArrays arrays;
+    arrays.positions.resize(positions * 3);
+    arrays.textureCords.resize(textureCords * 2);
+    arrays.normals.resize(normals * 3);
+    arrays.faces.resize(triangles * 9);
+    parallelFor(threads, chunks.size(), [&chunks, &arrays](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++)
+        {
+            parseObjChunk(&chunks[i], &arrays);
+        }
+    });
+    for (int i = 0; i < threads; i++)
+    {
+        if (chunks[i].failed)
+        {
+            const char* line = chunks[i].begin;
+            for (int n = 0; n < chunks[i].failedLine; n++)
+            {
+                line = nextLine(line, chunks[i].end);
+            }
+            const char* lineEnd = nextLine(line, chunks[i].end);
+            LOGE("Invalid OBJ line: %.*s", (int) std::min<size_t>(lineEnd - line, 80), line);
+            return false;
+        }
+    }
+    // 展开成逐角顶点，文件里没有vt或vn时不输出对应的属性
+    bool hasTextureCords = textureCords > 0;
+    bool hasNormals = normals > 0;
+    size_t cornerCount = triangles * 3;
+    std::vector<float> corners(cornerCount * cornerFloats);
+    parallelFor(threads, cornerCount, [&arrays, &corners](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++)
+        {
+            const int* face = &arrays.faces[i * 3];
+            float* corner = &corners[i * cornerFloats];
+            memcpy(corner, &arrays.positions[(size_t) face[0] * 3], sizeof(float) * 3);
+            if (face[2] >= 0)
+            {
+                memcpy(corner + 3, &arrays.normals[(size_t) face[2] * 3], sizeof(float) * 3);
+            }
+            else
+            {
+                corner[3] = corner[4] = corner[5] = 0.0f;
+            }
+            if (face[1] >= 0)
+            {
+                memcpy(corner + 6, &arrays.textureCords[(size_t) face[1] * 2], sizeof(float) * 2);
+            }
+            else
+            {
+                corner[6] = corner[7] = 0.0f;
+            }
+        }
+    });
+    std::vector<int>().swap(arrays.faces); // 去重前释放，大文件可以省下不少内存
+    double parseMilliseconds = millisecondsSince(start);
+    start = Clock::now();
+    buildIndexedMesh(corners, hasNormals, hasTextureCords, mesh);
+    if (stats != NULL)
+    {
+        stats->threads = threads;
+        stats->triangles = (int) triangles;
+        stats->corners = (int) cornerCount;
+        stats->parseMilliseconds = parseMilliseconds;
+        stats->dedupMilliseconds = millisecondsSince(start);
+    }
+    return true;
+}
+
+// ---------------- glTF ----------------
+
+// 够用的JSON解析器：glb里的JSON通常只有几KB，解析成树再按名字查找
+struct JsonValue
+{
+    enum Type
+    {
+        JSON_NULL,
+        JSON_BOOL,
+        JSON_NUMBER,
+        JSON_STRING,
+        JSON_ARRAY,
+        JSON_OBJECT
+    } type;
+    double number;
+    std::string string;
+    std::vector<std::string> keys; // 对象的键，和items一一对应
+    std::vector<JsonValue> items;
+
+    JsonValue() : type(JSON_NULL), number(0.0) {}
+
+    const JsonValue* find(const char* key) const
+    {
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (keys[i] == key)
+            {
+                return &items[i];
+            }
+        }
+        return NULL;
+    }
+
+    double numberOr(const char* key, double fallback) const
+    {
+        const JsonValue* value = find(key);
+        return value != NULL && value->type == JSON_NUMBER ? value->number : fallback;
+    }
+};
+
+static bool parseJsonValue(const char** cursor, const char* end, JsonValue* value, int depth);
+
+static const char* skipJsonSpaces(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+    {
+        p++;
+    }
+    return p;
+}
+
+// 转义只处理到能跳过的程度，glTF里用到的键和值都是ASCII
+static bool parseJsonString(const char** cursor, const char* end, std::string* string)
+{
+    const char* p = *cursor + 1;
+    string->clear();
+    while (p < end && *p != '"')
+    {
+        if (*p == '\\' && p + 1 < end)
+        {
+            p++;
+        }
+        string->push_back(*p++);
+    }
+    if (p >= end)
+    {
+        return false;
+    }
+    *cursor = p + 1;
+    return true;
+}
+
+static bool parseJsonValue(const char** cursor, const char* end, JsonValue* value, int depth)
+{
+    const char* p = skipJsonSpaces(*cursor, end);
+    if (p >= end || depth > 64)
+    {
+        return false;
+    }
+    if (*p == '{' || *p == '[')
+    {
+        bool object = *p == '{';
+        char close = object ? '}' : ']';
+        value->type = object ? JsonValue::JSON_OBJECT : JsonValue::JSON_ARRAY;
+        p = skipJsonSpaces(p + 1, end);
+        while (p < end && *p != close)
+        {
+            if (object)
+            {
+                std::string key;
+                if (*p != '"' || !parseJsonString(&p, end, &key))
+                {
+                    return false;
+                }
+                p = skipJsonSpaces(p, end);
+                if (p >= end || *p != ':')
+                {
+                    return false;
+                }
+                p++;
+                value->keys.push_back(key);
+            }
+            value->items.push_back(JsonValue());
+            if (!parseJsonValue(&p, end, &value->items.back(), depth + 1))
+            {
+                return false;
+            }
+            p = skipJsonSpaces(p, end);
+            if (p < end && *p == ',')
+            {
+                p = skipJsonSpaces(p + 1, end);
+            }
+        }
+        if (p >= end)
+        {
+            return false;
+        }
+        *cursor = p + 1;
+        return true;
+    }
+    if (*p == '"')
+    {
+        value->type = JsonValue::JSON_STRING;
+        if (!parseJsonString(&p, end, &value->string))
+        {
+            return false;
+        }
+        *cursor = p;
+        return true;
+    }
+    if (end - p >= 4 && (strncmp(p, "true", 4) == 0 || strncmp(p, "null", 4) == 0))
+    {
+        value->type = *p == 't' ? JsonValue::JSON_BOOL : JsonValue::JSON_NULL;
+        value->number = *p == 't' ? 1.0 : 0.0;
+        *cursor = p + 4;
+        return true;
+    }
+    if (end - p >= 5 && strncmp(p, "false", 5) == 0)
+    {
+        value->type = JsonValue::JSON_BOOL;
+        *cursor = p + 5;
+        return true;
+    }
+    if (!parseNumber(&p, end, &value->number))
+    {
+        return false;
+    }
+    value->type = JsonValue::JSON_NUMBER;
+    *cursor = p;
+    return true;
+}
+
+static const unsigned int glbMagic = 0x46546C67; // "glTF"
+static const unsigned int glbJsonChunk = 0x4E4F534A;
+static const unsigned int glbBinaryChunk = 0x004E4942;
+
+// 可以直接读取的accessor：数据在BIN块中的起始位置、步长、个数和分量类型
+struct GltfAccessor
+{
+    const unsigned char* data;
+    size_t stride;
+    size_t count;
+    int componentType;
+    int components;
+    bool normalized;
+};
+
+static int componentBytes(int componentType)
+{
+    switch (componentType)
+    {
+        case 5120: // BYTE
+        case 5121: // UNSIGNED_BYTE
+            return 1;
+        case 5122: // SHORT
+        case 5123: // UNSIGNED_SHORT
+            return 2;
+        case 5125: // UNSIGNED_INT
+        case 5126: // FLOAT
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+static int typeComponents(const std::string& type)
+{
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    return 0;
+}
+
+static bool findAccessor(const JsonValue& root, int index, const unsigned char* binary, size_t binaryBytes,
+                         GltfAccessor* accessor)
+{
+    const JsonValue* accessors = root.find("accessors");
+    const JsonValue* views = root.find("bufferViews");
+    if (accessors == NULL || views == NULL || index < 0 || index >= (int) accessors->items.size())
+    {
+        LOGE("glTF accessor %d missing", index);
+        return false;
+    }
+    const JsonValue& json = accessors->items[index];
+    const JsonValue* type = json.find("type");
+    int viewIndex = (int) json.numberOr("bufferView", -1);
+    if (json.find("sparse") != NULL || viewIndex < 0 || viewIndex >= (int) views->items.size() || type == NULL)
+    {
+        LOGE("glTF accessor %d is sparse or has no buffer view", index);
+        return false;
+    }
+    const JsonValue& view = views->items[viewIndex];
+    accessor->componentType = (int) json.numberOr("componentType", 0);
+    accessor->components = typeComponents(type->string);
+    // 先把JSON里的数字限制在文件范围内再转换成size_t，负数或极大的值转换后会绕回，下面的范围检查就失效了
+    double count = json.numberOr("count", 0);
+    double viewOffset = view.numberOr("byteOffset", 0);
+    double viewLength = view.numberOr("byteLength", 0);
+    double accessorOffset = json.numberOr("byteOffset", 0);
+    double byteStride = view.numberOr("byteStride", 0);
+    if (count < 0 || count > (double) binaryBytes || viewOffset < 0 || viewLength < 0
+        || viewOffset + viewLength > (double) binaryBytes || accessorOffset < 0 || accessorOffset > viewLength
+        || byteStride < 0 || byteStride > 255)
+    {
+        LOGE("glTF accessor %d is out of range or not in the GLB binary chunk", index);
+        return false;
+    }
+    accessor->count = (size_t) count;
+    const JsonValue* normalized = json.find("normalized");
+    accessor->normalized = normalized != NULL && normalized->number != 0.0;
+    size_t elementBytes = (size_t) componentBytes(accessor->componentType) * accessor->components;
+    accessor->stride = (size_t) byteStride;
+    accessor->stride = accessor->stride != 0 ? accessor->stride : elementBytes;
+    size_t offset = (size_t) viewOffset + (size_t) accessorOffset;
+    size_t viewEnd = (size_t) viewOffset + (size_t) viewLength;
+    // offset + (count - 1) * stride + elementBytes <= viewEnd，写成不会溢出的形式
+    if (elementBytes == 0 || view.numberOr("buffer", 0) != 0 || view.find("uri") != NULL ||
+        (accessor->count > 0 && (elementBytes > viewEnd - offset
+                                 || accessor->count - 1 > (viewEnd - offset - elementBytes) / accessor->stride)))
+    {
+        LOGE("glTF accessor %d is out of range or not in the GLB binary chunk", index);
+        return false;
+    }
+    accessor->data = binary + offset;
+    return true;
+}
+
+// 读第element个元素的第component个分量，整数按normalized转换到[0, 1]或[-1, 1]
+static float readComponent(const GltfAccessor* accessor, size_t element, int component)
+{
+    const unsigned char* p = accessor->data + element * accessor->stride;
+    switch (accessor->componentType)
+    {
+        case 5126:
+        {
+            float value;
+            memcpy(&value, p + component * 4, 4);
+            return value;
+        }
+        case 5121:
+            return accessor->normalized ? p[component] / 255.0f : p[component];
+        case 5120:
+        {
+            float value = (float) (signed char) p[component];
+            return accessor->normalized ? std::max(value / 127.0f, -1.0f) : value;
+        }
+        case 5123:
+        case 5122:
+        {
+            unsigned short bits;
+            memcpy(&bits, p + component * 2, 2);
+            if (accessor->componentType == 5122)
+            {
+                float value = (float) (short) bits;
+                return accessor->normalized ? std::max(value / 32767.0f, -1.0f) : value;
+            }
+            return accessor->normalized ? bits / 65535.0f : bits;
+        }
+        default:
+        {
+            unsigned int value;
+            memcpy(&value, p + component * 4, 4);
+            return (float) value;
+        }
+    }
+}
+
+// glTF的索引只能是UNSIGNED_BYTE、UNSIGNED_SHORT和UNSIGNED_INT
+static bool validIndexType(int componentType)
+{
+    return componentType == 5121 || componentType == 5123 || componentType == 5125;
+}
+
+static unsigned int readIndex(const GltfAccessor* accessor, size_t element)
+{
+    const unsigned char* p = accessor->data + element * accessor->stride;
+    if (accessor->componentType == 5121)
+    {
+        return *p;
+    }
+    if (accessor->componentType == 5123)
+    {
+        unsigned short value;
+        memcpy(&value, p, 2);
+        return value;
+    }
+    unsigned int value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+bool importGlb(const unsigned char* data, size_t size, int threads, ImportedMesh* mesh, MeshImportStats* stats)
+{
+    Clock::time_point start = Clock::now();
+    unsigned int header[2] = {0, 0}; // magic、版本
+    memcpy(header, data, size >= 8 ? 8 : 0);
+    if (size < 20 || header[0] != glbMagic || header[1] != 2)
+    {
+        LOGE("Not a glTF 2.0 binary file");
+        return false;
+    }
+    unsigned int jsonBytes;
+    unsigned int chunkType;
+    memcpy(&jsonBytes, data + 12, 4);
+    memcpy(&chunkType, data + 16, 4);
+    if (chunkType != glbJsonChunk || 20 + (size_t) jsonBytes > size)
+    {
+        LOGE("GLB JSON chunk missing");
+        return false;
+    }
+    const char* json = (const char*) data + 20;
+    const unsigned char* binary = NULL;
+    size_t binaryBytes = 0;
+    size_t binaryHeader = 20 + (size_t) ((jsonBytes + 3) & ~3u);
+    if (binaryHeader + 8 <= size)
+    {
+        unsigned int length;
+        memcpy(&length, data + binaryHeader, 4);
+        memcpy(&chunkType, data + binaryHeader + 4, 4);
+        if (chunkType == glbBinaryChunk && binaryHeader + 8 + (size_t) length <= size)
+        {
+            binary = data + binaryHeader + 8;
+            binaryBytes = length;
+        }
+    }
+    JsonValue root;
+    const char* cursor = json;
+    if (!parseJsonValue(&cursor, json + jsonBytes, &root, 0) || root.type != JsonValue::JSON_OBJECT)
+    {
+        LOGE("Invalid GLB JSON");
+        return false;
+    }
+    const JsonValue* meshes = root.find("meshes");
+    if (meshes == NULL || binary == NULL)
+    {
+        LOGE("GLB has no meshes or no binary chunk");
+        return false;
+    }
+
+    // 先收集所有三角形图元的accessor，算出总角数，再并行展开
+    struct Primitive
+    {
+        GltfAccessor positions;
+        GltfAccessor normals;
+        GltfAccessor textureCords;
+        GltfAccessor indices;
+        bool hasNormals;
+        bool hasTextureCords;
+        bool indexed;
+        size_t cornerBase;
+        size_t corners;
+    };
+    std::vector<Primitive> primitives;
+    size_t cornerCount = 0;
+    bool hasNormals = false;
+    bool hasTextureCords = false;
+    for (size_t m = 0; m < meshes->items.size(); m++)
+    {
+        const JsonValue* list = meshes->items[m].find("primitives");
+        for (size_t i = 0; list != NULL && i < list->items.size(); i++)
+        {
+            const JsonValue& json = list->items[i];
+            const JsonValue* attributes = json.find("attributes");
+            if (json.numberOr("mode", 4) != 4 || attributes == NULL)
+            {
+                LOGI("Skipping non-triangle glTF primitive");
+                continue;
+            }
+            Primitive primitive;
+            if (!findAccessor(root, (int) attributes->numberOr("POSITION", -1), binary, binaryBytes,
+                              &primitive.positions) ||
+                primitive.positions.componentType != 5126 || primitive.positions.components != 3)
+            {
+                LOGE("glTF primitive needs float VEC3 positions");
+                return false;
+            }
+            primitive.hasNormals = attributes->find("NORMAL") != NULL;
+            primitive.hasTextureCords = attributes->find("TEXCOORD_0") != NULL;
+            primitive.indexed = json.find("indices") != NULL;
+            if ((primitive.hasNormals && !findAccessor(root, (int) attributes->numberOr("NORMAL", -1), binary,
+                                                       binaryBytes, &primitive.normals)) ||
+                (primitive.hasTextureCords && !findAccessor(root, (int) attributes->numberOr("TEXCOORD_0", -1), binary,
+                                                            binaryBytes, &primitive.textureCords)) ||
+                (primitive.indexed && !findAccessor(root, (int) json.numberOr("indices", -1), binary, binaryBytes,
+                                                    &primitive.indices)))
+            {
+                return false;
+            }
+            if ((primitive.hasNormals && (primitive.normals.components != 3 ||
+                                          primitive.normals.count != primitive.positions.count)) ||
+                (primitive.hasTextureCords && (primitive.textureCords.components != 2 ||
+                                               primitive.textureCords.count != primitive.positions.count)) ||
+                (primitive.indexed && (primitive.indices.components != 1 || !validIndexType(primitive.indices.componentType))))
+            {
+                LOGE("glTF primitive attributes do not match");
+                return false;
+            }
+            primitive.corners = primitive.indexed ? primitive.indices.count : primitive.positions.count;
+            primitive.corners -= primitive.corners % 3;
+            primitive.cornerBase = cornerCount;
+            cornerCount += primitive.corners;
+            hasNormals = hasNormals || primitive.hasNormals;
+            hasTextureCords = hasTextureCords || primitive.hasTextureCords;
+            primitives.push_back(primitive);
+        }
+    }
+    if (cornerCount == 0 || cornerCount > (size_t) 0x7fffffff)
+    {
+        LOGE("GLB has %zu triangle corners", cornerCount);
+        return false;
+    }
+    threads = resolveThreads(threads, size, minChunkBytes);
+    std::vector<float> corners(cornerCount * cornerFloats);
+    std::atomic<bool> badIndex(false);
+    for (size_t n = 0; n < primitives.size(); n++)
+    {
+        const Primitive* primitive = &primitives[n];
+        float* out = &corners[primitive->cornerBase * cornerFloats];
+        int primitiveThreads = resolveThreads(threads, primitive->corners, 64 * 1024);
+        parallelFor(primitiveThreads, primitive->corners, [primitive, out, &badIndex](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++)
+            {
+                size_t vertex = primitive->indexed ? readIndex(&primitive->indices, i) : i;
+                float* corner = out + i * cornerFloats;
+                if (vertex >= primitive->positions.count)
+                {
+                    badIndex = true;
+                    vertex = 0;
+                }
+                memset(corner, 0, sizeof(float) * cornerFloats);
+                memcpy(corner, primitive->positions.data + vertex * primitive->positions.stride, sizeof(float) * 3);
+                for (int c = 0; primitive->hasNormals && c < 3; c++)
+                {
+                    corner[3 + c] = readComponent(&primitive->normals, vertex, c);
+                }
+                for (int c = 0; primitive->hasTextureCords && c < 2; c++)
+                {
+                    corner[6 + c] = readComponent(&primitive->textureCords, vertex, c);
+                }
+            }
+        });
+        if (badIndex)
+        {
+            LOGE("glTF index out of range");
+            return false;
+        }
+    }
+    double parseMilliseconds = millisecondsSince(start);
+    start = Clock::now();
+    buildIndexedMesh(corners, hasNormals, hasTextureCords, mesh);
+    if (stats != NULL)
+    {
+        stats->threads = threads;
+        stats->triangles = (int) (cornerCount / 3);
+        stats->corners = (int) cornerCount;
+        stats->parseMilliseconds = parseMilliseconds;
+        stats->dedupMilliseconds = millisecondsSince(start);
+    }
+    return true;
+}
+
+bool importMesh(const char* path, int threads, ImportedMesh* mesh, MeshImportStats* stats)
+{
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+    {
+        LOGE("Could not open mesh %s", path);
+        return false;
+    }
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0)
+    {
+        LOGE("Could not stat mesh %s", path);
+        close(file);
+        return false;
+    }
+    size_t size = (size_t) status.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED)
+    {
+        LOGE("Could not map mesh %s", path);
+        return false;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    const unsigned char* data = (const unsigned char*) mapping;
+    bool ok = size >= 4 && memcmp(data, "glTF", 4) == 0 ? importGlb(data, size, threads, mesh, stats)
+                                                         : importObj((const char*) data, size, threads, mesh, stats);
+    munmap(mapping, size);
+    if (!ok)
+    {
+        LOGE("Could not import mesh %s", path);
+    }
+    else if (stats != NULL)
+    {
+        stats->fileBytes = size;
+    }
+    return ok;
+}
+
+bool createImportedMesh(Mesh* mesh, const ImportedMesh* imported, GLint positionLocation, GLint normalLocation,
+                        GLint textureCordLocation)
+{
+    if (imported->indexType == GL_UNSIGNED_INT)
+    {
+        const char* version = (const char*) glGetString(GL_VERSION);
+        const char* extensions = (const char*) glGetString(GL_EXTENSIONS);
+        bool es3 = version != NULL && strncmp(version, "OpenGL ES ", 10) == 0 && version[10] >= '3';
+        if (!es3 && (extensions == NULL || strstr(extensions, "GL_OES_element_index_uint") == NULL))
+        {
+            LOGE("Mesh has %d vertices, 32-bit indices are not supported", imported->vertexCount);
+            return false;
+        }
+    }
+    MeshAttribute attributes[] = {
+            {positionLocation, 3, GL_FLOAT, GL_FALSE, &imported->positions[0],
+             (GLsizeiptr) (imported->positions.size() * sizeof(float)), 0},
+            {imported->hasNormals ? normalLocation : -1, 3, GL_FLOAT, GL_FALSE,
+             imported->hasNormals ? &imported->normals[0] : NULL, (GLsizeiptr) (imported->normals.size() * sizeof(float)), 0},
+            {imported->hasTextureCords ? textureCordLocation : -1, 2, GL_FLOAT, GL_FALSE,
+             imported->hasTextureCords ? &imported->textureCords[0] : NULL,
+             (GLsizeiptr) (imported->textureCords.size() * sizeof(float)), 0},
+    };
+    const void* indices = imported->indexType == GL_UNSIGNED_SHORT ? (const void*) &imported->shortIndices[0]
+                                                                   : (const void*) &imported->indices[0];
+    return createMesh(mesh, GL_TRIANGLES, attributes, 3, imported->vertexCount, indices, imported->indexCount,
+                      imported->indexType);
+}
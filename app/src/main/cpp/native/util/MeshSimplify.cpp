@@ -0,0 +1,597 @@
+/**
+ * --- 网格简化和LOD ---
+ *
+ * Garland和Heckbert的二次误差度量：每个位置累加周围三角形所在平面的二次型（按面积加权），
+ * 把顶点移到另一点的误差就是到这些平面的（加权平均）距离平方。每一轮：
+ *    1.列出所有允许的边折叠a→b（a并到b，结果仍然用b的顶点），代价是a的二次型在b处的误差加上属性的差
+ *    2.按代价从小到大折叠，同一轮里一个位置只参与一次；会让周围三角形翻转（法线转过75度以上）的折叠跳过
+ *    3.替换索引，去掉退化的三角形
+ * 直到三角形数达到目标或者最小的代价超过误差上限。
+ *
+ * 顶点按位置分组后分成四类：
+ *    - 普通：位置只有一个顶点，周围是封闭的扇形，可以折叠到任何相邻顶点
+ *    - 边界：网格的开放边上，只能沿边界折叠，边界上额外加垂直于三角形的平面，保持轮廓
+ *    - 接缝：同一位置有两个顶点（法线或纹理坐标不同，例如lesson4立方体每个面单独的顶点），只能沿接缝折叠，
+ *            两边的顶点一起移动，接缝两侧的属性保持不变
+ *    - 锁定：角上、三个以上的面相交等更复杂的位置，不动
+ * 立方体的每个角都是三个面的交点，所以课程里的立方体简化后保持不变。
+ */
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "../include/IndexOptimizer.h"
+#include "../include/MeshSimplify.h"
+
+enum VertexKind
+{
+    KIND_MANIFOLD,
+    KIND_BORDER,
+    KIND_SEAM,
+    KIND_LOCKED
+};
+
+static const unsigned int noEdge = ~0u;
+static const unsigned int manyEdges = ~0u - 1;
+static const double borderWeight = 10.0; // 边界平面的权重（乘以边长的平方）
+static const double seamWeight = 1.0;
+static const float flipThreshold = 0.25f; // 折叠前后三角形法线夹角的余弦小于它时算翻转
+
+struct Quadric
+{
+    double a00, a11, a22, a01, a02, a12;
+    double b0, b1, b2;
+    double c;
+    double area; // 累加的三角形面积，误差除以它得到平均距离平方
+};
+
+// 平面n·p + d = 0（n是单位向量）的二次型，乘以weight
+static void addPlane(Quadric* q, const double* n, double d, double weight)
+{
+    q->a00 += weight * n[0] * n[0];
+    q->a11 += weight * n[1] * n[1];
+    q->a22 += weight * n[2] * n[2];
+    q->a01 += weight * n[0] * n[1];
+    q->a02 += weight * n[0] * n[2];
+    q->a12 += weight * n[1] * n[2];
+    q->b0 += weight * n[0] * d;
+    q->b1 += weight * n[1] * d;
+    q->b2 += weight * n[2] * d;
+    q->c += weight * d * d;
+}
+
+static void addQuadric(Quadric* q, const Quadric& other)
+{
+    q->a00 += other.a00;
+    q->a11 += other.a11;
+    q->a22 += other.a22;
+    q->a01 += other.a01;
+    q->a02 += other.a02;
+    q->a12 += other.a12;
+    q->b0 += other.b0;
+    q->b1 += other.b1;
+    q->b2 += other.b2;
+    q->c += other.c;
+    q->area += other.area;
+}
+
+static double quadricError(const Quadric& q, const float* p)
+{
+    double x = p[0], y = p[1], z = p[2];
+    double rx = q.a00 * x + q.a01 * y + q.a02 * z;
+    double ry = q.a01 * x + q.a11 * y + q.a12 * z;
+    double rz = q.a02 * x + q.a12 * y + q.a22 * z;
+    double error = x * rx + y * ry + z * rz + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+    return fabs(error) / std::max(q.area, 1e-20);
+}
+
+static void cross(double* n, const float* a, const float* b, const float* c)
+{
+    double e1[3] = {(double) b[0] - a[0], (double) b[1] - a[1], (double) b[2] - a[2]};
+    double e2[3] = {(double) c[0] - a[0], (double) c[1] - a[1], (double) c[2] - a[2]};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// 位置完全相同的顶点分成一组：remap是组里第一个顶点，wedge把组里的顶点连成环
+static void groupPositions(const float* positions, int vertexCount, std::vector<unsigned int>* remap,
+                           std::vector<unsigned int>* wedge)
+{
+    size_t tableSize = 1;
+    while (tableSize < (size_t) vertexCount * 2)
+    {
+        tableSize *= 2;
+    }
+    std::vector<int> table(tableSize, -1);
+    remap->resize(vertexCount);
+    wedge->resize(vertexCount);
+    for (int v = 0; v < vertexCount; v++)
+    {
+        unsigned int bits[3];
+        memcpy(bits, positions + v * 3, sizeof(bits));
+        unsigned int hash = bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u;
+        size_t slot = hash & (tableSize - 1);
+        while (table[slot] >= 0 && memcmp(positions + table[slot] * 3, positions + v * 3, sizeof(float) * 3) != 0)
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] < 0)
+        {
+            table[slot] = v;
+            (*remap)[v] = v;
+            (*wedge)[v] = v;
+        }
+        else
+        {
+            unsigned int first = (unsigned int) table[slot];
+            (*remap)[v] = first;
+            (*wedge)[v] = (*wedge)[first];
+            (*wedge)[first] = v;
+        }
+    }
+}
+
+// 当前索引中每个顶点所在的三角形
+struct TriangleAdjacency
+{
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> triangles;
+};
+
+static void buildAdjacency(TriangleAdjacency* adjacency, const unsigned int* indices, int indexCount, int vertexCount)
+{
+    adjacency->offsets.assign(vertexCount + 1, 0);
+    for (int i = 0; i < indexCount; i++)
+    {
+        adjacency->offsets[indices[i] + 1]++;
+    }
+    for (int v = 0; v < vertexCount; v++)
+    {
+        adjacency->offsets[v + 1] += adjacency->offsets[v];
+    }
+    adjacency->triangles.resize(indexCount);
+    std::vector<unsigned int> fill(adjacency->offsets.begin(), adjacency->offsets.end() - 1);
+    for (int i = 0; i < indexCount; i++)
+    {
+        adjacency->triangles[fill[indices[i]]++] = (unsigned int) (i / 3);
+    }
+}
+
+// 三角形中a的下一个顶点，即有向边a→next
+static unsigned int nextCorner(const unsigned int* triangle, unsigned int a)
+{
+    return triangle[0] == a ? triangle[1] : triangle[1] == a ? triangle[2] : triangle[0];
+}
+
+static bool hasEdge(const TriangleAdjacency& adjacency, const unsigned int* indices, unsigned int a, unsigned int b)
+{
+    for (unsigned int i = adjacency.offsets[a]; i < adjacency.offsets[a + 1]; i++)
+    {
+        if (nextCorner(indices + adjacency.triangles[i] * 3, a) == b)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 按位置看，有没有从b所在位置到a所在位置的边
+static bool hasPositionEdge(const TriangleAdjacency& adjacency, const unsigned int* indices,
+                            const std::vector<unsigned int>& remap, const std::vector<unsigned int>& wedge,
+                            unsigned int a, unsigned int b)
+{
+    unsigned int x = b;
+    do
+    {
+        for (unsigned int i = adjacency.offsets[x]; i < adjacency.offsets[x + 1]; i++)
+        {
+            if (remap[nextCorner(indices + adjacency.triangles[i] * 3, x)] == remap[a])
+            {
+                return true;
+            }
+        }
+        x = wedge[x];
+    } while (x != b);
+    return false;
+}
+
+// 按顶点下标看的开放边：每个顶点记录唯一的一条出边、入边，没有时为noEdge，多于一条时为manyEdges
+static void findOpenEdges(const TriangleAdjacency& adjacency, const unsigned int* indices, int indexCount,
+                          int vertexCount, std::vector<unsigned int>* openIn, std::vector<unsigned int>* openOut)
+{
+    openIn->assign(vertexCount, noEdge);
+    openOut->assign(vertexCount, noEdge);
+    for (int i = 0; i < indexCount; i++)
+    {
+        unsigned int a = indices[i];
+        unsigned int b = indices[i - i % 3 + (i + 1) % 3];
+        if (!hasEdge(adjacency, indices, b, a))
+        {
+            (*openOut)[a] = (*openOut)[a] == noEdge ? b : manyEdges;
+            (*openIn)[b] = (*openIn)[b] == noEdge ? a : manyEdges;
+        }
+    }
+}
+
+static bool singleEdge(unsigned int edge)
+{
+    return edge != noEdge && edge != manyEdges;
+}
+
+static void classifyVertices(std::vector<unsigned char>* kinds, const TriangleAdjacency& adjacency,
+                             const unsigned int* indices, const std::vector<unsigned int>& remap,
+                             const std::vector<unsigned int>& wedge, const std::vector<unsigned int>& openIn,
+                             const std::vector<unsigned int>& openOut)
+{
+    int vertexCount = (int) remap.size();
+    kinds->assign(vertexCount, KIND_LOCKED);
+    for (int v = 0; v < vertexCount; v++)
+    {
+        unsigned char& kind = (*kinds)[v];
+        if (adjacency.offsets[v] == adjacency.offsets[v + 1])
+        {
+            continue;
+        }
+        unsigned int w = wedge[v];
+        if (w == (unsigned int) v)
+        {
+            if (openIn[v] == noEdge && openOut[v] == noEdge)
+            {
+                kind = KIND_MANIFOLD;
+            }
+            else if (singleEdge(openIn[v]) && singleEdge(openOut[v]) &&
+                     !hasPositionEdge(adjacency, indices, remap, wedge, v, openOut[v]) &&
+                     !hasPositionEdge(adjacency, indices, remap, wedge, openIn[v], v))
+            {
+                kind = KIND_BORDER; // 开放边在位置上也是开放的，是真正的边界，而不是接缝的端点
+            }
+        }
+        else if (wedge[w] == (unsigned int) v)
+        {
+            // 两个顶点各有一条开放的入边和出边，并且在位置上是同一条边的两个方向
+            if (singleEdge(openIn[v]) && singleEdge(openOut[v]) && singleEdge(openIn[w]) && singleEdge(openOut[w]) &&
+                remap[openIn[v]] == remap[openOut[w]] && remap[openOut[v]] == remap[openIn[w]])
+            {
+                kind = KIND_SEAM;
+            }
+        }
+    }
+}
+
+struct Collapse
+{
+    unsigned int from;
+    unsigned int to;
+    float cost;
+};
+
+static bool compareCollapses(const Collapse& a, const Collapse& b)
+{
+    return a.cost < b.cost;
+}
+
+// 接缝另一侧的顶点w沿接缝折叠时对应的目标
+static unsigned int seamTarget(const std::vector<unsigned int>& openIn, const std::vector<unsigned int>& openOut,
+                               unsigned int a, unsigned int b, unsigned int w)
+{
+    return openOut[a] == b ? openIn[w] : openOut[w];
+}
+
+static bool canCollapse(const std::vector<unsigned char>& kinds, const std::vector<unsigned int>& remap,
+                        const std::vector<unsigned int>& wedge, const std::vector<unsigned int>& openIn,
+                        const std::vector<unsigned int>& openOut, unsigned int a, unsigned int b)
+{
+    unsigned char from = kinds[a];
+    unsigned char to = kinds[b];
+    if (remap[a] == remap[b] || from == KIND_LOCKED)
+    {
+        return false;
+    }
+    if (from == KIND_MANIFOLD)
+    {
+        return true;
+    }
+    // 边界和接缝上的顶点只能沿开放边移动到同类或锁定的顶点
+    if ((to != from && to != KIND_LOCKED) || (openOut[a] != b && openIn[a] != b))
+    {
+        return false;
+    }
+    if (from == KIND_SEAM)
+    {
+        // 另一侧的顶点也要有对应的开放边，折叠到同一个位置
+        unsigned int target = seamTarget(openIn, openOut, a, b, wedge[a]);
+        return singleEdge(target) && remap[target] == remap[b];
+    }
+    return true;
+}
+
+static float attributeError(const SimplifyAttributes* attributes, unsigned int a, unsigned int b)
+{
+    if (attributes == NULL)
+    {
+        return 0.0f;
+    }
+    float error = 0.0f;
+    const float* from = attributes->data + (size_t) a * attributes->components;
+    const float* to = attributes->data + (size_t) b * attributes->components;
+    for (int k = 0; k < attributes->components; k++)
+    {
+        float difference = (from[k] - to[k]) * attributes->weights[k];
+        error += difference * difference;
+    }
+    return error;
+}
+
+// a移到b的位置后，a周围不含b的三角形有没有翻转
+static bool collapseFlips(const TriangleAdjacency& adjacency, const unsigned int* indices, const float* positions,
+                          const std::vector<unsigned int>& remap, const std::vector<unsigned int>& wedge,
+                          unsigned int a, unsigned int b)
+{
+    const float* target = positions + b * 3;
+    unsigned int x = a;
+    do
+    {
+        for (unsigned int i = adjacency.offsets[x]; i < adjacency.offsets[x + 1]; i++)
+        {
+            const unsigned int* triangle = indices + adjacency.triangles[i] * 3;
+            if (remap[triangle[0]] == remap[b] || remap[triangle[1]] == remap[b] || remap[triangle[2]] == remap[b])
+            {
+                continue; // 折叠后退化，会被删掉
+            }
+            unsigned int c = nextCorner(triangle, x);
+            unsigned int d = nextCorner(triangle, c);
+            double before[3];
+            double after[3];
+            cross(before, positions + x * 3, positions + c * 3, positions + d * 3);
+            cross(after, target, positions + c * 3, positions + d * 3);
+            double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+            double lengths = sqrt((before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+                                  (after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+            if (dot <= flipThreshold * lengths)
+            {
+                return true;
+            }
+        }
+        x = wedge[x];
+    } while (x != a);
+    return false;
+}
+
+int simplifyMesh(unsigned int* destination, const unsigned int* indices, int indexCount, const float* positions,
+                 int vertexCount, const SimplifyAttributes* attributes, int targetIndexCount, float targetError,
+                 float* resultError)
+{
+    indexCount -= indexCount % 3;
+    std::vector<unsigned int> current(indices, indices + indexCount);
+    std::vector<unsigned int> remap;
+    std::vector<unsigned int> wedge;
+    groupPositions(positions, vertexCount, &remap, &wedge);
+    TriangleAdjacency adjacency;
+    buildAdjacency(&adjacency, &current[0], indexCount, vertexCount);
+    std::vector<unsigned int> openIn;
+    std::vector<unsigned int> openOut;
+    findOpenEdges(adjacency, &current[0], indexCount, vertexCount, &openIn, &openOut);
+    std::vector<unsigned char> kinds;
+    classifyVertices(&kinds, adjacency, &current[0], remap, wedge, openIn, openOut);
+
+    // 每个位置的二次型：周围三角形的平面，加上边界边上垂直于三角形的平面
+    std::vector<Quadric> quadrics(vertexCount);
+    memset(&quadrics[0], 0, sizeof(Quadric) * vertexCount);
+    for (int i = 0; i < indexCount; i += 3)
+    {
+        const float* p[3] = {positions + current[i] * 3, positions + current[i + 1] * 3, positions + current[i + 2] * 3};
+        double n[3];
+        cross(n, p[0], p[1], p[2]);
+        double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0)
+        {
+            continue;
+        }
+        n[0] /= length;
+        n[1] /= length;
+        n[2] /= length;
+        double d = -(n[0] * p[0][0] + n[1] * p[0][1] + n[2] * p[0][2]);
+        Quadric plane;
+        memset(&plane, 0, sizeof(plane));
+        addPlane(&plane, n, d, length * 0.5);
+        plane.area = length * 0.5;
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int a = current[i + k];
+            unsigned int b = current[i + (k + 1) % 3];
+            addQuadric(&quadrics[remap[a]], plane);
+            if (!hasEdge(adjacency, &current[0], b, a))
+            {
+                // 网格边界上的平面权重大；接缝两侧都有三角形，加较小的权重让接缝本身的形状也尽量不变
+                bool border = !hasPositionEdge(adjacency, &current[0], remap, wedge, a, b);
+                const float* pa = positions + a * 3;
+                const float* pb = positions + b * 3;
+                double edge[3] = {(double) pb[0] - pa[0], (double) pb[1] - pa[1], (double) pb[2] - pa[2]};
+                double m[3] = {edge[1] * n[2] - edge[2] * n[1], edge[2] * n[0] - edge[0] * n[2],
+                               edge[0] * n[1] - edge[1] * n[0]};
+                double edgeLength = sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+                if (edgeLength > 0.0)
+                {
+                    m[0] /= edgeLength;
+                    m[1] /= edgeLength;
+                    m[2] /= edgeLength;
+                    double md = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+                    double weight = (border ? borderWeight : seamWeight) * edgeLength * edgeLength;
+                    addPlane(&quadrics[remap[a]], m, md, weight);
+                    addPlane(&quadrics[remap[b]], m, md, weight);
+                }
+            }
+        }
+    }
+
+    double errorLimit = (double) targetError * targetError;
+    double maxError = 0.0;
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> collapseRemap(vertexCount);
+    std::vector<char> locked(vertexCount);
+    while (indexCount > targetIndexCount)
+    {
+        if (adjacency.triangles.size() != (size_t) indexCount)
+        {
+            buildAdjacency(&adjacency, &current[0], indexCount, vertexCount);
+            findOpenEdges(adjacency, &current[0], indexCount, vertexCount, &openIn, &openOut);
+        }
+        collapses.clear();
+        for (int i = 0; i < indexCount; i++)
+        {
+            unsigned int a = current[i];
+            unsigned int b = current[i - i % 3 + (i + 1) % 3];
+            for (int direction = 0; direction < 2; direction++)
+            {
+                unsigned int from = direction == 0 ? a : b;
+                unsigned int to = direction == 0 ? b : a;
+                if (!canCollapse(kinds, remap, wedge, openIn, openOut, from, to))
+                {
+                    continue;
+                }
+                double cost = quadricError(quadrics[remap[from]], positions + to * 3) + attributeError(attributes, from, to);
+                if (kinds[from] == KIND_SEAM)
+                {
+                    unsigned int w = wedge[from];
+                    cost += attributeError(attributes, w, seamTarget(openIn, openOut, from, to, w));
+                }
+                Collapse collapse = {from, to, (float) cost};
+                collapses.push_back(collapse);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), compareCollapses);
+        for (int v = 0; v < vertexCount; v++)
+        {
+            collapseRemap[v] = v;
+        }
+        std::fill(locked.begin(), locked.end(), 0);
+        int goal = (indexCount - targetIndexCount) / 3;
+        int removed = 0;
+        int performed = 0;
+        for (size_t c = 0; c < collapses.size() && removed < goal; c++)
+        {
+            const Collapse& collapse = collapses[c];
+            unsigned int a = collapse.from;
+            unsigned int b = collapse.to;
+            if (collapse.cost > errorLimit)
+            {
+                break;
+            }
+            if (locked[remap[a]] || locked[remap[b]] ||
+                collapseFlips(adjacency, &current[0], positions, remap, wedge, a, b))
+            {
+                continue;
+            }
+            collapseRemap[a] = b;
+            if (kinds[a] == KIND_SEAM)
+            {
+                unsigned int w = wedge[a];
+                collapseRemap[w] = seamTarget(openIn, openOut, a, b, w);
+            }
+            addQuadric(&quadrics[remap[b]], quadrics[remap[a]]);
+            locked[remap[a]] = 1;
+            locked[remap[b]] = 1;
+            maxError = std::max(maxError, (double) collapse.cost);
+            removed += kinds[a] == KIND_BORDER ? 1 : 2;
+            performed++;
+        }
+        if (performed == 0)
+        {
+            break;
+        }
+        int write = 0;
+        for (int i = 0; i < indexCount; i += 3)
+        {
+            unsigned int a = collapseRemap[current[i]];
+            unsigned int b = collapseRemap[current[i + 1]];
+            unsigned int c = collapseRemap[current[i + 2]];
+            if (remap[a] != remap[b] && remap[b] != remap[c] && remap[a] != remap[c])
+            {
+                current[write] = a;
+                current[write + 1] = b;
+                current[write + 2] = c;
+                write += 3;
+            }
+        }
+        indexCount = write;
+    }
+    if (indexCount > 0)
+    {
+        memcpy(destination, &current[0], sizeof(unsigned int) * indexCount);
+    }
+    if (resultError != NULL)
+    {
+        *resultError = (float) sqrt(maxError);
+    }
+    return indexCount;
+}
+
+void buildLodChain(MeshLodChain* chain, const unsigned int* indices, int indexCount, const float* positions,
+                   int vertexCount, const SimplifyAttributes* attributes, int maxLods, float reduction, float maxError)
+{
+    indexCount -= indexCount % 3;
+    chain->indices.assign(indices, indices + indexCount);
+    if (indexCount > 0)
+    {
+        optimizeVertexCache(&chain->indices[0], &chain->indices[0], indexCount, vertexCount);
+    }
+    memset(chain->lods, 0, sizeof(chain->lods));
+    chain->lods[0].indexCount = (unsigned int) indexCount;
+    chain->lodCount = 1;
+    std::vector<unsigned int> level(chain->indices);
+    float error = 0.0f;
+    while (chain->lodCount < std::min(maxLods, maxMeshLods) && error < maxError && !level.empty())
+    {
+        int levelCount = (int) level.size();
+        int target = (int) (levelCount / 3 * reduction) * 3;
+        float levelError = 0.0f;
+        int count = simplifyMesh(&level[0], &level[0], levelCount, positions, vertexCount, attributes, target,
+                                 maxError - error, &levelError);
+        if (count == 0 || count > levelCount * 9 / 10)
+        {
+            break; // 误差已经到上限，或者剩下的顶点基本都锁定了
+        }
+        level.resize(count);
+        optimizeVertexCache(&level[0], &level[0], count, vertexCount);
+        error += levelError;
+        MeshCacheLod& lod = chain->lods[chain->lodCount++];
+        lod.firstIndex = (unsigned int) chain->indices.size();
+        lod.indexCount = (unsigned int) count;
+        lod.error = error;
+        chain->indices.insert(chain->indices.end(), level.begin(), level.end());
+    }
+}
+
+float lodErrorScale(float fieldOfView, int viewportHeight)
+{
+    return viewportHeight / (2.0f * tanf(fieldOfView * (float) M_PI / 360.0f));
+}
+
+int selectLod(const MeshCacheLod* lods, int lodCount, float distance, float scale, float errorScale,
+              float maxPixelError)
+{
+    // 误差e在距离distance处投影成e * scale * errorScale / distance像素
+    for (int i = lodCount - 1; i > 0; i--)
+    {
+        if (lods[i].error * scale * errorScale <= maxPixelError * distance)
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+void resetLodStats(LodStats* stats)
+{
+    memset(stats, 0, sizeof(LodStats));
+}
+
+void countLod(LodStats* stats, const MeshCacheLod* lods, int lod)
+{
+    stats->objects++;
+    stats->trianglesFull += lods[0].indexCount / 3;
+    stats->trianglesDrawn += lods[lod].indexCount / 3;
+    stats->objectsPerLod[lod]++;
+}
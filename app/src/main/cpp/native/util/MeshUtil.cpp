@@ -0,0 +1,324 @@
+/**
+ * --- 静态网格 ---
+ *
+ * 之前的课程在每帧绘制时都把CPU上的数组指针直接传给glVertexAttribPointer和glDrawElements，
+ * 驱动每一帧都要把这些顶点和索引数据重新复制一遍，再重新检查一遍属性设置。
+ * 对于不会变化的几何体，更好的做法是在初始化时：
+ *    - 用glBufferData把顶点数据和索引数据一次性上传到缓冲区对象（VBO/IBO），数据从此留在GPU可以直接访问的内存里
+ *    - 用顶点数组对象（VAO）把属性指针、启用状态和索引缓冲区的绑定记录下来
+ * 这样绘制时只需要绑定VAO再调用glDrawElements。
+ *
+ * 每个属性的数据在顶点缓冲区里依次排放（先是全部位置，然后是全部颜色……），属性指针的最后一个参数变成了缓冲区内的偏移。
+ * 绑定和属性设置都通过StateCache.h进行，连续绘制同一个网格时不会重复绑定。
+ * 也可以用createInterleavedMesh上传按VertexLayout交错、量化好的顶点数据，见VertexFormat.cpp。
+ */
+#include <cstring>
+
+#include "../include/MeshUtil.h"
+#include "../include/StateCache.h"
+#include "../include/VertexFormat.h"
+#include "../include/LogUtil.h"
+
+// GLES2上下文（ContextFactory在设备不支持GLES3时会退回2.0）没有VAO
+static bool vertexArraySupported()
+{
+    const char* version = (const char*) glGetString(GL_VERSION);
+    return version != NULL && strncmp(version, "OpenGL ES ", 10) == 0 && version[10] >= '3';
+}
+
+static int typeSize(GLenum type)
+{
+    switch (type)
+    {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+            return 1;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+// 设置属性指针，此时vertexBuffer和indexBuffer需要已经绑定
+static void setupAttributes(const Mesh* mesh)
+{
+    for (int i = 0; i < mesh->attributeCount; i++)
+    {
+        const MeshAttribute& attribute = mesh->attributes[i];
+        cachedVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized,
+                                  attribute.stride, attribute.data);
+        cachedEnableVertexAttribArray(attribute.location);
+    }
+}
+
+// 创建VAO（如果支持）和顶点缓冲区并绑定，之后由调用方上传顶点数据
+static void beginMesh(Mesh* mesh)
+{
+    if (vertexArraySupported())
+    {
+        glGenVertexArrays(1, &mesh->vertexArray);
+        cachedBindVertexArray(mesh->vertexArray);
+    }
+    glGenBuffers(1, &mesh->vertexBuffer);
+    cachedBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
+}
+
+// 上传索引、设置属性指针并解绑，最后用glGetError检查整个创建过程
+static bool finishMesh(Mesh* mesh, const void* indices, GLsizei indexCount, GLenum indexType)
+{
+    if (indices)
+    {
+        glGenBuffers(1, &mesh->indexBuffer);
+        cachedBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr) indexCount * typeSize(indexType), indices, GL_STATIC_DRAW);
+    }
+    setupAttributes(mesh);
+    if (mesh->vertexArray)
+    {
+        cachedBindVertexArray(0); // VAO已经记录好了，解绑避免后面的属性设置被误写进去
+    }
+    cachedBindBuffer(GL_ARRAY_BUFFER, 0);
+    cachedBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    if (glGetError() != GL_NO_ERROR)
+    {
+        LOGE("Could not create mesh");
+        deleteMesh(mesh);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * 创建网格并上传数据
+ * @param mode 图元类型
+ * @param attributes 顶点属性，location小于0的属性会被跳过
+ * @param vertexCount 顶点个数，没有索引时用于glDrawArrays
+ * @param indices 索引数组，为NULL时不使用索引
+ * @param indexCount 索引个数
+ * @param indexType GL_UNSIGNED_BYTE、GL_UNSIGNED_SHORT或GL_UNSIGNED_INT
+ * @return 失败时返回false，mesh中已创建的对象会被删除
+ */
+bool createMesh(Mesh* mesh, GLenum mode, const MeshAttribute* attributes, int attributeCount,
+                GLsizei vertexCount, const void* indices, GLsizei indexCount, GLenum indexType)
+{
+    memset(mesh, 0, sizeof(Mesh));
+    while (glGetError() != GL_NO_ERROR) {} // 清掉之前遗留的错误，最后用glGetError判断创建是否成功
+    if (attributeCount > maxMeshAttributes)
+    {
+        LOGE("Mesh has %d attributes, at most %d are supported", attributeCount, maxMeshAttributes);
+        return false;
+    }
+    mesh->mode = mode;
+    mesh->count = indices ? indexCount : vertexCount;
+    mesh->indexType = indexType;
+
+    // 先算出总大小和每个属性的偏移，再一次性分配缓冲区
+    GLsizeiptr totalBytes = 0;
+    for (int i = 0; i < attributeCount; i++)
+    {
+        if (attributes[i].location < 0)
+        {
+            continue;
+        }
+        MeshAttribute& attribute = mesh->attributes[mesh->attributeCount++];
+        attribute = attributes[i];
+        attribute.data = (const void*) totalBytes;
+        totalBytes += (attributes[i].bytes + 3) & ~3; // 每个属性按4字节对齐
+    }
+
+    beginMesh(mesh);
+    glBufferData(GL_ARRAY_BUFFER, totalBytes, NULL, GL_STATIC_DRAW);
+    for (int i = 0, j = 0; i < attributeCount; i++)
+    {
+        if (attributes[i].location >= 0)
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, (GLintptr) mesh->attributes[j++].data, attributes[i].bytes, attributes[i].data);
+        }
+    }
+    return finishMesh(mesh, indices, indexCount, indexType);
+}
+
+/**
+ * 用交错的顶点数据创建网格，所有属性共用一个步长，偏移来自layout
+ * @param vertices 按layout打包好的顶点数据，共layout->stride * vertexCount字节
+ * @return 失败时返回false，mesh中已创建的对象会被删除
+ */
+bool createInterleavedMesh(Mesh* mesh, GLenum mode, const VertexLayout* layout, const void* vertices,
+                           GLsizei vertexCount, const void* indices, GLsizei indexCount, GLenum indexType)
+{
+    memset(mesh, 0, sizeof(Mesh));
+    while (glGetError() != GL_NO_ERROR) {}
+    mesh->mode = mode;
+    mesh->count = indices ? indexCount : vertexCount;
+    mesh->indexType = indexType;
+    for (int i = 0; i < layout->elementCount; i++)
+    {
+        const VertexElement& element = layout->elements[i];
+        if (element.location < 0)
+        {
+            continue;
+        }
+        MeshAttribute& attribute = mesh->attributes[mesh->attributeCount++];
+        attribute.location = element.location;
+        getVertexElementType(&element, &attribute.size, &attribute.type, &attribute.normalized);
+        attribute.data = (const void*) (GLintptr) element.offset;
+        attribute.bytes = element.bytes;
+        attribute.stride = layout->stride;
+    }
+
+    beginMesh(mesh);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) layout->stride * vertexCount, vertices, GL_STATIC_DRAW);
+    return finishMesh(mesh, indices, indexCount, indexType);
+}
+
+// 绑定网格，之后可以直接调用glDrawElements。有VAO时只有一次调用，VAO会保持绑定。
+void bindMesh(const Mesh* mesh)
+{
+    if (mesh->vertexArray)
+    {
+        cachedBindVertexArray(mesh->vertexArray);
+        return;
+    }
+    cachedBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
+    cachedBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
+    setupAttributes(mesh);
+}
+
+void drawMesh(const Mesh* mesh)
+{
+    bindMesh(mesh);
+    if (mesh->indexBuffer)
+    {
+        glDrawElements(mesh->mode, mesh->count, mesh->indexType, 0);
+    }
+    else
+    {
+        glDrawArrays(mesh->mode, 0, mesh->count);
+    }
+}
+
+void drawMeshRange(const Mesh* mesh, GLsizei firstIndex, GLsizei count)
+{
+    bindMesh(mesh);
+    if (mesh->indexBuffer)
+    {
+        GLsizeiptr indexBytes = mesh->indexType == GL_UNSIGNED_INT ? 4 : mesh->indexType == GL_UNSIGNED_SHORT ? 2 : 1;
+        glDrawElements(mesh->mode, count, mesh->indexType, (const void*) (firstIndex * indexBytes));
+    }
+    else
+    {
+        glDrawArrays(mesh->mode, firstIndex, count);
+    }
+}
+
+void deleteMesh(Mesh* mesh)
+{
+    if (mesh->vertexArray)
+    {
+        cachedDeleteVertexArrays(1, &mesh->vertexArray);
+    }
+    if (mesh->vertexBuffer)
+    {
+        cachedDeleteBuffers(1, &mesh->vertexBuffer);
+    }
+    if (mesh->indexBuffer)
+    {
+        cachedDeleteBuffers(1, &mesh->indexBuffer);
+    }
+    memset(mesh, 0, sizeof(Mesh));
+}
+
+/**
+ * --- 实例化绘制 ---
+ *
+ * 要画几千个相同的网格时，每个网格一次glUniformMatrix4fv加一次glDrawElements，CPU时间几乎全花在驱动的调用开销上。
+ * GLES3的实例化绘制把每个实例不同的数据（这里是模型视图矩阵）放进一个顶点属性缓冲区，
+ * 用glVertexAttribDivisor(location, 1)让这个属性每个实例才前进一次，然后一次glDrawElementsInstanced画出全部实例。
+ * 着色器里用attribute mat4代替uniform mat4，其它不变。一个mat4属性占用4个连续的位置，每个位置是矩阵的一列。
+ *
+ * 矩阵每帧都会变化，更新时先用glBufferData(NULL)丢弃旧的存储（orphan），驱动可以给这一帧分配新的内存，
+ * 不必等GPU画完上一帧再覆盖，然后用glBufferSubData写入。
+ */
+bool attachInstanceMatrices(Mesh* mesh, InstanceBuffer* instances, GLint location, GLsizei capacity)
+{
+    memset(instances, 0, sizeof(InstanceBuffer));
+    if (mesh->vertexArray == 0 || location < 0)
+    {
+        LOGE("Instanced drawing needs a GLES3 context and a mat4 attribute");
+        return false;
+    }
+    while (glGetError() != GL_NO_ERROR) {}
+    instances->location = location;
+    instances->capacity = capacity > 0 ? capacity : 1;
+    cachedBindVertexArray(mesh->vertexArray);
+    glGenBuffers(1, &instances->buffer);
+    cachedBindBuffer(GL_ARRAY_BUFFER, instances->buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) instances->capacity * 16 * sizeof(float), NULL, GL_STREAM_DRAW);
+    for (int column = 0; column < 4; column++)
+    {
+        cachedVertexAttribPointer(location + column, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float),
+                                  (const void*) (column * 4 * sizeof(float)));
+        cachedEnableVertexAttribArray(location + column);
+        glVertexAttribDivisor(location + column, 1); // 每个实例前进一次
+    }
+    cachedBindVertexArray(0);
+    cachedBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (glGetError() != GL_NO_ERROR)
+    {
+        LOGE("Could not create instance buffer");
+        deleteInstanceBuffer(instances);
+        return false;
+    }
+    return true;
+}
+
+void updateInstanceMatrices(InstanceBuffer* instances, const float* matrices, GLsizei count)
+{
+    if (count > instances->capacity)
+    {
+        instances->capacity = count + count / 2; // 多留一些，避免数量逐渐增加时每帧重新分配
+    }
+    cachedBindBuffer(GL_ARRAY_BUFFER, instances->buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) instances->capacity * 16 * sizeof(float), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr) count * 16 * sizeof(float), matrices);
+}
+
+/**
+ * 矩阵直接写在流式缓冲区里时，每帧的数据在不同的段，偏移不同，要重新设置四列的属性指针。
+ * 偏移没变（例如同一段里的第二次绘制）时cachedVertexAttribPointer会省掉调用。
+ */
+void pointInstanceMatrices(const Mesh* mesh, const InstanceBuffer* instances, GLuint buffer, GLintptr offset)
+{
+    cachedBindVertexArray(mesh->vertexArray);
+    cachedBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (int column = 0; column < 4; column++)
+    {
+        cachedVertexAttribPointer(instances->location + column, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float),
+                                  (const void*) (offset + column * 4 * sizeof(float)));
+    }
+}
+
+void drawMeshInstanced(const Mesh* mesh, GLsizei instanceCount)
+{
+    bindMesh(mesh);
+    if (mesh->indexBuffer)
+    {
+        glDrawElementsInstanced(mesh->mode, mesh->count, mesh->indexType, 0, instanceCount);
+    }
+    else
+    {
+        glDrawArraysInstanced(mesh->mode, 0, mesh->count, instanceCount);
+    }
+}
+
+void deleteInstanceBuffer(InstanceBuffer* instances)
+{
+    if (instances->buffer)
+    {
+        cachedDeleteBuffers(1, &instances->buffer);
+    }
+    memset(instances, 0, sizeof(InstanceBuffer));
+}
@@ -0,0 +1,289 @@
+/**
+ * --- mipmap生成 ---
+ *
+ * 没有mipmap时，缩小的纹理每个屏幕像素只采样原图中的一个点，远处会闪烁（混叠），相邻像素采样的位置在原图里相距很远，
+ * 纹理缓存也几乎全部失效。这里在CPU上生成完整的mipmap链，配合GL_LINEAR_MIPMAP_LINEAR（三线性过滤）使用。
+ *
+ * 过滤在线性空间中进行：sRGB编码的颜色直接平均会偏暗（sRGB的0.5只有约21%的亮度），先查表转成线性浮点，
+ * 过滤后再编码回sRGB。每一级都从上一级的线性浮点结果生成，不会因为反复量化到8位而累积误差；
+ * 第0级不整张转换，生成第1级时按行查表转换，8K的原图可以省下1GB内存。
+ *
+ * 过滤器是可分离的：先在水平方向把一行缩成一半，再在竖直方向合并几行。
+ *    - box：2个抽头（0.5, 0.5），就是2x2平均
+ *    - Kaiser：8个抽头，sinc(x/2)乘以Kaiser窗（beta = 4），保留更多细节，负的旁瓣会让结果略微超出范围，写回前截断到[0, 1]
+ * 一个RGBA像素正好是一个SimdFloat4，每个抽头是一次simdMulAdd，NEON和SSE都能用；SIMD_SCALAR时按分量循环。
+ *
+ * 同一级的输出按行分成几段，分给多个线程，每个线程自己计算需要的水平过滤结果（段边界处会重复算几行）。
+ * 级别之间有依赖，所以按级别顺序进行。很小的级别直接在当前线程完成。
+ */
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "../include/MipUtil.h"
+#include "../include/SimdUtil.h"
+#include "../include/LogUtil.h"
+
+static const int kaiserTaps = 8;
+static const int linearToSrgbSize = 4096;
+static const int minParallelPixels = 64 * 1024; // 少于这么多输出像素的级别不分线程
+
+static float srgbToLinearTable[256];
+static unsigned char linearToSrgbTable[linearToSrgbSize];
+static float kaiserWeights[kaiserTaps];
+
+// 第一类零阶修正贝塞尔函数，用级数展开计算
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static bool initMipTables()
+{
+    for (int i = 0; i < 256; i++)
+    {
+        double c = i / 255.0;
+        srgbToLinearTable[i] = (float) (c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4));
+    }
+    for (int i = 0; i < linearToSrgbSize; i++)
+    {
+        double l = (double) i / (linearToSrgbSize - 1);
+        double c = l <= 0.0031308 ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+        linearToSrgbTable[i] = (unsigned char) (c * 255.0 + 0.5);
+    }
+    // 抽头位于源像素-3.5到3.5（输出像素中心在两个源像素之间）
+    const double beta = 4.0;
+    double sum = 0.0;
+    for (int k = 0; k < kaiserTaps; k++)
+    {
+        double x = k - kaiserTaps / 2 + 0.5;
+        double t = x / (kaiserTaps / 2);
+        double sinc = sin(M_PI * x / 2.0) / (M_PI * x / 2.0);
+        double window = besselI0(beta * sqrt(1.0 - t * t)) / besselI0(beta);
+        kaiserWeights[k] = (float) (sinc * window);
+        sum += kaiserWeights[k];
+    }
+    for (int k = 0; k < kaiserTaps; k++)
+    {
+        kaiserWeights[k] = (float) (kaiserWeights[k] / sum);
+    }
+    return true;
+}
+
+static const bool mipTablesReady = initMipTables();
+
+// 一个RGBA像素的累加
+#if defined(SIMD_SCALAR)
+struct Pixel4
+{
+    float v[4];
+};
+static inline Pixel4 pixelZero()
+{
+    Pixel4 p = {{0.0f, 0.0f, 0.0f, 0.0f}};
+    return p;
+}
+static inline Pixel4 pixelMulAdd(Pixel4 a, float weight, const float* p)
+{
+    for (int c = 0; c < 4; c++)
+    {
+        a.v[c] += weight * p[c];
+    }
+    return a;
+}
+static inline void pixelStore(float* p, Pixel4 a)
+{
+    for (int c = 0; c < 4; c++)
+    {
+        p[c] = a.v[c];
+    }
+}
+static inline void pixelStoreClamped(float* p, Pixel4 a)
+{
+    for (int c = 0; c < 4; c++)
+    {
+        p[c] = std::min(1.0f, std::max(0.0f, a.v[c]));
+    }
+}
+#else
+typedef SimdFloat4 Pixel4;
+static inline Pixel4 pixelZero() { return simdSplat(0.0f); }
+static inline Pixel4 pixelMulAdd(Pixel4 a, float weight, const float* p)
+{
+    return simdMulAdd(a, simdSplat(weight), simdLoad(p));
+}
+static inline void pixelStore(float* p, Pixel4 a) { simdStore(p, a); }
+static inline void pixelStoreClamped(float* p, Pixel4 a)
+{
+    simdStore(p, simdMin(simdMax(a, simdSplat(0.0f)), simdSplat(1.0f)));
+}
+#endif
+
+// 一级的过滤任务：source是上一级的线性浮点RGBA，第1级直接从8位的原图按行转换（原图整张转成浮点太占内存）
+struct MipLevelJob
+{
+    const unsigned char* sourceBytes;
+    const float* source;
+    int sourceWidth;
+    int sourceHeight;
+    float* destination; // 线性浮点RGBA，供下一级使用
+    unsigned char* output; // 编码后的RGBA8
+    int width;
+    int height;
+    bool srgb;
+    const float* weights;
+    int taps;
+};
+
+// 8位RGBA转换成线性浮点
+static void decodeRow(const unsigned char* rgba, int count, bool srgb, float* out)
+{
+    for (int i = 0; i < count; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            out[i * 4 + c] = srgb ? srgbToLinearTable[rgba[i * 4 + c]] : rgba[i * 4 + c] / 255.0f;
+        }
+        out[i * 4 + 3] = rgba[i * 4 + 3] / 255.0f;
+    }
+}
+
+// 把源图像的第row行（超出范围时取边缘）水平缩小一半写入out，scratch用来放转换后的8位源行
+static void filterRow(const MipLevelJob* job, int row, float* scratch, float* out)
+{
+    row = std::min(std::max(row, 0), job->sourceHeight - 1);
+    const float* line = job->source + (size_t) row * job->sourceWidth * 4;
+    if (job->sourceBytes != NULL)
+    {
+        decodeRow(job->sourceBytes + (size_t) row * job->sourceWidth * 4, job->sourceWidth, job->srgb, scratch);
+        line = scratch;
+    }
+    int first = 1 - job->taps / 2; // 输出像素x覆盖的第一个源像素是2x + first
+    for (int x = 0; x < job->width; x++)
+    {
+        Pixel4 sum = pixelZero();
+        for (int k = 0; k < job->taps; k++)
+        {
+            int column = std::min(std::max(2 * x + first + k, 0), job->sourceWidth - 1);
+            sum = pixelMulAdd(sum, job->weights[k], line + column * 4);
+        }
+        pixelStore(out + x * 4, sum);
+    }
+}
+
+static void encodePixel(const float* linear, bool srgb, unsigned char* out)
+{
+    for (int c = 0; c < 3; c++)
+    {
+        out[c] = srgb ? linearToSrgbTable[(int) (linear[c] * (linearToSrgbSize - 1) + 0.5f)]
+                      : (unsigned char) (linear[c] * 255.0f + 0.5f);
+    }
+    out[3] = (unsigned char) (linear[3] * 255.0f + 0.5f);
+}
+
+// 生成输出的[firstRow, lastRow)行。rows是taps行水平过滤结果的环形缓存，源行r放在r % taps
+static void filterRows(const MipLevelJob* job, int firstRow, int lastRow)
+{
+    std::vector<float> rows((size_t) job->taps * job->width * 4);
+    std::vector<int> cached(job->taps, -1 - job->taps);
+    std::vector<float> scratch(job->sourceBytes != NULL ? (size_t) job->sourceWidth * 4 : 0);
+    int first = 1 - job->taps / 2;
+    for (int y = firstRow; y < lastRow; y++)
+    {
+        for (int k = 0; k < job->taps; k++)
+        {
+            int row = 2 * y + first + k;
+            int slot = ((row % job->taps) + job->taps) % job->taps;
+            if (cached[slot] != row)
+            {
+                filterRow(job, row, scratch.empty() ? NULL : &scratch[0], &rows[(size_t) slot * job->width * 4]);
+                cached[slot] = row;
+            }
+        }
+        float* destination = job->destination + (size_t) y * job->width * 4;
+        unsigned char* output = job->output + (size_t) y * job->width * 4;
+        for (int x = 0; x < job->width; x++)
+        {
+            Pixel4 sum = pixelZero();
+            for (int k = 0; k < job->taps; k++)
+            {
+                int row = 2 * y + first + k;
+                int slot = ((row % job->taps) + job->taps) % job->taps;
+                sum = pixelMulAdd(sum, job->weights[k], &rows[((size_t) slot * job->width + x) * 4]);
+            }
+            pixelStoreClamped(destination + x * 4, sum); // Kaiser的负旁瓣可能让结果超出[0, 1]
+            encodePixel(destination + x * 4, job->srgb, output + x * 4);
+        }
+    }
+}
+
+bool generateMipChain(const unsigned char* rgba, int width, int height, bool srgb, MipFilter filter, int threads,
+                      MipChain* chain)
+{
+    if (width <= 0 || height <= 0 || width > 32768 || height > 32768)
+    {
+        LOGE("Invalid mipmap source size %dx%d", width, height);
+        return false;
+    }
+    (void) mipTablesReady;
+    if (threads <= 0)
+    {
+        threads = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    size_t total = 0;
+    chain->levelCount = 0;
+    for (int w = width, h = height;; w = std::max(1, w / 2), h = std::max(1, h / 2))
+    {
+        chain->width[chain->levelCount] = w;
+        chain->height[chain->levelCount] = h;
+        chain->offset[chain->levelCount] = total;
+        chain->levelCount++;
+        total += (size_t) w * h * 4;
+        if ((w == 1 && h == 1) || chain->levelCount == maxMipLevels)
+        {
+            break;
+        }
+    }
+    chain->pixels.resize(total);
+    std::copy(rgba, rgba + (size_t) width * height * 4, chain->pixels.begin());
+
+    std::vector<float> source;
+    static const float boxWeights[2] = {0.5f, 0.5f};
+    std::vector<float> destination;
+    for (int level = 1; level < chain->levelCount; level++)
+    {
+        MipLevelJob job;
+        job.sourceBytes = level == 1 ? rgba : NULL;
+        job.source = level == 1 ? NULL : &source[0];
+        job.sourceWidth = chain->width[level - 1];
+        job.sourceHeight = chain->height[level - 1];
+        job.width = chain->width[level];
+        job.height = chain->height[level];
+        destination.resize((size_t) job.width * job.height * 4);
+        job.destination = &destination[0];
+        job.output = &chain->pixels[chain->offset[level]];
+        job.srgb = srgb;
+        job.weights = filter == MIP_FILTER_KAISER ? kaiserWeights : boxWeights;
+        job.taps = filter == MIP_FILTER_KAISER ? kaiserTaps : 2;
+        int workers = job.width * job.height < minParallelPixels ? 1 : std::min(threads, job.height);
+        std::vector<std::thread> pool;
+        for (int i = 1; i < workers; i++)
+        {
+            pool.push_back(std::thread(filterRows, &job, job.height * i / workers, job.height * (i + 1) / workers));
+        }
+        filterRows(&job, 0, job.height / workers);
+        for (size_t i = 0; i < pool.size(); i++)
+        {
+            pool[i].join();
+        }
+        source.swap(destination);
+    }
+    return true;
+}
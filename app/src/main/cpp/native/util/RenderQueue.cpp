@@ -0,0 +1,369 @@
+/**
+ * --- 排序键渲染队列 ---
+ *
+ * 课程在renderFrame里按代码顺序直接绘制。物体和材质一多，相邻两次绘制的程序、纹理、网格往往都不一样，
+ * 每次绘制前都要切换状态；半透明物体还必须从远到近画，不透明物体从近到远画才能让深度测试挡掉更多像素。
+ *
+ * 这里场景代码不直接绘制，而是把物体提交成绘制包（材质、网格、模型视图矩阵），每个包带一个64位的排序键：
+ *
+ *    不透明：| 层 4 | 0 | 程序 10 | 纹理 10 | 网格 15 | 深度 24 |
+ *    半透明：| 层 4 | 1 | 反转的深度 24 | 程序 10 | 纹理 10 | 网格 15 |
+ *
+ * 按键从小到大排序后：先按层，同一层里不透明在前、半透明在后；不透明物体按状态聚在一起，同样状态的按从近到远；
+ * 半透明物体从远到近，远近相同时才按状态。程序、纹理、网格直接用GL对象的名字（截断到各自的位数），
+ * 只决定顺序，能不能合并还要比较包里真正的材质和网格，所以名字截断后重复也不会画错。
+ *
+ * 排序用LSD基数排序，每趟8位、最多8趟，先一次扫描算出全部8个字节的直方图，某个字节在所有键上都相同（例如只有一层、
+ * 没有半透明物体时的最高字节）就跳过这一趟。每趟都是稳定的，键完全相同的包保持提交顺序。
+ *
+ * 排好后，程序支持实例化（材质有instanceLocation）的相邻包，只要材质的状态和网格相同就合并成一批，矩阵按顺序写进
+ * 环形流式缓冲区（StreamBuffer.cpp），一次glDrawElementsInstanced画完；先写完全部批次的矩阵（每帧只映射一次），
+ * 再统一提交绘制。包、矩阵、排序的临时数组都放在队列的每帧数据区里，flush后清空但保留容量。
+ */
+#include <GLES3/gl3.h>
+#include <chrono>
+#include <cstring>
+
+#include "../include/RenderQueue.h"
+#include "../include/StateCache.h"
+
+static const int programKeyBits = 10;
+static const int textureKeyBits = 10;
+static const int meshKeyBits = 15;
+static const unsigned long long depthKeyMask = (1ull << renderDepthBits) - 1;
+static const GLsizeiptr initialInstanceBytes = 1024 * 16 * sizeof(float);
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+bool createRenderQueue(RenderQueue* queue)
+{
+    queue->packets.clear();
+    queue->matrices.clear();
+    queue->batches.clear();
+    queue->nearDistance = 0.1f;
+    queue->farDistance = 100.0f;
+    queue->sort = true;
+    queue->batch = true;
+    memset(&queue->stats, 0, sizeof(queue->stats));
+    return createStreamBuffer(&queue->instances, GL_ARRAY_BUFFER, initialInstanceBytes, 3);
+}
+
+void deleteRenderQueue(RenderQueue* queue)
+{
+    if (queue->instances.buffer)
+    {
+        deleteStreamBuffer(&queue->instances);
+    }
+    std::vector<DrawPacket>().swap(queue->packets);
+    std::vector<float>().swap(queue->matrices);
+    std::vector<unsigned long long>().swap(queue->sortKeys);
+    std::vector<unsigned int>().swap(queue->order);
+    std::vector<unsigned long long>().swap(queue->scratchKeys);
+    std::vector<unsigned int>().swap(queue->scratchOrder);
+    std::vector<RenderBatch>().swap(queue->batches);
+}
+
+void beginRenderQueue(RenderQueue* queue, float nearDistance, float farDistance)
+{
+    queue->packets.clear();
+    queue->matrices.clear();
+    queue->nearDistance = nearDistance;
+    queue->farDistance = farDistance > nearDistance ? farDistance : nearDistance + 1.0f;
+}
+
+static unsigned long long meshKey(const Mesh* mesh)
+{
+    return (mesh->vertexArray ? mesh->vertexArray : mesh->vertexBuffer) & ((1u << meshKeyBits) - 1);
+}
+
+unsigned long long renderSortKey(const RenderQueue* queue, int layer, const RenderMaterial* material, const Mesh* mesh,
+                                 float depth)
+{
+    float scaled = (depth - queue->nearDistance) / (queue->farDistance - queue->nearDistance);
+    scaled = scaled < 0.0f ? 0.0f : scaled > 1.0f ? 1.0f : scaled;
+    unsigned long long quantized = (unsigned long long) (scaled * depthKeyMask) & depthKeyMask;
+    unsigned long long program = material->program & ((1u << programKeyBits) - 1);
+    unsigned long long texture = material->texture & ((1u << textureKeyBits) - 1);
+    unsigned long long state = (program << (textureKeyBits + meshKeyBits)) | (texture << meshKeyBits) | meshKey(mesh);
+    unsigned long long key = (unsigned long long) (layer & (renderLayerCount - 1)) << 60;
+    if (material->translucent)
+    {
+        return key | (1ull << 59) | ((depthKeyMask - quantized) << 35) | state; // 远的在前
+    }
+    return key | (state << renderDepthBits) | quantized; // 同样状态的近的在前
+}
+
+void submitDraw(RenderQueue* queue, int layer, const RenderMaterial* material, const Mesh* mesh, const float* modelView)
+{
+    DrawPacket packet;
+    packet.key = renderSortKey(queue, layer, material, mesh, -modelView[14]); // 相机看向-z
+    packet.material = material;
+    packet.mesh = mesh;
+    packet.matrix = (int) (queue->matrices.size() / 16);
+    queue->matrices.insert(queue->matrices.end(), modelView, modelView + 16);
+    queue->packets.push_back(packet);
+}
+
+void radixSortKeys(unsigned long long* keys, unsigned int* order, int count,
+                   unsigned long long* scratchKeys, unsigned int* scratchOrder)
+{
+    unsigned int histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (int i = 0; i < count; i++)
+    {
+        unsigned long long key = keys[i];
+        for (int pass = 0; pass < 8; pass++)
+        {
+            histograms[pass][(key >> (pass * 8)) & 255]++;
+        }
+        order[i] = (unsigned int) i;
+    }
+    unsigned long long* sourceKeys = keys;
+    unsigned int* sourceOrder = order;
+    unsigned long long* destinationKeys = scratchKeys;
+    unsigned int* destinationOrder = scratchOrder;
+    for (int pass = 0; pass < 8 && count > 1; pass++)
+    {
+        int shift = pass * 8;
+        unsigned int* histogram = histograms[pass];
+        if (histogram[(sourceKeys[0] >> shift) & 255] == (unsigned int) count)
+        {
+            continue; // 这个字节全部相同，顺序不变
+        }
+        unsigned int offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++)
+        {
+            unsigned int bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            unsigned int position = histogram[(sourceKeys[i] >> shift) & 255]++;
+            destinationKeys[position] = sourceKeys[i];
+            destinationOrder[position] = sourceOrder[i];
+        }
+        unsigned long long* swapKeys = sourceKeys;
+        sourceKeys = destinationKeys;
+        destinationKeys = swapKeys;
+        unsigned int* swapOrder = sourceOrder;
+        sourceOrder = destinationOrder;
+        destinationOrder = swapOrder;
+    }
+    if (sourceKeys != keys)
+    {
+        memcpy(keys, sourceKeys, sizeof(unsigned long long) * count);
+        memcpy(order, sourceOrder, sizeof(unsigned int) * count);
+    }
+}
+
+// 按order的顺序逐个绘制需要的状态切换（第一次设置也算）
+static void countStateChanges(const RenderQueue* queue, const unsigned int* order, int count, RenderStateChanges* changes)
+{
+    GLuint program = 0;
+    GLuint texture = 0;
+    const Mesh* mesh = NULL;
+    bool translucent = false;
+    for (int i = 0; i < count; i++)
+    {
+        const DrawPacket& packet = queue->packets[order ? order[i] : (unsigned int) i];
+        const RenderMaterial* material = packet.material;
+        changes->programs += material->program != program;
+        changes->textures += material->texture != 0 && material->texture != texture;
+        changes->meshes += packet.mesh != mesh;
+        changes->blendToggles += material->translucent != translucent;
+        program = material->program;
+        texture = material->texture != 0 ? material->texture : texture;
+        mesh = packet.mesh;
+        translucent = material->translucent;
+    }
+}
+
+// 两个包能否画在同一次实例化绘制里
+static bool canBatch(const DrawPacket& first, const DrawPacket& next)
+{
+    const RenderMaterial* a = first.material;
+    const RenderMaterial* b = next.material;
+    return a->instanceLocation >= 0 && first.mesh == next.mesh
+           && (a == b || (a->program == b->program && a->texture == b->texture && a->translucent == b->translucent
+                          && a->instanceLocation == b->instanceLocation));
+}
+
+// 流式缓冲区每段放得下bytes，不够时重新创建
+static bool reserveInstances(RenderQueue* queue, GLsizeiptr bytes)
+{
+    if (queue->instances.buffer == 0 || bytes <= queue->instances.frameBytes)
+    {
+        return queue->instances.buffer != 0;
+    }
+    deleteStreamBuffer(&queue->instances);
+    return createStreamBuffer(&queue->instances, GL_ARRAY_BUFFER, bytes + bytes / 2, 3);
+}
+
+// 把合并后的批次分好，实例化批次的矩阵写进流式缓冲区，返回是否开始了流式缓冲区的一帧
+static bool buildBatches(RenderQueue* queue, int count)
+{
+    queue->batches.clear();
+    GLsizeiptr instanceBytes = 0;
+    for (int i = 0; i < count;)
+    {
+        RenderBatch batch = {i, 1, -1};
+        const DrawPacket& first = queue->packets[queue->order[i]];
+        while (queue->batch && i + batch.count < count && canBatch(first, queue->packets[queue->order[i + batch.count]]))
+        {
+            batch.count++;
+        }
+        if (first.material->instanceLocation >= 0)
+        {
+            instanceBytes += (GLsizeiptr) batch.count * 16 * sizeof(float) + 16; // 加上对齐可能浪费的空间
+        }
+        queue->batches.push_back(batch);
+        i += batch.count;
+    }
+    if (instanceBytes == 0 || !reserveInstances(queue, instanceBytes))
+    {
+        return false;
+    }
+    beginStreamFrame(&queue->instances);
+    for (size_t b = 0; b < queue->batches.size(); b++)
+    {
+        RenderBatch& batch = queue->batches[b];
+        if (queue->packets[queue->order[batch.first]].material->instanceLocation < 0)
+        {
+            continue;
+        }
+        float* destination = (float*) streamAllocate(&queue->instances, (GLsizeiptr) batch.count * 16 * sizeof(float),
+                                                     16, &batch.offset);
+        if (destination == NULL)
+        {
+            batch.offset = -1;
+            continue;
+        }
+        for (int i = 0; i < batch.count; i++)
+        {
+            const DrawPacket& packet = queue->packets[queue->order[batch.first + i]];
+            memcpy(destination + i * 16, &queue->matrices[(size_t) packet.matrix * 16], 16 * sizeof(float));
+        }
+    }
+    unmapStreamBuffer(&queue->instances); // GLES3的缓冲区映射时不能绘制
+    return true;
+}
+
+static void setBlending(bool translucent)
+{
+    if (translucent)
+    {
+        cachedEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE); // 半透明物体不挡住后面的半透明物体
+    }
+    else
+    {
+        cachedDisable(GL_BLEND);
+        glDepthMask(GL_TRUE);
+    }
+}
+
+void flushRenderQueue(RenderQueue* queue, const float* projection)
+{
+    int count = (int) queue->packets.size();
+    RenderQueueStats& stats = queue->stats;
+    stats.frames++;
+    stats.packets += count;
+    if (count == 0)
+    {
+        return;
+    }
+    countStateChanges(queue, NULL, count, &stats.unsorted);
+    stats.unsorted.drawCalls += count;
+
+    Clock::time_point start = Clock::now();
+    queue->order.resize(count);
+    if (queue->sort)
+    {
+        queue->sortKeys.resize(count);
+        queue->scratchKeys.resize(count);
+        queue->scratchOrder.resize(count);
+        for (int i = 0; i < count; i++)
+        {
+            queue->sortKeys[i] = queue->packets[i].key;
+        }
+        radixSortKeys(&queue->sortKeys[0], &queue->order[0], count, &queue->scratchKeys[0], &queue->scratchOrder[0]);
+    }
+    else
+    {
+        for (int i = 0; i < count; i++)
+        {
+            queue->order[i] = (unsigned int) i;
+        }
+    }
+    stats.sortMilliseconds += millisecondsSince(start);
+
+    start = Clock::now();
+    bool streamed = buildBatches(queue, count);
+    countStateChanges(queue, &queue->order[0], count, &stats.sorted);
+    bool translucent = false;
+    GLuint program = 0;
+    for (size_t b = 0; b < queue->batches.size(); b++)
+    {
+        const RenderBatch& batch = queue->batches[b];
+        const DrawPacket& first = queue->packets[queue->order[batch.first]];
+        const RenderMaterial* material = first.material;
+        if (material->translucent != translucent)
+        {
+            translucent = material->translucent;
+            setBlending(translucent);
+        }
+        cachedUseProgram(material->program);
+        if (material->program != program && material->projectionLocation >= 0)
+        {
+            cachedUniformMatrix4fv(material->projectionLocation, 1, projection); // 值没变时被StateCache省掉
+        }
+        program = material->program;
+        if (material->texture != 0)
+        {
+            cachedActiveTexture(GL_TEXTURE0);
+            cachedBindTexture(GL_TEXTURE_2D, material->texture);
+        }
+        if (material->instanceLocation >= 0)
+        {
+            if (batch.offset < 0)
+            {
+                stats.overflows++;
+                continue;
+            }
+            InstanceBuffer instances = {0, material->instanceLocation, 0};
+            pointInstanceMatrices(first.mesh, &instances, queue->instances.buffer, batch.offset);
+            drawMeshInstanced(first.mesh, batch.count);
+            stats.instancedPackets += batch.count;
+        }
+        else
+        {
+            cachedUniformMatrix4fv(material->modelViewLocation, 1, &queue->matrices[(size_t) first.matrix * 16]);
+            drawMesh(first.mesh);
+        }
+        stats.batches++;
+        stats.sorted.drawCalls++;
+    }
+    if (translucent)
+    {
+        setBlending(false);
+    }
+    if (streamed)
+    {
+        endStreamFrame(&queue->instances);
+    }
+    stats.submitMilliseconds += millisecondsSince(start);
+    queue->packets.clear();
+    queue->matrices.clear();
+}
+
+void resetRenderQueueStats(RenderQueue* queue)
+{
+    memset(&queue->stats, 0, sizeof(queue->stats));
+}
@@ -0,0 +1,183 @@
+/**
+ * --- 场景注册表 ---
+ *
+ * 原来每课都导出同名的setupGraphics和renderFrame，Native.cpp只能在链接时选一课（Light），换课要重新编译，
+ * 其他几课的动态库也一直打包在APK里却用不上。现在每课定义一个Scene，用静态的SceneRegistration在库被加载时注册自己；
+ * selectScene按名字找到场景，还没注册时才dlopen对应的libName.so，所以启动时只加载选中的一课。
+ * 切换场景时先停掉模拟线程、释放当前场景的GL资源，再dlclose它的库，内存里只留当前场景。
+ *
+ * 直接链接了课程库的程序（例如Benchmark链接了InstancedCube）启动时就已经注册，不会再dlopen，也不会被卸载。
+ */
+#include <EGL/egl.h>
+#include <cstring>
+#include <dlfcn.h>
+#include <string>
+
+#include "../include/FrameProfiler.h"
+#include "../include/LogUtil.h"
+#include "../include/Scene.h"
+#include "../include/SimulationUtil.h"
+
+static const char* sceneNames[] = {"Triangle", "Cube", "TextureCube", "Light", "InstancedCube"};
+static const int maxRegisteredScenes = 16;
+
+// 只用零初始化的静态变量，课程库的静态构造函数可能在这个文件的构造函数之前运行
+static const Scene* registeredScenes[maxRegisteredScenes];
+static int registeredCount;
+static char libraryDirectory[512];
+
+static const Scene* activeScene;
+static void* activeLibrary; // 为NULL时场景不是由selectScene加载的，不卸载
+static EGLContext activeContext; // setup时的上下文，用来判断是否只需要resize
+static EGLContext profilerContext; // 帧分析器的GPU计时查询属于哪个上下文，换场景时不变
+
+SceneRegistration::SceneRegistration(const Scene* registered) : scene(registered)
+{
+    registerScene(registered);
+}
+
+SceneRegistration::~SceneRegistration()
+{
+    unregisterScene(scene);
+}
+
+void registerScene(const Scene* scene)
+{
+    if (registeredCount == maxRegisteredScenes)
+    {
+        LOGE("Too many scenes, could not register %s", scene->name);
+        return;
+    }
+    registeredScenes[registeredCount++] = scene;
+}
+
+void unregisterScene(const Scene* scene)
+{
+    for (int i = 0; i < registeredCount; i++)
+    {
+        if (registeredScenes[i] == scene)
+        {
+            registeredScenes[i] = registeredScenes[--registeredCount];
+            break;
+        }
+    }
+    if (activeScene == scene)
+    {
+        activeScene = NULL; // 库被别人卸载了，资源已经没法释放
+        activeLibrary = NULL;
+    }
+}
+
+int sceneCount()
+{
+    return (int) (sizeof(sceneNames) / sizeof(sceneNames[0]));
+}
+
+const char* sceneName(int index)
+{
+    return index >= 0 && index < sceneCount() ? sceneNames[index] : NULL;
+}
+
+void setSceneLibraryDirectory(const char* directory)
+{
+    if (directory == NULL)
+    {
+        libraryDirectory[0] = '\0';
+        return;
+    }
+    strncpy(libraryDirectory, directory, sizeof(libraryDirectory) - 1);
+    libraryDirectory[sizeof(libraryDirectory) - 1] = '\0';
+}
+
+static const Scene* findScene(const char* name)
+{
+    for (int i = 0; i < registeredCount; i++)
+    {
+        if (strcmp(registeredScenes[i]->name, name) == 0)
+        {
+            return registeredScenes[i];
+        }
+    }
+    return NULL;
+}
+
+void closeScene()
+{
+    stopSimulation(); // 模拟线程在调用场景库里的函数，要先停下来
+    if (activeScene != NULL)
+    {
+        activeScene->teardown();
+        activeScene = NULL;
+    }
+    if (activeLibrary != NULL)
+    {
+        dlclose(activeLibrary); // 静态的SceneRegistration析构时注销场景
+        activeLibrary = NULL;
+    }
+    activeContext = EGL_NO_CONTEXT;
+}
+
+bool selectScene(const char* name, int width, int height)
+{
+    EGLContext context = eglGetCurrentContext();
+    if (context != profilerContext)
+    {
+        // 新的GL上下文，旧的计时查询已经随旧上下文销毁，不管是哪个场景都要重新创建
+        initFrameProfiler();
+        profilerContext = context;
+    }
+    if (activeScene != NULL && strcmp(activeScene->name, name) == 0)
+    {
+        if (context == activeContext)
+        {
+            activeScene->resize(width, height);
+            return true;
+        }
+        // 上下文重建了，原来的GL资源已经随旧上下文销毁，库不用重新加载，直接重新setup
+        stopSimulation();
+        activeContext = context;
+        if (!activeScene->setup(width, height))
+        {
+            LOGE("Could not set up scene %s", name);
+            closeScene();
+            return false;
+        }
+        return true;
+    }
+    closeScene();
+    const Scene* scene = findScene(name);
+    void* library = NULL;
+    if (scene == NULL)
+    {
+        std::string path = std::string(libraryDirectory[0] != '\0' ? libraryDirectory : "");
+        path += (path.empty() ? "lib" : "/lib") + std::string(name) + ".so";
+        library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (library == NULL)
+        {
+            LOGE("Could not load scene %s: %s", name, dlerror());
+            return false;
+        }
+        scene = findScene(name);
+        if (scene == NULL)
+        {
+            LOGE("%s does not register a scene named %s", path.c_str(), name);
+            dlclose(library);
+            return false;
+        }
+    }
+    activeScene = scene;
+    activeLibrary = library;
+    activeContext = context;
+    if (!scene->setup(width, height))
+    {
+        LOGE("Could not set up scene %s", name);
+        closeScene();
+        return false;
+    }
+    return true;
+}
+
+const Scene* currentScene()
+{
+    return activeScene;
+}
@@ -0,0 +1,372 @@
+/**
+ * --- 着色器变体 ---
+ *
+ * 课程里的着色器都是写死的字符串，光照的每个功能（镜面反射、纹理、逐像素）都要另写一份才能去掉。这里把功能写成模板里的
+ * #ifdef，getShaderVariant按功能组合在源码前加#define再编译，编译器会把没用到的分支连同它们的uniform一起去掉。
+ * 组合一共只有2^SHADER_FEATURE_COUNT种，但实际用到的很少，所以第一次请求时才编译，结果按（模板，功能）记录下来；
+ * createProgram本身按源码缓存程序二进制，每个变体的源码不同，下次启动时也只从磁盘加载用到的变体。
+ *
+ * 光照里每帧不变的量（归一化后的光线和视线方向、光强乘颜色常量）在CPU上用computeLightingUniforms算一次，作为uniform传入，
+ * 通过StateCache设置，值没有变化的帧不会调用驱动。
+ */
+#include <GLES3/gl3.h>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+#include "../include/LoadUtil.h"
+#include "../include/LogUtil.h"
+#include "../include/ShaderVariant.h"
+#include "../include/StateCache.h"
+#include "../include/UniformBlocks.h"
+
+static const char* featureDefines[SHADER_FEATURE_COUNT] = {"PER_PIXEL_LIGHTING", "SPECULAR", "TEXTURE", "UNIFORM_BLOCKS"};
+
+// Phong光照：两个着色器共用，逐顶点时编译进顶点着色器，逐像素时编译进块着色器
+#define PHONG_LIGHTING_SOURCE \
+        "#ifdef UNIFORM_BLOCKS\n" \
+        LIGHTING_BLOCK_SOURCE /* 和下面的uniform同名，phong不需要改 */ \
+        "#else\n" \
+        "uniform vec3 inverseLightDirection;\n" /* 入射光反转后的方向（我们需要一个往外发散的向量表示反射出的光的向量），CPU上已经归一化 */ \
+        "uniform vec3 inverseEyeDirection;\n" /* 反转后的视角方向，这个例子简单使用了一个固定的视角，通常这个值需要根据相机矩阵计算 */ \
+        "uniform vec3 ambientLightIntensity;\n" /* 环境光强度 */ \
+        "uniform vec3 diffuseLightIntensity;\n" /* 漫反射光强度（这个例子中用的白光） */ \
+        "#ifdef SPECULAR\n" \
+        "uniform vec3 specularColour;\n" /* 镜面反射光强度乘颜色常量，这里用白光，因为反射到视角中的光是白光 */ \
+        "uniform float shininess;\n" /* 指数，因为我们点积的值都是0-1之间的，所以这个值越大（反射的向量与视角的夹角越大），镜面反射光的结果越小 */ \
+        "#endif\n" \
+        "#endif\n" \
+        "vec3 phong(vec3 normal, vec3 colour)\n" /* colour同时作为漫反射和环境光的颜色常量，通常这两个值需要单独指定颜色 */ \
+        "{\n" \
+        "    float normalDotLight = max(0.0, dot(normal, inverseLightDirection));\n" /* 点乘计算出法线和光线的夹角，cos值，和0.0做max方法过滤掉负值（反射光在背面的值） */ \
+        "    vec3 result = normalDotLight * colour * diffuseLightIntensity;\n" /* 角度*颜色常量*强度，得到漫反射光的颜色 */ \
+        "    result += colour * ambientLightIntensity;\n" /* 环境光颜色*环境光强度，这个颜色是统一的，不会随着角度或视角变化 */ \
+        "#ifdef SPECULAR\n" \
+        "    vec3 lightReflectionDirection = reflect(vec3(0) - inverseLightDirection, normal);\n" /* 使用reflect接口计算反射光的方向 */ \
+        "    float normalDotReflection = max(0.0, dot(inverseEyeDirection, lightReflectionDirection));\n" /* 点积计算反射光和视角的夹角 */ \
+        "    result += pow(normalDotReflection, shininess) * specularColour;\n" /* 角度*颜色常量*强度，得到镜面反射光的颜色 */ \
+        "#endif\n" \
+        "    return result;\n" \
+        "}\n"
+
+// 顶点着色器
+static const char phongVertexShader[] =
+        "attribute vec3 vertexNormal;\n" // 顶点法线
+        "attribute vec4 vertexPosition;\n" // 顶点坐标
+        "attribute vec3 vertexColour;\n" // 顶点颜色
+        "#ifdef UNIFORM_BLOCKS\n"
+        CAMERA_BLOCK_SOURCE // 所有程序共用，切换程序不需要重新上传
+        OBJECT_BLOCK_SOURCE
+        "#else\n"
+        "uniform mat4 projection;\n" // 投影矩阵（uniform类似全局变量，可在顶点着色器和块着色器中被访问，但在其中不能被修改）
+        "uniform mat4 modelView;\n" // 模型矩阵
+        "#endif\n"
+        "#ifdef TEXTURE\n"
+        "attribute vec2 vertexTextureCord;\n"
+        "varying vec2 fragTextureCord;\n"
+        "#endif\n"
+        "#ifdef PER_PIXEL_LIGHTING\n"
+        "varying vec3 fragNormal;\n" // 逐像素时把法线和颜色常量插值后交给块着色器计算
+        "varying vec3 fragBaseColour;\n"
+        "#else\n"
+        "varying vec3 fragColour;\n" // 用于传递给片段着色器颜色（varying用于传递属性给片段着色器）
+        PHONG_LIGHTING_SOURCE
+        "#endif\n"
+        "void main()\n"
+        "{\n"
+        "    vec3 transformedVertexNormal = normalize((modelView * vec4(vertexNormal, 0.0)).xyz);\n" // 用模型矩阵来转换顶点法线
+        "#ifdef PER_PIXEL_LIGHTING\n"
+        "    fragNormal = transformedVertexNormal;\n"
+        "    fragBaseColour = vertexColour;\n"
+        "#else\n"
+        "    fragColour = phong(transformedVertexNormal, vertexColour);\n"
+        "#endif\n"
+        "#ifdef TEXTURE\n"
+        "    fragTextureCord = vertexTextureCord;\n"
+        "#endif\n"
+        "    gl_Position = projection * modelView * vertexPosition;\n" // GL坐标设置成投影矩阵和模型视图矩阵的乘积
+        "}\n";
+
+// 块着色器
+static const char phongFragmentShader[] =
+        "precision mediump float;\n" // 设置精度
+        "#ifdef TEXTURE\n"
+        "uniform sampler2D materialTexture;\n"
+        "varying vec2 fragTextureCord;\n"
+        "#endif\n"
+        "#ifdef PER_PIXEL_LIGHTING\n"
+        "varying vec3 fragNormal;\n"
+        "varying vec3 fragBaseColour;\n"
+        PHONG_LIGHTING_SOURCE
+        "#else\n"
+        "varying vec3 fragColour;\n" // 从顶点着色器传递过来的颜色（vec3没有透明属性）
+        "#endif\n"
+        "void main()\n"
+        "{\n"
+        "#ifdef PER_PIXEL_LIGHTING\n"
+        "    vec3 colour = phong(normalize(fragNormal), fragBaseColour);\n" // 插值后的法线不再是单位向量
+        "#else\n"
+        "    vec3 colour = fragColour;\n"
+        "#endif\n"
+        "#ifdef TEXTURE\n"
+        "    colour *= texture2D(materialTexture, fragTextureCord).rgb;\n"
+        "#endif\n"
+        "    gl_FragColor = vec4(colour, 1.0);\n" // 设置颜色（1.0设置的是透明属性）
+        "}\n";
+
+const ShaderTemplate phongTemplate = {phongVertexShader, phongFragmentShader};
+
+struct ShaderVariant
+{
+    const ShaderTemplate* shaderTemplate;
+    unsigned int features;
+    GLuint program;
+};
+
+static ShaderVariant variants[maxShaderVariants];
+static int variantCount = 0;
+static ShaderVariantStats variantStats;
+
+static double currentMilliseconds()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+}
+
+std::string shaderVariantSource(const char* source, unsigned int features)
+{
+    std::string defines;
+    for (int i = 0; i < SHADER_FEATURE_COUNT; i++)
+    {
+        if (features & (1u << i))
+        {
+            defines += std::string("#define ") + featureDefines[i] + " 1\n";
+        }
+    }
+    // #version必须是第一行
+    const char* body = source;
+    if (strncmp(source, "#version", 8) == 0)
+    {
+        const char* end = strchr(source, '\n');
+        body = end != NULL ? end + 1 : source + strlen(source);
+        return std::string(source, body - source) + (end != NULL ? "" : "\n") + defines + body;
+    }
+    return defines + body;
+}
+
+static bool identifierCharacter(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+std::string upgradeShaderSource(const std::string& source, GLenum stage)
+{
+    // 模板自己写了#version时（shaderVariantSource把它留在第一行），已经是3.00的不用改写，其他的去掉这一行换成3.00
+    size_t i = 0;
+    if (source.compare(0, 8, "#version") == 0)
+    {
+        if (source.compare(0, 16, "#version 300 es\n") == 0 || source.compare(0, 16, "#version 310 es\n") == 0
+            || source.compare(0, 16, "#version 320 es\n") == 0)
+        {
+            return source;
+        }
+        size_t end = source.find('\n');
+        i = end != std::string::npos ? end + 1 : source.size();
+    }
+    bool fragment = stage == GL_FRAGMENT_SHADER;
+    std::string result = "#version 300 es\n";
+    if (fragment)
+    {
+        result += "out mediump vec4 fragmentColour;\n"; // 3.00去掉了gl_FragColor
+    }
+    // 按标识符整个替换，不会改到名字里包含这些词的变量（例如vertexTextureCord）
+    while (i < source.size())
+    {
+        if (!identifierCharacter(source[i]))
+        {
+            result += source[i++];
+            continue;
+        }
+        size_t end = i;
+        while (end < source.size() && identifierCharacter(source[end]))
+        {
+            end++;
+        }
+        std::string word = source.substr(i, end - i);
+        if (word == "attribute")
+        {
+            result += "in";
+        }
+        else if (word == "varying")
+        {
+            result += fragment ? "in" : "out";
+        }
+        else if (word == "texture2D")
+        {
+            result += "texture";
+        }
+        else if (word == "gl_FragColor")
+        {
+            result += "fragmentColour";
+        }
+        else
+        {
+            result += word;
+        }
+        i = end;
+    }
+    return result;
+}
+
+GLuint getShaderVariant(const ShaderTemplate* shaderTemplate, unsigned int features)
+{
+    for (int i = 0; i < variantCount; i++)
+    {
+        if (variants[i].shaderTemplate == shaderTemplate && variants[i].features == features)
+        {
+            variantStats.hits++;
+            return variants[i].program;
+        }
+    }
+    if (variantCount == maxShaderVariants)
+    {
+        LOGE("Too many shader variants, at most %d are cached", maxShaderVariants);
+        return 0;
+    }
+    double start = currentMilliseconds();
+    std::string vertexSource = shaderVariantSource(shaderTemplate->vertexSource, features);
+    std::string fragmentSource = shaderVariantSource(shaderTemplate->fragmentSource, features);
+    if (features & SHADER_UNIFORM_BLOCKS)
+    {
+        vertexSource = upgradeShaderSource(vertexSource, GL_VERTEX_SHADER);
+        fragmentSource = upgradeShaderSource(fragmentSource, GL_FRAGMENT_SHADER);
+    }
+    GLuint program = createProgram(vertexSource.c_str(), fragmentSource.c_str());
+    variantStats.buildMilliseconds += currentMilliseconds() - start;
+    if (program == 0)
+    {
+        LOGE("Could not create shader variant 0x%x", features);
+        return 0;
+    }
+    if (features & SHADER_UNIFORM_BLOCKS)
+    {
+        bindProgramUniformBlocks(program); // 块和绑定点的对应关系不保存在程序二进制里，从缓存加载的程序也要设置
+    }
+    ShaderVariant& variant = variants[variantCount++];
+    variant.shaderTemplate = shaderTemplate;
+    variant.features = features;
+    variant.program = program;
+    variantStats.built++;
+    return program;
+}
+
+void resetShaderVariants()
+{
+    variantCount = 0;
+}
+
+void deleteShaderVariants()
+{
+    for (int i = 0; i < variantCount; i++)
+    {
+        cachedDeleteProgram(variants[i].program);
+    }
+    variantCount = 0;
+}
+
+void getShaderVariantStats(ShaderVariantStats* stats)
+{
+    *stats = variantStats;
+}
+
+void resetShaderVariantStats()
+{
+    memset(&variantStats, 0, sizeof(variantStats));
+}
+
+unsigned int materialShaderFeatures(const LightingMaterial* material)
+{
+    unsigned int features = 0;
+    if (material->specularColour[0] > 0.0f || material->specularColour[1] > 0.0f || material->specularColour[2] > 0.0f)
+    {
+        features |= SHADER_SPECULAR;
+    }
+    if (material->texture != 0)
+    {
+        features |= SHADER_TEXTURE;
+    }
+    if (material->perPixel)
+    {
+        features |= SHADER_PER_PIXEL_LIGHTING;
+    }
+    return features;
+}
+
+static void normalize(float* destination, const float* vector)
+{
+    float length = sqrtf(vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2]);
+    float scale = length > 0.0f ? 1.0f / length : 0.0f;
+    destination[0] = vector[0] * scale;
+    destination[1] = vector[1] * scale;
+    destination[2] = vector[2] * scale;
+}
+
+void computeLightingUniforms(LightingUniforms* uniforms, const float* lightDirection, const float* eyeDirection,
+                             const float* ambient, const float* diffuse, const float* specular,
+                             const LightingMaterial* material)
+{
+    normalize(uniforms->inverseLightDirection, lightDirection);
+    normalize(uniforms->inverseEyeDirection, eyeDirection);
+    memcpy(uniforms->ambientLightIntensity, ambient, sizeof(float) * 3);
+    memcpy(uniforms->diffuseLightIntensity, diffuse, sizeof(float) * 3);
+    for (int k = 0; k < 3; k++)
+    {
+        uniforms->specularColour[k] = material->specularColour[k] * specular[k];
+    }
+    uniforms->shininess = material->shininess;
+}
+
+void getLightingLocations(GLuint program, LightingLocations* locations)
+{
+    locations->inverseLightDirection = glGetUniformLocation(program, "inverseLightDirection");
+    locations->inverseEyeDirection = glGetUniformLocation(program, "inverseEyeDirection");
+    locations->ambientLightIntensity = glGetUniformLocation(program, "ambientLightIntensity");
+    locations->diffuseLightIntensity = glGetUniformLocation(program, "diffuseLightIntensity");
+    locations->specularColour = glGetUniformLocation(program, "specularColour");
+    locations->shininess = glGetUniformLocation(program, "shininess");
+    locations->materialTexture = glGetUniformLocation(program, "materialTexture");
+}
+
+void applyLightingUniforms(const LightingLocations* locations, const LightingUniforms* uniforms)
+{
+    // 位置为-1时glUniform本来就会忽略，这里直接跳过，省掉一次调用
+    if (locations->inverseLightDirection >= 0)
+    {
+        cachedUniform3fv(locations->inverseLightDirection, 1, uniforms->inverseLightDirection);
+    }
+    if (locations->inverseEyeDirection >= 0)
+    {
+        cachedUniform3fv(locations->inverseEyeDirection, 1, uniforms->inverseEyeDirection);
+    }
+    if (locations->ambientLightIntensity >= 0)
+    {
+        cachedUniform3fv(locations->ambientLightIntensity, 1, uniforms->ambientLightIntensity);
+    }
+    if (locations->diffuseLightIntensity >= 0)
+    {
+        cachedUniform3fv(locations->diffuseLightIntensity, 1, uniforms->diffuseLightIntensity);
+    }
+    if (locations->specularColour >= 0)
+    {
+        cachedUniform3fv(locations->specularColour, 1, uniforms->specularColour);
+    }
+    if (locations->shininess >= 0)
+    {
+        cachedUniform1f(locations->shininess, uniforms->shininess);
+    }
+    if (locations->materialTexture >= 0)
+    {
+        cachedUniform1i(locations->materialTexture, 0);
+    }
+}
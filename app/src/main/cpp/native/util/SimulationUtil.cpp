@@ -0,0 +1,230 @@
+/**
+ * --- 模拟线程 ---
+ *
+ * 课程代码在renderFrame里更新动画（angle += 1），模拟和GL提交在同一个渲染线程上串行执行，
+ * 动画速度还取决于帧率：60Hz的屏幕上转一圈6秒，120Hz上3秒，掉帧时变慢。
+ *
+ * 这里把场景更新放到单独的线程上，按固定步长推进（和帧率无关），每轮更新后把渲染需要的数据写成一份快照，
+ * 通过三缓冲发布给渲染线程。渲染线程每帧只取最新的快照提交绘制，不读场景状态，所以：
+ *    - 多核手机上模拟可以和GL提交并行
+ *    - 模拟偶尔很慢时，渲染线程继续提交上一份快照，不会卡住
+ *    - 快照发布后不会再被修改，渲染线程读取时不需要加锁
+ *
+ * 三缓冲：写者持有一块，读者持有一块，第三块放在原子变量middle里。写者写完后用exchange把自己的块换成middle，
+ * 读者发现middle里有新数据时同样用exchange换走，双方都只做一次原子交换，不会等待对方。
+ * 写者比读者快时，没被读到的快照直接被覆盖，读者总是拿到最新的一份。
+ *
+ * 固定步长：累计经过的时间，每满一个步长调用一次update。模拟线程被系统挂起很久（或者单步比步长还慢）时，
+ * 一轮最多追maxCatchUpSteps步，多出的时间丢掉，否则会越追越落后。
+ */
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "../include/SimulationUtil.h"
+#include "../include/LogUtil.h"
+
+static const unsigned int tripleBufferIndexMask = 3;
+static const unsigned int tripleBufferFreshBit = 4;
+static const int maxCatchUpSteps = 5;
+
+bool createTripleBuffer(TripleBuffer* buffer, size_t slotBytes)
+{
+    buffer->slots = (unsigned char*) calloc(3, slotBytes);
+    if (buffer->slots == NULL)
+    {
+        LOGE("Could not allocate triple buffer of %zu bytes", 3 * slotBytes);
+        return false;
+    }
+    buffer->slotBytes = slotBytes;
+    buffer->writeIndex = 0;
+    buffer->middle.store(1, std::memory_order_relaxed);
+    buffer->readIndex = 2;
+    return true;
+}
+
+void deleteTripleBuffer(TripleBuffer* buffer)
+{
+    free(buffer->slots);
+    buffer->slots = NULL;
+}
+
+void* tripleBufferWriteSlot(TripleBuffer* buffer)
+{
+    return buffer->slots + buffer->writeIndex * buffer->slotBytes;
+}
+
+void publishTripleBuffer(TripleBuffer* buffer)
+{
+    // release让快照的内容在读者换到这一块之前可见，acquire保证换回来的块读者已经不再使用
+    unsigned int previous = buffer->middle.exchange(buffer->writeIndex | tripleBufferFreshBit, std::memory_order_acq_rel);
+    buffer->writeIndex = previous & tripleBufferIndexMask;
+}
+
+const void* tripleBufferLatest(TripleBuffer* buffer)
+{
+    if (buffer->middle.load(std::memory_order_relaxed) & tripleBufferFreshBit)
+    {
+        unsigned int previous = buffer->middle.exchange(buffer->readIndex, std::memory_order_acq_rel);
+        buffer->readIndex = previous & tripleBufferIndexMask;
+    }
+    return buffer->slots + buffer->readIndex * buffer->slotBytes;
+}
+
+static TripleBuffer snapshots;
+static std::thread simulationThread;
+static bool simulationRunning = false;
+static SimulationUpdate simulationUpdate;
+static SimulationSnapshot simulationSnapshot;
+static double simulationStep;
+
+// 暂停和停止用条件变量唤醒模拟线程，快照的传递不经过这把锁
+static std::mutex simulationMutex;
+static std::condition_variable simulationWake;
+static bool simulationStopping;
+static bool simulationPaused;
+
+static std::atomic<long long> stepCount(0);
+static std::atomic<long long> publishedCount(0);
+static std::atomic<long long> consumedCount(0);
+static std::atomic<long long> skippedCount(0);
+static std::atomic<double> maxUpdateMilliseconds(0.0);
+
+static void publishSnapshot()
+{
+    simulationSnapshot(tripleBufferWriteSlot(&snapshots));
+    publishTripleBuffer(&snapshots);
+    publishedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void simulationLoop()
+{
+    typedef std::chrono::steady_clock Clock;
+    const Clock::duration step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(simulationStep));
+    Clock::time_point previous = Clock::now();
+    Clock::duration accumulated = Clock::duration::zero();
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(simulationMutex);
+            if (simulationPaused)
+            {
+                simulationWake.wait(lock, [] { return simulationStopping || !simulationPaused; });
+                previous = Clock::now(); // 暂停期间的时间不算
+                accumulated = Clock::duration::zero();
+            }
+            if (simulationStopping)
+            {
+                return;
+            }
+            Clock::time_point now = Clock::now();
+            accumulated += now - previous;
+            previous = now;
+            if (accumulated < step)
+            {
+                // 睡到下一个步长，停止或暂停时提前醒来
+                simulationWake.wait_for(lock, step - accumulated);
+                continue;
+            }
+        }
+        int steps = (int) (accumulated / step);
+        if (steps > maxCatchUpSteps)
+        {
+            skippedCount.fetch_add(steps - maxCatchUpSteps, std::memory_order_relaxed);
+            accumulated -= step * (steps - maxCatchUpSteps);
+            steps = maxCatchUpSteps;
+        }
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < steps; i++)
+        {
+            simulationUpdate(simulationStep);
+            accumulated -= step;
+        }
+        stepCount.fetch_add(steps, std::memory_order_relaxed);
+        publishSnapshot();
+        double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (milliseconds > maxUpdateMilliseconds.load(std::memory_order_relaxed))
+        {
+            maxUpdateMilliseconds.store(milliseconds, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool startSimulation(SimulationUpdate update, SimulationSnapshot snapshot, size_t snapshotBytes, double stepSeconds)
+{
+    stopSimulation();
+    if (stepSeconds <= 0)
+    {
+        LOGE("Simulation step must be positive: %f", stepSeconds);
+        return false;
+    }
+    if (!createTripleBuffer(&snapshots, snapshotBytes))
+    {
+        return false;
+    }
+    simulationUpdate = update;
+    simulationSnapshot = snapshot;
+    simulationStep = stepSeconds;
+    simulationStopping = false;
+    stepCount.store(0);
+    publishedCount.store(0);
+    consumedCount.store(0);
+    skippedCount.store(0);
+    maxUpdateMilliseconds.store(0.0);
+    publishSnapshot(); // 线程还没开始，第一帧就有快照可用
+    simulationThread = std::thread(simulationLoop);
+    simulationRunning = true;
+    return true;
+}
+
+void stopSimulation()
+{
+    if (!simulationRunning)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(simulationMutex);
+        simulationStopping = true;
+    }
+    simulationWake.notify_one();
+    simulationThread.join();
+    deleteTripleBuffer(&snapshots);
+    simulationRunning = false;
+}
+
+void setSimulationPaused(bool paused)
+{
+    {
+        std::lock_guard<std::mutex> lock(simulationMutex);
+        simulationPaused = paused;
+    }
+    simulationWake.notify_one();
+}
+
+const void* latestSimulationSnapshot()
+{
+    if (!simulationRunning)
+    {
+        return NULL;
+    }
+    unsigned int previous = snapshots.readIndex;
+    const void* snapshot = tripleBufferLatest(&snapshots);
+    if (snapshots.readIndex != previous)
+    {
+        consumedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+void getSimulationStats(SimulationStats* stats)
+{
+    stats->steps = stepCount.load(std::memory_order_relaxed);
+    stats->published = publishedCount.load(std::memory_order_relaxed);
+    stats->consumed = consumedCount.load(std::memory_order_relaxed);
+    stats->skippedSteps = skippedCount.load(std::memory_order_relaxed);
+    stats->maxUpdateMilliseconds = maxUpdateMilliseconds.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,817 @@
+/**
+ * --- 软件光栅化 ---
+ *
+ * CI机器上没有GPU，Mesa的llvmpipe虽然能跑课程，但画面随Mesa版本变化，帧时间也主要是llvmpipe自己的开销。
+ * 这里在CPU上实现课程用到的那一小部分管线，画面只取决于这份代码，可以和基准图像逐像素比较：
+ *    1.顶点变换：每1024个顶点一个任务，位置乘以投影×模型视图矩阵（matrixTransformVec4Array），
+ *      有光照时用和phongTemplate逐顶点变体相同的公式算出颜色
+ *    2.图元装配和分块：在调用线程上按提交顺序裁剪近、远平面，剔除背面和视锥外的三角形，算出三条边的边函数和
+ *      深度、1/w、各属性除以w的平面方程（在屏幕上线性插值后再乘w就是透视正确的结果），
+ *      再把三角形编号加入它的包围盒覆盖的每个64×64分块
+ *    3.光栅化：每个非空分块是一个任务，线程先做自己队列里的，做完后从别的线程的队列尾部偷（各分块的三角形数差别很大）。
+ *      分块内逐行每次用SIMD算4个像素的边函数和深度（见SimdUtil.h），覆盖且通过深度测试的像素再逐个算颜色
+ * 一个分块只由一个线程写，分块内按提交顺序处理，所以结果和线程数、任务被谁偷走都无关。
+ * 边函数在每组像素处直接求值而不是逐步累加，共享一条边的两个三角形得到正好相反的值，配合左上规则，边上的像素只画一次。
+ */
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "../include/CameraUtil.h"
+#include "../include/LogUtil.h"
+#include "../include/SimdUtil.h"
+#include "../include/SoftRaster.h"
+
+static const int maxSoftRasterThreads = 64;
+static const int maxFramebufferSize = 16384;
+static const int vertexChunk = 1024; // 每个顶点变换任务的顶点数
+static const int varyingCount = 5; // 颜色3个、纹理坐标2个
+
+// ---- 线程池 ----
+
+struct SoftTask
+{
+    void (*function)(int index, void* context);
+    void* context;
+    int index;
+};
+
+struct SoftTaskQueue
+{
+    std::mutex mutex;
+    std::deque<SoftTask> tasks;
+};
+
+static SoftTaskQueue taskQueues[maxSoftRasterThreads];
+static std::vector<std::thread> rasterThreads;
+static int queueCount = 1; // 第0个队列属于调用softDraw的线程
+static std::mutex poolMutex;
+static std::condition_variable workAvailable;
+static std::condition_variable workFinished;
+static std::atomic<int> remainingTasks(0);
+static std::atomic<int> stealCount(0);
+static int workGeneration = 0;
+static bool stoppingThreads = false;
+
+static bool takeTask(int self, SoftTask* task)
+{
+    {
+        std::lock_guard<std::mutex> lock(taskQueues[self].mutex);
+        if (!taskQueues[self].tasks.empty())
+        {
+            *task = taskQueues[self].tasks.front();
+            taskQueues[self].tasks.pop_front();
+            return true;
+        }
+    }
+    // 自己的做完了，从别的队列尾部偷，尾部离队列的主人正在做的任务最远
+    for (int i = 1; i < queueCount; i++)
+    {
+        SoftTaskQueue* victim = &taskQueues[(self + i) % queueCount];
+        std::lock_guard<std::mutex> lock(victim->mutex);
+        if (!victim->tasks.empty())
+        {
+            *task = victim->tasks.back();
+            victim->tasks.pop_back();
+            stealCount++;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void runTasks(int self)
+{
+    SoftTask task;
+    while (takeTask(self, &task))
+    {
+        task.function(task.index, task.context);
+        if (remainingTasks.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            workFinished.notify_all();
+        }
+    }
+}
+
+static void workerLoop(int self)
+{
+    std::unique_lock<std::mutex> lock(poolMutex);
+    int seenGeneration = workGeneration;
+    while (true)
+    {
+        while (!stoppingThreads && workGeneration == seenGeneration)
+        {
+            workAvailable.wait(lock);
+        }
+        if (stoppingThreads)
+        {
+            return;
+        }
+        seenGeneration = workGeneration;
+        lock.unlock();
+        runTasks(self);
+        lock.lock();
+    }
+}
+
+// 执行function(0..count-1, context)，连续的任务平均分到各线程的队列，调用线程也参与，全部完成后返回
+static void runParallel(int count, void (*function)(int index, void* context), void* context)
+{
+    if (queueCount == 1 || count <= 1)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            function(i, context);
+        }
+        return;
+    }
+    remainingTasks = count;
+    for (int queue = 0; queue < queueCount; queue++)
+    {
+        std::lock_guard<std::mutex> lock(taskQueues[queue].mutex);
+        for (int i = count * queue / queueCount; i < count * (queue + 1) / queueCount; i++)
+        {
+            SoftTask task = {function, context, i};
+            taskQueues[queue].tasks.push_back(task);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        workGeneration++;
+    }
+    workAvailable.notify_all();
+    runTasks(0);
+    std::unique_lock<std::mutex> lock(poolMutex);
+    while (remainingTasks.load() != 0)
+    {
+        workFinished.wait(lock);
+    }
+}
+
+void startSoftRasterThreads(int threads)
+{
+    stopSoftRasterThreads();
+    if (threads <= 0)
+    {
+        threads = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    queueCount = std::min(threads, maxSoftRasterThreads);
+    stoppingThreads = false;
+    for (int i = 1; i < queueCount; i++)
+    {
+        rasterThreads.push_back(std::thread(workerLoop, i));
+    }
+}
+
+void stopSoftRasterThreads()
+{
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stoppingThreads = true;
+    }
+    workAvailable.notify_all();
+    for (size_t i = 0; i < rasterThreads.size(); i++)
+    {
+        rasterThreads[i].join();
+    }
+    rasterThreads.clear();
+    queueCount = 1;
+}
+
+int softRasterThreadCount()
+{
+    return queueCount;
+}
+
+// ---- 帧缓冲 ----
+
+bool createSoftFramebuffer(SoftFramebuffer* framebuffer, int width, int height)
+{
+    if (width <= 0 || height <= 0 || width > maxFramebufferSize || height > maxFramebufferSize)
+    {
+        LOGE("Invalid software framebuffer size %dx%d", width, height);
+        return false;
+    }
+    framebuffer->width = width;
+    framebuffer->height = height;
+    framebuffer->colour.assign((size_t) width * height * 4, 0);
+    // 多留4个，光栅化时每次读4个像素的深度，最后一行的末尾不会越界
+    framebuffer->depth.assign((size_t) width * height + 4, 1.0f);
+    return true;
+}
+
+static unsigned char toUnorm8(float value)
+{
+    value = std::min(1.0f, std::max(0.0f, value));
+    return (unsigned char) (value * 255.0f + 0.5f);
+}
+
+void clearSoftFramebuffer(SoftFramebuffer* framebuffer, float red, float green, float blue, float alpha)
+{
+    unsigned char pixel[4] = {toUnorm8(red), toUnorm8(green), toUnorm8(blue), toUnorm8(alpha)};
+    unsigned char* colour = &framebuffer->colour[0];
+    for (size_t i = 0; i < framebuffer->colour.size(); i += 4)
+    {
+        memcpy(colour + i, pixel, 4);
+    }
+    std::fill(framebuffer->depth.begin(), framebuffer->depth.end(), 1.0f);
+}
+
+// ---- 顶点变换 ----
+
+// 裁剪空间的顶点，varyings为颜色和纹理坐标（还没有除以w）
+struct ClipVertex
+{
+    float position[4];
+    float varyings[varyingCount];
+};
+
+struct VertexJob
+{
+    const SoftDraw* draw;
+    float modelViewProjection[16];
+    float modelView[16];
+};
+
+static std::vector<ClipVertex> clipVertices;
+
+// source为NULL时为单位矩阵
+static void copyMatrix(float* matrix, const float* source)
+{
+    if (source != NULL)
+    {
+        memcpy(matrix, source, sizeof(float) * 16);
+    }
+    else
+    {
+        matrixIdentityFunction(matrix);
+    }
+}
+
+// 和phongTemplate逐顶点变体的phong函数相同
+static void phong(const LightingUniforms* lighting, const float* normal, const float* colour, float* result)
+{
+    float normalDotLight = std::max(0.0f, normal[0] * lighting->inverseLightDirection[0]
+                                          + normal[1] * lighting->inverseLightDirection[1]
+                                          + normal[2] * lighting->inverseLightDirection[2]);
+    for (int i = 0; i < 3; i++)
+    {
+        result[i] = normalDotLight * colour[i] * lighting->diffuseLightIntensity[i]
+                    + colour[i] * lighting->ambientLightIntensity[i];
+    }
+    if (lighting->specularColour[0] == 0.0f && lighting->specularColour[1] == 0.0f && lighting->specularColour[2] == 0.0f)
+    {
+        return; // materialShaderFeatures会选没有镜面反射的变体
+    }
+    // reflect(-L, N) = -L + 2 * dot(N, L) * N，这里的点积没有截断到0
+    float reflection[3];
+    float dotNL = normal[0] * lighting->inverseLightDirection[0] + normal[1] * lighting->inverseLightDirection[1]
+                  + normal[2] * lighting->inverseLightDirection[2];
+    for (int i = 0; i < 3; i++)
+    {
+        reflection[i] = 2.0f * dotNL * normal[i] - lighting->inverseLightDirection[i];
+    }
+    float normalDotReflection = std::max(0.0f, lighting->inverseEyeDirection[0] * reflection[0]
+                                               + lighting->inverseEyeDirection[1] * reflection[1]
+                                               + lighting->inverseEyeDirection[2] * reflection[2]);
+    float specular = powf(normalDotReflection, lighting->shininess);
+    for (int i = 0; i < 3; i++)
+    {
+        result[i] += specular * lighting->specularColour[i];
+    }
+}
+
+static void transformVertices(int chunk, void* context)
+{
+    const VertexJob* job = (const VertexJob*) context;
+    const SoftDraw* draw = job->draw;
+    static const float white[3] = {1.0f, 1.0f, 1.0f};
+    const float* constantColour = draw->constantColour != NULL ? draw->constantColour : white;
+    int first = chunk * vertexChunk;
+    int count = std::min(vertexChunk, draw->vertexCount - first);
+    // 每个线程一份，第一次用时分配
+    static thread_local std::vector<float> positions(vertexChunk * 4);
+    static thread_local std::vector<float> transformed(vertexChunk * 4);
+    for (int i = 0; i < count; i++)
+    {
+        const float* position = draw->positions + (size_t) (first + i) * draw->positionSize;
+        positions[i * 4] = position[0];
+        positions[i * 4 + 1] = position[1];
+        positions[i * 4 + 2] = draw->positionSize > 2 ? position[2] : 0.0f;
+        positions[i * 4 + 3] = 1.0f;
+    }
+    matrixTransformVec4Array(&transformed[0], job->modelViewProjection, &positions[0], count);
+    const float* modelView = job->modelView;
+    for (int i = 0; i < count; i++)
+    {
+        int vertex = first + i;
+        ClipVertex* output = &clipVertices[vertex];
+        memcpy(output->position, &transformed[i * 4], sizeof(float) * 4);
+        const float* colour = draw->colours != NULL ? draw->colours + (size_t) vertex * 3 : constantColour;
+        if (draw->lighting != NULL)
+        {
+            // normalize((modelView * vec4(normal, 0.0)).xyz)
+            const float* normal = draw->normals + (size_t) vertex * 3;
+            float transformedNormal[3];
+            for (int j = 0; j < 3; j++)
+            {
+                transformedNormal[j] = modelView[j] * normal[0] + modelView[4 + j] * normal[1] + modelView[8 + j] * normal[2];
+            }
+            float length = sqrtf(transformedNormal[0] * transformedNormal[0] + transformedNormal[1] * transformedNormal[1]
+                                 + transformedNormal[2] * transformedNormal[2]);
+            for (int j = 0; j < 3; j++)
+            {
+                transformedNormal[j] /= length;
+            }
+            phong(draw->lighting, transformedNormal, colour, output->varyings);
+        }
+        else
+        {
+            memcpy(output->varyings, colour, sizeof(float) * 3);
+        }
+        if (draw->texture != NULL)
+        {
+            output->varyings[3] = draw->textureCoordinates[(size_t) vertex * 2];
+            output->varyings[4] = draw->textureCoordinates[(size_t) vertex * 2 + 1];
+        }
+        else
+        {
+            output->varyings[3] = 0.0f;
+            output->varyings[4] = 0.0f;
+        }
+    }
+}
+
+// ---- 图元装配和分块 ----
+
+// 屏幕上的三角形，所有平面方程都是 value = a * x + b * y + c，x、y是像素中心的坐标
+struct SoftTriangle
+{
+    float edgeA[3]; // 第i条边是第i个顶点对面的边，三角形内部为正
+    float edgeB[3];
+    float edgeC[3];
+    int inclusive; // 第i位为1时刚好在第i条边上的像素也算在内（左上规则）
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+    float depth[3];
+    float inverseW[3];
+    float varyings[varyingCount][3]; // 属性除以w
+};
+
+static std::vector<SoftTriangle> triangles;
+static std::vector<std::vector<int> > tileBins;
+static std::vector<int> activeTiles;
+static std::vector<long long> tilePixels;
+static SoftRasterStats rasterStats;
+
+enum ClipPlane
+{
+    CLIP_NEAR,
+    CLIP_FAR
+};
+
+static float planeDistance(const ClipVertex* vertex, ClipPlane plane)
+{
+    return plane == CLIP_NEAR ? vertex->position[3] + vertex->position[2] : vertex->position[3] - vertex->position[2];
+}
+
+// Sutherland-Hodgman，保留距离非负的部分，返回输出的顶点数
+static int clipPolygon(const ClipVertex* input, int count, ClipVertex* output, ClipPlane plane)
+{
+    int outputCount = 0;
+    for (int i = 0; i < count; i++)
+    {
+        const ClipVertex* current = &input[i];
+        const ClipVertex* next = &input[(i + 1) % count];
+        float currentDistance = planeDistance(current, plane);
+        float nextDistance = planeDistance(next, plane);
+        if (currentDistance >= 0.0f)
+        {
+            output[outputCount++] = *current;
+        }
+        if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+        {
+            float t = currentDistance / (currentDistance - nextDistance);
+            ClipVertex* vertex = &output[outputCount++];
+            for (int j = 0; j < 4; j++)
+            {
+                vertex->position[j] = current->position[j] + (next->position[j] - current->position[j]) * t;
+            }
+            for (int j = 0; j < varyingCount; j++)
+            {
+                vertex->varyings[j] = current->varyings[j] + (next->varyings[j] - current->varyings[j]) * t;
+            }
+        }
+    }
+    return outputCount;
+}
+
+static void planeEquation(const float* values, const SoftTriangle* triangle, float inverseArea, float* plane)
+{
+    plane[0] = (values[0] * triangle->edgeA[0] + values[1] * triangle->edgeA[1] + values[2] * triangle->edgeA[2]) * inverseArea;
+    plane[1] = (values[0] * triangle->edgeB[0] + values[1] * triangle->edgeB[1] + values[2] * triangle->edgeB[2]) * inverseArea;
+    plane[2] = (values[0] * triangle->edgeC[0] + values[1] * triangle->edgeC[1] + values[2] * triangle->edgeC[2]) * inverseArea;
+}
+
+// 视口变换并建立三角形，被剔除时返回false
+static bool setupTriangle(const ClipVertex* vertices[3], int width, int height, bool cullBackFaces, SoftTriangle* triangle)
+{
+    float x[3], y[3], z[3], inverseW[3];
+    for (int i = 0; i < 3; i++)
+    {
+        const float* position = vertices[i]->position;
+        if (position[3] <= 0.0f)
+        {
+            return false;
+        }
+        inverseW[i] = 1.0f / position[3];
+        x[i] = (position[0] * inverseW[i] * 0.5f + 0.5f) * width;
+        y[i] = (0.5f - position[1] * inverseW[i] * 0.5f) * height; // 第一行在最上面
+        z[i] = position[2] * inverseW[i] * 0.5f + 0.5f;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        int a = (i + 1) % 3;
+        int b = (i + 2) % 3;
+        triangle->edgeA[i] = y[a] - y[b];
+        triangle->edgeB[i] = x[b] - x[a];
+        triangle->edgeC[i] = x[a] * y[b] - x[b] * y[a];
+    }
+    float area = triangle->edgeA[0] * x[0] + triangle->edgeB[0] * y[0] + triangle->edgeC[0];
+    // y轴朝下，GL里逆时针的正面在这里面积为负
+    if (area == 0.0f || (cullBackFaces && area > 0.0f))
+    {
+        return false;
+    }
+    // 三角形内部和对面的顶点在边的同一侧，边函数的符号和面积相同，面积为负时全部取反
+    if (area < 0.0f)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            triangle->edgeA[i] = -triangle->edgeA[i];
+            triangle->edgeB[i] = -triangle->edgeB[i];
+            triangle->edgeC[i] = -triangle->edgeC[i];
+        }
+        area = -area;
+    }
+    triangle->inclusive = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        // 内部在右边的是左边的边，水平且内部在下面的是上边的边
+        if (triangle->edgeA[i] > 0.0f || (triangle->edgeA[i] == 0.0f && triangle->edgeB[i] > 0.0f))
+        {
+            triangle->inclusive |= 1 << i;
+        }
+    }
+    triangle->minX = std::max(0, (int) floorf(std::min(x[0], std::min(x[1], x[2]))));
+    triangle->minY = std::max(0, (int) floorf(std::min(y[0], std::min(y[1], y[2]))));
+    triangle->maxX = std::min(width - 1, (int) ceilf(std::max(x[0], std::max(x[1], x[2]))));
+    triangle->maxY = std::min(height - 1, (int) ceilf(std::max(y[0], std::max(y[1], y[2]))));
+    if (triangle->minX > triangle->maxX || triangle->minY > triangle->maxY)
+    {
+        return false;
+    }
+    float inverseArea = 1.0f / area;
+    planeEquation(z, triangle, inverseArea, triangle->depth);
+    planeEquation(inverseW, triangle, inverseArea, triangle->inverseW);
+    for (int v = 0; v < varyingCount; v++)
+    {
+        float values[3];
+        for (int i = 0; i < 3; i++)
+        {
+            values[i] = vertices[i]->varyings[v] * inverseW[i];
+        }
+        planeEquation(values, triangle, inverseArea, triangle->varyings[v]);
+    }
+    return true;
+}
+
+static void binTriangle(const ClipVertex* vertices[3], int width, int height, bool cullBackFaces, int tilesX)
+{
+    SoftTriangle triangle;
+    if (!setupTriangle(vertices, width, height, cullBackFaces, &triangle))
+    {
+        rasterStats.culled++;
+        return;
+    }
+    int index = (int) triangles.size();
+    triangles.push_back(triangle);
+    for (int tileY = triangle.minY / softTileSize; tileY <= triangle.maxY / softTileSize; tileY++)
+    {
+        for (int tileX = triangle.minX / softTileSize; tileX <= triangle.maxX / softTileSize; tileX++)
+        {
+            tileBins[tileY * tilesX + tileX].push_back(index);
+            rasterStats.binned++;
+        }
+    }
+}
+
+// 裁剪掉近、远平面以外的部分（x、y方向超出视口的部分由包围盒截掉），结果按扇形拆成三角形
+static void assembleTriangle(const ClipVertex* vertices[3], int width, int height, bool cullBackFaces, int tilesX)
+{
+    int outside = 0;
+    int anyOutside = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        const float* p = vertices[i]->position;
+        int code = (p[0] < -p[3] ? 1 : 0) | (p[0] > p[3] ? 2 : 0) | (p[1] < -p[3] ? 4 : 0) | (p[1] > p[3] ? 8 : 0)
+                   | (p[2] < -p[3] ? 16 : 0) | (p[2] > p[3] ? 32 : 0);
+        outside = i == 0 ? code : outside & code;
+        anyOutside |= code;
+    }
+    if (outside != 0) // 三个顶点都在同一个平面外
+    {
+        rasterStats.culled++;
+        return;
+    }
+    if ((anyOutside & (16 | 32)) == 0)
+    {
+        binTriangle(vertices, width, height, cullBackFaces, tilesX);
+        return;
+    }
+    ClipVertex polygon[8];
+    ClipVertex clipped[8];
+    for (int i = 0; i < 3; i++)
+    {
+        polygon[i] = *vertices[i];
+    }
+    int count = clipPolygon(polygon, 3, clipped, CLIP_NEAR);
+    count = clipPolygon(clipped, count, polygon, CLIP_FAR);
+    if (count < 3)
+    {
+        rasterStats.culled++;
+        return;
+    }
+    for (int i = 1; i + 1 < count; i++)
+    {
+        const ClipVertex* fan[3] = {&polygon[0], &polygon[i], &polygon[i + 1]};
+        binTriangle(fan, width, height, cullBackFaces, tilesX);
+    }
+}
+
+// ---- 光栅化 ----
+
+struct RasterJob
+{
+    SoftFramebuffer* framebuffer;
+    const SoftDraw* draw;
+    int tilesX;
+};
+
+static void sampleTexture(const SoftTexture* texture, float s, float t, float* rgb)
+{
+    int x = (int) floorf(s * texture->width) % texture->width;
+    int y = (int) floorf(t * texture->height) % texture->height;
+    x += x < 0 ? texture->width : 0;
+    y += y < 0 ? texture->height : 0;
+    const unsigned char* texel = texture->rgba + ((size_t) y * texture->width + x) * 4;
+    for (int i = 0; i < 3; i++)
+    {
+        rgb[i] = texel[i] / 255.0f;
+    }
+}
+
+static void shadePixel(const SoftTriangle* triangle, const SoftDraw* draw, float x, float y, unsigned char* colour)
+{
+    float w = 1.0f / (triangle->inverseW[0] * x + triangle->inverseW[1] * y + triangle->inverseW[2]);
+    float varyings[varyingCount];
+    for (int v = 0; v < varyingCount; v++)
+    {
+        varyings[v] = (triangle->varyings[v][0] * x + triangle->varyings[v][1] * y + triangle->varyings[v][2]) * w;
+    }
+    if (draw->texture != NULL)
+    {
+        float texel[3];
+        sampleTexture(draw->texture, varyings[3], varyings[4], texel);
+        for (int i = 0; i < 3; i++)
+        {
+            varyings[i] *= texel[i];
+        }
+    }
+    colour[0] = toUnorm8(varyings[0]);
+    colour[1] = toUnorm8(varyings[1]);
+    colour[2] = toUnorm8(varyings[2]);
+    colour[3] = 255;
+}
+
+// 从x开始的4个像素（中心在x+0.5...x+3.5，y）被三角形覆盖的位掩码
+#if defined(SIMD_SCALAR)
+static int coverageMask(const SoftTriangle* triangle, const float* rowEdges, int x)
+{
+    int mask = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        float px = x + i + 0.5f;
+        bool inside = true;
+        for (int e = 0; e < 3; e++)
+        {
+            float value = triangle->edgeA[e] * px + rowEdges[e];
+            inside = inside && (value > 0.0f || (value == 0.0f && (triangle->inclusive & (1 << e))));
+        }
+        mask |= inside ? 1 << i : 0;
+    }
+    return mask;
+}
+
+static int depthMask(const float* depthPlane, float rowDepth, int x, const float* depth, float* values)
+{
+    int mask = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        values[i] = depthPlane[0] * (x + i + 0.5f) + rowDepth;
+        mask |= values[i] < depth[i] ? 1 << i : 0;
+    }
+    return mask;
+}
+#else
+static int coverageMask(const SoftTriangle* triangle, const float* rowEdges, int x)
+{
+    SimdFloat4 zero = simdSplat(0.0f);
+    SimdFloat4 px = simdAdd(simdSplat((float) x), simdSet(0.5f, 1.5f, 2.5f, 3.5f));
+    int mask = 15;
+    for (int e = 0; e < 3; e++)
+    {
+        SimdFloat4 value = simdMulAdd(simdSplat(rowEdges[e]), simdSplat(triangle->edgeA[e]), px);
+        // 在左上的边上（值为0）也算覆盖时取value >= 0，否则取value > 0，即0 - value < 0
+        mask &= (triangle->inclusive & (1 << e)) ? ~simdNegativeMask(value) & 15 : simdNegativeMask(simdSub(zero, value));
+    }
+    return mask;
+}
+
+static int depthMask(const float* depthPlane, float rowDepth, int x, const float* depth, float* values)
+{
+    SimdFloat4 px = simdAdd(simdSplat((float) x), simdSet(0.5f, 1.5f, 2.5f, 3.5f));
+    SimdFloat4 z = simdMulAdd(simdSplat(rowDepth), simdSplat(depthPlane[0]), px);
+    simdStore(values, z);
+    return simdNegativeMask(simdSub(z, simdLoad(depth)));
+}
+#endif
+
+static void rasterTile(int task, void* context)
+{
+    const RasterJob* job = (const RasterJob*) context;
+    SoftFramebuffer* framebuffer = job->framebuffer;
+    const SoftDraw* draw = job->draw;
+    int tile = activeTiles[task];
+    int tileMinX = tile % job->tilesX * softTileSize;
+    int tileMinY = tile / job->tilesX * softTileSize;
+    int tileMaxX = std::min(framebuffer->width, tileMinX + softTileSize) - 1;
+    int tileMaxY = std::min(framebuffer->height, tileMinY + softTileSize) - 1;
+    const std::vector<int>& bin = tileBins[tile];
+    long long pixels = 0;
+    for (size_t t = 0; t < bin.size(); t++)
+    {
+        const SoftTriangle* triangle = &triangles[bin[t]];
+        int minX = std::max(triangle->minX, tileMinX);
+        int maxX = std::min(triangle->maxX, tileMaxX);
+        int minY = std::max(triangle->minY, tileMinY);
+        int maxY = std::min(triangle->maxY, tileMaxY);
+        for (int y = minY; y <= maxY; y++)
+        {
+            float py = y + 0.5f;
+            float rowEdges[3];
+            for (int e = 0; e < 3; e++)
+            {
+                rowEdges[e] = triangle->edgeB[e] * py + triangle->edgeC[e];
+            }
+            float rowDepth = triangle->depth[1] * py + triangle->depth[2];
+            size_t row = (size_t) y * framebuffer->width;
+            for (int x = minX; x <= maxX; x += 4)
+            {
+                int mask = coverageMask(triangle, rowEdges, x);
+                if (maxX - x < 3)
+                {
+                    mask &= (1 << (maxX - x + 1)) - 1;
+                }
+                if (mask == 0)
+                {
+                    continue;
+                }
+                float* depth = &framebuffer->depth[row + x];
+                float depthValues[4];
+                int passed = depthMask(triangle->depth, rowDepth, x, depth, depthValues);
+                if (draw->depthTest)
+                {
+                    mask &= passed;
+                }
+                for (int i = 0; i < 4; i++)
+                {
+                    if ((mask & (1 << i)) == 0)
+                    {
+                        continue;
+                    }
+                    if (draw->depthTest)
+                    {
+                        depth[i] = depthValues[i];
+                    }
+                    shadePixel(triangle, draw, x + i + 0.5f, py, &framebuffer->colour[(row + x + i) * 4]);
+                    pixels++;
+                }
+            }
+        }
+    }
+    tilePixels[task] = pixels;
+}
+
+template<typename Index>
+static void assembleIndexed(const Index* indices, const SoftDraw* draw, int width, int height, int tilesX)
+{
+    for (int i = 0; i + 2 < draw->count; i += 3)
+    {
+        // 按无符号比较，2^31以上的GL_UNSIGNED_INT索引转成int会变成负数而通过检查
+        unsigned int vertexCount = (unsigned int) draw->vertexCount;
+        if ((unsigned int) indices[i] >= vertexCount || (unsigned int) indices[i + 1] >= vertexCount
+            || (unsigned int) indices[i + 2] >= vertexCount)
+        {
+            rasterStats.culled++; // 和GL一样，越界的索引不画
+            continue;
+        }
+        const ClipVertex* vertices[3] = {&clipVertices[indices[i]], &clipVertices[indices[i + 1]], &clipVertices[indices[i + 2]]};
+        assembleTriangle(vertices, width, height, draw->cullBackFaces, tilesX);
+    }
+}
+
+void softDraw(SoftFramebuffer* framebuffer, const SoftDraw* draw)
+{
+    if (draw->count < 3 || draw->vertexCount <= 0)
+    {
+        return;
+    }
+    if ((draw->lighting != NULL && draw->normals == NULL) || (draw->texture != NULL && draw->textureCoordinates == NULL))
+    {
+        LOGE("Software draw is missing normals or texture coordinates");
+        return;
+    }
+    VertexJob vertexJob;
+    vertexJob.draw = draw;
+    float projection[16];
+    copyMatrix(projection, draw->projection);
+    copyMatrix(vertexJob.modelView, draw->modelView);
+    matrixMultiply(vertexJob.modelViewProjection, projection, vertexJob.modelView);
+    clipVertices.resize(draw->vertexCount);
+    runParallel((draw->vertexCount + vertexChunk - 1) / vertexChunk, transformVertices, &vertexJob);
+
+    int width = framebuffer->width;
+    int height = framebuffer->height;
+    int tilesX = (width + softTileSize - 1) / softTileSize;
+    int tileCount = tilesX * ((height + softTileSize - 1) / softTileSize);
+    tileBins.resize(tileCount);
+    for (int i = 0; i < tileCount; i++)
+    {
+        tileBins[i].clear();
+    }
+    triangles.clear();
+    rasterStats.triangles += draw->count / 3;
+    if (draw->indices == NULL)
+    {
+        for (int i = 0; i + 2 < draw->count && i + 2 < draw->vertexCount; i += 3)
+        {
+            const ClipVertex* vertices[3] = {&clipVertices[i], &clipVertices[i + 1], &clipVertices[i + 2]};
+            assembleTriangle(vertices, width, height, draw->cullBackFaces, tilesX);
+        }
+    }
+    else if (draw->indexType == GL_UNSIGNED_INT)
+    {
+        assembleIndexed((const GLuint*) draw->indices, draw, width, height, tilesX);
+    }
+    else
+    {
+        assembleIndexed((const GLushort*) draw->indices, draw, width, height, tilesX);
+    }
+
+    activeTiles.clear();
+    for (int i = 0; i < tileCount; i++)
+    {
+        if (!tileBins[i].empty())
+        {
+            activeTiles.push_back(i);
+        }
+    }
+    tilePixels.assign(activeTiles.size(), 0);
+    RasterJob rasterJob = {framebuffer, draw, tilesX};
+    int steals = stealCount.load();
+    runParallel((int) activeTiles.size(), rasterTile, &rasterJob);
+    rasterStats.steals += stealCount.load() - steals;
+    for (size_t i = 0; i < tilePixels.size(); i++)
+    {
+        rasterStats.pixels += tilePixels[i];
+    }
+}
+
+void getSoftRasterStats(SoftRasterStats* stats)
+{
+    *stats = rasterStats;
+}
+
+void resetSoftRasterStats()
+{
+    memset(&rasterStats, 0, sizeof(rasterStats));
+}
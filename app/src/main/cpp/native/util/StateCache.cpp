@@ -0,0 +1,556 @@
+/**
+ * --- GL状态缓存 ---
+ *
+ * 每次GL调用，驱动都要做参数检查、标记脏状态，有的驱动在绘制前还要根据变化的状态重新校验甚至重新生成着色器，
+ * 所以即使设置的值和原来一样，调用也不是免费的。课程代码为了清楚，每帧都会重新设置一遍清屏颜色、程序、投影矩阵等，
+ * 这些值大多数帧都没有变化。
+ *
+ * 这里在CPU上保存一份"影子状态"：当前程序、每个纹理单元绑定的纹理、缓冲区绑定、VAO、顶点属性设置、
+ * 每个程序每个uniform最后一次设置的值，以及清屏颜色、开关和视口。设置的值和影子状态相同（uniform按字节比较）时直接返回，
+ * 不同时才调用驱动并更新影子状态。每类调用分别统计真正发出和被省略的次数，可以用来衡量冗余状态设置有多少。
+ *
+ * 注意：
+ *    - 影子状态只在GL线程上使用，不加锁
+ *    - 初始状态是"未知"，第一次设置一定会调用驱动，所以上下文重建后调用resetStateCache即可
+ *    - 顶点属性和GL_ELEMENT_ARRAY_BUFFER属于VAO的状态，切换VAO后它们变成未知
+ *    - 只缓存常用的目标和开关，其它参数直接调用驱动（计为发出）
+ */
+#include <cstring>
+#include <vector>
+
+#include "../include/StateCache.h"
+
+static const GLuint unknownObject = 0xFFFFFFFFu;
+static const int maxCachedTextureUnits = 16;
+static const int maxCachedTextureTargets = 4;
+static const int maxCachedAttributes = 16;
+static const int maxCachedUniformLocation = 1024;
+static const int maxCachedUniformBytes = 64; // 一个mat4，更大的数组不缓存
+
+struct CachedAttribute
+{
+    signed char enabled; // -1表示未知
+    bool pointerKnown;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    GLsizei stride;
+    const void* pointer;
+    GLuint buffer; // 设置指针时绑定的GL_ARRAY_BUFFER，它也是属性状态的一部分
+};
+
+struct CachedUniform
+{
+    unsigned char kind; // 0表示未知，其它值区分glUniform的类型
+    unsigned char bytes;
+    unsigned char value[maxCachedUniformBytes];
+};
+
+struct CachedProgram
+{
+    GLuint program;
+    std::vector<CachedUniform> uniforms; // 按location索引
+};
+
+enum UniformKind
+{
+    UNIFORM_UNKNOWN = 0,
+    UNIFORM_1I,
+    UNIFORM_1F,
+    UNIFORM_3F,
+    UNIFORM_4F,
+    UNIFORM_MATRIX3,
+    UNIFORM_MATRIX4,
+};
+
+static const GLenum cachedTextureTargets[maxCachedTextureTargets] = {
+        GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_3D, GL_TEXTURE_2D_ARRAY
+};
+static const GLenum cachedCapabilities[] = {
+        GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_SCISSOR_TEST, GL_STENCIL_TEST, GL_POLYGON_OFFSET_FILL, GL_DITHER
+};
+static const int cachedCapabilityCount = sizeof(cachedCapabilities) / sizeof(cachedCapabilities[0]);
+
+static StateCacheStats stats;
+static GLuint currentProgram;
+static CachedProgram* currentProgramState; // currentProgram的uniform影子，程序未知时为NULL
+static std::vector<CachedProgram> programs;
+static GLenum activeTexture;
+static GLuint textures[maxCachedTextureUnits][maxCachedTextureTargets];
+static GLuint arrayBuffer;
+static GLuint elementArrayBuffer;
+static GLuint uniformBuffer;
+static GLuint vertexArray;
+static CachedAttribute attributes[maxCachedAttributes];
+static bool clearColorKnown;
+static GLfloat clearColor[4];
+static signed char capabilities[cachedCapabilityCount];
+static bool viewportKnown;
+static GLint viewport[4];
+
+// 统计一次调用，返回true表示可以省略
+static inline bool elide(StateCategory category, bool unchanged)
+{
+    if (unchanged)
+    {
+        stats.elided[category]++;
+    }
+    else
+    {
+        stats.issued[category]++;
+    }
+    return unchanged;
+}
+
+static void forgetVertexArrayState()
+{
+    elementArrayBuffer = unknownObject;
+    for (int i = 0; i < maxCachedAttributes; i++)
+    {
+        attributes[i].enabled = -1;
+        attributes[i].pointerKnown = false;
+    }
+}
+
+void resetStateCache()
+{
+    currentProgram = unknownObject;
+    currentProgramState = NULL;
+    programs.clear();
+    activeTexture = 0;
+    for (int unit = 0; unit < maxCachedTextureUnits; unit++)
+    {
+        for (int target = 0; target < maxCachedTextureTargets; target++)
+        {
+            textures[unit][target] = unknownObject;
+        }
+    }
+    arrayBuffer = unknownObject;
+    uniformBuffer = unknownObject;
+    vertexArray = unknownObject;
+    forgetVertexArrayState();
+    clearColorKnown = false;
+    memset(capabilities, -1, sizeof(capabilities));
+    viewportKnown = false;
+}
+
+// 静态初始化时状态全部未知
+static struct StateCacheInitializer
+{
+    StateCacheInitializer() { resetStateCache(); }
+} stateCacheInitializer;
+
+void getStateCacheStats(StateCacheStats* result)
+{
+    *result = stats;
+}
+
+void resetStateCacheStats()
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+void cachedUseProgram(GLuint program)
+{
+    if (elide(STATE_PROGRAM, program == currentProgram))
+    {
+        return;
+    }
+    glUseProgram(program);
+    currentProgram = program;
+    currentProgramState = NULL;
+    for (size_t i = 0; i < programs.size(); i++)
+    {
+        if (programs[i].program == program)
+        {
+            currentProgramState = &programs[i];
+            return;
+        }
+    }
+    if (program != 0)
+    {
+        CachedProgram state;
+        state.program = program;
+        programs.push_back(state);
+        currentProgramState = &programs.back();
+    }
+}
+
+void cachedActiveTexture(GLenum unit)
+{
+    if (elide(STATE_TEXTURE, unit == activeTexture))
+    {
+        return;
+    }
+    glActiveTexture(unit);
+    activeTexture = unit;
+}
+
+static GLuint* textureBinding(GLenum target)
+{
+    int unit = (int) activeTexture - GL_TEXTURE0;
+    if (activeTexture == 0 || unit < 0 || unit >= maxCachedTextureUnits)
+    {
+        return NULL;
+    }
+    for (int i = 0; i < maxCachedTextureTargets; i++)
+    {
+        if (cachedTextureTargets[i] == target)
+        {
+            return &textures[unit][i];
+        }
+    }
+    return NULL;
+}
+
+void cachedBindTexture(GLenum target, GLuint texture)
+{
+    GLuint* binding = textureBinding(target);
+    if (elide(STATE_TEXTURE, binding != NULL && *binding == texture))
+    {
+        return;
+    }
+    glBindTexture(target, texture);
+    if (binding != NULL)
+    {
+        *binding = texture;
+    }
+}
+
+static GLuint* bufferBinding(GLenum target)
+{
+    switch (target)
+    {
+        case GL_ARRAY_BUFFER:
+            return &arrayBuffer;
+        case GL_ELEMENT_ARRAY_BUFFER:
+            return &elementArrayBuffer;
+        case GL_UNIFORM_BUFFER:
+            return &uniformBuffer;
+        default:
+            return NULL;
+    }
+}
+
+void cachedBindBuffer(GLenum target, GLuint buffer)
+{
+    GLuint* binding = bufferBinding(target);
+    if (elide(STATE_BUFFER, binding != NULL && *binding == buffer))
+    {
+        return;
+    }
+    glBindBuffer(target, buffer);
+    if (binding != NULL)
+    {
+        *binding = buffer;
+    }
+}
+
+void cachedBindVertexArray(GLuint array)
+{
+    if (elide(STATE_VERTEX_ARRAY, array == vertexArray))
+    {
+        return;
+    }
+    glBindVertexArray(array);
+    vertexArray = array;
+    forgetVertexArrayState();
+}
+
+void cachedEnableVertexAttribArray(GLuint index)
+{
+    bool cached = index < (GLuint) maxCachedAttributes;
+    if (elide(STATE_ATTRIBUTE, cached && attributes[index].enabled == 1))
+    {
+        return;
+    }
+    glEnableVertexAttribArray(index);
+    if (cached)
+    {
+        attributes[index].enabled = 1;
+    }
+}
+
+void cachedDisableVertexAttribArray(GLuint index)
+{
+    bool cached = index < (GLuint) maxCachedAttributes;
+    if (elide(STATE_ATTRIBUTE, cached && attributes[index].enabled == 0))
+    {
+        return;
+    }
+    glDisableVertexAttribArray(index);
+    if (cached)
+    {
+        attributes[index].enabled = 0;
+    }
+}
+
+void cachedVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+    bool cached = index < (GLuint) maxCachedAttributes && arrayBuffer != unknownObject;
+    if (cached)
+    {
+        const CachedAttribute& attribute = attributes[index];
+        bool unchanged = attribute.pointerKnown && attribute.size == size && attribute.type == type
+                         && attribute.normalized == normalized && attribute.stride == stride
+                         && attribute.pointer == pointer && attribute.buffer == arrayBuffer;
+        // 客户端数组（没有绑定缓冲区）的内容可能变了，驱动每次绘制都会重新读取，所以只有缓冲区里的属性才能省略
+        if (elide(STATE_ATTRIBUTE, unchanged && arrayBuffer != 0))
+        {
+            return;
+        }
+    }
+    else
+    {
+        elide(STATE_ATTRIBUTE, false);
+    }
+    glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+    if (cached)
+    {
+        CachedAttribute& attribute = attributes[index];
+        attribute.pointerKnown = true;
+        attribute.size = size;
+        attribute.type = type;
+        attribute.normalized = normalized;
+        attribute.stride = stride;
+        attribute.pointer = pointer;
+        attribute.buffer = arrayBuffer;
+    }
+}
+
+// 比较并记录当前程序中location的值，返回true表示与上次相同
+static bool uniformUnchanged(GLint location, UniformKind kind, const void* value, size_t bytes)
+{
+    if (currentProgramState == NULL || location < 0 || location >= maxCachedUniformLocation
+        || bytes > (size_t) maxCachedUniformBytes)
+    {
+        return elide(STATE_UNIFORM, false);
+    }
+    std::vector<CachedUniform>& uniforms = currentProgramState->uniforms;
+    if ((size_t) location >= uniforms.size())
+    {
+        CachedUniform unknown;
+        unknown.kind = UNIFORM_UNKNOWN;
+        uniforms.resize(location + 1, unknown);
+    }
+    CachedUniform& uniform = uniforms[location];
+    if (elide(STATE_UNIFORM, uniform.kind == kind && uniform.bytes == bytes && memcmp(uniform.value, value, bytes) == 0))
+    {
+        return true;
+    }
+    uniform.kind = (unsigned char) kind;
+    uniform.bytes = (unsigned char) bytes;
+    memcpy(uniform.value, value, bytes);
+    return false;
+}
+
+void cachedUniform1i(GLint location, GLint value)
+{
+    if (!uniformUnchanged(location, UNIFORM_1I, &value, sizeof(value)))
+    {
+        glUniform1i(location, value);
+    }
+}
+
+void cachedUniform1f(GLint location, GLfloat value)
+{
+    if (!uniformUnchanged(location, UNIFORM_1F, &value, sizeof(value)))
+    {
+        glUniform1f(location, value);
+    }
+}
+
+void cachedUniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z)
+{
+    GLfloat value[3] = {x, y, z};
+    if (!uniformUnchanged(location, UNIFORM_3F, value, sizeof(value)))
+    {
+        glUniform3f(location, x, y, z);
+    }
+}
+
+void cachedUniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+{
+    GLfloat value[4] = {x, y, z, w};
+    if (!uniformUnchanged(location, UNIFORM_4F, value, sizeof(value)))
+    {
+        glUniform4f(location, x, y, z, w);
+    }
+}
+
+void cachedUniform3fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    if (!uniformUnchanged(location, UNIFORM_3F, value, sizeof(GLfloat) * 3 * count))
+    {
+        glUniform3fv(location, count, value);
+    }
+}
+
+void cachedUniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    if (!uniformUnchanged(location, UNIFORM_4F, value, sizeof(GLfloat) * 4 * count))
+    {
+        glUniform4fv(location, count, value);
+    }
+}
+
+void cachedUniformMatrix3fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    if (!uniformUnchanged(location, UNIFORM_MATRIX3, value, sizeof(GLfloat) * 9 * count))
+    {
+        glUniformMatrix3fv(location, count, GL_FALSE, value);
+    }
+}
+
+void cachedUniformMatrix4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    if (!uniformUnchanged(location, UNIFORM_MATRIX4, value, sizeof(GLfloat) * 16 * count))
+    {
+        glUniformMatrix4fv(location, count, GL_FALSE, value);
+    }
+}
+
+void cachedClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+    GLfloat colour[4] = {red, green, blue, alpha};
+    if (elide(STATE_FIXED_FUNCTION, clearColorKnown && memcmp(clearColor, colour, sizeof(colour)) == 0))
+    {
+        return;
+    }
+    glClearColor(red, green, blue, alpha);
+    clearColorKnown = true;
+    memcpy(clearColor, colour, sizeof(colour));
+}
+
+static signed char* capabilityState(GLenum capability)
+{
+    for (int i = 0; i < cachedCapabilityCount; i++)
+    {
+        if (cachedCapabilities[i] == capability)
+        {
+            return &capabilities[i];
+        }
+    }
+    return NULL;
+}
+
+void cachedEnable(GLenum capability)
+{
+    signed char* state = capabilityState(capability);
+    if (elide(STATE_FIXED_FUNCTION, state != NULL && *state == 1))
+    {
+        return;
+    }
+    glEnable(capability);
+    if (state != NULL)
+    {
+        *state = 1;
+    }
+}
+
+void cachedDisable(GLenum capability)
+{
+    signed char* state = capabilityState(capability);
+    if (elide(STATE_FIXED_FUNCTION, state != NULL && *state == 0))
+    {
+        return;
+    }
+    glDisable(capability);
+    if (state != NULL)
+    {
+        *state = 0;
+    }
+}
+
+void cachedViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GLint value[4] = {x, y, width, height};
+    if (elide(STATE_FIXED_FUNCTION, viewportKnown && memcmp(viewport, value, sizeof(value)) == 0))
+    {
+        return;
+    }
+    glViewport(x, y, width, height);
+    viewportKnown = true;
+    memcpy(viewport, value, sizeof(value));
+}
+
+void cachedDeleteProgram(GLuint program)
+{
+    glDeleteProgram(program);
+    for (size_t i = 0; i < programs.size(); i++)
+    {
+        if (programs[i].program == program)
+        {
+            programs.erase(programs.begin() + i);
+            break;
+        }
+    }
+    // erase会移动后面的元素，重新查找当前程序的影子；正在使用的程序被删除后仍然是当前程序，但不再缓存它的uniform
+    currentProgramState = NULL;
+    for (size_t i = 0; i < programs.size(); i++)
+    {
+        if (programs[i].program == currentProgram)
+        {
+            currentProgramState = &programs[i];
+        }
+    }
+}
+
+void cachedDeleteTextures(GLsizei count, const GLuint* ids)
+{
+    glDeleteTextures(count, ids);
+    // 被删除的纹理只从当前绑定它的绑定点上解绑（变成0）
+    for (GLsizei i = 0; i < count; i++)
+    {
+        for (int unit = 0; unit < maxCachedTextureUnits; unit++)
+        {
+            for (int target = 0; target < maxCachedTextureTargets; target++)
+            {
+                if (textures[unit][target] == ids[i])
+                {
+                    textures[unit][target] = 0;
+                }
+            }
+        }
+    }
+}
+
+void cachedDeleteBuffers(GLsizei count, const GLuint* ids)
+{
+    glDeleteBuffers(count, ids);
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (arrayBuffer == ids[i])
+        {
+            arrayBuffer = 0;
+        }
+        if (elementArrayBuffer == ids[i])
+        {
+            elementArrayBuffer = 0;
+        }
+        if (uniformBuffer == ids[i])
+        {
+            uniformBuffer = 0;
+        }
+        for (int a = 0; a < maxCachedAttributes; a++)
+        {
+            if (attributes[a].pointerKnown && attributes[a].buffer == ids[i])
+            {
+                attributes[a].pointerKnown = false;
+            }
+        }
+    }
+}
+
+void cachedDeleteVertexArrays(GLsizei count, const GLuint* ids)
+{
+    glDeleteVertexArrays(count, ids);
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (vertexArray == ids[i])
+        {
+            vertexArray = 0; // 删除当前VAO后绑定回到默认VAO，它的属性状态未知
+            forgetVertexArrayState();
+        }
+    }
+}
@@ -0,0 +1,218 @@
+/**
+ * --- 环形流式缓冲区 ---
+ *
+ * 每帧变化的数据如果用glBufferData(NULL)丢弃旧存储再glBufferSubData（orphan），CPU先把数据写到自己的数组里，
+ * 驱动再复制一遍，每帧还可能分配新的存储。这里换成一个固定的缓冲区对象，分成frameCount段轮流使用：
+ *
+ *    段0 | 段1 | 段2      第n帧写段n % frameCount
+ *
+ * 写入方通过streamAllocate在当前这一段里按对齐要求分配，拿到的指针直接指向glMapBufferRange映射出来的内存。
+ * 映射用GL_MAP_UNSYNCHRONIZED_BIT，驱动不会等GPU，也不做隐式同步；同步由我们自己负责：
+ * 每一段用完（endStreamFrame）时插入一个glFenceSync，下一次轮到这一段时（beginStreamFrame）先glClientWaitSync等它触发，
+ * 保证GPU已经读完上一轮的数据。段数足够（通常3段，CPU最多领先GPU两帧）时栅栏早就触发了，等待时间是0。
+ *
+ * 桌面GL和GLES3.2的扩展有持久映射（GL_MAP_PERSISTENT_BIT），缓冲区可以一直映射着；GLES3.0没有，
+ * 缓冲区映射期间不能用来绘制，所以每帧写完数据后要unmapStreamBuffer，下次分配时再映射段里剩下的部分。
+ * 映射时加上GL_MAP_INVALIDATE_RANGE_BIT（不需要旧内容）和GL_MAP_FLUSH_EXPLICIT_BIT（只刷新真正写了的范围）。
+ *
+ * 映射失败时（驱动不支持或者是GLES2上下文）退回到CPU数组加glBufferSubData，接口不变。
+ */
+#include <GLES3/gl3.h>
+#include <chrono>
+#include <cstring>
+
+#include "../include/StreamBuffer.h"
+#include "../include/StateCache.h"
+#include "../include/LogUtil.h"
+
+static const GLuint64 fenceTimeoutNanoseconds = 100000000; // 每次等待最多0.1秒，超时就再等，不会丢掉栅栏
+static const double stallThresholdMilliseconds = 0.1;
+
+bool createStreamBuffer(StreamBuffer* stream, GLenum target, GLsizeiptr bytesPerFrame, int frameCount)
+{
+    memset(stream->fences, 0, sizeof(stream->fences));
+    memset(&stream->stats, 0, sizeof(stream->stats));
+    stream->staging.clear();
+    stream->target = target;
+    stream->frameCount = frameCount < 2 ? 2 : frameCount > maxStreamFrames ? maxStreamFrames : frameCount;
+    stream->frameBytes = (bytesPerFrame + streamRegionAlignment - 1) / streamRegionAlignment * streamRegionAlignment;
+    stream->frame = 0;
+    stream->used = 0;
+    stream->mappedStart = 0;
+    stream->mapped = NULL;
+    stream->mapping = true;
+    while (glGetError() != GL_NO_ERROR) {}
+    glGenBuffers(1, &stream->buffer);
+    cachedBindBuffer(target, stream->buffer);
+    glBufferData(target, stream->frameBytes * stream->frameCount, NULL, GL_STREAM_DRAW);
+    if (glGetError() != GL_NO_ERROR)
+    {
+        LOGE("Could not create a %ld byte stream buffer", (long) (stream->frameBytes * stream->frameCount));
+        deleteStreamBuffer(stream);
+        return false;
+    }
+    return true;
+}
+
+void beginStreamFrame(StreamBuffer* stream)
+{
+    unmapStreamBuffer(stream);
+    stream->frame = (stream->frame + 1) % stream->frameCount;
+    stream->used = 0;
+    stream->mappedStart = 0;
+    GLsync fence = stream->fences[stream->frame];
+    if (fence == 0)
+    {
+        return;
+    }
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    // 第一次等待时刷新命令队列，否则栅栏可能一直没有提交给GPU
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeoutNanoseconds);
+    while (result == GL_TIMEOUT_EXPIRED)
+    {
+        result = glClientWaitSync(fence, 0, fenceTimeoutNanoseconds);
+    }
+    if (result == GL_WAIT_FAILED)
+    {
+        glFinish(); // 不知道GPU有没有用完，只能等全部完成
+    }
+    double stall = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    glDeleteSync(fence);
+    stream->fences[stream->frame] = 0;
+    stream->stats.stallMilliseconds += stall;
+    if (stall > stallThresholdMilliseconds)
+    {
+        stream->stats.stalls++;
+    }
+    if (stall > stream->stats.maxStallMilliseconds)
+    {
+        stream->stats.maxStallMilliseconds = stall;
+    }
+}
+
+// 映射当前这一段从used到段尾的部分
+static bool mapRemainingRegion(StreamBuffer* stream)
+{
+    GLsizeiptr remaining = stream->frameBytes - stream->used;
+    GLintptr regionStart = (GLintptr) stream->frame * stream->frameBytes;
+    stream->mappedStart = stream->used;
+    if (stream->mapping)
+    {
+        cachedBindBuffer(stream->target, stream->buffer);
+        stream->mapped = (unsigned char*) glMapBufferRange(stream->target, regionStart + stream->used, remaining,
+                                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT
+                                                           | GL_MAP_FLUSH_EXPLICIT_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (stream->mapped != NULL)
+        {
+            return true;
+        }
+        while (glGetError() != GL_NO_ERROR) {}
+        LOGE("glMapBufferRange failed, streaming through glBufferSubData");
+        stream->mapping = false;
+    }
+    stream->staging.resize(stream->frameBytes);
+    stream->mapped = &stream->staging[stream->used];
+    return true;
+}
+
+void* streamAllocate(StreamBuffer* stream, GLsizeiptr bytes, GLsizeiptr alignment, GLintptr* offset)
+{
+    // 每段的起点已经按streamRegionAlignment对齐，对齐段内偏移就是对齐缓冲区里的偏移（alignment不超过它时）
+    GLintptr regionStart = (GLintptr) stream->frame * stream->frameBytes;
+    GLintptr start = regionStart + stream->used;
+    if (alignment > 1)
+    {
+        start = (start + alignment - 1) & ~(GLintptr) (alignment - 1);
+    }
+    if (bytes <= 0 || start + bytes > regionStart + stream->frameBytes)
+    {
+        stream->stats.overflows++;
+        return NULL;
+    }
+    if (stream->mapped == NULL && !mapRemainingRegion(stream))
+    {
+        return NULL;
+    }
+    unsigned char* pointer = stream->mapped + (start - regionStart - stream->mappedStart);
+    stream->used = start - regionStart + bytes;
+    *offset = start;
+    return pointer;
+}
+
+void unmapStreamBuffer(StreamBuffer* stream)
+{
+    if (stream->mapped == NULL)
+    {
+        return;
+    }
+    GLsizeiptr written = stream->used - stream->mappedStart;
+    GLintptr regionStart = (GLintptr) stream->frame * stream->frameBytes;
+    cachedBindBuffer(stream->target, stream->buffer);
+    if (stream->mapping)
+    {
+        if (written > 0)
+        {
+            glFlushMappedBufferRange(stream->target, 0, written); // 相对于映射范围的起点
+        }
+        if (glUnmapBuffer(stream->target) == GL_FALSE)
+        {
+            LOGE("Stream buffer contents were lost while mapped"); // 例如显示模式切换，这一帧的数据会错
+        }
+    }
+    else if (written > 0)
+    {
+        glBufferSubData(stream->target, regionStart + stream->mappedStart, written, stream->mapped);
+    }
+    stream->mapped = NULL;
+}
+
+void endStreamFrame(StreamBuffer* stream)
+{
+    unmapStreamBuffer(stream);
+    if (stream->fences[stream->frame] != 0)
+    {
+        glDeleteSync(stream->fences[stream->frame]);
+    }
+    stream->fences[stream->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stream->stats.frames++;
+    stream->stats.lastFrameBytes = stream->used;
+    stream->stats.bytesStreamed += stream->used;
+    if (!stream->mapping)
+    {
+        stream->stats.fallbackFrames++;
+    }
+}
+
+void deleteStreamBuffer(StreamBuffer* stream)
+{
+    if (stream->mapped != NULL && stream->mapping)
+    {
+        cachedBindBuffer(stream->target, stream->buffer);
+        glUnmapBuffer(stream->target);
+    }
+    for (int i = 0; i < maxStreamFrames; i++)
+    {
+        if (stream->fences[i] != 0)
+        {
+            glDeleteSync(stream->fences[i]);
+        }
+    }
+    // GPU还没读完的数据由驱动保留到绘制完成，不需要等栅栏
+    if (stream->buffer)
+    {
+        cachedDeleteBuffers(1, &stream->buffer);
+    }
+    std::vector<unsigned char>().swap(stream->staging);
+    memset(stream->fences, 0, sizeof(stream->fences));
+    stream->buffer = 0;
+    stream->frameBytes = 0;
+    stream->used = 0;
+    stream->mappedStart = 0;
+    stream->mapped = NULL;
+}
+
+void resetStreamBufferStats(StreamBuffer* stream)
+{
+    memset(&stream->stats, 0, sizeof(stream->stats));
+}
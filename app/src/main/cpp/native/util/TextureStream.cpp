@@ -0,0 +1,779 @@
+/**
+ * --- 异步纹理流式加载 ---
+ *
+ * lesson3的纹理是代码里写死的3x3图片，在setupGraphics里同步上传。真实的纹理通常是几MB的压缩纹理，
+ * 在GL线程上读文件、解析、上传会让第一帧等很久。这里把工作分成两部分：
+ *    - 工作线程：mmap映射KTX/KTX2文件，解析文件头，切出每一级mipmap的数据，并提前读一遍让页面进入内存
+ *      （否则缺页会发生在GL线程的上传调用里）。格式不被支持时（例如没有ASTC）改用备用文件。
+ *    - GL线程：每帧调用pumpTextureUploads，只做上传调用，超过时间预算就留到下一帧。
+ *
+ * 上传顺序是从最小的一级到最大的一级。ES3上用glTexStorage2D分配好全部级别，大的级别按textureSliceBytes切成条带
+ * 用glCompressedTexSubImage2D分几帧上传，每传完一级就把GL_TEXTURE_BASE_LEVEL设到这一级，纹理马上可以使用，
+ * 随后几帧逐渐变清晰；ES2不能设置BASE_LEVEL也没有glTexStorage2D，整级上传，全部上传完才能使用。
+ *
+ * 文件映射一直保留到最后一级上传完成，上传直接从映射的内存读取，不复制。
+ *
+ * 只有一级的RGBA8文件（没有预先生成mipmap）由工作线程用generateMipChain补齐mipmap链，之后上传生成的数据，
+ * 文件映射马上释放。离线烘焙好mipmap的文件（host工具MipBake）可以省掉这一步。
+ */
+#include <GLES3/gl3.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "../include/TextureStream.h"
+#include "../include/MipUtil.h"
+#include "../include/StateCache.h"
+#include "../include/LogUtil.h"
+
+static const unsigned char ktx1Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+static const unsigned char ktx2Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+static const unsigned int ktx1HeaderBytes = 64;
+static const unsigned int ktx2HeaderBytes = 80;
+static const unsigned int ktxNativeEndianness = 0x04030201;
+static const size_t textureSliceBytes = 256 * 1024; // ES3上每次上传的条带大小，大的级别分几帧上传
+
+enum TextureFeature
+{
+    FEATURE_RGBA8, // 所有上下文都支持
+    FEATURE_ES3, // ES3核心功能（ETC2、sRGB的RGBA8）
+    FEATURE_ASTC // GL_KHR_texture_compression_astc_ldr
+};
+
+// KTX2用Vulkan的格式编号，KTX1用GL的内部格式，两者都映射到GL内部格式和块大小
+struct KtxFormat
+{
+    unsigned int vkFormat;
+    GLenum internalFormat;
+    int blockWidth;
+    int blockHeight;
+    int blockBytes;
+    TextureFeature feature;
+};
+
+static const GLenum astcFormat = 0x93B0; // GL_COMPRESSED_RGBA_ASTC_4x4_KHR，其它块大小依次加1
+static const GLenum astcSrgbFormat = 0x93D0; // GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR
+static const unsigned int vkAstcFormat = 157; // VK_FORMAT_ASTC_4x4_UNORM_BLOCK，后面是SRGB，其它块大小依次加2
+static const int astcBlockSizes[][2] = {{4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6}, {8, 8},
+                                        {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12}};
+static const int astcBlockSizeCount = sizeof(astcBlockSizes) / sizeof(astcBlockSizes[0]);
+
+static const KtxFormat ktxFormats[] = {
+        {37, GL_RGBA8, 1, 1, 4, FEATURE_RGBA8}, // VK_FORMAT_R8G8B8A8_UNORM
+        {43, GL_SRGB8_ALPHA8, 1, 1, 4, FEATURE_ES3}, // VK_FORMAT_R8G8B8A8_SRGB
+        {147, GL_COMPRESSED_RGB8_ETC2, 4, 4, 8, FEATURE_ES3},
+        {148, GL_COMPRESSED_SRGB8_ETC2, 4, 4, 8, FEATURE_ES3},
+        {149, GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, 4, 4, 8, FEATURE_ES3},
+        {150, GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2, 4, 4, 8, FEATURE_ES3},
+        {151, GL_COMPRESSED_RGBA8_ETC2_EAC, 4, 4, 16, FEATURE_ES3},
+        {152, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 4, 4, 16, FEATURE_ES3},
+};
+
+static bool findFormat(bool byVkFormat, unsigned int value, KtxFormat* format)
+{
+    for (size_t i = 0; i < sizeof(ktxFormats) / sizeof(ktxFormats[0]); i++)
+    {
+        if ((byVkFormat ? ktxFormats[i].vkFormat : ktxFormats[i].internalFormat) == value)
+        {
+            *format = ktxFormats[i];
+            return true;
+        }
+    }
+    for (int i = 0; i < astcBlockSizeCount; i++)
+    {
+        for (int srgb = 0; srgb < 2; srgb++)
+        {
+            unsigned int vkFormat = vkAstcFormat + 2 * i + srgb;
+            GLenum internalFormat = (srgb ? astcSrgbFormat : astcFormat) + i;
+            if ((byVkFormat ? vkFormat : internalFormat) == value)
+            {
+                KtxFormat astc = {vkFormat, internalFormat, astcBlockSizes[i][0], astcBlockSizes[i][1], 16, FEATURE_ASTC};
+                *format = astc;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static unsigned int readUint32(const unsigned char* data)
+{
+    unsigned int value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static unsigned long long readUint64(const unsigned char* data)
+{
+    unsigned long long value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static size_t levelBytes(const KtxFormat* format, int width, int height)
+{
+    size_t blocksX = (size_t) ((width + format->blockWidth - 1) / format->blockWidth);
+    size_t blocksY = (size_t) ((height + format->blockHeight - 1) / format->blockHeight);
+    return blocksX * blocksY * format->blockBytes;
+}
+
+// 检查尺寸和级数，填好每一级的宽高
+static bool initImage(KtxImage* image, const KtxFormat* format, unsigned int width, unsigned int height,
+                      unsigned int levelCount)
+{
+    if (width == 0 || height == 0 || width > 16384 || height > 16384)
+    {
+        LOGE("Unsupported KTX size %ux%u", width, height);
+        return false;
+    }
+    levelCount = levelCount == 0 ? 1 : levelCount; // 0表示只有一级，需要运行时生成mipmap
+    if (levelCount > (unsigned int) maxTextureLevels)
+    {
+        LOGE("Too many KTX mipmap levels: %u", levelCount);
+        return false;
+    }
+    image->internalFormat = format->internalFormat;
+    image->compressed = format->blockWidth > 1;
+    image->blockWidth = format->blockWidth;
+    image->blockHeight = format->blockHeight;
+    image->width = (int) width;
+    image->height = (int) height;
+    image->levelCount = (int) levelCount;
+    for (int level = 0; level < image->levelCount; level++)
+    {
+        image->levels[level].width = image->width >> level > 0 ? image->width >> level : 1;
+        image->levels[level].height = image->height >> level > 0 ? image->height >> level : 1;
+    }
+    return true;
+}
+
+static bool parseKtx1(const unsigned char* data, size_t size, KtxImage* image)
+{
+    if (size < ktx1HeaderBytes)
+    {
+        LOGE("KTX file truncated");
+        return false;
+    }
+    if (readUint32(data + 12) != ktxNativeEndianness)
+    {
+        LOGE("Byte-swapped KTX files are not supported");
+        return false;
+    }
+    unsigned int glType = readUint32(data + 16);
+    unsigned int glFormat = readUint32(data + 24);
+    unsigned int glInternalFormat = readUint32(data + 28);
+    unsigned int arrayElements = readUint32(data + 48);
+    unsigned int faces = readUint32(data + 52);
+    if (readUint32(data + 44) != 0 || arrayElements != 0 || faces != 1)
+    {
+        LOGE("Only 2D KTX textures are supported");
+        return false;
+    }
+    KtxFormat format;
+    bool found = glType == 0 ? findFormat(false, glInternalFormat, &format) && format.blockWidth > 1
+                             : glType == GL_UNSIGNED_BYTE && glFormat == GL_RGBA &&
+                               findFormat(true, glInternalFormat == GL_SRGB8_ALPHA8 ? 43 : 37, &format);
+    if (!found)
+    {
+        LOGE("Unsupported KTX format 0x%x (type 0x%x)", glInternalFormat, glType);
+        return false;
+    }
+    if (!initImage(image, &format, readUint32(data + 36), readUint32(data + 40), readUint32(data + 56)))
+    {
+        return false;
+    }
+    size_t offset = (size_t) ktx1HeaderBytes + readUint32(data + 60);
+    for (int level = 0; level < image->levelCount; level++)
+    {
+        KtxLevel& current = image->levels[level];
+        if (offset + 4 > size)
+        {
+            LOGE("KTX file truncated at level %d", level);
+            return false;
+        }
+        current.bytes = readUint32(data + offset);
+        current.data = data + offset + 4;
+        if (current.bytes != levelBytes(&format, current.width, current.height) || offset + 4 + current.bytes > size)
+        {
+            LOGE("KTX level %d has %zu bytes, expected %zu", level, current.bytes,
+                 levelBytes(&format, current.width, current.height));
+            return false;
+        }
+        offset += 4 + ((current.bytes + 3) & ~(size_t) 3); // 每级数据按4字节对齐
+    }
+    return true;
+}
+
+static bool parseKtx2(const unsigned char* data, size_t size, KtxImage* image)
+{
+    if (size < ktx2HeaderBytes)
+    {
+        LOGE("KTX2 file truncated");
+        return false;
+    }
+    unsigned int vkFormat = readUint32(data + 12);
+    if (readUint32(data + 28) != 0 || readUint32(data + 32) != 0 || readUint32(data + 36) != 1)
+    {
+        LOGE("Only 2D KTX2 textures are supported");
+        return false;
+    }
+    if (readUint32(data + 44) != 0)
+    {
+        LOGE("Supercompressed KTX2 files are not supported");
+        return false;
+    }
+    KtxFormat format;
+    if (!findFormat(true, vkFormat, &format))
+    {
+        LOGE("Unsupported KTX2 vkFormat %u", vkFormat);
+        return false;
+    }
+    if (!initImage(image, &format, readUint32(data + 20), readUint32(data + 24), readUint32(data + 40)))
+    {
+        return false;
+    }
+    if (ktx2HeaderBytes + 24 * (size_t) image->levelCount > size)
+    {
+        LOGE("KTX2 level index truncated");
+        return false;
+    }
+    for (int level = 0; level < image->levelCount; level++)
+    {
+        KtxLevel& current = image->levels[level];
+        const unsigned char* index = data + ktx2HeaderBytes + 24 * level; // byteOffset, byteLength, uncompressedByteLength
+        unsigned long long offset = readUint64(index);
+        unsigned long long bytes = readUint64(index + 8);
+        if (bytes != levelBytes(&format, current.width, current.height) || offset > size || bytes > size - offset)
+        {
+            LOGE("KTX2 level %d has %llu bytes at %llu, expected %zu", level, bytes, offset,
+                 levelBytes(&format, current.width, current.height));
+            return false;
+        }
+        current.data = data + offset;
+        current.bytes = (size_t) bytes;
+    }
+    return true;
+}
+
+bool parseKtx(const unsigned char* data, size_t size, KtxImage* image)
+{
+    if (size >= sizeof(ktx1Identifier) && memcmp(data, ktx1Identifier, sizeof(ktx1Identifier)) == 0)
+    {
+        return parseKtx1(data, size, image);
+    }
+    if (size >= sizeof(ktx2Identifier) && memcmp(data, ktx2Identifier, sizeof(ktx2Identifier)) == 0)
+    {
+        return parseKtx2(data, size, image);
+    }
+    LOGE("Not a KTX file");
+    return false;
+}
+
+bool writeKtx2(const char* path, const KtxImage* image)
+{
+    KtxFormat format;
+    if (!findFormat(false, image->internalFormat, &format))
+    {
+        LOGE("Cannot write KTX2 format 0x%x", image->internalFormat);
+        return false;
+    }
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        LOGE("Could not create %s", path);
+        return false;
+    }
+    // vkFormat、typeSize、宽、高、深度、层数、面数、级数、超压缩方式，然后是DFD和KVD的位置（都没有）
+    unsigned int header[] = {format.vkFormat, 1, (unsigned int) image->width, (unsigned int) image->height, 0, 0, 1,
+                             (unsigned int) image->levelCount, 0, 0, 0, 0, 0};
+    unsigned long long globalData[2] = {0, 0}; // 没有超压缩全局数据
+    bool written = fwrite(ktx2Identifier, sizeof(ktx2Identifier), 1, file) == 1 &&
+                   fwrite(header, sizeof(header), 1, file) == 1 && fwrite(globalData, sizeof(globalData), 1, file) == 1;
+    unsigned long long offset = ktx2HeaderBytes + 24 * (unsigned long long) image->levelCount;
+    for (int level = 0; level < image->levelCount && written; level++)
+    {
+        unsigned long long index[3] = {offset, image->levels[level].bytes, image->levels[level].bytes};
+        written = fwrite(index, sizeof(index), 1, file) == 1;
+        offset += image->levels[level].bytes;
+    }
+    for (int level = 0; level < image->levelCount && written; level++)
+    {
+        written = fwrite(image->levels[level].data, 1, image->levels[level].bytes, file) == image->levels[level].bytes;
+    }
+    if (fclose(file) != 0 || !written)
+    {
+        LOGE("Could not write %s", path);
+        return false;
+    }
+    return true;
+}
+
+struct TextureRequest
+{
+    int handle;
+    std::string path;
+    std::string fallbackPath;
+};
+
+// 工作线程解析好的文件，交给GL线程上传
+struct LoadedTexture
+{
+    int handle;
+    bool valid; // 加载失败时为false
+    void* mapping; // 改用生成的mipmap链以后为NULL
+    size_t mappingBytes;
+    MipChain* mips; // 运行时生成的mipmap链，image的各级指向这里
+    KtxImage image;
+};
+
+// GL线程上的纹理状态
+struct StreamedTexture
+{
+    StreamedTextureState state;
+    GLuint texture;
+};
+
+static bool streaming = false;
+static std::string sceneTexturePath;
+static std::string sceneTextureFallbackPath;
+static bool streamSupports[3]; // 按TextureFeature
+static bool streamProgressive; // ES3可以设置GL_TEXTURE_BASE_LEVEL
+
+// 请求队列和解析结果队列由工作线程和GL线程共享。工作线程在有请求时才启动，处理完队列就退出，
+// 不会有线程一直等在这里（课程库被dlclose或者进程退出时也就没有需要收尾的线程）
+static std::mutex streamMutex;
+static std::condition_variable streamIdle;
+static bool streamWorking;
+static bool streamStopping;
+static std::deque<TextureRequest> requests;
+static std::vector<LoadedTexture> loaded;
+static long long bytesMapped;
+static int mipChainsGenerated;
+static double mipMilliseconds;
+
+// 以下只在GL线程上访问
+static std::vector<StreamedTexture> textures;
+static std::deque<LoadedTexture> uploads; // 正在上传的纹理，按请求完成解析的顺序
+static int uploadLevel; // uploads.front()下一个要上传的级别，从最小的一级往大传
+static int uploadRow; // uploadLevel中下一条的起始行
+static TextureStreamStats streamStats;
+
+static void releaseTexture(LoadedTexture* texture)
+{
+    if (texture->mapping != NULL)
+    {
+        munmap(texture->mapping, texture->mappingBytes);
+        texture->mapping = NULL;
+    }
+    delete texture->mips;
+    texture->mips = NULL;
+}
+
+static bool formatSupported(const KtxImage* image)
+{
+    KtxFormat format;
+    return findFormat(false, image->internalFormat, &format) && streamSupports[format.feature];
+}
+
+// 映射并解析文件，把每一级的每个页面都读一遍，确保上传时不会在GL线程上缺页
+static bool loadKtxFile(const char* path, LoadedTexture* texture)
+{
+    texture->mapping = NULL;
+    texture->mips = NULL;
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+    {
+        LOGE("Could not open texture %s", path);
+        return false;
+    }
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0)
+    {
+        LOGE("Could not stat texture %s", path);
+        close(file);
+        return false;
+    }
+    size_t size = (size_t) status.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file); // 映射建立后文件描述符就不需要了
+    if (mapping == MAP_FAILED)
+    {
+        LOGE("Could not map texture %s", path);
+        return false;
+    }
+    madvise(mapping, size, MADV_WILLNEED);
+    texture->mapping = mapping;
+    texture->mappingBytes = size;
+    if (!parseKtx((const unsigned char*) mapping, size, &texture->image))
+    {
+        LOGE("Could not parse texture %s", path);
+        releaseTexture(texture);
+        return false;
+    }
+    volatile unsigned char touched = 0;
+    for (int level = 0; level < texture->image.levelCount; level++)
+    {
+        const KtxLevel& current = texture->image.levels[level];
+        for (size_t offset = 0; offset < current.bytes; offset += 4096)
+        {
+            touched ^= current.data[offset];
+        }
+    }
+    (void) touched;
+    return true;
+}
+
+// 只有一级的RGBA8纹理在工作线程上生成完整的mipmap链，改为从生成的数据上传。ES2上非2的幂的纹理不能用mipmap，保持原样
+static void generateMips(LoadedTexture* texture)
+{
+    KtxImage& image = texture->image;
+    bool powerOfTwo = (image.width & (image.width - 1)) == 0 && (image.height & (image.height - 1)) == 0;
+    if (image.compressed || image.levelCount > 1 || (image.width == 1 && image.height == 1) ||
+        (!streamProgressive && !powerOfTwo))
+    {
+        return;
+    }
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    MipChain* mips = new MipChain;
+    int threads = (int) std::thread::hardware_concurrency() - 1; // 给GL线程留一个核
+    if (!generateMipChain(image.levels[0].data, image.width, image.height, image.internalFormat == GL_SRGB8_ALPHA8,
+                          MIP_FILTER_BOX, threads > 1 ? threads : 1, mips))
+    {
+        delete mips;
+        return;
+    }
+    munmap(texture->mapping, texture->mappingBytes);
+    texture->mapping = NULL;
+    texture->mips = mips;
+    image.levelCount = mips->levelCount;
+    for (int level = 0; level < mips->levelCount; level++)
+    {
+        image.levels[level].data = &mips->pixels[mips->offset[level]];
+        image.levels[level].bytes = (size_t) mips->width[level] * mips->height[level] * 4;
+        image.levels[level].width = mips->width[level];
+        image.levels[level].height = mips->height[level];
+    }
+    double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(streamMutex);
+    mipChainsGenerated++;
+    mipMilliseconds += elapsed;
+}
+
+static void streamLoop()
+{
+    while (true)
+    {
+        TextureRequest request;
+        {
+            std::lock_guard<std::mutex> lock(streamMutex);
+            if (streamStopping || requests.empty())
+            {
+                streamWorking = false;
+                streamIdle.notify_all();
+                return;
+            }
+            request = requests.front();
+            requests.pop_front();
+        }
+        LoadedTexture texture;
+        texture.handle = request.handle;
+        bool ok = loadKtxFile(request.path.c_str(), &texture);
+        if (ok && !formatSupported(&texture.image))
+        {
+            LOGI("Texture format 0x%x of %s not supported, trying fallback", texture.image.internalFormat,
+                 request.path.c_str());
+            releaseTexture(&texture);
+            ok = false;
+        }
+        if (!ok && !request.fallbackPath.empty())
+        {
+            ok = loadKtxFile(request.fallbackPath.c_str(), &texture) && formatSupported(&texture.image);
+            if (!ok)
+            {
+                releaseTexture(&texture);
+            }
+        }
+        texture.valid = ok;
+        if (ok)
+        {
+            {
+                std::lock_guard<std::mutex> lock(streamMutex);
+                bytesMapped += (long long) texture.mappingBytes;
+            }
+            generateMips(&texture);
+        }
+        std::lock_guard<std::mutex> lock(streamMutex);
+        loaded.push_back(texture);
+    }
+}
+
+bool startTextureStreaming()
+{
+    stopTextureStreaming();
+    const char* version = (const char*) glGetString(GL_VERSION);
+    const char* extensions = (const char*) glGetString(GL_EXTENSIONS);
+    streamProgressive = version != NULL && strncmp(version, "OpenGL ES 3", 11) == 0;
+    streamSupports[FEATURE_RGBA8] = true;
+    streamSupports[FEATURE_ES3] = streamProgressive;
+    streamSupports[FEATURE_ASTC] = extensions != NULL && strstr(extensions, "GL_KHR_texture_compression_astc_ldr") != NULL;
+    textures.clear();
+    streaming = true;
+    return true;
+}
+
+void stopTextureStreaming()
+{
+    if (!streaming)
+    {
+        return;
+    }
+    {
+        // 正在解析的文件会处理完，剩下的请求丢掉
+        std::unique_lock<std::mutex> lock(streamMutex);
+        streamStopping = true;
+        streamIdle.wait(lock, [] { return !streamWorking; });
+        streamStopping = false;
+    }
+    streaming = false;
+    for (size_t i = 0; i < loaded.size(); i++)
+    {
+        releaseTexture(&loaded[i]);
+    }
+    for (size_t i = 0; i < uploads.size(); i++)
+    {
+        releaseTexture(&uploads[i]);
+    }
+    loaded.clear();
+    uploads.clear();
+    requests.clear();
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        if (textures[i].state == TEXTURE_PENDING)
+        {
+            textures[i].state = TEXTURE_FAILED;
+        }
+    }
+}
+
+int requestTexture(const char* path, const char* fallbackPath)
+{
+    StreamedTexture texture = {TEXTURE_PENDING, 0};
+    int handle = (int) textures.size();
+    textures.push_back(texture);
+    streamStats.requested++;
+    if (!streaming)
+    {
+        LOGE("Texture streaming not started, dropping %s", path);
+        textures[handle].state = TEXTURE_FAILED;
+        streamStats.failed++;
+        return handle;
+    }
+    TextureRequest request;
+    request.handle = handle;
+    request.path = path;
+    request.fallbackPath = fallbackPath != NULL ? fallbackPath : "";
+    std::lock_guard<std::mutex> lock(streamMutex);
+    requests.push_back(request);
+    if (!streamWorking)
+    {
+        streamWorking = true;
+        std::thread(streamLoop).detach();
+    }
+    return handle;
+}
+
+// 创建纹理对象并设置采样参数。ES3上用glTexStorage2D一次分配全部级别，之后按条带上传，并先把可用的级别限制为最小的一级
+static void beginUpload(LoadedTexture* upload, StreamedTexture* texture)
+{
+    const KtxImage& image = upload->image;
+    glGenTextures(1, &texture->texture);
+    cachedBindTexture(GL_TEXTURE_2D, texture->texture);
+    // ES2上只有完整的mipmap链才能用mipmap过滤
+    bool fullChain = image.levels[image.levelCount - 1].width == 1 && image.levels[image.levelCount - 1].height == 1;
+    bool mipmapped = image.levelCount > 1 && (streamProgressive || fullChain);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (streamProgressive)
+    {
+        glTexStorage2D(GL_TEXTURE_2D, mipmapped ? image.levelCount : 1, image.internalFormat, image.width, image.height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, mipmapped ? image.levelCount - 1 : 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipmapped ? image.levelCount - 1 : 0);
+    }
+    uploadLevel = mipmapped ? image.levelCount - 1 : 0;
+    uploadRow = 0;
+}
+
+// 上传uploadLevel从uploadRow开始的一条，返回上传的字节数。ES2上整级上传
+static size_t uploadSlice(const KtxImage* image)
+{
+    const KtxLevel& current = image->levels[uploadLevel];
+    if (!image->compressed)
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4); // RGBA8每行都是4字节对齐的
+    }
+    if (!streamProgressive)
+    {
+        if (image->compressed)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, uploadLevel, image->internalFormat, current.width, current.height, 0,
+                                   (GLsizei) current.bytes, current.data);
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, uploadLevel, GL_RGBA, current.width, current.height, 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, current.data);
+        }
+        uploadRow = current.height;
+        return current.bytes;
+    }
+    // 一行块的字节数，条带的高度是块高度的整数倍（最后一条可以到边缘为止）
+    int blockRows = (current.height + image->blockHeight - 1) / image->blockHeight;
+    size_t rowBytes = current.bytes / blockRows;
+    int sliceBlockRows = (int) (textureSliceBytes / rowBytes);
+    sliceBlockRows = sliceBlockRows > 0 ? sliceBlockRows : 1;
+    int firstBlockRow = uploadRow / image->blockHeight;
+    int height = sliceBlockRows * image->blockHeight;
+    height = uploadRow + height < current.height ? height : current.height - uploadRow;
+    int sliceBlocks = (height + image->blockHeight - 1) / image->blockHeight;
+    const unsigned char* data = current.data + firstBlockRow * rowBytes;
+    size_t bytes = sliceBlocks * rowBytes;
+    if (image->compressed)
+    {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, uploadLevel, 0, uploadRow, current.width, height, image->internalFormat,
+                                  (GLsizei) bytes, data);
+    }
+    else
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, uploadLevel, 0, uploadRow, current.width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    }
+    uploadRow += height;
+    return bytes;
+}
+
+int pumpTextureUploads(double budgetMilliseconds)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(streamMutex);
+        streamStats.bytesMapped = bytesMapped;
+        streamStats.mipChainsGenerated = mipChainsGenerated;
+        streamStats.mipMilliseconds = mipMilliseconds;
+        for (size_t i = 0; i < loaded.size(); i++)
+        {
+            uploads.push_back(loaded[i]);
+        }
+        loaded.clear();
+    }
+    int uploaded = 0;
+    double elapsed = 0.0;
+    while (!uploads.empty() && (uploaded == 0 || elapsed < budgetMilliseconds))
+    {
+        LoadedTexture& upload = uploads.front();
+        StreamedTexture& texture = textures[upload.handle];
+        if (!upload.valid)
+        {
+            texture.state = TEXTURE_FAILED;
+            streamStats.failed++;
+            uploads.pop_front();
+            continue;
+        }
+        if (texture.texture == 0)
+        {
+            beginUpload(&upload, &texture);
+        }
+        else
+        {
+            cachedBindTexture(GL_TEXTURE_2D, texture.texture);
+        }
+        streamStats.bytesStreamed += (long long) uploadSlice(&upload.image);
+        uploaded++;
+        elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (uploadRow < upload.image.levels[uploadLevel].height)
+        {
+            continue; // 这一级还没传完
+        }
+        streamStats.levelsUploaded++;
+        if (streamProgressive)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, uploadLevel); // 这一级及更小的级别已经可以使用
+        }
+        if (uploadLevel == 0)
+        {
+            texture.state = TEXTURE_COMPLETE;
+            streamStats.completed++;
+            releaseTexture(&upload);
+            uploads.pop_front();
+        }
+        else
+        {
+            texture.state = streamProgressive ? TEXTURE_PARTIAL : TEXTURE_PENDING;
+            uploadLevel--;
+            uploadRow = 0;
+        }
+    }
+    if (uploaded > 0)
+    {
+        streamStats.framesWithUploads++;
+        streamStats.uploadMilliseconds += elapsed;
+        if (elapsed > budgetMilliseconds)
+        {
+            streamStats.framesOverBudget++;
+            streamStats.stallMilliseconds += elapsed - budgetMilliseconds;
+        }
+        if (elapsed > streamStats.maxFrameMilliseconds)
+        {
+            streamStats.maxFrameMilliseconds = elapsed;
+        }
+    }
+    return uploaded;
+}
+
+StreamedTextureState getStreamedTexture(int handle, GLuint* texture)
+{
+    if (handle < 0 || handle >= (int) textures.size())
+    {
+        *texture = 0;
+        return TEXTURE_FAILED;
+    }
+    *texture = textures[handle].texture;
+    return textures[handle].state;
+}
+
+void getTextureStreamStats(TextureStreamStats* stats)
+{
+    *stats = streamStats;
+}
+
+void resetTextureStreamStats()
+{
+    memset(&streamStats, 0, sizeof(streamStats));
+    std::lock_guard<std::mutex> lock(streamMutex);
+    bytesMapped = 0;
+    mipChainsGenerated = 0;
+    mipMilliseconds = 0.0;
+}
+
+void setSceneTextureFile(const char* path, const char* fallbackPath)
+{
+    sceneTexturePath = path != NULL ? path : "";
+    sceneTextureFallbackPath = fallbackPath != NULL ? fallbackPath : "";
+}
+
+bool getSceneTextureFile(std::string* path, std::string* fallbackPath)
+{
+    *path = sceneTexturePath;
+    *fallbackPath = sceneTextureFallbackPath;
+    return !sceneTexturePath.empty();
+}
@@ -0,0 +1,225 @@
+/**
+ * --- 共享的uniform块 ---
+ *
+ * 每个程序都有自己的uniform：lesson4每帧用glUniformMatrix4fv设置projection、modelView，再逐个设置光照参数，
+ * 场景里有多个程序时，每切换一次程序这些值都要对新程序重新设置一遍（StateCache按程序记录，只能省掉同一个程序里的重复）。
+ *
+ * GLES3的uniform块把一组uniform放进缓冲区对象，块按名字连到绑定点（glUniformBlockBinding），缓冲区绑定到绑定点
+ * （glBindBufferBase/Range），之后所有连到这个绑定点的程序读的都是同一块数据。这里分成三块：
+ *    - Camera（绑定点0）：投影、视图和两者的乘积，每帧最多上传一次
+ *    - Lighting（绑定点1）：computeLightingUniforms算好的光照参数，每帧最多上传一次
+ *    - Object（绑定点2）：每个物体的模型视图矩阵，从流式缓冲区里分配，每个物体用glBindBufferRange换一下偏移
+ * 布局用std140，C++里的结构体（UniformBlocks.h）和着色器里的块逐字节对应，不需要查询成员偏移。
+ *
+ * 相机块和光照块内容没有变化时不上传。缓冲区绑定到绑定点之后一直不变，切换程序不需要任何uniform调用。
+ * GLSL ES 3.00没有layout(binding = N)（3.10才有），所以每个程序链接（或从缓存加载）之后要调用bindProgramUniformBlocks。
+ */
+#include <GLES3/gl3.h>
+#include <cstring>
+
+#include "../include/CameraUtil.h"
+#include "../include/LogUtil.h"
+#include "../include/StateCache.h"
+#include "../include/UniformBlocks.h"
+
+static const char* blockNames[UNIFORM_BLOCK_COUNT] = {"Camera", "Lighting", "Object"};
+
+static GLuint cameraBuffer = 0;
+static GLuint lightingBuffer = 0;
+static StreamBuffer objectStream;
+static GLintptr objectAlignment = 16;
+static GLintptr boundObjectOffset = -1;
+static CameraBlock camera;
+static LightingBlock lighting;
+static bool cameraKnown = false; // camera、lighting是否是缓冲区里的内容
+static bool lightingKnown = false;
+static UniformBlockStats blockStats;
+
+bool uniformBlocksSupported()
+{
+    const char* version = (const char*) glGetString(GL_VERSION);
+    return version != NULL && strncmp(version, "OpenGL ES ", 10) == 0 && version[10] >= '3';
+}
+
+static GLuint createBlockBuffer(GLenum binding, GLsizeiptr bytes)
+{
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    cachedBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, bytes, NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer); // 同时也会改变GL_UNIFORM_BUFFER的绑定，和缓存里的一样
+    return buffer;
+}
+
+bool initUniformBlocks(int maxObjectsPerFrame)
+{
+    cameraBuffer = 0;
+    lightingBuffer = 0;
+    objectStream.buffer = 0;
+    boundObjectOffset = -1;
+    cameraKnown = false;
+    lightingKnown = false;
+    if (!uniformBlocksSupported())
+    {
+        LOGE("Uniform blocks need a GLES3 context");
+        return false;
+    }
+    while (glGetError() != GL_NO_ERROR) {}
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    objectAlignment = alignment > 16 ? alignment : 16;
+    cameraBuffer = createBlockBuffer(UNIFORM_BLOCK_CAMERA, sizeof(CameraBlock));
+    lightingBuffer = createBlockBuffer(UNIFORM_BLOCK_LIGHTING, sizeof(LightingBlock));
+    GLsizeiptr objectBytes = (sizeof(ObjectBlock) + objectAlignment - 1) / objectAlignment * objectAlignment;
+    bool created = createStreamBuffer(&objectStream, GL_UNIFORM_BUFFER,
+                                      objectBytes * (maxObjectsPerFrame > 0 ? maxObjectsPerFrame : 1), 3);
+    if (!created || glGetError() != GL_NO_ERROR)
+    {
+        LOGE("Could not create uniform block buffers");
+        deleteUniformBlocks();
+        return false;
+    }
+    return true;
+}
+
+void deleteUniformBlocks()
+{
+    if (cameraBuffer)
+    {
+        cachedDeleteBuffers(1, &cameraBuffer);
+    }
+    if (lightingBuffer)
+    {
+        cachedDeleteBuffers(1, &lightingBuffer);
+    }
+    if (objectStream.buffer)
+    {
+        deleteStreamBuffer(&objectStream);
+    }
+    cameraBuffer = 0;
+    lightingBuffer = 0;
+    boundObjectOffset = -1;
+    cameraKnown = false;
+    lightingKnown = false;
+}
+
+void bindProgramUniformBlocks(GLuint program)
+{
+    for (int binding = 0; binding < UNIFORM_BLOCK_COUNT; binding++)
+    {
+        GLuint index = glGetUniformBlockIndex(program, blockNames[binding]);
+        if (index != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(program, index, binding);
+        }
+    }
+}
+
+void beginUniformFrame()
+{
+    if (objectStream.buffer)
+    {
+        beginStreamFrame(&objectStream);
+    }
+    blockStats.frames++;
+}
+
+void endUniformFrame()
+{
+    if (objectStream.buffer)
+    {
+        endStreamFrame(&objectStream);
+    }
+}
+
+static void uploadBlock(GLuint buffer, const void* data, GLsizeiptr bytes)
+{
+    cachedBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, bytes, data);
+}
+
+void updateCameraBlock(const float* projection, const float* view)
+{
+    CameraBlock block;
+    memcpy(block.projection, projection, sizeof(block.projection));
+    if (view != NULL)
+    {
+        memcpy(block.view, view, sizeof(block.view));
+    }
+    else
+    {
+        matrixIdentityFunction(block.view);
+    }
+    matrixMultiply(block.viewProjection, block.projection, block.view);
+    if (cameraBuffer == 0 || (cameraKnown && memcmp(&block, &camera, sizeof(block)) == 0))
+    {
+        return;
+    }
+    camera = block;
+    cameraKnown = true;
+    uploadBlock(cameraBuffer, &camera, sizeof(camera));
+    blockStats.cameraUploads++;
+}
+
+void updateLightingBlock(const LightingUniforms* uniforms)
+{
+    LightingBlock block;
+    memset(&block, 0, sizeof(block));
+    memcpy(block.inverseLightDirection, uniforms->inverseLightDirection, sizeof(float) * 3);
+    memcpy(block.inverseEyeDirection, uniforms->inverseEyeDirection, sizeof(float) * 3);
+    memcpy(block.ambientLightIntensity, uniforms->ambientLightIntensity, sizeof(float) * 3);
+    memcpy(block.diffuseLightIntensity, uniforms->diffuseLightIntensity, sizeof(float) * 3);
+    memcpy(block.specularColour, uniforms->specularColour, sizeof(float) * 3);
+    block.shininess = uniforms->shininess;
+    if (lightingBuffer == 0 || (lightingKnown && memcmp(&block, &lighting, sizeof(block)) == 0))
+    {
+        return;
+    }
+    lighting = block;
+    lightingKnown = true;
+    uploadBlock(lightingBuffer, &lighting, sizeof(lighting));
+    blockStats.lightingUploads++;
+}
+
+GLintptr writeObjectBlock(const float* modelView)
+{
+    GLintptr offset;
+    ObjectBlock* block = objectStream.buffer
+                         ? (ObjectBlock*) streamAllocate(&objectStream, sizeof(ObjectBlock), objectAlignment, &offset)
+                         : NULL;
+    if (block == NULL)
+    {
+        LOGE("Out of object uniform block space for this frame");
+        return -1;
+    }
+    memcpy(block->modelView, modelView, sizeof(block->modelView));
+    blockStats.objectBlocks++;
+    return offset;
+}
+
+void bindObjectBlock(GLintptr offset)
+{
+    if (offset < 0)
+    {
+        return;
+    }
+    unmapStreamBuffer(&objectStream); // 缓冲区映射时不能用来绘制
+    if (offset == boundObjectOffset)
+    {
+        return; // 同一个物体块连续画了多次
+    }
+    cachedBindBuffer(GL_UNIFORM_BUFFER, objectStream.buffer);
+    glBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_BLOCK_OBJECT, objectStream.buffer, offset, sizeof(ObjectBlock));
+    boundObjectOffset = offset;
+    blockStats.objectBindings++;
+}
+
+void getUniformBlockStats(UniformBlockStats* stats)
+{
+    *stats = blockStats;
+}
+
+void resetUniformBlockStats()
+{
+    memset(&blockStats, 0, sizeof(blockStats));
+}
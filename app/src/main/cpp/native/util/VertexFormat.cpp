@@ -0,0 +1,285 @@
+/**
+ * --- 交错和量化的顶点格式 ---
+ *
+ * 之前的课程每个属性用一个float数组，lesson4的光照立方体每个顶点有位置、法线、颜色三个float3，
+ * 共36字节，分在三个数组里，GPU取一个顶点要访问三处内存。中低端GPU上顶点读取的带宽常常是瓶颈，可以从两方面减少：
+ *    - 交错：一个顶点的所有属性放在一起（位置、法线、颜色、位置、法线、颜色……），一次读取就能拿到整个顶点
+ *    - 量化：属性不一定需要32位浮点的精度。位置可以用16位浮点（half）；法线是单位向量，
+ *      用10:10:10:2或每分量8位的有符号归一化整数就足够；颜色本来就是8位精度，用无符号归一化8位
+ * 这样光照立方体的一个顶点从36字节变成16字节（half位置8字节 + 10:10:10:2法线4字节 + 8位颜色4字节）。
+ *
+ * GLES3的glVertexAttribPointer直接支持这些格式（GL_HALF_FLOAT、GL_INT_2_10_10_10_REV、normalized的GL_BYTE/GL_UNSIGNED_BYTE），
+ * 着色器里拿到的仍然是浮点数，不需要修改着色器。每个属性都按4字节对齐，这是很多GPU取顶点的要求。
+ */
+#include <cmath>
+#include <cstring>
+
+#include "../include/VertexFormat.h"
+#include "../include/LogUtil.h"
+#include "../include/StateCache.h"
+
+// GL_HALF_FLOAT和GL_INT_2_10_10_10_REV是GLES3才有的顶点格式，8位归一化格式GLES2就支持
+bool packedVertexFormatsSupported()
+{
+    const char* version = (const char*) glGetString(GL_VERSION);
+    return version != NULL && strncmp(version, "OpenGL ES ", 10) == 0 && version[10] >= '3';
+}
+
+void initVertexLayout(VertexLayout* layout)
+{
+    memset(layout, 0, sizeof(VertexLayout));
+}
+
+static GLsizei elementBytes(GLint components, VertexElementFormat format)
+{
+    switch (format)
+    {
+        case VERTEX_FLOAT:
+            return 4 * components;
+        case VERTEX_HALF:
+            return components == 3 ? 8 : 2 * ((components + 1) & ~1);
+        default: // 8位和10:10:10:2都占4字节
+            return 4;
+    }
+}
+
+/**
+ * 往布局末尾添加一个属性，偏移和步长自动计算
+ * @return 属性太多或格式不能表示这个分量个数时返回false
+ */
+bool addVertexElement(VertexLayout* layout, GLint location, GLint components, VertexElementFormat format)
+{
+    if (layout->elementCount >= maxVertexElements || components < 1 || components > 4)
+    {
+        LOGE("Invalid vertex element (%d components)", components);
+        return false;
+    }
+    if (format == VERTEX_INT_2_10_10_10 && components > 3)
+    {
+        LOGE("10:10:10:2 format only holds 3 normalised components");
+        return false;
+    }
+    VertexElement& element = layout->elements[layout->elementCount++];
+    element.location = location;
+    element.components = components;
+    element.format = format;
+    element.offset = layout->stride;
+    element.bytes = elementBytes(components, format);
+    layout->stride += element.bytes;
+    return true;
+}
+
+// 属性在glVertexAttribPointer中对应的size、type和normalized参数
+void getVertexElementType(const VertexElement* element, GLint* size, GLenum* type, GLboolean* normalized)
+{
+    *size = element->components;
+    *normalized = GL_FALSE;
+    switch (element->format)
+    {
+        case VERTEX_FLOAT:
+            *type = GL_FLOAT;
+            break;
+        case VERTEX_HALF:
+            *type = GL_HALF_FLOAT;
+            break;
+        case VERTEX_SNORM8:
+            *type = GL_BYTE;
+            *normalized = GL_TRUE;
+            break;
+        case VERTEX_UNORM8:
+            *type = GL_UNSIGNED_BYTE;
+            *normalized = GL_TRUE;
+            break;
+        case VERTEX_INT_2_10_10_10: // 这种格式的size必须是4，第4个分量（2位）写的是0，着色器用vec3读取时会被忽略
+            *size = 4;
+            *type = GL_INT_2_10_10_10_REV;
+            *normalized = GL_TRUE;
+            break;
+    }
+}
+
+void setupVertexLayout(const VertexLayout* layout, const void* base)
+{
+    for (int i = 0; i < layout->elementCount; i++)
+    {
+        const VertexElement& element = layout->elements[i];
+        if (element.location < 0)
+        {
+            continue;
+        }
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        getVertexElementType(&element, &size, &type, &normalized);
+        cachedVertexAttribPointer(element.location, size, type, normalized, layout->stride, (const char*) base + element.offset);
+        cachedEnableVertexAttribArray(element.location);
+    }
+}
+
+// float转half，舍入到最近的偶数，超出范围的值变成无穷大
+unsigned short floatToHalf(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, 4);
+    unsigned int sign = (bits >> 16) & 0x8000;
+    int exponent = (int) ((bits >> 23) & 0xFF) - 127 + 15;
+    unsigned int mantissa = bits & 0x7FFFFF;
+    if (((bits >> 23) & 0xFF) == 0xFF) // NaN和无穷大
+    {
+        return (unsigned short) (sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+    if (exponent >= 31)
+    {
+        return (unsigned short) (sign | 0x7C00);
+    }
+    if (exponent <= 0) // 非规格化数或者0
+    {
+        if (exponent < -10)
+        {
+            return (unsigned short) sign;
+        }
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        unsigned int half = mantissa >> shift;
+        unsigned int remainder = mantissa & ((1u << shift) - 1);
+        unsigned int halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1)))
+        {
+            half++;
+        }
+        return (unsigned short) (sign | half);
+    }
+    unsigned int half = ((unsigned int) exponent << 10) | (mantissa >> 13);
+    unsigned int remainder = mantissa & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+        half++; // 进位可能让指数加1，正好得到正确结果（包括溢出成无穷大）
+    }
+    return (unsigned short) (sign | half);
+}
+
+float halfToFloat(unsigned short value)
+{
+    unsigned int sign = (unsigned int) (value & 0x8000) << 16;
+    unsigned int exponent = (value >> 10) & 0x1F;
+    unsigned int mantissa = value & 0x3FF;
+    unsigned int bits;
+    if (exponent == 0)
+    {
+        float result = ldexpf((float) mantissa, -24);
+        return sign ? -result : result;
+    }
+    if (exponent == 31)
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    float result;
+    memcpy(&result, &bits, 4);
+    return result;
+}
+
+static float clampUnit(float value, float low)
+{
+    return value < low ? low : value > 1.0f ? 1.0f : value;
+}
+
+void packVertices(const VertexLayout* layout, const float* const* sources, int vertexCount, void* output)
+{
+    unsigned char* vertex = (unsigned char*) output;
+    memset(output, 0, (size_t) layout->stride * vertexCount);
+    for (int v = 0; v < vertexCount; v++, vertex += layout->stride)
+    {
+        for (int e = 0; e < layout->elementCount; e++)
+        {
+            const VertexElement& element = layout->elements[e];
+            const float* source = sources[e] + (size_t) v * element.components;
+            unsigned char* destination = vertex + element.offset;
+            switch (element.format)
+            {
+                case VERTEX_FLOAT:
+                    memcpy(destination, source, 4 * element.components);
+                    break;
+                case VERTEX_HALF:
+                    for (int c = 0; c < element.components; c++)
+                    {
+                        unsigned short half = floatToHalf(source[c]);
+                        memcpy(destination + 2 * c, &half, 2);
+                    }
+                    break;
+                case VERTEX_SNORM8:
+                    for (int c = 0; c < element.components; c++)
+                    {
+                        destination[c] = (unsigned char) (signed char) lroundf(clampUnit(source[c], -1.0f) * 127.0f);
+                    }
+                    break;
+                case VERTEX_UNORM8:
+                    for (int c = 0; c < element.components; c++)
+                    {
+                        destination[c] = (unsigned char) lroundf(clampUnit(source[c], 0.0f) * 255.0f);
+                    }
+                    break;
+                case VERTEX_INT_2_10_10_10:
+                {
+                    unsigned int packed = 0;
+                    for (int c = 0; c < element.components; c++)
+                    {
+                        int value = (int) lroundf(clampUnit(source[c], -1.0f) * 511.0f);
+                        packed |= ((unsigned int) value & 0x3FF) << (10 * c);
+                    }
+                    memcpy(destination, &packed, 4);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// 解码规则与GLES3规范中归一化整数转浮点的规则一致：有符号时 max(c / (2^(b-1) - 1), -1)
+void unpackVertices(const VertexLayout* layout, const void* input, int vertexCount, float* const* destinations)
+{
+    const unsigned char* vertex = (const unsigned char*) input;
+    for (int v = 0; v < vertexCount; v++, vertex += layout->stride)
+    {
+        for (int e = 0; e < layout->elementCount; e++)
+        {
+            const VertexElement& element = layout->elements[e];
+            float* destination = destinations[e] + (size_t) v * element.components;
+            const unsigned char* source = vertex + element.offset;
+            for (int c = 0; c < element.components; c++)
+            {
+                switch (element.format)
+                {
+                    case VERTEX_FLOAT:
+                        memcpy(&destination[c], source + 4 * c, 4);
+                        break;
+                    case VERTEX_HALF:
+                    {
+                        unsigned short half;
+                        memcpy(&half, source + 2 * c, 2);
+                        destination[c] = halfToFloat(half);
+                        break;
+                    }
+                    case VERTEX_SNORM8:
+                        destination[c] = clampUnit((signed char) source[c] / 127.0f, -1.0f);
+                        break;
+                    case VERTEX_UNORM8:
+                        destination[c] = source[c] / 255.0f;
+                        break;
+                    case VERTEX_INT_2_10_10_10:
+                    {
+                        unsigned int packed;
+                        memcpy(&packed, source, 4);
+                        int value = (int) ((packed >> (10 * c)) & 0x3FF);
+                        value = value >= 512 ? value - 1024 : value; // 符号扩展
+                        destination[c] = clampUnit(value / 511.0f, -1.0f);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
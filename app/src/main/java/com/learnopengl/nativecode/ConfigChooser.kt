@@ -1,13 +1,14 @@
 package com.learnopengl.nativecode
 
 import android.opengl.EGL14
+import android.opengl.EGLExt
 import android.opengl.GLSurfaceView
 import javax.microedition.khronos.egl.EGL10
 import javax.microedition.khronos.egl.EGLConfig
 import javax.microedition.khronos.egl.EGLDisplay
 
 /**
- * 用于选择EGL配置
+ * 用于选择EGL配置，优先选择可以创建OpenGL ES 3.0上下文的配置，没有时退回2.0，结果记在contextVersion里供ContextFactory使用
  */
 class ConfigChooser: GLSurfaceView.EGLConfigChooser {
     companion object {
@@ -23,7 +24,24 @@ class ConfigChooser: GLSurfaceView.EGLConfigChooser {
     }
     private val value = IntArray(1) // 用于获取属性值
 
+    /**
+     * 选中的配置支持的OpenGL ES版本（3或2）
+     */
+    var contextVersion = 3
+        private set
+
     override fun chooseConfig(egl: EGL10, display: EGLDisplay): EGLConfig {
+        // 强制检查EGL_RENDERABLE_TYPE的驱动上，ES3上下文只能用带ES3_BIT的配置创建
+        chooseConfig(egl, display, EGLExt.EGL_OPENGL_ES3_BIT_KHR)?.let {
+            contextVersion = 3
+            return it
+        }
+        contextVersion = 2
+        return chooseConfig(egl, display, EGL14.EGL_OPENGL_ES2_BIT)
+            ?: throw IllegalArgumentException("No config chosen")
+    }
+
+    private fun chooseConfig(egl: EGL10, display: EGLDisplay, renderableType: Int): EGLConfig? {
         // 设置配置列表
         val configAttributes = intArrayOf(
             EGL10.EGL_RED_SIZE, redSize,
@@ -32,7 +50,7 @@ class ConfigChooser: GLSurfaceView.EGLConfigChooser {
             EGL10.EGL_ALPHA_SIZE, alphaSize,
             EGL10.EGL_DEPTH_SIZE, depthSize,
             EGL10.EGL_STENCIL_SIZE, stencilSize,
-            EGL10.EGL_RENDERABLE_TYPE, EGL14.EGL_OPENGL_ES2_BIT, // 选择OpenGL ES 2.0
+            EGL10.EGL_RENDERABLE_TYPE, renderableType, // 选择OpenGL ES 3.0或2.0
             EGL10.EGL_NONE // 表示属性列表结束
         )
         // 获取配置数量
@@ -46,10 +64,13 @@ class ConfigChooser: GLSurfaceView.EGLConfigChooser {
         )
         // 获取满足条件的配置列表
         val configsNumber = numConfig[0]
+        if (configsNumber <= 0) {
+            return null
+        }
 
         val configs = arrayOfNulls<EGLConfig?>(configsNumber)
         egl.eglChooseConfig(display, configAttributes, configs, configsNumber, numConfig)
-        return selectConfig(egl, display, configs) ?: throw IllegalArgumentException("No config chosen")
+        return selectConfig(egl, display, configs)
     }
 
 
@@ -9,15 +9,25 @@ import javax.microedition.khronos.egl.EGLDisplay
 
 /**
  * 用于创建和销毁EGLContext，指定OpenGL ES版本
+ *
+ * @param configChooser 选择配置时记下了配置支持的版本，只对支持ES3的配置请求ES3上下文
  */
-class ContextFactory: GLSurfaceView.EGLContextFactory {
+class ContextFactory(private val configChooser: ConfigChooser): GLSurfaceView.EGLContextFactory {
 
     override fun createContext(egl: EGL10, display: EGLDisplay?, config: EGLConfig?): EGLContext? {
-        val attrList = intArrayOf(
-            EGL_CONTEXT_CLIENT_VERSION, 2, // （OpenGL ES 版本）2.0
-            EGL10.EGL_NONE // EGL10.EGL_NONE表示数组结束
-        )
-        return egl.eglCreateContext(display, config, EGL10.EGL_NO_CONTEXT, attrList)
+        // 优先使用OpenGL ES 3.0（着色器程序二进制缓存等功能需要），配置或设备不支持时退回2.0
+        val versions = if (configChooser.contextVersion >= 3) intArrayOf(3, 2) else intArrayOf(2)
+        for (version in versions) {
+            val attrList = intArrayOf(
+                EGL_CONTEXT_CLIENT_VERSION, version, // OpenGL ES 版本
+                EGL10.EGL_NONE // EGL10.EGL_NONE表示数组结束
+            )
+            val context = egl.eglCreateContext(display, config, EGL10.EGL_NO_CONTEXT, attrList)
+            if (context != null && context != EGL10.EGL_NO_CONTEXT) {
+                return context
+            }
+        }
+        return EGL10.EGL_NO_CONTEXT
     }
 
 
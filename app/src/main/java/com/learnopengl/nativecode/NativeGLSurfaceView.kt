@@ -3,6 +3,7 @@ package com.learnopengl.nativecode
 import android.content.Context
 import android.opengl.GLSurfaceView
 import android.util.AttributeSet
+import java.io.File
 
 
 class NativeGLSurfaceView @JvmOverloads constructor(
@@ -10,10 +11,44 @@ class NativeGLSurfaceView @JvmOverloads constructor(
     attributeSet: AttributeSet? = null
 ): GLSurfaceView(context, attributeSet) {
 
+    private val renderer: NativeRender
+
     init {
-        setEGLContextFactory(ContextFactory())
-        setEGLConfigChooser(ConfigChooser())
-        setRenderer(NativeRender())
+        val configChooser = ConfigChooser()
+        setEGLContextFactory(ContextFactory(configChooser))
+        setEGLConfigChooser(configChooser)
+        // codeCacheDir在应用升级时会被系统清空，适合存放着色器程序二进制
+        val programCache = File(context.codeCacheDir, "programs").apply { mkdirs() }
+        // lesson3的纹理放在应用的files/textures目录下（例如用adb push），文件不存在时只显示内置纹理
+        val textures = File(context.filesDir, "textures")
+        val texture = File(textures, "texture.ktx2")
+        val textureFallback = File(textures, "texture-rgba8.ktx2")
+        renderer = NativeRender(
+            programCache.absolutePath,
+            if (texture.exists()) texture.absolutePath else "",
+            if (textureFallback.exists()) textureFallback.absolutePath else ""
+        )
+        setRenderer(renderer)
+    }
+
+    override fun onPause() {
+        super.onPause()
+        renderer.setSimulationPaused(true) // 不可见时停止更新场景
+    }
+
+    override fun onResume() {
+        super.onResume()
+        renderer.setSimulationPaused(false)
+    }
+
+    /**
+     * 切换显示的课程，只有选中的课程的库会被加载
+     */
+    fun selectScene(name: String) {
+        renderer.selectScene(name)
     }
 
+    val sceneNames: Array<String>
+        get() = renderer.getSceneNames()
+
 }
\ No newline at end of file
@@ -4,7 +4,16 @@ import android.opengl.GLSurfaceView
 import javax.microedition.khronos.egl.EGLConfig
 import javax.microedition.khronos.opengles.GL10
 
-class NativeRender: GLSurfaceView.Renderer {
+/**
+ * @param cacheDirectory 着色器程序二进制缓存目录
+ * @param textureFile lesson3流式加载的KTX/KTX2纹理，空字符串时只用内置纹理
+ * @param textureFallbackFile 设备不支持textureFile的压缩格式时改用的RGBA8纹理，可以为空
+ */
+class NativeRender(
+    private val cacheDirectory: String,
+    private val textureFile: String = "",
+    private val textureFallbackFile: String = ""
+): GLSurfaceView.Renderer {
 
     companion object {
         init {
@@ -17,8 +26,31 @@ class NativeRender: GLSurfaceView.Renderer {
 
     external fun setup()
 
-    override fun onSurfaceCreated(gl: GL10?, config: EGLConfig?) {
+    external fun setCacheDirectory(path: String)
+
+    external fun setTextureFile(path: String, fallbackPath: String)
+
+    external fun setSimulationPaused(paused: Boolean)
+
+    /**
+     * 切换要显示的场景（课程），可以在任意线程调用，渲染线程在下一帧释放当前场景并加载新的，默认为"Light"
+     */
+    external fun selectScene(name: String)
 
+    /**
+     * 所有可以选择的场景名
+     */
+    external fun getSceneNames(): Array<String>
+
+    /**
+     * 最近240帧的帧时间（毫秒），可以在任意线程调用：
+     * [帧数, GPU计时是否可用(0/1), 然后清屏、矩阵、状态、绘制、整帧CPU、GPU各自的p50、p95、p99]
+     */
+    external fun getFrameProfile(): FloatArray
+
+    override fun onSurfaceCreated(gl: GL10?, config: EGLConfig?) {
+        setCacheDirectory(cacheDirectory)
+        setTextureFile(textureFile, textureFallbackFile)
     }
 
     override fun onSurfaceChanged(gl: GL10?, width: Int, height: Int) {